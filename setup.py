@@ -14,15 +14,22 @@ sources = ["src/system/utility.cc",
            "src/interface/multistrand_module.cc",
            "src/interface/optionlists.cc",
            "src/interface/options.cc",
+           "src/interface/resultbuffer.cc",
            "src/loop/move.cc",
            "src/loop/moveutil.cc",
            "src/loop/loop.cc",
            "src/system/energyoptions.cc",
            "src/energymodel/nupackenergymodel.cc",
            "src/energymodel/energymodel.cc",
+           "src/energymodel/parametercache.cc",
+           "src/energymodel/energyseries.cc",
            "src/state/scomplex.cc",
            "src/state/scomplexlist.cc",
            "src/system/statespace.cc",
+           "src/system/trajectoryfile.cc",
+           "src/system/jobfile.cc",
+           "src/system/phasestats.cc",
+           "src/system/mempool.cc",
            "src/system/simoptions.cc",
            "src/system/ssystem.cc",
            "src/state/strandordering.cc"
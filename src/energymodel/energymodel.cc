@@ -10,9 +10,13 @@
 #include "moveutil.h"
 #include "sequtil.h"
 #include "options.h"
+#include "mempool.h"
+#include "phasestats.h"
 
 #include <iostream>
 #include <fstream>
+#include <limits>
+#include <algorithm>
 
 bool printedRates = false; // to print the constants to file once
 
@@ -27,14 +31,19 @@ EnergyModel::EnergyModel(void) {
 	// nothing yet either
 }
 
-EnergyModel::~EnergyModel(void) {
-	// nothing
-}
+EnergyModel::EnergyModel(const EnergyModel& other) :
+		simOptions(other.simOptions), numActiveNT(other.numActiveNT), inspection(other.inspection), dangles(other.dangles),
+		arrhenius(other.arrhenius), current_temp(other.current_temp) {
+
+	paramFiles[0] = other.paramFiles[0];
+	paramFiles[1] = other.paramFiles[1];
 
-// Return state of the energyOption toggle
-bool EnergyModel::useArrhenius(void) {
+	std::copy(other.arrheniusRates, other.arrheniusRates + MOVETYPE_SIZE * MOVETYPE_SIZE, arrheniusRates);
+	std::copy(other.contextJoinRates, other.contextJoinRates + HALFCONTEXT_COUNT * HALFCONTEXT_COUNT, contextJoinRates);
 
-	return simOptions->energyOptions->usingArrhenius();
+}
+
+EnergyModel::~EnergyModel(void) {
 
 }
 
@@ -205,19 +214,26 @@ double EnergyModel::fastestUniRate(void) {
 
 }
 
-double EnergyModel::applyPrefactors(double tempRate, MoveType left, MoveType right) {
+// Tabulates applyPrefactors(getJoinRate(), ..) for every pair of half-contexts,
+// so that bimolecular rates are a table lookup. Call again when the join rate,
+// the Arrhenius rates or the inspection flag change.
+void EnergyModel::computeContextJoinRates(void) {
 
-	if (inspection) {
-		return 1.0;
-	}
+	for (int i = 0; i < HALFCONTEXT_COUNT; i++) {
 
-	if (useArrhenius()) {
+		HalfContext top = HalfContext::fromIndex(i);
 
-		return tempRate * arrheniusRates[left * MOVETYPE_SIZE + right];
+		for (int j = 0; j < HALFCONTEXT_COUNT; j++) {
 
-	} else {
+			HalfContext bot = HalfContext::fromIndex(j);
+
+			MoveType left = moveutil::combineBi(top.left, bot.right);
+			MoveType right = moveutil::combineBi(top.right, bot.left);
+
+			contextJoinRates[i * HALFCONTEXT_COUNT + j] = applyPrefactors(getJoinRate(), left, right);
+
+		}
 
-		return tempRate;
 	}
 
 }
@@ -333,20 +349,6 @@ MoveType EnergyModel::prefactorOpen(int index, int numOfSides, int sideLengths[]
 
 }
 
-double EnergyModel::singleStrandedStacking(char* sequence, int length) {
-
-	if (simOptions->energyOptions->usingArrhenius() && length > 4) {
-
-		return arrheniusLoopEnergy(sequence, length);
-
-	} else {
-
-		return 0.0;
-
-	}
-
-}
-
 // FD: April 28 2017
 // FD: Adding initialization penalty when side length is zero, and
 // Fd: only when there is an extension (single stranded or stack) on either side.
@@ -382,6 +384,338 @@ double EnergyModel::initializationPenalty(int length, int loop, int size) {
 
 }
 
+// The penalty for a side between two pairs, see above.
+double EnergyModel::initializationPenalty(int length) {
+
+	if (length == 0) {
+		return INIT_PENALTY;
+	}
+
+	if (length == 1) {
+		return (INIT_PENALTY / 2.0);
+	}
+
+	return 0.0;
+
+}
+
+double EnergyModel::CachedHairpinEnergy(char *seq, int size) {
+
+	char* start;
+	StrandTable* table = findStrand(seq, seq + size + 1, &start);
+
+	if (table == NULL) {
+		return HairpinEnergy(seq, size);
+	}
+
+	int i = seq - start;
+	return table->hairpinEnergy(i, i + size + 1);
+
+}
+
+thread_local StrandRegistry* EnergyModel::workerStrands = NULL;
+
+void EnergyModel::useWorkerStrands(StrandRegistry* strands) {
+
+	workerStrands = strands;
+
+}
+
+StrandRegistry& EnergyModel::registry(void) {
+
+	StrandRegistry* strands = workerStrands;
+
+	if (strands != NULL && strands->model == this) {
+		return *strands;
+	}
+
+	return ownStrands;
+
+}
+
+StrandTable* EnergyModel::findStrand(char *first, char *last, char **start) {
+
+	StrandRegistry& strands = registry();
+
+	if (strands.lastTable == NULL || first < strands.lastStrand || last >= strands.lastStrand + strands.lastTable->length) {
+
+		std::map<char*, StrandTable*>::iterator it = strands.live.upper_bound(first);
+
+		if (it == strands.live.begin()) {
+			return NULL;
+		}
+
+		--it;
+
+		if (last >= it->first + it->second->length) {
+			return NULL;
+		}
+
+		strands.lastStrand = it->first;
+		strands.lastTable = it->second;
+
+	}
+
+	*start = strands.lastStrand;
+	return strands.lastTable;
+
+}
+
+StrandTable* EnergyModel::addStrand(char *codeSeq, int size) {
+
+	StrandRegistry& strands = registry();
+	StrandTable*& table = strands.tables[string(codeSeq, size)];
+
+	if (table == NULL) {
+		table = new StrandTable(this, codeSeq, size);
+	}
+
+	table->users++;
+	strands.live[codeSeq] = table;
+
+	return table;
+
+}
+
+void EnergyModel::removeStrand(char *codeSeq, StrandTable* table) {
+
+	StrandRegistry& strands = registry();
+
+	strands.live.erase(codeSeq);
+	table->users--;
+
+	if (strands.lastStrand == codeSeq) {
+		strands.lastStrand = NULL;
+		strands.lastTable = NULL;
+	}
+
+}
+
+// Deletes the tables that no live strand uses.
+void EnergyModel::trimStrandTables(void) {
+
+	StrandRegistry& strands = registry();
+	std::map<string, StrandTable*>::iterator it = strands.tables.begin();
+
+	while (it != strands.tables.end()) {
+
+		if (it->second->users == 0) {
+			delete it->second;
+			strands.tables.erase(it++);
+		} else {
+			++it;
+		}
+	}
+
+}
+
+StrandRegistry::~StrandRegistry(void) {
+
+	for (std::map<string, StrandTable*>::iterator it = tables.begin(); it != tables.end(); ++it) {
+		delete it->second;
+	}
+
+}
+
+StrandTable::StrandTable(EnergyModel* em, char* codeSeq, int size) :
+		model(em), length(size), sequence(codeSeq, size) {
+
+	if (size <= HAIRPIN_TABLE_MAX_LENGTH) {
+		rows.assign(size, (double*) NULL);
+	}
+
+	int words = size / PARTNER_WORD_BITS + 1;
+
+	for (int base = 1; base < 5; base++) {
+
+		partnerBits[base].assign(words, 0);
+
+		for (int j = 0; j < size; j++) {
+			if (pairtypes[base][(int) codeSeq[j]] != 0) {
+				partnerBits[base][j / PARTNER_WORD_BITS] |= 1ULL << (j % PARTNER_WORD_BITS);
+			}
+		}
+	}
+
+}
+
+StrandTable::~StrandTable(void) {
+
+	for (size_t i = 0; i < rows.size(); i++) {
+		MemPool::deleteArray(rows[i]);
+	}
+
+}
+
+// row i holds the hairpins closed by i and j, for j = i + 1 .. length - 1.
+double* StrandTable::fillRow(int i) {
+
+	int count = length - i - 1;
+	double* row = MemPool::newArray<double>(count);
+
+	for (int k = 0; k < count; k++) {
+		row[k] = std::numeric_limits<double>::quiet_NaN();
+	}
+
+	rows[i] = row;
+	return row;
+
+}
+
+// The terms, and every loop energy made from them, are counted as the energy of a
+// multiloop or open loop, as MultiloopEnergy and OpenloopEnergy would be.
+LoopTerms::LoopTerms(EnergyModel* em, bool isOpen, int size, int* lengths, char** sequences) {
+
+	PhaseTimer phase(isOpen ? PHASE_ENERGY_OPENLOOP : PHASE_ENERGY_MULTILOOP);
+
+	model = em;
+	open = isOpen;
+	sidelen = lengths;
+	seqs = sequences;
+	sides = open ? size + 1 : size;
+
+	sideSum = MemPool::newArray<double>(sides + 1);
+	pairSum = MemPool::newArray<double>(size + 1);
+	lengthPrefix = MemPool::newArray<int>(sides + 1);
+
+	sideSum[0] = 0.0;
+	pairSum[0] = 0.0;
+	lengthPrefix[0] = 0;
+
+	for (int k = 0; k < sides; k++) {
+
+		double term = 0.0;
+
+		// an open loop without pairs has no energy.
+		if (!open) {
+
+			char prevPartner = seqs[(k + sides - 1) % sides][sidelen[(k + sides - 1) % sides] + 1];
+			term = model->LoopSideEnergy(seqs[k], sidelen[k], prevPartner, seqs[(k + 1) % sides][0], (k == 0) ? sideFirst : sideInner);
+
+		} else if (size > 0) {
+
+			if (k == 0) {
+				term = model->LoopSideEnergy(seqs[k], sidelen[k], 0, seqs[k + 1][0], sideOpenFirst);
+			} else if (k == size) {
+				term = model->LoopSideEnergy(seqs[k], sidelen[k], seqs[k - 1][sidelen[k - 1] + 1], 0, sideOpenLast);
+			} else {
+				term = model->LoopSideEnergy(seqs[k], sidelen[k], seqs[k - 1][sidelen[k - 1] + 1], seqs[k + 1][0], sideInner);
+			}
+		}
+
+		sideSum[k + 1] = sideSum[k] + term;
+		lengthPrefix[k + 1] = lengthPrefix[k] + sidelen[k];
+
+	}
+
+	// pair k joins side k to the next one.
+	for (int k = 0; k < size; k++) {
+		pairSum[k + 1] = pairSum[k] + model->LoopPairEnergy(seqs[k][sidelen[k] + 1], seqs[(k + 1) % sides][0]);
+	}
+
+}
+
+LoopTerms::~LoopTerms(void) {
+
+	MemPool::deleteArray(sideSum);
+	MemPool::deleteArray(pairSum);
+	MemPool::deleteArray(lengthPrefix);
+
+}
+
+// the sum of length terms from index from onwards, wrapping around at count.
+double LoopTerms::rangeSum(double* prefix, int count, int from, int length) {
+
+	if (length <= 0)
+		return 0.0;
+
+	if (from + length <= count)
+		return prefix[from + length] - prefix[from];
+
+	return (prefix[count] - prefix[from]) + prefix[from + length - count];
+
+}
+
+int LoopTerms::lengthSum(int from, int length) {
+
+	if (length <= 0)
+		return 0;
+
+	if (from + length <= sides)
+		return lengthPrefix[from + length] - lengthPrefix[from];
+
+	return (lengthPrefix[sides] - lengthPrefix[from]) + lengthPrefix[from + length - sides];
+
+}
+
+double LoopTerms::outerEnergy(int first, int a, int last, int b) {
+
+	PhaseTimer phase(open ? PHASE_ENERGY_OPENLOOP : PHASE_ENERGY_MULTILOOP);
+
+	int pairs = open ? sides - 1 : sides;
+	int removed = (last - first + sides) % sides; // the pairs first..last-1 close off the inner loop
+	int kept = sides - removed - 1; // the sides after last, up to first
+
+	char left = seqs[first][a];
+	char right = seqs[last][b];
+
+	char prevPartner = 0, nextPartner = 0;
+	SideRole leftRole = sideInner, rightRole = sideInner;
+
+	if (!(open && first == 0)) {
+		int prev = (first + sides - 1) % sides;
+		prevPartner = seqs[prev][sidelen[prev] + 1];
+	}
+
+	if (!(open && last == sides - 1)) {
+		nextPartner = seqs[(last + 1) % sides][0];
+	}
+
+	if (open) {
+		leftRole = (first == 0) ? sideOpenFirst : sideInner;
+		rightRole = (last == sides - 1) ? sideOpenLast : sideInner;
+	} else {
+		leftRole = (first == 0) ? sideFirst : sideInner;
+		rightRole = (last == 0 && first != 0) ? sideFirst : sideInner;
+	}
+
+	double energy = rangeSum(pairSum, pairs, last, pairs - removed);
+	energy += model->LoopPairEnergy(left, right);
+	energy += rangeSum(sideSum, sides, last + 1, kept);
+	energy += model->LoopSideEnergy(seqs[first], a - 1, prevPartner, right, leftRole);
+	energy += model->LoopSideEnergy(seqs[last] + b, sidelen[last] - b, left, nextPartner, rightRole);
+
+	if (!open) {
+		int length = lengthSum(last + 1, kept) + (a - 1) + (sidelen[last] - b);
+		energy += model->MultiloopBaseEnergy(kept + 2, length);
+	}
+
+	return energy;
+
+}
+
+double LoopTerms::innerEnergy(int first, int a, int last, int b) {
+
+	PhaseTimer phase(PHASE_ENERGY_MULTILOOP);
+
+	int pairs = open ? sides - 1 : sides;
+
+	char left = seqs[first][a];
+	char right = seqs[last][b];
+
+	double energy = rangeSum(pairSum, pairs, first, last - first);
+	energy += model->LoopPairEnergy(right, left);
+	energy += rangeSum(sideSum, sides, first + 1, last - first - 1);
+	energy += model->LoopSideEnergy(seqs[first] + a, sidelen[first] - a, right, seqs[first + 1][0], sideFirst);
+	energy += model->LoopSideEnergy(seqs[last], b - 1, seqs[last - 1][sidelen[last - 1] + 1], left, sideInner);
+
+	int length = lengthSum(first + 1, last - first - 1) + (sidelen[first] - a) + (b - 1);
+	energy += model->MultiloopBaseEnergy(last - first + 1, length);
+
+	return energy;
+
+}
+
 double EnergyModel::arrheniusLoopEnergy(char* seq, int length) {
 
 	double output = 0.0;
@@ -393,7 +727,7 @@ double EnergyModel::arrheniusLoopEnergy(char* seq, int length) {
 		switch (myMult) {
 
 		case baseA * baseA:
-			output += (simOptions->energyOptions->dHA - simOptions->energyOptions->getTemperature() * (simOptions->energyOptions->dSA / 1000.0));
+			output += (simOptions->energyOptions->dHA - current_temp * (simOptions->energyOptions->dSA / 1000.0));
 			break;
 		}
 
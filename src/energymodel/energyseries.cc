@@ -0,0 +1,148 @@
+/*
+ Copyright (c) 2017 California Institute of Technology. All rights reserved.
+ Multistrand nucleic acid kinetic simulator
+ help@multistrand.org
+ */
+
+#include "energyseries.h"
+
+#include <math.h>
+
+// how far, in kcal/mol relative to the energy, the middle temperature may be off the
+// line for a loop to count as linear.
+const double LINEAR_TOLERANCE = 1e-9;
+
+EnergySeries::EnergySeries(NupackEnergyModel* model, const std::vector<double>& temps) :
+		base(model), temperatures(temps), models(temps.size(), (NupackEnergyModel*) NULL), low(0), high(0), middle(-1) {
+
+	int count = temperatures.size();
+
+	if (count == 0) {
+		return;
+	}
+
+	for (int i = 0; i < count; i++) {
+
+		if (temperatures[i] < temperatures[low])
+			low = i;
+		if (temperatures[i] > temperatures[high])
+			high = i;
+
+	}
+
+	// strictly between, and the closest to the centre.
+	double centre = 0.5 * (temperatures[low] + temperatures[high]);
+
+	for (int i = 0; i < count; i++) {
+
+		if (temperatures[low] < temperatures[i] && temperatures[i] < temperatures[high]
+				&& (middle < 0 || fabs(temperatures[i] - centre) < fabs(temperatures[middle] - centre))) {
+			middle = i;
+		}
+
+	}
+
+}
+
+EnergySeries::~EnergySeries(void) {
+
+	for (NupackEnergyModel* model : models) {
+		delete model;
+	}
+
+}
+
+// a temperature that appears more than once has one model, at its first index.
+EnergyModel* EnergySeries::model(int index) {
+
+	if (temperatures[index] == base->getTemperature()) {
+		return base;
+	}
+
+	for (int i = 0; i < index; i++) {
+		if (temperatures[i] == temperatures[index]) {
+			index = i;
+			break;
+		}
+	}
+
+	if (models[index] == NULL) {
+		models[index] = base->atTemperature(temperatures[index]);
+	}
+
+	return models[index];
+
+}
+
+void EnergySeries::addComplex(StrandComplex* complex, int volumeFlag, double* energies) {
+
+	int count = temperatures.size();
+
+	if (count == 0) {
+		return;
+	}
+
+	loops.clear();
+	complex->getLoops(loops);
+
+	// the loops that are linear in the temperature, summed: their energy at the lowest
+	// temperature, and its change per Kelvin, -dS.
+	double lowEnergy = 0.0;
+	double perKelvin = 0.0;
+
+	for (Loop* loop : loops) {
+
+		if (middle >= 0) {
+
+			double first = loop->getEnergy(model(low));
+			double last = loop->getEnergy(model(high));
+			double centre = loop->getEnergy(model(middle));
+
+			double slope = (last - first) / (temperatures[high] - temperatures[low]);
+			double line = first + slope * (temperatures[middle] - temperatures[low]);
+
+			if (fabs(centre - line) <= LINEAR_TOLERANCE * (1.0 + fabs(centre))) {
+
+				lowEnergy += first;
+				perKelvin += slope;
+				linearLoops++;
+				continue;
+
+			}
+		}
+
+		for (int i = 0; i < count; i++) {
+			energies[i] += loop->getEnergy(model(i));
+		}
+
+		evaluatedLoops++;
+
+	}
+
+	for (int i = 0; i < count; i++) {
+		energies[i] += lowEnergy + perKelvin * (temperatures[i] - temperatures[low]);
+	}
+
+	int joins = complex->getStrandCount() - 1;
+
+	if (joins == 0 || !(volumeFlag & 0x03)) {
+		return;
+	}
+
+	// dG_volume is RT log(1 / concentration) and dG_assoc a parameter: both are linear.
+	EnergyModel* first = model(low);
+	EnergyModel* last = model(high);
+	double span = temperatures[high] - temperatures[low];
+
+	for (int i = 0; i < count; i++) {
+
+		double ratio = (span > 0.0) ? (temperatures[i] - temperatures[low]) / span : 0.0;
+
+		if (volumeFlag & 0x01)
+			energies[i] += joins * (first->getVolumeEnergy() + ratio * (last->getVolumeEnergy() - first->getVolumeEnergy()));
+		if (volumeFlag & 0x02)
+			energies[i] += joins * (first->getAssocEnergy() + ratio * (last->getAssocEnergy() - first->getAssocEnergy()));
+
+	}
+
+}
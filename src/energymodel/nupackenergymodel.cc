@@ -12,6 +12,10 @@
 
 #include "simoptions.h"
 #include "options.h"
+#include "phasestats.h"
+#include "parametercache.h"
+
+#include <memory>
 
 #undef DEBUG
 //#define DEBUG
@@ -23,6 +27,22 @@ static double T_scale(double dG, double dH, double T) {
 
 }
 
+// Tables scaled to one temperature, to another at ratio times that: dG - dH, the
+// -T dS term (with the salt correction of the stacks), is proportional to T.
+template<typename Table>
+static void T_rescale(Table& dG, const Table& dH, double ratio) {
+
+	static_assert(sizeof(Table) % sizeof(double) == 0, "the tables hold doubles only");
+
+	double* g = (double*) &dG;
+	const double* h = (const double*) &dH;
+
+	for (size_t i = 0; i < sizeof(Table) / sizeof(double); i++) {
+		g[i] = h[i] + ratio * (g[i] - h[i]);
+	}
+
+}
+
 const double CELSIUS37_IN_KELVIN = 310.15;
 const double TEMPERATURE_ZERO_CELSIUS_IN_KELVIN = 273.15;
 
@@ -40,6 +60,21 @@ extern int baseLookup(char base);
 
 double NupackEnergyModel::returnRate(double start_energy, double end_energy, int enth_entr_toggle) {
 
+	if (kinetic_rate_method == RATE_METHOD_KAWASAKI) {
+		return rate<RATE_METHOD_KAWASAKI>(start_energy, end_energy, enth_entr_toggle);
+	} else if (kinetic_rate_method == RATE_METHOD_METROPOLIS or RATE_METHOD_ARRHENIUS == kinetic_rate_method) {
+		return rate<RATE_METHOD_METROPOLIS>(start_energy, end_energy, enth_entr_toggle);
+	}
+
+	return -9999.99;
+
+}
+
+// returnRate for one rate method; the Arrhenius prefactors are applied to the
+// Metropolis rate afterwards, see applyPrefactors.
+template<int RateMethod>
+double NupackEnergyModel::rate(double start_energy, double end_energy, int enth_entr_toggle) {
+
 	if (inspection) {
 		return 1.0;
 	}
@@ -51,22 +86,20 @@ double NupackEnergyModel::returnRate(double start_energy, double end_energy, int
 	}
 	// dG_assoc, if it were included in (start_energy, end_energy), would need to be deleted here. However, it never gets added into any energies except for display purposes. So it gets used in the join move rate, but not here.
 	// OLD: dG_assoc is typically a negative number, and included as part of the complex before disassociation. Thus it must be subtracted from the dE (leading to a typically slower disassociation rate.).
-	if (kinetic_rate_method == RATE_METHOD_KAWASAKI) {  // Kawasaki
+	if (RateMethod == RATE_METHOD_KAWASAKI) {  // Kawasaki
 
-		return uniscale * exp(-0.5 * dE / _RT);
+		return uniscale * rateExp(dE, -0.5 * dE / _RT);
 
-	} else if (kinetic_rate_method == RATE_METHOD_METROPOLIS or RATE_METHOD_ARRHENIUS == kinetic_rate_method) {
+	} else {
 		// Metropolis
 		if (dE < 0) {
 			return uniscale * 1.0;
 		} else {
-			return uniscale * exp(-dE / _RT);
+			return uniscale * rateExp(dE, -dE / _RT);
 		}
 
 	}
 
-	return -9999.99;
-
 }
 
 double NupackEnergyModel::getJoinRate(void) {
@@ -99,6 +132,7 @@ double NupackEnergyModel::getAssocEnergy(void) {
 // non entropy/enthalpy energy functions
 double NupackEnergyModel::StackEnergy(int i, int j, int p, int q) {
 
+	PhaseTimer phase(PHASE_ENERGY_STACK);
 	return stack_37_dG[pairtypes[i][j] - 1][pairtypes[p][q] - 1];
 
 }
@@ -112,6 +146,7 @@ double NupackEnergyModel::StackEnthalpy(int i, int j, int p, int q) {
 
 double NupackEnergyModel::BulgeEnergy(int i, int j, int p, int q, int bulgesize) {
 
+	PhaseTimer phase(PHASE_ENERGY_BULGE);
 	return this->BulgeEnergy(i, j, p, q, bulgesize, bulge_37_dG, stack_37_dG);
 
 }
@@ -121,8 +156,8 @@ double NupackEnergyModel::BulgeEnthalpy(int i, int j, int p, int q, int bulgesiz
 	return this->BulgeEnergy(i, j, p, q, bulgesize, bulge_37_dH, stack_37_dH);
 }
 
-double NupackEnergyModel::BulgeEnergy(int i, int j, int p, int q, int bulgesize, array<double, 31> bulge,
-		array<array<double, PAIRS_NUPACK>, PAIRS_NUPACK> stack) {
+double NupackEnergyModel::BulgeEnergy(int i, int j, int p, int q, int bulgesize, const array<double, 31>& bulge,
+		const array<array<double, PAIRS_NUPACK>, PAIRS_NUPACK>& stack) {
 
 	double energy = 0.0;
 
@@ -132,7 +167,7 @@ double NupackEnergyModel::BulgeEnergy(int i, int j, int p, int q, int bulgesize,
 
 	} else {
 
-		energy = bulge[30] + (log((double) bulgesize / 30.0) * log_loop_penalty / 100.0);
+		energy = bulge[30] + logLoopPenalty30(bulgesize);
 
 	}
 
@@ -154,6 +189,7 @@ double NupackEnergyModel::BulgeEnergy(int i, int j, int p, int q, int bulgesize,
 
 double NupackEnergyModel::InteriorEnergy(char *seq1, char *seq2, int size1, int size2) {
 
+	PhaseTimer phase(PHASE_ENERGY_INTERIOR);
 	return this->InteriorEnergy(seq1, seq2, size1, size2, internal_dG);
 
 }
@@ -189,7 +225,7 @@ double NupackEnergyModel::InteriorEnergy(char *seq1, char *seq2, int size1, int
 	if (size1 + size2 <= 30) {
 		energy = internal.basic[size1 + size2];
 	} else {
-		energy = internal.basic[30] + (log((double) (size1 + size2) / 30.0) * log_loop_penalty / 100.0);
+		energy = internal.basic[30] + logLoopPenalty30(size1 + size2);
 	}
 
 	// NINIO term...
@@ -227,6 +263,7 @@ double NupackEnergyModel::InteriorEnergy(char *seq1, char *seq2, int size1, int
 
 double NupackEnergyModel::HairpinEnergy(char *seq, int size) {
 
+	PhaseTimer phase(PHASE_ENERGY_HAIRPIN);
 	return HairpinEnergy(seq, size, hairpin_dG);
 
 }
@@ -246,7 +283,7 @@ double NupackEnergyModel::HairpinEnergy(char *seq, int size, hairpin_energies& h
 		energy = hairpin.basic[size];
 	} else {
 		energy = hairpin.basic[30];
-		energy += (log((double) size / 30.0) * log_loop_penalty / 100.0);
+		energy += logLoopPenalty30(size);
 
 	}
 
@@ -279,6 +316,7 @@ double NupackEnergyModel::HairpinEnergy(char *seq, int size, hairpin_energies& h
 
 double NupackEnergyModel::MultiloopEnergy(int size, int *sidelen, char **sequences) {
 
+	PhaseTimer phase(PHASE_ENERGY_MULTILOOP);
 	return MultiloopEnergy(size, sidelen, sequences, multiloop_dG);
 
 }
@@ -291,6 +329,19 @@ double NupackEnergyModel::MultiloopEnthalpy(int size, int *sidelen, char **seque
 
 double NupackEnergyModel::MultiloopEnergy(int size, int *sidelen, char **sequences, multiloop_energies& multiloop) {
 
+	if (dangles == DANGLES_NONE) {
+		return multiloopEnergy<DANGLES_NONE>(size, sidelen, sequences, multiloop);
+	} else if (dangles == DANGLES_SOME) {
+		return multiloopEnergy<DANGLES_SOME>(size, sidelen, sequences, multiloop);
+	}
+
+	return multiloopEnergy<DANGLES_ALL>(size, sidelen, sequences, multiloop);
+
+}
+
+template<int Dangles>
+double NupackEnergyModel::multiloopEnergy(int size, int *sidelen, char **sequences, multiloop_energies& multiloop) {
+
 	// no dangle terms yet, this is equiv to dangles = 0;
 	int totallength = 0;
 	double energy = 0.0, dangle3, dangle5;
@@ -334,10 +385,10 @@ double NupackEnergyModel::MultiloopEnergy(int size, int *sidelen, char **sequenc
 	} else if (totallength <= 6) {
 		energy += multiloop.base * totallength;
 	} else {
-		energy += multiloop.base * 6 + (log((double) totallength / 6.0) * log_loop_penalty / 100.0);
+		energy += multiloop.base * 6 + logLoopPenalty6(totallength);
 	}
 
-	if (dangles == DANGLES_NONE) {
+	if (Dangles == DANGLES_NONE) {
 
 		return energy;
 
@@ -350,12 +401,12 @@ double NupackEnergyModel::MultiloopEnergy(int size, int *sidelen, char **sequenc
 
 			rt_pt = pairtypes[sequences[loop][0]][sequences[loopminus1][sidelen[loopminus1] + 1]] - 1;
 
-			if (!(dangles == DANGLES_SOME && sidelen[loopminus1] == 0)) {
+			if (!(Dangles == DANGLES_SOME && sidelen[loopminus1] == 0)) {
 
 				dangle5 = multiloop.dangle_5[pt][sequences[loopminus1][1]];
 				dangle3 = multiloop.dangle_3[rt_pt][sequences[loopminus1][sidelen[loopminus1]]];
 
-				if (dangles == DANGLES_SOME && sidelen[loopminus1] == 1) {
+				if (Dangles == DANGLES_SOME && sidelen[loopminus1] == 1) {
 					energy += ((dangle3 < dangle5) ? dangle3 : dangle5); // minimum of two terms.
 
 				} else {
@@ -377,6 +428,7 @@ double NupackEnergyModel::MultiloopEnergy(int size, int *sidelen, char **sequenc
 
 double NupackEnergyModel::OpenloopEnergy(int size, int *sidelen, char **sequences) {
 
+	PhaseTimer phase(PHASE_ENERGY_OPENLOOP);
 	return OpenloopEnergy(size, sidelen, sequences, multiloop_dG);
 
 }
@@ -389,6 +441,19 @@ double NupackEnergyModel::OpenloopEnthalpy(int size, int *sidelen, char **sequen
 
 double NupackEnergyModel::OpenloopEnergy(int size, int *sidelen, char **sequences, multiloop_energies& multiloop) {
 
+	if (dangles == DANGLES_NONE) {
+		return openloopEnergy<DANGLES_NONE>(size, sidelen, sequences, multiloop);
+	} else if (dangles == DANGLES_SOME) {
+		return openloopEnergy<DANGLES_SOME>(size, sidelen, sequences, multiloop);
+	}
+
+	return openloopEnergy<DANGLES_ALL>(size, sidelen, sequences, multiloop);
+
+}
+
+template<int Dangles>
+double NupackEnergyModel::openloopEnergy(int size, int *sidelen, char **sequences, multiloop_energies& multiloop) {
+
 	if (debugTraces) {
 		cout << "Computing OpenLoopEnergy, size = " << size << endl;
 	}
@@ -419,7 +484,7 @@ double NupackEnergyModel::OpenloopEnergy(int size, int *sidelen, char **sequence
 		cout << "Mid OpenLoop -- Energy is now " << energy << endl;
 	}
 
-	if (dangles == DANGLES_NONE || size == 0) {
+	if (Dangles == DANGLES_NONE || size == 0) {
 		return energy;
 	} else {
 
@@ -444,9 +509,9 @@ double NupackEnergyModel::OpenloopEnergy(int size, int *sidelen, char **sequence
 			rt_pt = pairtypes[sequences[loop + 2][0]][sequences[loop + 1][sidelen[loop + 1] + 1]] - 1;
 			dangle5 = multiloop.dangle_5[pt][sequences[loop + 1][1]];
 			dangle3 = multiloop.dangle_3[rt_pt][sequences[loop + 1][sidelen[loop + 1]]];
-			if (dangles == DANGLES_SOME && sidelen[loop + 1] == 1) {
+			if (Dangles == DANGLES_SOME && sidelen[loop + 1] == 1) {
 				energy += (dangle3 < dangle5 ? dangle3 : dangle5); // minimum of the two terms.
-			} else if (dangles == DANGLES_SOME && sidelen[loop + 1] == 0) {
+			} else if (Dangles == DANGLES_SOME && sidelen[loop + 1] == 0) {
 				energy += 0.0; // dangles=DANGLES_SOME has no stacking when 0 bases between.
 							   // dangles=DANGLES_ALL, however, does. Weird, eh?
 			} else {
@@ -477,11 +542,106 @@ double NupackEnergyModel::OpenloopEnergy(int size, int *sidelen, char **sequence
 	return energy;
 }
 
+// The terminal penalties of the pair between a side ending in first and the next side, starting in second.
+double NupackEnergyModel::LoopPairEnergy(char first, char second) {
+
+	double energy = 0.0;
+	int pt = pairtypes[first][second] - 1;
+
+	if ((pt == 0) || (pt > 2)) { // AT penalty applies
+		energy += terminal_AU;
+	}
+	if (!gtenable && (pt > 3)) { // GT penalty applies
+		energy += 100000.0;
+	}
+
+	return energy;
+}
+
+// The single stranded stacking, initialization penalty and dangles of one side,
+// as added up by MultiloopEnergy and OpenloopEnergy.
+double NupackEnergyModel::LoopSideEnergy(char *seq, int size, char prevPartner, char nextPartner, SideRole role) {
+
+	if (dangles == DANGLES_NONE) {
+		return loopSideEnergy<DANGLES_NONE>(seq, size, prevPartner, nextPartner, role);
+	} else if (dangles == DANGLES_SOME) {
+		return loopSideEnergy<DANGLES_SOME>(seq, size, prevPartner, nextPartner, role);
+	}
+
+	return loopSideEnergy<DANGLES_ALL>(seq, size, prevPartner, nextPartner, role);
+
+}
+
+template<int Dangles>
+double NupackEnergyModel::loopSideEnergy(char *seq, int size, char prevPartner, char nextPartner, SideRole role) {
+
+	multiloop_energies& multiloop = multiloop_dG;
+	double energy = 0.0, dangle3, dangle5;
+
+	// OpenloopEnergy leaves out the stacking of the 3' side.
+	if (role != sideOpenLast) {
+		energy += singleStrandedStacking(seq, size);
+	}
+
+	if (role == sideInner) {
+		energy += initializationPenalty(size);
+	}
+
+	if (Dangles == DANGLES_NONE) {
+		return energy;
+	}
+
+	if (role == sideOpenFirst) {
+
+		if (size > 0) {
+			energy += multiloop.dangle_3[pairtypes[nextPartner][seq[size + 1]] - 1][seq[size]];
+		}
+
+	} else if (role == sideOpenLast) {
+
+		if (size > 0) {
+			energy += multiloop.dangle_5[pairtypes[seq[0]][prevPartner] - 1][seq[1]];
+		}
+
+	} else if (!(Dangles == DANGLES_SOME && size == 0)) {
+
+		dangle5 = multiloop.dangle_5[pairtypes[seq[0]][prevPartner] - 1][seq[1]];
+		dangle3 = multiloop.dangle_3[pairtypes[nextPartner][seq[size + 1]] - 1][seq[size]];
+
+		if (Dangles == DANGLES_SOME && size == 1) {
+			energy += ((dangle3 < dangle5) ? dangle3 : dangle5); // minimum of two terms.
+		} else {
+			energy += dangle3 + dangle5;
+		}
+	}
+
+	return energy;
+}
+
+// The terms of MultiloopEnergy that depend only on the number of sides and unpaired bases.
+double NupackEnergyModel::MultiloopBaseEnergy(int size, int totalLength) {
+
+	multiloop_energies& multiloop = multiloop_dG;
+	double energy = size * multiloop.internal;
+
+	energy += multiloop.closing;
+
+	if (!logml) {
+		energy += multiloop.base * totalLength;
+	} else if (totalLength <= 6) {
+		energy += multiloop.base * totalLength;
+	} else {
+		energy += multiloop.base * 6 + logLoopPenalty6(totalLength);
+	}
+
+	return energy;
+}
+
 // constructors, internal functions
 
 NupackEnergyModel::NupackEnergyModel(PyObject* energy_options) :
 
-		log_loop_penalty_37(107.856), kinetic_rate_method(RATE_METHOD_KAWASAKI), bimolecular_penalty(1.96), kBoltzmann(.00198717), current_temp(310.15) // Check references for this loop penalty term.
+		log_loop_penalty_37(107.856), kinetic_rate_method(RATE_METHOD_KAWASAKI), bimolecular_penalty(1.96), kBoltzmann(.00198717) // Check references for this loop penalty term.
 {
 
 	simOptions = new PSimOptions(energy_options);
@@ -495,14 +655,17 @@ NupackEnergyModel::NupackEnergyModel(PyObject* energy_options) :
 
 	}
 
+	computeContextJoinRates();
+
 }
 
 NupackEnergyModel::NupackEnergyModel(SimOptions* options) :
-		log_loop_penalty_37(107.856), kinetic_rate_method(RATE_METHOD_KAWASAKI), bimolecular_penalty(1.96), kBoltzmann(.00198717), current_temp(310.15) // Check references for this loop penalty term.
+		log_loop_penalty_37(107.856), kinetic_rate_method(RATE_METHOD_KAWASAKI), bimolecular_penalty(1.96), kBoltzmann(.00198717) // Check references for this loop penalty term.
 {
 	simOptions = options;
 	processOptions();
 	computeArrheniusRates(current_temp);
+	computeContextJoinRates();
 }
 
 // returns a FILE pointer or prints an error message.
@@ -541,7 +704,6 @@ FILE* NupackEnergyModel::openFiles(char* nupackhome, string& paramPath, string&
 void NupackEnergyModel::processOptions() {
 
 	// 	This is the tough part, performing all read/input duties.
-	char in_buffer[2048];
 	int loop, loop2, loop3, loop4, loop5, loop6;
 	double temperature;
 	FILE *fp = NULL, *fp2 = NULL; // fp is dG energy file, fp2 is dH.
@@ -553,6 +715,7 @@ void NupackEnergyModel::processOptions() {
 
 	temperature = myEnergyOptions->getTemperature();
 	dangles = myEnergyOptions->getDangles();
+	arrhenius = myEnergyOptions->usingArrhenius();
 	logml = myEnergyOptions->getLogml();
 	gtenable = myEnergyOptions->getGtenable();
 	kinetic_rate_method = myEnergyOptions->getKineticRateMethod();
@@ -612,6 +775,174 @@ void NupackEnergyModel::processOptions() {
 
 	}
 
+	// the same files at the same temperature and salt as an earlier energy model:
+	// its tables are copied instead of reading the files again.
+	ParameterKey cacheKey, unscaledKey;
+	std::unique_ptr<ParameterTables> tables;
+
+	if (fp2 != NULL) {
+
+		cacheKey = ParameterCache::key(fp, fp2, myEnergyOptions);
+		tables.reset(new ParameterTables);
+
+		if (ParameterCache::load(cacheKey, simOptions->parameterCache, *tables)) {
+
+			fclose(fp);
+			fclose(fp2);
+
+			loadTables(*tables);
+
+			_RT = kBoltzmann * temperature;
+			current_temp = temperature;
+			numActiveNT = simOptions->initialActiveNT;
+
+			setupRates();
+			setupKernels();
+			return;
+
+		}
+
+		unscaledKey = ParameterCache::unscaled(cacheKey);
+	}
+
+	// the same files at other conditions: their tables before scaling are copied, and
+	// scaled below. Otherwise the files are read, and those tables kept for the next.
+	if (fp2 != NULL && ParameterCache::load(unscaledKey, simOptions->parameterCache, *tables)) {
+
+		fclose(fp);
+		fclose(fp2);
+
+		loadTables(*tables);
+
+	} else {
+
+		readEnergies(fp);
+
+		if (fp2 == NULL) {
+			if (temperature < CELSIUS37_IN_KELVIN - .0001 || temperature > CELSIUS37_IN_KELVIN + .0001) {
+				fprintf(stderr,
+						"ERROR: Temperature was set to %0.2lf C, but only dG type data files could be found. Please ensure that the requested parameter set has both .dG and .dH files!\n",
+						temperature);
+				exit(0);
+			}
+			return;
+		}
+
+		readEnthalpies(fp2);
+
+		saveTables(*tables);
+		ParameterCache::store(unscaledKey, simOptions->parameterCache, *tables);
+
+	}
+
+// Temperature change section.
+
+	_RT = kBoltzmann * current_temp;
+
+	log_loop_penalty = 100.0 * 1.75 * kBoltzmann * current_temp;
+
+	double saltCorrection = 0.368 * log(myEnergyOptions->sodium + 3.3 * sqrt(myEnergyOptions->magnesium));
+
+	for (loop = 0; loop < PAIRS_NUPACK; loop++) {
+		for (loop2 = 0; loop2 < PAIRS_NUPACK; loop2++) {
+
+			stack_37_dG[loop][loop2] = T_scale(stack_37_dG[loop][loop2], stack_37_dH[loop][loop2], temperature);
+			// now adjusting for a single salt correction term.
+			stack_37_dG[loop][loop2] += (saltCorrection * -temperature) / 1000.0;
+		}
+	}
+
+	for (loop = 0; loop < 31; loop++)
+		hairpin_dG.basic[loop] = T_scale(hairpin_dG.basic[loop], hairpin_dH.basic[loop], temperature);
+
+	for (loop = 0; loop < PAIRS_NUPACK; loop++)
+		for (loop2 = 0; loop2 < BASES; loop2++)
+			for (loop3 = 0; loop3 < BASES; loop3++)
+				hairpin_dG.mismatch[loop][loop2][loop3] = T_scale(hairpin_dG.mismatch[loop][loop2][loop3], hairpin_dH.mismatch[loop][loop2][loop3],
+						temperature);
+
+	for (loop = 0; loop < 4096; loop++)
+		hairpin_dG.tetraloop[loop] = T_scale(hairpin_dG.tetraloop[loop], hairpin_dH.tetraloop[loop], temperature);
+
+	for (loop = 0; loop < 1024; loop++)
+		hairpin_dG.triloop[loop] = T_scale(hairpin_dG.triloop[loop], hairpin_dH.triloop[loop], temperature);
+
+	for (loop = 0; loop < 31; loop++)
+		bulge_37_dG[loop] = T_scale(bulge_37_dG[loop], bulge_37_dH[loop], temperature);
+
+	for (loop = 0; loop < 31; loop++)
+		internal_dG.basic[loop] = T_scale(internal_dG.basic[loop], internal_dH.basic[loop], temperature);
+
+	for (loop = 0; loop < BASES; loop++)
+		for (loop2 = 0; loop2 < BASES; loop2++)
+			for (loop3 = 0; loop3 < PAIRS_NUPACK; loop3++)
+				internal_dG.mismatch[loop][loop2][loop3] = T_scale(internal_dG.mismatch[loop][loop2][loop3], internal_dH.mismatch[loop][loop2][loop3],
+						temperature);
+
+	internal_dG.maximum_NINIO = T_scale(internal_dG.maximum_NINIO, internal_dH.maximum_NINIO, temperature);
+
+	for (loop = 0; loop < 5; loop++)
+		internal_dG.ninio_correction[loop] = T_scale(internal_dG.ninio_correction[loop], internal_dH.ninio_correction[loop], temperature);
+
+	for (loop = 0; loop < PAIRS_NUPACK; loop++)
+		for (loop2 = 0; loop2 < PAIRS_NUPACK; loop2++)
+			for (loop3 = 0; loop3 < BASES; loop3++)
+				for (loop4 = 0; loop4 < BASES; loop4++)
+					internal_dG.internal_1_1[loop][loop2][loop3][loop4] = T_scale(internal_dG.internal_1_1[loop][loop2][loop3][loop4],
+							internal_dH.internal_1_1[loop][loop2][loop3][loop4], temperature);
+
+	for (loop = 0; loop < PAIRS_NUPACK; loop++)
+		for (loop5 = 0; loop5 < BASES; loop5++)
+			for (loop2 = 0; loop2 < PAIRS_NUPACK; loop2++)
+				for (loop3 = 0; loop3 < BASES; loop3++)
+					for (loop4 = 0; loop4 < BASES; loop4++)
+						internal_dG.internal_2_1[loop][loop5][loop2][loop3][loop4] = T_scale(internal_dG.internal_2_1[loop][loop5][loop2][loop3][loop4],
+								internal_dH.internal_2_1[loop][loop5][loop2][loop3][loop4], temperature);
+
+	for (loop = 0; loop < PAIRS_NUPACK; loop++)
+		for (loop2 = 0; loop2 < PAIRS_NUPACK; loop2++)
+			for (loop3 = 0; loop3 < BASES; loop3++)
+				for (loop4 = 0; loop4 < BASES; loop4++)
+					for (loop5 = 0; loop5 < BASES; loop5++)
+						for (loop6 = 0; loop6 < BASES; loop6++)
+							internal_dG.internal_2_2[loop][loop2][loop3][loop4][loop5][loop6] = T_scale(
+									internal_dG.internal_2_2[loop][loop2][loop3][loop4][loop5][loop6],
+									internal_dH.internal_2_2[loop][loop2][loop3][loop4][loop5][loop6], temperature);
+
+	multiloop_dG.base = T_scale(multiloop_dG.base, multiloop_dH.base, temperature);
+	multiloop_dG.closing = T_scale(multiloop_dG.closing, multiloop_dH.closing, temperature);
+	multiloop_dG.internal = T_scale(multiloop_dG.internal, multiloop_dH.internal, temperature);
+
+	for (loop = 0; loop < PAIRS_NUPACK; loop++)
+		for (loop2 = 0; loop2 < BASES; loop2++) {
+			multiloop_dG.dangle_3[loop][loop2] = T_scale(multiloop_dG.dangle_3[loop][loop2], multiloop_dH.dangle_3[loop][loop2], temperature);
+			multiloop_dG.dangle_5[loop][loop2] = T_scale(multiloop_dG.dangle_5[loop][loop2], multiloop_dH.dangle_5[loop][loop2], temperature);
+		}
+
+	terminal_AU = T_scale(terminal_AU, terminal_AU_dH, temperature);
+
+	bimolecular_penalty = T_scale(bimolecular_penalty, bimolecular_penalty_dH, temperature);
+// need additional conversion as well
+
+	saveTables(*tables);
+	ParameterCache::store(cacheKey, simOptions->parameterCache, *tables);
+
+	_RT = kBoltzmann * temperature;
+
+	current_temp = temperature;
+
+	//FD: adding cotranscriptional initialziation
+	numActiveNT = simOptions->initialActiveNT;
+
+	setupRates();
+	setupKernels();
+}
+
+// Reads the parameters of the dG file, and closes it.
+void NupackEnergyModel::readEnergies(FILE *fp) {
+
+	char in_buffer[2048];
+
 	fgets(in_buffer, 2048, fp);
 	while (!feof(fp)) {
 		if (in_buffer[0] == '>') // data area or comment (mfold)
@@ -742,17 +1073,13 @@ void NupackEnergyModel::processOptions() {
 			fgets(in_buffer, 2048, fp);
 	}
 	fclose(fp);
-	/* Enthalpy loading section for all those pesky dH terms. */
 
-	if (fp2 == NULL) {
-		if (temperature < CELSIUS37_IN_KELVIN - .0001 || temperature > CELSIUS37_IN_KELVIN + .0001) {
-			fprintf(stderr,
-					"ERROR: Temperature was set to %0.2lf C, but only dG type data files could be found. Please ensure that the requested parameter set has both .dG and .dH files!\n",
-					temperature);
-			exit(0);
-		}
-		return;
-	}
+}
+
+// Reads the parameters of the dH file, and closes it.
+void NupackEnergyModel::readEnthalpies(FILE *fp2) {
+
+	char in_buffer[2048];
 
 	fgets(in_buffer, 2048, fp2);
 	while (!feof(fp2)) {
@@ -886,103 +1213,89 @@ void NupackEnergyModel::processOptions() {
 
 	fclose(fp2);
 
-// Temperature change section.
-
-	_RT = kBoltzmann * current_temp;
-
-	log_loop_penalty = 100.0 * 1.75 * kBoltzmann * current_temp;
-
-	double saltCorrection = 0.368 * log(myEnergyOptions->sodium + 3.3 * sqrt(myEnergyOptions->magnesium));
-
-	for (loop = 0; loop < PAIRS_NUPACK; loop++) {
-		for (loop2 = 0; loop2 < PAIRS_NUPACK; loop2++) {
-
-			stack_37_dG[loop][loop2] = T_scale(stack_37_dG[loop][loop2], stack_37_dH[loop][loop2], temperature);
-			// now adjusting for a single salt correction term.
-			stack_37_dG[loop][loop2] += (saltCorrection * -temperature) / 1000.0;
-		}
-	}
+}
 
-	for (loop = 0; loop < 31; loop++)
-		hairpin_dG.basic[loop] = T_scale(hairpin_dG.basic[loop], hairpin_dH.basic[loop], temperature);
+void NupackEnergyModel::saveTables(ParameterTables& tables) {
+
+	tables.stack_dG = stack_37_dG;
+	tables.stack_dH = stack_37_dH;
+	tables.hairpin_dG = hairpin_dG;
+	tables.hairpin_dH = hairpin_dH;
+	tables.bulge_dG = bulge_37_dG;
+	tables.bulge_dH = bulge_37_dH;
+	tables.internal_dG = internal_dG;
+	tables.internal_dH = internal_dH;
+	tables.multiloop_dG = multiloop_dG;
+	tables.multiloop_dH = multiloop_dH;
+
+	tables.terminal_AU = terminal_AU;
+	tables.terminal_AU_dH = terminal_AU_dH;
+	tables.bimolecular_penalty = bimolecular_penalty;
+	tables.bimolecular_penalty_dH = bimolecular_penalty_dH;
+	tables.log_loop_penalty = log_loop_penalty;
 
-	for (loop = 0; loop < PAIRS_NUPACK; loop++)
-		for (loop2 = 0; loop2 < BASES; loop2++)
-			for (loop3 = 0; loop3 < BASES; loop3++)
-				hairpin_dG.mismatch[loop][loop2][loop3] = T_scale(hairpin_dG.mismatch[loop][loop2][loop3], hairpin_dH.mismatch[loop][loop2][loop3],
-						temperature);
+}
 
-	for (loop = 0; loop < 4096; loop++)
-		hairpin_dG.tetraloop[loop] = T_scale(hairpin_dG.tetraloop[loop], hairpin_dH.tetraloop[loop], temperature);
+void NupackEnergyModel::loadTables(const ParameterTables& tables) {
+
+	stack_37_dG = tables.stack_dG;
+	stack_37_dH = tables.stack_dH;
+	hairpin_dG = tables.hairpin_dG;
+	hairpin_dH = tables.hairpin_dH;
+	bulge_37_dG = tables.bulge_dG;
+	bulge_37_dH = tables.bulge_dH;
+	internal_dG = tables.internal_dG;
+	internal_dH = tables.internal_dH;
+	multiloop_dG = tables.multiloop_dG;
+	multiloop_dH = tables.multiloop_dH;
+
+	terminal_AU = tables.terminal_AU;
+	terminal_AU_dH = tables.terminal_AU_dH;
+	bimolecular_penalty = tables.bimolecular_penalty;
+	bimolecular_penalty_dH = tables.bimolecular_penalty_dH;
+	log_loop_penalty = tables.log_loop_penalty;
 
-	for (loop = 0; loop < 1024; loop++)
-		hairpin_dG.triloop[loop] = T_scale(hairpin_dG.triloop[loop], hairpin_dH.triloop[loop], temperature);
+}
 
-	for (loop = 0; loop < 31; loop++)
-		bulge_37_dG[loop] = T_scale(bulge_37_dG[loop], bulge_37_dH[loop], temperature);
+NupackEnergyModel* NupackEnergyModel::atTemperature(double temperature) {
 
-	for (loop = 0; loop < 31; loop++)
-		internal_dG.basic[loop] = T_scale(internal_dG.basic[loop], internal_dH.basic[loop], temperature);
+	NupackEnergyModel* model = clone();
+	model->rescale(temperature);
 
-	for (loop = 0; loop < BASES; loop++)
-		for (loop2 = 0; loop2 < BASES; loop2++)
-			for (loop3 = 0; loop3 < PAIRS_NUPACK; loop3++)
-				internal_dG.mismatch[loop][loop2][loop3] = T_scale(internal_dG.mismatch[loop][loop2][loop3], internal_dH.mismatch[loop][loop2][loop3],
-						temperature);
+	return model;
 
-	internal_dG.maximum_NINIO = T_scale(internal_dG.maximum_NINIO, internal_dH.maximum_NINIO, temperature);
+}
 
-	for (loop = 0; loop < 5; loop++)
-		internal_dG.ninio_correction[loop] = T_scale(internal_dG.ninio_correction[loop], internal_dH.ninio_correction[loop], temperature);
+NupackEnergyModel* NupackEnergyModel::clone(void) {
 
-	for (loop = 0; loop < PAIRS_NUPACK; loop++)
-		for (loop2 = 0; loop2 < PAIRS_NUPACK; loop2++)
-			for (loop3 = 0; loop3 < BASES; loop3++)
-				for (loop4 = 0; loop4 < BASES; loop4++)
-					internal_dG.internal_1_1[loop][loop2][loop3][loop4] = T_scale(internal_dG.internal_1_1[loop][loop2][loop3][loop4],
-							internal_dH.internal_1_1[loop][loop2][loop3][loop4], temperature);
+	return new NupackEnergyModel(*this);
 
-	for (loop = 0; loop < PAIRS_NUPACK; loop++)
-		for (loop5 = 0; loop5 < BASES; loop5++)
-			for (loop2 = 0; loop2 < PAIRS_NUPACK; loop2++)
-				for (loop3 = 0; loop3 < BASES; loop3++)
-					for (loop4 = 0; loop4 < BASES; loop4++)
-						internal_dG.internal_2_1[loop][loop5][loop2][loop3][loop4] = T_scale(internal_dG.internal_2_1[loop][loop5][loop2][loop3][loop4],
-								internal_dH.internal_2_1[loop][loop5][loop2][loop3][loop4], temperature);
-
-	for (loop = 0; loop < PAIRS_NUPACK; loop++)
-		for (loop2 = 0; loop2 < PAIRS_NUPACK; loop2++)
-			for (loop3 = 0; loop3 < BASES; loop3++)
-				for (loop4 = 0; loop4 < BASES; loop4++)
-					for (loop5 = 0; loop5 < BASES; loop5++)
-						for (loop6 = 0; loop6 < BASES; loop6++)
-							internal_dG.internal_2_2[loop][loop2][loop3][loop4][loop5][loop6] = T_scale(
-									internal_dG.internal_2_2[loop][loop2][loop3][loop4][loop5][loop6],
-									internal_dH.internal_2_2[loop][loop2][loop3][loop4][loop5][loop6], temperature);
+}
 
-	multiloop_dG.base = T_scale(multiloop_dG.base, multiloop_dH.base, temperature);
-	multiloop_dG.closing = T_scale(multiloop_dG.closing, multiloop_dH.closing, temperature);
-	multiloop_dG.internal = T_scale(multiloop_dG.internal, multiloop_dH.internal, temperature);
+// Every dG table was scaled from dG at 37 C and dH by processOptions, so the tables
+// at another temperature follow from those at current_temp.
+void NupackEnergyModel::rescale(double temperature) {
 
-	for (loop = 0; loop < PAIRS_NUPACK; loop++)
-		for (loop2 = 0; loop2 < BASES; loop2++) {
-			multiloop_dG.dangle_3[loop][loop2] = T_scale(multiloop_dG.dangle_3[loop][loop2], multiloop_dH.dangle_3[loop][loop2], temperature);
-			multiloop_dG.dangle_5[loop][loop2] = T_scale(multiloop_dG.dangle_5[loop][loop2], multiloop_dH.dangle_5[loop][loop2], temperature);
-		}
+	double ratio = temperature / current_temp;
 
-	terminal_AU = T_scale(terminal_AU, terminal_AU_dH, temperature);
+	T_rescale(stack_37_dG, stack_37_dH, ratio);
+	T_rescale(hairpin_dG, hairpin_dH, ratio);
+	T_rescale(bulge_37_dG, bulge_37_dH, ratio);
+	T_rescale(internal_dG, internal_dH, ratio);
+	T_rescale(multiloop_dG, multiloop_dH, ratio);
+	T_rescale(terminal_AU, terminal_AU_dH, ratio);
+	T_rescale(bimolecular_penalty, bimolecular_penalty_dH, ratio);
 
-	bimolecular_penalty = T_scale(bimolecular_penalty, bimolecular_penalty_dH, temperature);
-// need additional conversion as well
+	log_loop_penalty = 100.0 * 1.75 * kBoltzmann * temperature;
 
 	_RT = kBoltzmann * temperature;
-
 	current_temp = temperature;
 
-	//FD: adding cotranscriptional initialziation
-	numActiveNT = simOptions->initialActiveNT;
-
 	setupRates();
+	setupKernels();
+	computeArrheniusRates(current_temp);
+	computeContextJoinRates();
+
 }
 
 /* ------------------------------------------------------------------------
@@ -1555,3 +1868,114 @@ void NupackEnergyModel::setupRates() {
 	joinrate = biscale * eOptions->getJoinConcentration();
 
 }
+
+// Needs the temperature scaled parameters, see processOptions.
+void NupackEnergyModel::setupKernels() {
+
+	mathKernels = simOptions->mathKernels;
+
+	if (kinetic_rate_method == RATE_METHOD_KAWASAKI) {
+		rateTable.setup(0.5 / _RT);
+	} else {
+		rateTable.setup(1.0 / _RT);
+	}
+
+	loopPenalty30.resize(LOOP_PENALTY_TABLE_SIZE);
+	loopPenalty6.resize(LOOP_PENALTY_TABLE_SIZE);
+
+	for (int size = 1; size < LOOP_PENALTY_TABLE_SIZE; size++) {
+		loopPenalty30[size] = (log((double) size / 30.0) * log_loop_penalty / 100.0);
+		loopPenalty6[size] = (log((double) size / 6.0) * log_loop_penalty / 100.0);
+	}
+
+}
+
+/* NupackModel: NupackEnergyModel with the dangles setting and the rate method
+ fixed when it is made, so that the calls that the loops make for every move do
+ not test them. Everything else is inherited. */
+
+template<int Dangles, int RateMethod>
+class NupackModel final : public NupackEnergyModel {
+public:
+
+	NupackModel(SimOptions* options) :
+			NupackEnergyModel(options) {
+	}
+
+	NupackEnergyModel* clone(void) {
+
+		return new NupackModel(*this);
+
+	}
+
+	double returnRate(double start_energy, double end_energy, int enth_entr_toggle) {
+
+		return rate<RateMethod>(start_energy, end_energy, enth_entr_toggle);
+
+	}
+
+	double MultiloopEnergy(int size, int *sidelen, char **sequences) {
+
+		PhaseTimer phase(PHASE_ENERGY_MULTILOOP);
+		return multiloopEnergy<Dangles>(size, sidelen, sequences, multiloop_dG);
+
+	}
+
+	double OpenloopEnergy(int size, int *sidelen, char **sequences) {
+
+		PhaseTimer phase(PHASE_ENERGY_OPENLOOP);
+		return openloopEnergy<Dangles>(size, sidelen, sequences, multiloop_dG);
+
+	}
+
+	double LoopSideEnergy(char *seq, int size, char prevPartner, char nextPartner, SideRole role) {
+
+		return loopSideEnergy<Dangles>(seq, size, prevPartner, nextPartner, role);
+
+	}
+
+};
+
+// The Arrhenius rates are Metropolis rates with prefactors.
+template<int Dangles>
+static NupackEnergyModel* createModel(SimOptions* options, long rateMethod) {
+
+	if (rateMethod == RATE_METHOD_KAWASAKI) {
+		return new NupackModel<Dangles, RATE_METHOD_KAWASAKI>(options);
+	}
+
+	return new NupackModel<Dangles, RATE_METHOD_METROPOLIS>(options);
+
+}
+
+NupackEnergyModel* NupackEnergyModel::create(SimOptions* options) {
+
+	EnergyOptions* energyOptions = options->getEnergyOptions();
+	long dangles = energyOptions->getDangles();
+	long rateMethod = energyOptions->getKineticRateMethod();
+
+	if (!options->specializedModel) {
+		return new NupackEnergyModel(options);
+	}
+
+	if (rateMethod != RATE_METHOD_KAWASAKI && rateMethod != RATE_METHOD_METROPOLIS && rateMethod != RATE_METHOD_ARRHENIUS) {
+		return new NupackEnergyModel(options);
+	}
+
+	if (dangles == DANGLES_NONE) {
+		return createModel<DANGLES_NONE>(options, rateMethod);
+	} else if (dangles == DANGLES_SOME) {
+		return createModel<DANGLES_SOME>(options, rateMethod);
+	} else if (dangles == DANGLES_ALL) {
+		return createModel<DANGLES_ALL>(options, rateMethod);
+	}
+
+	return new NupackEnergyModel(options);
+
+}
+
+NupackEnergyModel* NupackEnergyModel::create(PyObject* options) {
+
+	return create(new PSimOptions(options));
+
+}
@@ -0,0 +1,300 @@
+/*
+ Copyright (c) 2017 California Institute of Technology. All rights reserved.
+ Multistrand nucleic acid kinetic simulator
+ help@multistrand.org
+ */
+
+#include "parametercache.h"
+#include "energyoptions.h"
+#include "options.h"
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+
+// the blobs of this process, the least recently used first; mapped from a file or
+// allocated.
+struct CachedBlob {
+
+	ParameterBlob* blob;
+	bool mapped;
+
+};
+
+static std::vector<CachedBlob> cachedBlobs;
+static std::mutex cacheLock;
+static bool warnedDirectory = false;
+
+static const char blobMagic[8] = "MSPARAM";
+
+// FNV-1a, on eight bytes at a time
+static uint64_t hashBytes(const char* data, size_t size, uint64_t hash = 14695981039346656037ULL) {
+
+	size_t i = 0;
+
+	for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, data + i, sizeof(word));
+		hash ^= word;
+		hash *= 1099511628211ULL;
+	}
+
+	for (; i < size; i++) {
+		hash ^= (unsigned char) data[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+
+}
+
+// the hashes of the files read by this process, by inode, size and time of change;
+// under cacheLock.
+struct FileHash {
+
+	dev_t device;
+	ino_t inode;
+	off_t size;
+	time_t changed;
+	uint64_t hash;
+
+};
+
+static std::vector<FileHash> fileHashes;
+
+static uint64_t hashFile(FILE* file) {
+
+	struct stat info;
+	bool known = fstat(fileno(file), &info) == 0;
+
+	if (known) {
+		for (FileHash& entry : fileHashes) {
+			if (entry.device == info.st_dev && entry.inode == info.st_ino && entry.size == info.st_size && entry.changed == info.st_mtime) {
+				return entry.hash;
+			}
+		}
+	}
+
+	char buffer[65536];
+	uint64_t hash = 14695981039346656037ULL;
+	size_t count;
+
+	rewind(file);
+
+	while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+		hash = hashBytes(buffer, count, hash);
+	}
+
+	rewind(file);
+
+	if (known) {
+		FileHash entry = { info.st_dev, info.st_ino, info.st_size, info.st_mtime, hash };
+		fileHashes.push_back(entry);
+	}
+
+	return hash;
+
+}
+
+static string blobPath(const ParameterKey& key, const string& directory) {
+
+	char name[64];
+	snprintf(name, sizeof(name), "/multistrand-%016llx.param", (unsigned long long) hashBytes((const char*) &key, sizeof(key)));
+
+	return directory + name;
+
+}
+
+static bool matches(const ParameterBlob* blob, const ParameterKey& key) {
+
+	return memcmp(blob->magic, blobMagic, sizeof(blobMagic)) == 0 && blob->version == PARAMETER_CACHE_VERSION && blob->size == sizeof(ParameterBlob)
+			&& memcmp(&blob->key, &key, sizeof(key)) == 0 && blob->checksum == hashBytes((const char*) &blob->tables, sizeof(ParameterTables));
+
+}
+
+static void release(CachedBlob& cached) {
+
+	if (cached.mapped) {
+		munmap(cached.blob, sizeof(ParameterBlob));
+	} else {
+		delete cached.blob;
+	}
+
+}
+
+// under cacheLock
+static void remember(ParameterBlob* blob, bool mapped) {
+
+	if (cachedBlobs.size() >= (size_t) PARAMETER_CACHE_ENTRIES) {
+		release(cachedBlobs.front());
+		cachedBlobs.erase(cachedBlobs.begin());
+	}
+
+	CachedBlob cached = { blob, mapped };
+	cachedBlobs.push_back(cached);
+
+}
+
+static ParameterBlob* mapFile(const ParameterKey& key, const string& path) {
+
+	int fd = open(path.c_str(), O_RDONLY);
+
+	if (fd < 0) {
+		return NULL;
+	}
+
+	struct stat info;
+	void* data = MAP_FAILED;
+
+	if (fstat(fd, &info) == 0 && info.st_size == (off_t) sizeof(ParameterBlob)) {
+		data = mmap(NULL, sizeof(ParameterBlob), PROT_READ, MAP_SHARED, fd, 0);
+	}
+
+	close(fd);
+
+	if (data == MAP_FAILED) {
+		return NULL;
+	}
+
+	ParameterBlob* blob = (ParameterBlob*) data;
+
+	if (!matches(blob, key)) {
+		munmap(data, sizeof(ParameterBlob));
+		return NULL;
+	}
+
+	return blob;
+
+}
+
+// written under another name and renamed, so that other processes map either no
+// file or a complete one.
+static bool writeFile(const ParameterBlob* blob, const string& directory) {
+
+	if (mkdir(directory.c_str(), 0777) != 0 && errno != EEXIST) {
+		return false;
+	}
+
+	string path = blobPath(blob->key, directory);
+	string temporary = path + "." + std::to_string((long) getpid());
+
+	FILE* file = fopen(temporary.c_str(), "wb");
+
+	if (file == NULL) {
+		return false;
+	}
+
+	bool written = fwrite(blob, sizeof(ParameterBlob), 1, file) == 1;
+	written = (fclose(file) == 0) && written;
+
+	if (!written || rename(temporary.c_str(), path.c_str()) != 0) {
+		remove(temporary.c_str());
+		return false;
+	}
+
+	return true;
+
+}
+
+ParameterKey ParameterCache::key(FILE* dG, FILE* dH, EnergyOptions* options) {
+
+	std::lock_guard<std::mutex> guard(cacheLock);
+	ParameterKey key;
+	memset(&key, 0, sizeof(key));
+
+	key.hash_dG = hashFile(dG);
+	key.hash_dH = hashFile(dH);
+	key.temperature = options->getTemperature();
+	key.sodium = options->sodium;
+	key.magnesium = options->magnesium;
+	key.substrate = options->compareSubstrateType(SUBSTRATE_DNA) ? SUBSTRATE_DNA : SUBSTRATE_RNA;
+
+	return key;
+
+}
+
+// no run is at 0 K.
+ParameterKey ParameterCache::unscaled(const ParameterKey& key) {
+
+	ParameterKey unscaledKey = key;
+
+	unscaledKey.temperature = 0.0;
+	unscaledKey.sodium = 0.0;
+	unscaledKey.magnesium = 0.0;
+
+	return unscaledKey;
+
+}
+
+bool ParameterCache::load(const ParameterKey& key, const string& directory, ParameterTables& tables) {
+
+	std::lock_guard<std::mutex> guard(cacheLock);
+
+	for (size_t i = 0; i < cachedBlobs.size(); i++) {
+		if (memcmp(&cachedBlobs[i].blob->key, &key, sizeof(key)) == 0) {
+
+			tables = cachedBlobs[i].blob->tables;
+			std::rotate(cachedBlobs.begin() + i, cachedBlobs.begin() + i + 1, cachedBlobs.end());
+
+			return true;
+		}
+	}
+
+	if (!directory.empty()) {
+
+		ParameterBlob* blob = mapFile(key, blobPath(key, directory));
+
+		if (blob != NULL) {
+			remember(blob, true);
+			tables = blob->tables;
+			return true;
+		}
+
+	}
+
+	return false;
+
+}
+
+void ParameterCache::store(const ParameterKey& key, const string& directory, const ParameterTables& tables) {
+
+	ParameterBlob* blob = new ParameterBlob();
+
+	memcpy(blob->magic, blobMagic, sizeof(blobMagic));
+	blob->version = PARAMETER_CACHE_VERSION;
+	blob->size = sizeof(ParameterBlob);
+	blob->key = key;
+	blob->tables = tables;
+	blob->checksum = hashBytes((const char*) &blob->tables, sizeof(ParameterTables));
+
+	std::lock_guard<std::mutex> guard(cacheLock);
+
+	if (!directory.empty() && !writeFile(blob, directory) && !warnedDirectory) {
+		std::cerr << "Could not write the energy parameters to " << directory << ", they are kept for this process only.\n";
+		warnedDirectory = true;
+	}
+
+	remember(blob, false);
+
+}
+
+void ParameterCache::clear(void) {
+
+	std::lock_guard<std::mutex> guard(cacheLock);
+
+	for (CachedBlob& cached : cachedBlobs) {
+		release(cached);
+	}
+
+	cachedBlobs.clear();
+	fileHashes.clear();
+
+}
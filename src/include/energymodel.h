@@ -9,11 +9,16 @@
 #define __ENERGYMODEL_H__
 
 #include <stdio.h>
+#include <stdint.h>
 #include <python2.7/Python.h>
 #include <string>
 #include <array>
+#include <map>
+#include <vector>
 #include <moveutil.h>
 #include <sequtil.h>
+#include "mathkernels.h"
+#include "phasestats.h"
 
 using std::string;
 using std::array;
@@ -21,6 +26,9 @@ using std::array;
 class SimOptions;
 class Loop;
 class EnergyOptions;
+class EnergyModel;
+class StrandTable;
+struct ParameterTables;
 
 const int VIENNA = 0;
 const int MFOLD = 1;
@@ -48,27 +56,94 @@ enum LoopType {
 	openLoop, interiorLoop, bulgeLoop, stackLoop, hairpinLoop, multiLoop, LOOPTYPE_SIZE
 };
 
+// The place of a side within a multiloop or open loop, see EnergyModel::LoopSideEnergy.
+enum SideRole {
+	sideFirst, // side 0 of a multiloop
+	sideInner, // the other sides of a multiloop, and the sides of an open loop between two pairs
+	sideOpenFirst, // the 5' side of an open loop
+	sideOpenLast // the 3' side of an open loop
+};
+
 class energyS {
 public:
 	double dH; // enthalpy
 	double nTdS; // entropy - actually -TdS, such that dH + nTds = dG
 };
 
+// The live strands of one thread and the tables they use, see EnergyModel::addStrand.
+// A model keeps one for the thread that uses it; the workers of a parallel run, which
+// share the model, each have their own (see EnergyModel::useWorkerStrands).
+class StrandRegistry {
+public:
+	StrandRegistry(EnergyModel* em) :
+			model(em) {
+	}
+
+	~StrandRegistry(void);
+
+	StrandRegistry(const StrandRegistry&) = delete;
+	StrandRegistry& operator=(const StrandRegistry&) = delete;
+
+	EnergyModel* model;
+
+	std::map<string, StrandTable*> tables; // by code sequence
+	std::map<char*, StrandTable*> live; // by the first base of each live strand
+
+	// the strand of the last lookup; creation moves look up many hairpins in a row.
+	char* lastStrand = NULL;
+	StrandTable* lastTable = NULL;
+
+};
+
 class EnergyModel {
 
 public:
 	EnergyModel(void);
 	EnergyModel(PyObject *options);
 
+	// copies the settings and the rates, but not the strands registered with other.
+	EnergyModel(const EnergyModel& other);
+
 	// Implemented methods
-	bool useArrhenius(void);
-	double singleStrandedStacking(char* sequence, int length);
+	bool useArrhenius(void) {
+		return arrhenius;
+	}
+
+	// in Kelvin
+	double getTemperature(void) {
+		return current_temp;
+	}
+
+	double singleStrandedStacking(char* sequence, int length) {
+
+		if (arrhenius && length > 4) {
+			return arrheniusLoopEnergy(sequence, length);
+		}
+
+		return 0.0;
+	}
+
 	double initializationPenalty(int, int, int);
+	double initializationPenalty(int length);
 	double arrheniusLoopEnergy(char* seq, int size);
 	double saltCorrection(void);
 	void setArrheniusRate(double ratesArray[], EnergyOptions* options, double temperature, int left, int right);
 	void computeArrheniusRates(double temperature);
-	double applyPrefactors(double tempRate, MoveType left, MoveType right);
+
+	double applyPrefactors(double tempRate, MoveType left, MoveType right) {
+
+		if (inspection) {
+			return 1.0;
+		}
+
+		if (arrhenius) {
+			return tempRate * arrheniusRates[left * MOVETYPE_SIZE + right];
+		}
+
+		return tempRate;
+	}
+
+	void computeContextJoinRates(void);
 	MoveType getPrefactorsMulti(int, int, int[]);
 	MoveType prefactorOpen(int, int, int[]);
 	MoveType prefactorInternal(int, int);
@@ -83,6 +158,11 @@ public:
 	virtual double returnRate(double start_energy, double end_energy, int enth_entr_toggle) = 0;
 	virtual double getJoinRate_NoVolumeTerm(void) = 0;
 	virtual double getJoinRate(void) = 0;
+
+	// the join rate with prefactors applied, for a pair of half-contexts (see HalfContext::index).
+	double getContextJoinRate(int top, int bottom) {
+		return contextJoinRates[top * HALFCONTEXT_COUNT + bottom];
+	}
 	virtual double getVolumeEnergy(void) =0;
 	virtual double getAssocEnergy(void) =0;
 
@@ -102,9 +182,34 @@ public:
 	virtual double HairpinEnergy(char *seq, int size) = 0;
 	// just passing in the whole sequence
 
+	// HairpinEnergy, looked up in the table of the strand that seq points into.
+	double CachedHairpinEnergy(char *seq, int size);
+
+	// A strand registers its code sequence while it exists, so that CachedHairpinEnergy
+	// and PartnerScan can find its table. Strands with the same sequence share a table,
+	// which is kept until trimStrandTables is called with no strand using it.
+	StrandTable* addStrand(char *codeSeq, int size);
+	void removeStrand(char *codeSeq, StrandTable* table);
+	void trimStrandTables(void);
+
+	// The table of the strand that holds the bases first .. last, NULL if there is none.
+	// start is set to the first base of that strand.
+	StrandTable* findStrand(char *first, char *last, char **start);
+
+	// Strands registered on the calling thread go to the given registry, instead of the
+	// one of the model it was made for; NULL goes back to that. Nothing else of a model
+	// changes while it simulates, so threads can share it this way.
+	static void useWorkerStrands(StrandRegistry* strands);
+
 	virtual double MultiloopEnergy(int size, int *sidelen, char **sequences) = 0;
 	virtual double OpenloopEnergy(int size, int *sidelen, char **sequences) = 0;
 
+	// The terms that MultiloopEnergy and OpenloopEnergy add up, see LoopTerms.
+	// A side runs from seq[0] to seq[size + 1], which are paired to prevPartner and nextPartner.
+	virtual double LoopPairEnergy(char first, char second) = 0;
+	virtual double LoopSideEnergy(char *seq, int size, char prevPartner, char nextPartner, SideRole role) = 0;
+	virtual double MultiloopBaseEnergy(int size, int totalLength) = 0;
+
 	// FD January 2018: Adding the mimicking enthalpy functions
 	virtual double StackEnthalpy(int i, int j, int p, int q) = 0;
 	virtual double BulgeEnthalpy(int i, int j, int p, int q, int bulgesize) = 0;
@@ -127,8 +232,217 @@ public:
 
 protected:
 	long dangles;
+	bool arrhenius = false; // the options use the Arrhenius rate method, set by the subclass
+	double current_temp = 310.15; // in Kelvin, of the energies and rates; set by the subclass
 	double arrheniusRates[MOVETYPE_SIZE * MOVETYPE_SIZE];
+	double contextJoinRates[HALFCONTEXT_COUNT * HALFCONTEXT_COUNT];
+
+private:
+	StrandRegistry& registry(void);
+
+	StrandRegistry ownStrands { this };
+	static thread_local StrandRegistry* workerStrands;
+
+};
+
+// Strands longer than this do not cache their hairpin energies. The cache holds up
+// to length * (length - 1) / 2 energies, in rows made on first use, from MemPool.
+const int HAIRPIN_TABLE_MAX_LENGTH = 1024;
+
+const int PARTNER_WORD_BITS = 64;
+
+// What the loops look up about one strand sequence: the hairpin energies for every
+// pair of positions i < j, computed the first time they are asked for, and for each
+// base, a bitset of the positions it can pair with.
+class StrandTable {
+public:
+	StrandTable(EnergyModel* em, char* codeSeq, int length);
+	~StrandTable(void);
+
+	// the energy of the hairpin closed by bases i and j of the strand.
+	double hairpinEnergy(int i, int j) {
+
+		if (rows.empty()) {
+			return model->HairpinEnergy(&sequence[i], j - i - 1);
+		}
+
+		double* row = rows[i];
+
+		if (row == NULL) {
+			row = fillRow(i);
+		}
+
+		double& value = row[j - i - 1];
+
+		if (value != value) { // not computed yet
+			value = model->HairpinEnergy(&sequence[i], j - i - 1);
+		} else {
+			PhaseStats::countCall(PHASE_ENERGY_HAIRPIN);
+		}
+
+		return value;
+
+	}
+
+	// bit j (of word j / PARTNER_WORD_BITS) is set if base j of the strand can pair with the given base.
+	const uint64_t* partners(int base) {
+
+		return partnerBits[base].data();
+
+	}
+
+	EnergyModel* model;
+	int length;
+	int users = 0; // live strands with this table
+
+private:
+	double* fillRow(int i);
+
+	string sequence;
+	std::vector<double*> rows; // NaN until computed; empty for strands above HAIRPIN_TABLE_MAX_LENGTH
+	std::vector<uint64_t> partnerBits[5]; // by base code, one word longer than needed
+};
+
+// Enumerates the positions of a loop side that can pair with a given base, by going
+// over the set bits of the partner bitset of the side's strand, a word at a time.
+// The positions come in increasing order, like the loop
+//   for (pos = from; pos <= to; pos++) if (pairtypes[base][side[pos]] != 0) ...
+// which is also what it falls back to when the strand has no table.
+//
+//   for (scan.start(side, from, to, base); (pos = scan.next()) >= 0;)
+class PartnerScan {
+public:
+	PartnerScan(EnergyModel* em) :
+			model(em) {
+	}
+
+	void start(char* side, int from, int to, int base) {
+
+		seq = side;
+		pos = from;
+		last = to;
+		partner = base;
+		bits = NULL;
+
+		if (from > to) {
+			return;
+		}
+
+		if (table == NULL || side + from < strand || side + to >= strand + table->length) {
+			table = model->findStrand(side + from, side + to, &strand);
+		}
+
+		if (table == NULL) {
+			return;
+		}
+
+		offset = side - strand;
+		bits = table->partners(base);
+
+		int first = offset + from;
+		int end = offset + to;
+
+		index = first / PARTNER_WORD_BITS;
+		lastWord = end / PARTNER_WORD_BITS;
+		lastMask = ~0ULL >> (PARTNER_WORD_BITS - 1 - end % PARTNER_WORD_BITS);
+		word = bits[index] & (~0ULL << (first % PARTNER_WORD_BITS));
+
+		if (index == lastWord) {
+			word &= lastMask;
+		}
+
+	}
+
+	// the next position, -1 if there is none.
+	int next(void) {
+
+		if (bits == NULL) {
+
+			while (pos <= last) {
+				int p = pos++;
+				if (pairtypes[partner][(int) seq[p]] != 0) {
+					return p;
+				}
+			}
+
+			return -1;
+		}
+
+		while (word == 0) {
+
+			if (index == lastWord) {
+				return -1;
+			}
+
+			index++;
+			word = bits[index];
+
+			if (index == lastWord) {
+				word &= lastMask;
+			}
+		}
+
+		int p = index * PARTNER_WORD_BITS + __builtin_ctzll(word);
+		word &= word - 1;
+
+		return p - offset;
+
+	}
+
+private:
+	EnergyModel* model;
+
+	// the strand of the last side
+	char* strand = NULL;
+	StrandTable* table = NULL;
+
+	const uint64_t* bits = NULL;
+	uint64_t word = 0;
+	uint64_t lastMask = 0;
+	int index = 0;
+	int lastWord = 0;
+	int offset = 0; // of the side in the strand
+
+	// for sides without a table
+	char* seq = NULL;
+	int pos = 0;
+	int last = 0;
+	int partner = 0;
+};
 
+// The energy of a multiloop or open loop, split into one term for each side and
+// one for each pair between two sides, with running sums over both. MultiLoop and
+// OpenLoop use it to find the energy of the loops that a creation move leaves,
+// from the terms of the sides the move keeps and a few new terms, instead of
+// calling MultiloopEnergy or OpenloopEnergy on every candidate.
+class LoopTerms {
+public:
+	// size is numAdjacent of the loop: a multiloop has size sides, an open loop size + 1.
+	LoopTerms(EnergyModel* em, bool open, int size, int* sidelen, char** seqs);
+	~LoopTerms(void);
+
+	// The loop that remains after base a of side first pairs with base b of side last,
+	// made of the sides outside first..last. For a multiloop, last may be first + 1
+	// modulo the number of sides. first == last is a pair within one side.
+	double outerEnergy(int first, int a, int last, int b);
+
+	// The multiloop closed by the same pair, made of the sides between first and last.
+	double innerEnergy(int first, int a, int last, int b);
+
+private:
+	double rangeSum(double* prefix, int count, int from, int length);
+	int lengthSum(int from, int length);
+
+	EnergyModel* model;
+	bool open;
+	int sides;
+	int* sidelen;
+	char** seqs;
+
+	// prefix sums, e.g. sideSum[k] holds the terms of sides 0..k-1.
+	double* sideSum;
+	double* pairSum;
+	int* lengthPrefix;
 };
 
 struct hairpin_energies{
@@ -175,6 +489,10 @@ struct multiloop_energies{
 };
 
 
+const int LOOP_PENALTY_TABLE_SIZE = 2048;
+
+template<int Dangles, int RateMethod> class NupackModel;
+
 class NupackEnergyModel: public EnergyModel {
 
 public:
@@ -183,6 +501,16 @@ public:
 	NupackEnergyModel(SimOptions* options);
 //	~NupackEnergyModel(void);
 
+	// The model for the options, specialized for their dangles and rate method: its
+	// returnRate and loop energies test neither. Other settings get this class, and
+	// so do options with specializedModel off, to check the specialized models.
+	static NupackEnergyModel* create(SimOptions* options);
+	static NupackEnergyModel* create(PyObject* options);
+
+	// A copy of this model at another temperature, in Kelvin. Its tables are rescaled
+	// from the tables of this one, instead of reading the parameter files again.
+	NupackEnergyModel* atTemperature(double temperature);
+
 	double returnRate(double start_energy, double end_energy, int enth_entr_toggle);
 	double returnRate(energyS &start_energy, energyS &end_energy);
 
@@ -199,6 +527,10 @@ public:
 	double MultiloopEnergy(int size, int *sidelen, char **sequences);
 	double OpenloopEnergy(int size, int *sidelen, char **sequences);
 
+	double LoopPairEnergy(char first, char second);
+	double LoopSideEnergy(char *seq, int size, char prevPartner, char nextPartner, SideRole role);
+	double MultiloopBaseEnergy(int size, int totalLength);
+
 	// FD jan 2018: adding the corresponding enthalpy functions
 	double StackEnthalpy(int i, int j, int p, int q);
 	double BulgeEnthalpy(int i, int j, int p, int q, int bulgesize);
@@ -211,14 +543,34 @@ private:
 
 	void processOptions();
 	FILE* openFiles(char*, string&, string&, int);
+	void readEnergies(FILE *fp);
+	void readEnthalpies(FILE *fp2);
+
+	// the parameters read and scaled by processOptions, see parametercache.h
+	void saveTables(ParameterTables&);
+	void loadTables(const ParameterTables&);
+
+	// for atTemperature: a copy of the same class, and the tables of the copy moved
+	// from current_temp to temperature.
+	virtual NupackEnergyModel* clone(void);
+	void rescale(double temperature);
 
 	// FD jan 2018: helper functions, now seperated out
 	double HairpinEnergy(char *seq, int size, hairpin_energies&);
 	double InteriorEnergy(char *seq1, char *seq2, int size1, int size2, internal_energies& internal);
-	double BulgeEnergy(int i, int j, int p, int q, int bulgesize, array<double,31>, array<array<double, PAIRS_NUPACK>, PAIRS_NUPACK> );
+	double BulgeEnergy(int i, int j, int p, int q, int bulgesize, const array<double,31>&, const array<array<double, PAIRS_NUPACK>, PAIRS_NUPACK>& );
 	double MultiloopEnergy(int size, int *sidelen, char **sequences, multiloop_energies& multiloop);
 	double OpenloopEnergy(int size, int *sidelen, char **sequences, multiloop_energies& multiloop);
 
+	// the above for one dangles setting or rate method; the methods that take the
+	// setting from the options call these, and so does NupackModel.
+	template<int Dangles> double multiloopEnergy(int size, int *sidelen, char **sequences, multiloop_energies& multiloop);
+	template<int Dangles> double openloopEnergy(int size, int *sidelen, char **sequences, multiloop_energies& multiloop);
+	template<int Dangles> double loopSideEnergy(char *seq, int size, char prevPartner, char nextPartner, SideRole role);
+	template<int RateMethod> double rate(double start_energy, double end_energy, int enth_entr_toggle);
+
+	template<int Dangles, int RateMethod> friend class NupackModel;
+
 	// JS: All energy units are integers, in units of .01 kcal/mol, as used by ViennaRNA
 	// FD: In 2.0, the units changed to 0.01 kcal/mol for dH and kcal/mol for dG.
 	// FD: as of jan 2018, dH and dG are now both kcal/mol.
@@ -246,7 +598,7 @@ private:
 
 	// Logarithmic loop penalty. Doesn't seem to change for DNA/RNA?
 	double log_loop_penalty_37;
-	double log_loop_penalty;
+	double log_loop_penalty = 0.0; // set with the temperature
 
 	// biomolecular penalty
 	double bimolecular_penalty;
@@ -255,7 +607,6 @@ private:
 	// Kinetic rate toggle. 0 = kawasaki, 1 = metropolis, 2 = entropy/enthalpy, defaults to 2.
 	long kinetic_rate_method;
 	double kBoltzmann;
-	double current_temp;
 	double _RT;
 	double joinrate;
 	double dG_volume;
@@ -268,8 +619,47 @@ private:
 	int internal;
 	long logml;
 
+	// exp(-dE / RT) or exp(-0.5 dE / RT), see returnRate and mathkernels.h.
+	long mathKernels = KERNELS_LIBM;
+	RateExp rateTable;
+
+	double rateExp(double dE, double exponent) {
+
+		if (mathKernels == KERNELS_TABULATED)
+			return rateTable(dE);
+
+		double rate = exp(exponent);
+
+		if (mathKernels == KERNELS_VALIDATE)
+			MathKernels::compare(rateTable(dE), rate);
+
+		return rate;
+	}
+
+	// log(size / 30) and log(size / 6) times the log loop penalty, for loops up to
+	// LOOP_PENALTY_TABLE_SIZE bases. Computed by the same expression as the loop
+	// energy functions use for longer loops, so the values are identical.
+	std::vector<double> loopPenalty30, loopPenalty6;
+
+	double logLoopPenalty30(int size) {
+
+		if (size < LOOP_PENALTY_TABLE_SIZE)
+			return loopPenalty30[size];
+
+		return (log((double) size / 30.0) * log_loop_penalty / 100.0);
+	}
+
+	double logLoopPenalty6(int size) {
+
+		if (size < LOOP_PENALTY_TABLE_SIZE)
+			return loopPenalty6[size];
+
+		return (log((double) size / 6.0) * log_loop_penalty / 100.0);
+	}
+
 	// data loading functions:
 	void setupRates();
+	void setupKernels();
 
 	void internal_set_stack_energies(FILE *fp, char *buffer);
 	void internal_set_stack_enthalpies(FILE *fp, char *buffer);
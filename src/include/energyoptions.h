@@ -22,6 +22,8 @@ help@multistrand.org
 
 #include "utility.h"
 
+class JobFile;
+
 class EnergyOptions {
 public:
 
@@ -82,6 +84,9 @@ public:
 
 protected:
 
+	// falls back to the defaults for scaling factors and ion concentrations that are unset or out of range.
+	void checkSettings(void);
+
 	double temperature;
 	long dangles;
 	long logml;
@@ -112,18 +117,16 @@ protected:
 
 };
 
+// The energy options of a job file, see jobfile.h.
 class CEnergyOptions: public EnergyOptions {
 public:
 	// constructors
-	CEnergyOptions();
+	CEnergyOptions(JobFile* job);
 
 	// implemented virtual
 	bool compareSubstrateType(long);
 	void getParameterFile(char*, PyObject*);
 
-protected:
-	// empty
-
 };
 
 #endif /* __ENERGYOPTIONS_H_ */
@@ -0,0 +1,61 @@
+/*
+ Copyright (c) 2017 California Institute of Technology. All rights reserved.
+ Multistrand nucleic acid kinetic simulator
+ help@multistrand.org
+ */
+
+/* EnergySeries: the energies of complexes at a series of temperatures, for
+ multistrand.system.energy_matrix, without making an energy model per temperature
+ and the complexes again for each.
+
+ Every parameter is linear in the temperature, dG = dH - T dS, and so is the energy
+ of a loop, but for the terms that take the smaller of two parameters (the NINIO
+ term of interior loops, and with dangles some, the dangle of a single unpaired
+ base), which make it concave. So a loop is evaluated at the lowest, the highest and
+ a middle temperature of the series: when the middle one is on the line through the
+ other two, so is every temperature between, and the loop adds its dH and dS to
+ those of the complex. Only the other loops are evaluated at every temperature.
+
+ The models at the other temperatures are made from the one given, when they are
+ first needed; see NupackEnergyModel::atTemperature.
+ */
+
+#ifndef __ENERGYSERIES_H__
+#define __ENERGYSERIES_H__
+
+#include <vector>
+
+#include "energymodel.h"
+#include "scomplex.h"
+
+class EnergySeries {
+public:
+
+	// temperatures in Kelvin; the model is not owned.
+	EnergySeries(NupackEnergyModel* model, const std::vector<double>& temperatures);
+	~EnergySeries(void);
+
+	// adds the energy of the complex at each temperature to energies, with the volume
+	// and association terms that SComplexList::getEnergy(volume_flag) includes.
+	void addComplex(StrandComplex* complex, int volumeFlag, double* energies);
+
+	long linearLoops = 0; // by their dH and dS
+	long evaluatedLoops = 0; // at every temperature
+
+private:
+
+	EnergyModel* model(int index);
+
+	NupackEnergyModel* base;
+	std::vector<double> temperatures;
+	std::vector<NupackEnergyModel*> models; // made by atTemperature, or NULL
+
+	// the indexes of the lowest, highest and middle temperature; -1 for a series
+	// that has no temperature in between.
+	int low, high, middle;
+
+	LoopList loops;
+
+};
+
+#endif
@@ -0,0 +1,122 @@
+/*
+ Copyright (c) 2017 California Institute of Technology. All rights reserved.
+ Multistrand nucleic acid kinetic simulator
+ help@multistrand.org
+ */
+
+/* JobFile: the settings of a simulation, read from a text file instead of an
+ Options object, for the multistrand-sim executable (see testingmain.cc).
+ CSimOptions and CEnergyOptions read their settings from it.
+
+ The format is that of the Multistrand 1.x input files. Sections start with a
+ line "#Strands", "#StartStructure" or "#StopStructures" and run until the next
+ line that starts with '#'. Every other line that starts with '#' is a setting,
+ "#Key=Value", where the key is not case sensitive. Empty lines are skipped.
+
+ #Strands
+ substrate,GTGGGTACCGCACGTCACTCACCTCG
+ incumbent,CGAGGTGAGTGACGTGCGGT
+ #StartStructure
+ substrate,incumbent
+ ......((((((((((((((((((((+))))))))))))))))))))
+ #StopStructures
+ incumbent
+ ....................  dissoc
+ TAG: failure
+ ##
+ #NumSims=100
+
+ #Strands has one "name,sequence" line per strand. #StartStructure has two lines
+ per complex: the names of its strands, separated by ',', and its structure.
+ #StopStructures has, for every stop condition, the complexes it is met by, in
+ the same way, and then "TAG: " and its tag. The structure of a stop complex
+ may be followed by its type (exact, bound, dissoc, loose or count, see
+ StopCondition) and the count of the loose and count types, as in
+ "((((**+**))))  loose 2".
+
+ The settings are listed in CSimOptions::CSimOptions and
+ CEnergyOptions::CEnergyOptions.
+ */
+
+#ifndef __JOBFILE_H__
+#define __JOBFILE_H__
+
+#include <string>
+#include <vector>
+#include <map>
+#include <istream>
+
+using std::string;
+using std::vector;
+
+struct JobStrand {
+
+	string name;
+	string sequence;
+
+};
+
+struct JobComplex {
+
+	vector<int> strands; // indexes in JobFile::strands
+	string structure;
+	long type = 0; // STOPTYPE_*, for a stop complex
+	long count = 0;
+
+};
+
+struct JobStopCondition {
+
+	string tag;
+	vector<JobComplex> complexes;
+
+};
+
+class JobFile {
+public:
+
+	JobFile(const string& path);
+
+	// a job that is not in a file, such as the one of the benchmarks (see
+	// benchmarkmain.cc); name stands for the path in the error messages.
+	JobFile(std::istream& input, const string& name);
+
+	// empty if the file could be read and the settings asked for could be parsed,
+	// the reasons otherwise, one per line.
+	string error;
+
+	vector<JobStrand> strands;
+	vector<JobComplex> startState;
+	vector<JobStopCondition> stopConditions;
+
+	// the value of a setting is left as it is if the setting is not in the file.
+	void getString(const char* key, string& value);
+	void getDouble(const char* key, double* value);
+	void getLong(const char* key, long* value);
+	void getBool(const char* key, bool* value);
+
+	// the value of one of names, or a number.
+	void getChoice(const char* key, const char* const names[], const long values[], int count, long* value);
+
+	bool has(const char* key);
+
+	// the settings that were never asked for, likely misspelled.
+	vector<string> unusedSettings(void);
+
+private:
+
+	void read(std::istream& input);
+	bool readComplex(const string& names, const string& structure, int lineNumber, JobComplex& complex, bool stopComplex);
+	void addError(int lineNumber, const string& message);
+
+	const string* find(const char* key);
+
+	string path;
+
+	// by lower case key
+	std::map<string, string> settings;
+	std::map<string, bool> used;
+
+};
+
+#endif
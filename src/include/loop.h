@@ -11,8 +11,10 @@ help@multistrand.org
 #include <string>
 #include <vector>
 #include "energymodel.h"
+#include "mempool.h"
 #include "move.h"
 #include "moveutil.h"
+#include "ratetree.h"
 //#include "simtimer.h"
 
 using std::vector;
@@ -38,14 +40,54 @@ struct RateArr {
 	}
 };
 
+/* Running sums of rate and energy over the loops of one complex.
+ Loops add themselves when attached, remove themselves when deleted and report
+ rate changes through Loop::setTotalRate, so a complex does not have to walk
+ its loops to find its flux and energy. The sums are compensated (Neumaier)
+ and the owner rebuilds them from scratch every REBUILD_INTERVAL updates.
+ */
+class LoopSums {
+public:
+	LoopSums(void);
+	~LoopSums(void);
+	MEMPOOL_OPERATORS
+
+	void add(Loop* loop);
+	void remove(Loop* loop);
+	void changeRate(Loop* loop, double oldRate, double newRate);
+	void clear(void);
+
+	double getFlux(void);
+	double getEnergy(void);
+	bool needsRebuild(void);
+
+	void enableTree(void);
+	RateTree<Loop>* getTree(void);
+
+	static const long REBUILD_INTERVAL = 1 << 20;
+
+private:
+	static void accumulate(double& sum, double& compensation, double value);
+
+	double flux = 0.0;
+	double fluxCompensation = 0.0;
+	double energy = 0.0;
+	double energyCompensation = 0.0;
+	long updates = 0;
+
+	RateTree<Loop>* tree = NULL; // only for the sum-tree selection engine.
+};
+
 class Loop {
 public:
 	inline double getEnergy(void);
 	inline double getEnthalpy(void);
 	inline double getTotalRate(void);
+	double getEnergy(EnergyModel *model); // the energy under another model; this loop keeps its own.
 	char getType(void);
 	Loop(void);
 	virtual ~Loop(void);
+	MEMPOOL_OPERATORS
 	virtual void calculateEnergy(void) = 0;
 	virtual void calculateEnthalpy(void){};	// TODO: implement this.
 	virtual void generateMoves(void) = 0;
@@ -66,7 +108,7 @@ public:
 	double returnEnergies(Loop *comefrom); // returns the total energy of all loops underneath this one.
 	double returnEnthalpies(Loop *comefrom); // sums the enthalpy of the contained loops.
 	double returnFlux(Loop *comefrom); // returns the total rate of all loops underneath this one.
-	uint16_t getMoveCount(Loop *comefrom); // returns the number of transitions in this loop.
+	int getMoveCount(Loop *comefrom); // returns the number of transitions in this loop.
 	void firstGen(Loop *comefrom);
 	static void SetEnergyModel(EnergyModel *newEnergyModel);
 	static EnergyModel *GetEnergyModel(void);
@@ -84,11 +126,19 @@ public:
 	void printAllMoves(Loop*);
 	void generateAndSaveDeleteMove(Loop*, int);
 
+	// the complex keeps running sums (and for the sum-tree engine, one leaf) per loop.
+	Move *getLocalChoice(SimTimer& timer); // picks a move from this loop only.
+	void attachSums(LoopSums* sums);
+	void detachSums(void);
+
+	friend class LoopSums;
+
 	// FD: moving private to public
 	int numAdjacent;
 
 protected:
-	static EnergyModel *energyModel;
+	// per thread: the workers of a parallel run each set the model they share.
+	static thread_local EnergyModel *energyModel;
 
 	Loop** adjacentLoops;
 	int curAdjacent;
@@ -98,10 +148,19 @@ protected:
 	bool enthalpyComputed = false;
 	double totalRate;
 	MoveContainer *moves;
+	LoopSums* loopSums = NULL;
+	int rateSlot = -1; // leaf in loopSums' tree, if any.
 	char identity;
 	int add_index;
+
+	void setTotalRate(double rate); // keeps loopSums current.
 };
 
+// in the header, so that it can be used outside loop.cc, as by the benchmarks.
+inline double Loop::getTotalRate(void) {
+	return totalRate;
+}
+
 class StackLoop: public Loop {
 public:
 	void calculateEnergy(void);
@@ -0,0 +1,192 @@
+/*
+ Copyright (c) 2017 California Institute of Technology. All rights reserved.
+ Multistrand nucleic acid kinetic simulator
+ help@multistrand.org
+ */
+
+/* Table-driven exp and log for the calls made on every step: the rate of every
+ candidate move (NupackEnergyModel::returnRate) and the time advance
+ (SimTimer::advanceTime).
+
+ RateExp tabulates exp(-scale * dE) on a grid of MATH_EXP_STEP kcal/mol, the
+ resolution of the parameter files. Energies scaled to the temperature are not
+ on the grid, so the remainder is taken care of by a short series. The results
+ agree with libm to about 1e-14, relative; the error grows with |dE| because the
+ scale 1 / RT is rounded. MathKernels::log agrees to about 1e-16.
+
+ KERNELS_VALIDATE computes both and returns the libm value, so a run gives the
+ same results as with KERNELS_LIBM. MathKernels::check() counts the calls and
+ the largest relative difference seen, see SimSystem.kernelStats().
+ */
+
+#ifndef __MATHKERNELS_H__
+#define __MATHKERNELS_H__
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+/* WARNING: If you change the following defines, you must also
+ change the values in Literals.kernels_libm, Literals.kernels_tabulated
+ and Literals.kernels_validate in the file options.py.
+ */
+const int KERNELS_LIBM = 0x00;
+const int KERNELS_TABULATED = 0x01;
+const int KERNELS_VALIDATE = 0x02;
+
+const double MATH_EXP_STEP = 0.01; // kcal/mol
+const int MATH_EXP_POINTS = 5000; // the table covers -50 .. 50 kcal/mol
+const int MATH_LOG_BITS = 9;
+const int MATH_LOG_POINTS = 1 << MATH_LOG_BITS; // the mantissas in [0.5, 1) are split in this many bins
+
+// differences above this are counted as mismatches by the validation mode
+const double MATH_TOLERANCE = 1e-12;
+
+class MathKernels {
+public:
+
+	struct Check {
+		long count = 0;
+		long mismatches = 0;
+		double maxError = 0.0;
+	};
+
+	static void compare(double tabulated, double exact) {
+
+		Check& c = check();
+		double error = fabs(tabulated - exact);
+
+		if (exact != 0.0) {
+			error = error / fabs(exact);
+		}
+
+		c.count++;
+
+		if (error > c.maxError) {
+			c.maxError = error;
+		}
+
+		if (error > MATH_TOLERANCE) {
+			c.mismatches++;
+		}
+
+	}
+
+	// per thread, like MemPool.
+	static Check& check(void) {
+
+		static thread_local Check c;
+		return c;
+
+	}
+
+	// natural log for finite v > 0.
+	static double log(double v) {
+
+		// close to 1, where the table terms would cancel.
+		double x = v - 1.0;
+
+		if (fabs(x) < 1.0 / (2 * MATH_LOG_POINTS)) {
+			return log1pSeries(x);
+		}
+
+		const LogTable& t = logTable();
+
+		// v = m * 2^e with m in [0.5, 1); the top bits of the mantissa pick the bin.
+		uint64_t bits;
+		memcpy(&bits, &v, sizeof(bits));
+
+		int e = (int) ((bits >> 52) & 0x7ff) - 1022;
+
+		if (e == -1022 || e == 1025) { // zero, denormal, infinite or NaN
+			return ::log(v);
+		}
+
+		int i = (int) ((bits >> (52 - MATH_LOG_BITS)) & (MATH_LOG_POINTS - 1));
+
+		bits = (bits & 0x800fffffffffffffULL) | (1022ULL << 52);
+		double m;
+		memcpy(&m, &bits, sizeof(m));
+
+		x = (m - t.center[i]) * t.inverse[i];
+
+		return (e * M_LN2 + t.logCenter[i]) + log1pSeries(x);
+
+	}
+
+private:
+
+	// log(1 + x) for |x| < 1 / (2 * MATH_LOG_POINTS)
+	static double log1pSeries(double x) {
+
+		return x * (1.0 - x * (1.0 / 2.0 - x * (1.0 / 3.0 - x * (1.0 / 4.0 - x * (1.0 / 5.0 - x * (1.0 / 6.0))))));
+
+	}
+
+	struct LogTable {
+
+		LogTable(void) {
+
+			for (int i = 0; i < MATH_LOG_POINTS; i++) {
+				center[i] = 0.5 + (i + 0.5) / (2 * MATH_LOG_POINTS);
+				inverse[i] = 1.0 / center[i];
+				logCenter[i] = ::log(center[i]);
+			}
+
+		}
+
+		double center[MATH_LOG_POINTS];
+		double inverse[MATH_LOG_POINTS];
+		double logCenter[MATH_LOG_POINTS];
+
+	};
+
+	static const LogTable& logTable(void) {
+
+		static const LogTable table;
+		return table;
+
+	}
+
+};
+
+// exp(-scale * dE), for the rates of one kinetic rate method.
+class RateExp {
+public:
+
+	void setup(double newScale) {
+
+		scale = newScale;
+		table.resize(2 * MATH_EXP_POINTS + 1);
+
+		for (int k = -MATH_EXP_POINTS; k <= MATH_EXP_POINTS; k++) {
+			table[k + MATH_EXP_POINTS] = exp(-scale * (k * MATH_EXP_STEP));
+		}
+
+	}
+
+	double operator()(double dE) const {
+
+		if (!(fabs(dE) < MATH_EXP_POINTS * MATH_EXP_STEP)) { // also catches NaN
+			return exp(-scale * dE);
+		}
+
+		// the nearest grid point
+		int k = (int) (dE * (1.0 / MATH_EXP_STEP) + ((dE < 0.0) ? -0.5 : 0.5));
+
+		// exp(y) for |y| <= scale * MATH_EXP_STEP / 2
+		double y = -scale * (dE - k * MATH_EXP_STEP);
+		double series = 1.0 + y * (1.0 + y * (1.0 / 2.0 + y * (1.0 / 6.0 + y * (1.0 / 24.0 + y * (1.0 / 120.0 + y * (1.0 / 720.0))))));
+
+		return table[k + MATH_EXP_POINTS] * series;
+
+	}
+
+private:
+	double scale = 0.0;
+	std::vector<double> table;
+
+};
+
+#endif
@@ -0,0 +1,327 @@
+/*
+ Copyright (c) 2017 California Institute of Technology. All rights reserved.
+ Multistrand nucleic acid kinetic simulator
+ help@multistrand.org
+ */
+
+/* MemPool: size-class free lists for the objects that the simulation creates
+ and destroys on every step -- loops, moves, move lists, strand orderings, and
+ the arrays they own (adjacent loops, side lengths, sequences, move tables) --
+ and on a split: complexes, their list entries, loop sums and rate trees.
+
+ Blocks are cut from large chunks and, when released, go back onto the free
+ list of their size class. A trajectory ends by deleting the complex list,
+ which returns every block; the next trajectory reuses them, so once the pool
+ has grown to the peak size of a trajectory, the step loop no longer calls the
+ global allocator. Requests above MEMPOOL_MAX_BLOCK bytes are passed through.
+
+ The pool is per thread, so simulations on separate threads do not share it.
+ Chunks are aligned to their size and start with a pointer to the pool of the
+ thread that cut them, so a block released on another thread goes back to that
+ pool: it is queued there under a lock, and the owning thread takes it back on
+ its next allocation that finds an empty free list, or on trim(). A pool whose
+ thread ends with blocks still in use is kept until the last of them returns.
+ allocations() counts every request served. systemAllocations() counts the calls
+ the pool of this thread made to the global allocator, for its chunks and for the
+ requests it passes through; standard containers are served by the pool, and so
+ counted, through MemPoolAllocator. Compile with -DMEMPOOL_COUNT_GLOBAL to count
+ every call of the global operator new on the thread instead: mempool.cc then
+ replaces the global operators, which is meant for checks, not for the module
+ that is shipped.
+
+ Compile with -DNO_MEMPOOL to send every request to the global allocator,
+ e.g. for checking memory errors with a sanitizer. The counters still work.
+ */
+
+#ifndef __MEMPOOL_H__
+#define __MEMPOOL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <vector>
+
+// Small blocks come in multiples of MEMPOOL_GRANULE, which is also the alignment,
+// up to MEMPOOL_SMALL_BLOCK. Above that, block sizes are powers of two.
+const size_t MEMPOOL_GRANULE = 16;
+const size_t MEMPOOL_SMALL_CLASSES = 64;
+const size_t MEMPOOL_SMALL_BLOCK = MEMPOOL_GRANULE * MEMPOOL_SMALL_CLASSES;
+const size_t MEMPOOL_LARGE_CLASSES = 5;
+const size_t MEMPOOL_CLASSES = MEMPOOL_SMALL_CLASSES + MEMPOOL_LARGE_CLASSES;
+const size_t MEMPOOL_MAX_BLOCK = MEMPOOL_SMALL_BLOCK << MEMPOOL_LARGE_CLASSES;
+const size_t MEMPOOL_CHUNK = 128 * 1024;
+
+class MemPool {
+public:
+
+	static void* allocate(size_t size) {
+
+		State& pool = state();
+		pool.allocations++;
+
+#ifndef NO_MEMPOOL
+		if (size <= MEMPOOL_MAX_BLOCK) {
+
+			size_t sizeClass = classOf(size);
+			void* block = pool.freeList[sizeClass];
+
+			pool.live++;
+
+			if (block == NULL && pool.remotePending.load(std::memory_order_relaxed)) {
+				pool.drain();
+				block = pool.freeList[sizeClass];
+			}
+
+			if (block != NULL) {
+				pool.freeList[sizeClass] = *(void**) block;
+				return block;
+			}
+
+			size_t bytes = classSize(sizeClass);
+
+			if ((size_t) (pool.chunkEnd - pool.cursor) < bytes) {
+				pool.grow();
+			}
+
+			block = pool.cursor;
+			pool.cursor += bytes;
+			return block;
+		}
+#endif
+
+		pool.systemAllocations++;
+		return ::operator new(size);
+
+	}
+
+	// size must be the size the block was allocated with.
+	static void release(void* block, size_t size) {
+
+		if (block == NULL)
+			return;
+
+#ifndef NO_MEMPOOL
+		if (size <= MEMPOOL_MAX_BLOCK) {
+
+			State& pool = state();
+			State* owner = *(State**) ((uintptr_t) block & ~(uintptr_t) (MEMPOOL_CHUNK - 1));
+			size_t sizeClass = classOf(size);
+
+			if (owner != &pool) {
+				owner->releaseRemote(block, sizeClass);
+				return;
+			}
+
+			*(void**) block = pool.freeList[sizeClass];
+			pool.freeList[sizeClass] = block;
+			pool.live--;
+			return;
+		}
+#endif
+
+		::operator delete(block);
+
+	}
+
+	// Arrays of plain types (ints, pointers, doubles). Like new T[n], the
+	// elements are not initialized. The length is kept in a header, so
+	// deleteArray needs only the pointer.
+	template<class T>
+	static T* newArray(int n) {
+
+		size_t bytes = MEMPOOL_GRANULE + (n > 0 ? n : 0) * sizeof(T);
+		char* block = (char*) allocate(bytes);
+
+		*(size_t*) block = bytes;
+		return (T*) (block + MEMPOOL_GRANULE);
+
+	}
+
+	template<class T>
+	static void deleteArray(T* array) {
+
+		if (array == NULL)
+			return;
+
+		char* block = ((char*) array) - MEMPOOL_GRANULE;
+		release(block, *(size_t*) block);
+
+	}
+
+	static long allocations(void) {
+
+		return state().allocations;
+
+	}
+
+	static long systemAllocations(void) {
+
+#ifdef MEMPOOL_COUNT_GLOBAL
+		return globalAllocations;
+#else
+		return state().systemAllocations;
+#endif
+
+	}
+
+#ifdef MEMPOOL_COUNT_GLOBAL
+	// the calls of the global operator new of this thread, see mempool.cc.
+	static thread_local long globalAllocations;
+#endif
+
+	// Hands the chunks back to the global allocator, if no block is in use.
+	static void trim(void) {
+
+		state().trim();
+
+	}
+
+private:
+
+	static size_t classOf(size_t size) {
+
+		if (size <= MEMPOOL_SMALL_BLOCK)
+			return (size == 0) ? 0 : (size - 1) / MEMPOOL_GRANULE;
+
+		size_t sizeClass = MEMPOOL_SMALL_CLASSES;
+
+		for (size_t bytes = 2 * MEMPOOL_SMALL_BLOCK; bytes < size; bytes *= 2) {
+			sizeClass++;
+		}
+
+		return sizeClass;
+
+	}
+
+	static size_t classSize(size_t sizeClass) {
+
+		if (sizeClass < MEMPOOL_SMALL_CLASSES)
+			return (sizeClass + 1) * MEMPOOL_GRANULE;
+
+		return MEMPOOL_SMALL_BLOCK << (sizeClass - MEMPOOL_SMALL_CLASSES + 1);
+
+	}
+
+	// The methods that are not on the hot path are in mempool.cc.
+	struct State {
+
+		State(void) {
+
+			for (size_t i = 0; i < MEMPOOL_CLASSES; i++) {
+				freeList[i] = NULL;
+			}
+
+		}
+
+		~State(void) {
+
+			freeChunks();
+
+		}
+
+		void grow(void);
+		void trim(void);
+		void freeChunks(void);
+
+		// takes back the blocks that other threads released.
+		void drain(void);
+		void drainLocked(void);
+
+		// for a block of this pool that is released on another thread.
+		void releaseRemote(void* block, size_t sizeClass);
+
+		// called when the thread ends; deletes the pool if no block is in use.
+		void retire(void);
+
+		void* freeList[MEMPOOL_CLASSES];
+		std::vector<void*> chunks;
+		char* cursor = NULL;
+		char* chunkEnd = NULL;
+
+		long live = 0;
+		long allocations = 0;
+		long systemAllocations = 0;
+
+		// blocks released on other threads, each holding the next one and its
+		// size class; guarded by lock, as is orphaned.
+		std::mutex lock;
+		void* remote = NULL;
+		std::atomic<bool> remotePending { false };
+		bool orphaned = false;
+
+	};
+
+	// the pool outlives its thread while blocks of it are in use elsewhere.
+	struct Holder {
+
+		Holder(void) :
+				pool(new State) {
+		}
+
+		~Holder(void) {
+
+			pool->retire();
+
+		}
+
+		State* pool;
+
+	};
+
+	static State& state(void) {
+
+		static thread_local Holder holder;
+		return *holder.pool;
+
+	}
+
+};
+
+// Class-level operator new and delete that take their blocks from MemPool.
+// Deleting through a base pointer needs a virtual destructor, so that the
+// size passed to operator delete is that of the most derived class.
+#define MEMPOOL_OPERATORS \
+	static void* operator new(size_t size) { return MemPool::allocate(size); } \
+	static void operator delete(void* block, size_t size) { MemPool::release(block, size); }
+
+// For standard containers whose storage should come from MemPool, e.g.
+//   std::vector<Loop*, MemPoolAllocator<Loop*> >
+template<class T>
+class MemPoolAllocator {
+public:
+	typedef T value_type;
+
+	MemPoolAllocator(void) {
+	}
+
+	template<class U>
+	MemPoolAllocator(const MemPoolAllocator<U>&) {
+	}
+
+	T* allocate(size_t n) {
+
+		return (T*) MemPool::allocate(n * sizeof(T));
+
+	}
+
+	void deallocate(T* block, size_t n) {
+
+		MemPool::release(block, n * sizeof(T));
+
+	}
+
+};
+
+template<class T, class U>
+bool operator==(const MemPoolAllocator<T>&, const MemPoolAllocator<U>&) {
+	return true;
+}
+
+template<class T, class U>
+bool operator!=(const MemPoolAllocator<T>&, const MemPoolAllocator<U>&) {
+	return false;
+}
+
+#endif
@@ -19,6 +19,7 @@ const int MOVE_3 = 32;
 
 #include <string>
 #include <moveutil.h>
+#include "mempool.h"
 #include "simtimer.h"
 
 using std::string;
@@ -65,6 +66,8 @@ public:
 	friend class OpenLoop;
 	friend class BulgeLoop;
 	friend class StrandComplex;
+	friend struct MoveArray;
+	friend class MoveList;
 protected:
 	int type;
 
@@ -78,13 +81,15 @@ class MoveContainer {
 public:
 	MoveContainer(void);
 	virtual ~MoveContainer(void);
-	virtual void addMove(Move *newmove) = 0;
+	MEMPOOL_OPERATORS
+	virtual void addMove(const Move& newmove) = 0;
 	double getRate(void);
 
 	virtual void resetDeleteMoves(void) = 0;
 	virtual Move *getChoice(SimTimer& timer) = 0;
+	virtual Move *getChoiceIndexed(SimTimer& timer) = 0;
 	virtual Move *getMove(Move *iterator) = 0;
-	virtual uint16_t getCount(void) = 0;
+	virtual int getCount(void) = 0;
 	virtual void printAllMoves(bool) = 0;
 
 protected:
@@ -92,26 +97,38 @@ protected:
 
 };
 
+// Moves of one kind (creation or deletion), stored by value. The rate of each
+// move and the running sum of the rates are kept in dense arrays of their own,
+// so selection scans and bisects those without touching the moves.
+struct MoveArray {
+	Move* moves = NULL;
+	double* rates = NULL;
+	double* cumul = NULL;
+	int count = 0;
+	int size = 0;
+
+	void add(const Move& move);
+	void grow(int newSize);
+	void clear(void); // removes the moves, but keeps the storage.
+	void release(void);
+};
+
 class MoveList: public MoveContainer {
 public:
 	MoveList(int initial_size);
 	~MoveList(void);
-	void addMove(Move *newmove);
+	void addMove(const Move& newmove);
 	Move *getChoice(SimTimer& timer);
+	Move *getChoiceIndexed(SimTimer& timer); // binary search on the cumulative rates
 	Move *getMove(Move *iterator);
-	uint16_t getCount(void);
+	int getCount(void);
 	void resetDeleteMoves(void);
 	void printAllMoves(bool);
 
-	//  friend class Move;
 private:
-	Move **moves;
-	Move **del_moves;
-	uint16_t moves_size;
-	uint16_t moves_index;
-	uint16_t del_moves_size;
-	uint16_t del_moves_index;
-	uint16_t int_index;
+	MoveArray create; // creation and shift moves, chosen before deletion moves.
+	MoveArray del;
+	int int_index;
 };
 
 #endif
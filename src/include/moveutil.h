@@ -128,11 +128,21 @@ struct HalfContext {
 	bool operator==(const HalfContext& other) const;
 	bool operator<(const HalfContext&) const;
 
+	// position of this context in OpenInfo::tally and EnergyModel::contextJoinRates;
+	// follows the ordering of operator<.
+	int index(void) const {
+		return left * HALFCONTEXT_SIZE + right;
+	}
+
+	static HalfContext fromIndex(int);
+
 	QuartContext left = endC;
 	QuartContext right = endC;
 
 };
 
+const int HALFCONTEXT_COUNT = HALFCONTEXT_SIZE * HALFCONTEXT_SIZE;
+
 struct JoinCriteria {
 
 	JoinCriteria();
@@ -165,7 +175,9 @@ public:
 
 	double crossRate(OpenInfo&, EnergyModel&);
 
-	map<HalfContext, BaseCount> tally;
+	// exposed bases for every half-context, indexed by HalfContext::index().
+	// Contexts that do not occur simply hold a zero count.
+	BaseCount tally[HALFCONTEXT_COUNT];
 
 	int numExposedInternal = 0;
 	int numExposed = 0;
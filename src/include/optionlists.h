@@ -13,9 +13,15 @@ help@multistrand.org
 #define STOPTYPE_LOOSE_STRUCTURE               3
 #define STOPTYPE_PERCENT_OR_COUNT_STRUCTURE    4
 
+// pair table entries for unpaired positions and strand breaks
+#define PAIR_NONE                             -1
+#define PAIR_BREAK                            -2
+
 #include <python2.7/Python.h>
 #include <string>
+#include <vector>
 using std::string;
+using std::vector;
 
 // for PyObject *
 
@@ -47,9 +53,16 @@ class identList {
   void  make_unique( strandList *strands);
   std::string toString(void);
 
+  // maps a strand name to a small integer, equal names get equal integers.
+  static int internName( const char *name );
+
+  // hash of a circular list of interned names; equal for every rotation of the list.
+  static unsigned long rotationKey( vector<int>& nameIds );
+
   // public variables.
   long uid;
   char *id;
+  int nameId; // interned id, compared instead of the name when checking stop conditions
   PyObject *pyo_id;  // needed for correct ref counting dealloc.
   class identList *next;
 };
@@ -64,12 +77,16 @@ class complexItem {
 
   // functions
   string toString();
+  void compile(void);
 
 
   // public variables
   char *structure;
   int type;
   int count; // for use with percentage or count stop types
+  int id_count; // number of entries in strand_ids
+  unsigned long strandKey; // identList::rotationKey of strand_ids
+  vector<int> pairs; // pair table of structure, see StrandOrdering::getPairTable
   class identList *strand_ids;
   class complexItem *next;
 };
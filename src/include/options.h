@@ -145,6 +145,10 @@ help@multistrand.org
 #define pushTransitionInfo( options_obj, obj ) \
   _m_pushList( options_obj, obj, add_transition_info )
 
+// This macro DECREFs the passed obj once it's done with it.
+#define pushResultColumns( options_obj, obj ) \
+  _m_pushList( options_obj, obj, add_result_columns )
+
 #endif  // DEBUG_MACROS is FALSE (not set).
 
 /***************************************************
@@ -288,6 +292,10 @@ help@multistrand.org
 #define pushTransitionInfo( options_obj, obj ) \
   _m_d_pushList( options_obj, obj, add_transition_info )
 
+// This macro DECREFs the passed obj once it's done with it.
+#define pushResultColumns( options_obj, obj ) \
+  _m_d_pushList( options_obj, obj, add_result_columns )
+
 #endif
 
 /*****************************************************
@@ -309,6 +317,7 @@ static inline bool _m_testLongAttr(PyObject *obj, const char *attrname, const ch
 		return (local_val < value);
 	if (test[0] == '>')
 		return (local_val > value);
+	return false;
 }
 
 #ifdef DEBUG_MACROS
@@ -344,6 +353,7 @@ static inline bool _m_d_testLongAttr( PyObject *obj, const char *attrname, const
 		if( test[0] == '>' )
 		return (local_val > value );
 	}
+	return false;
 }
 #endif
 
@@ -457,6 +467,14 @@ const int ENERGYMODEL_VIENNA = 0x00;
 const int ENERGYMODEL_NUPACK = 0x01;
 
 
+/* WARNING: If you change the following defines, you must also
+ change the values in Literals.selection_linear and Literals.selection_sumtree
+ in the file options.py.
+ */
+const int SELECTION_ENGINE_LINEAR = 0x00;
+const int SELECTION_ENGINE_SUMTREE = 0x01;
+
+
 /* WARNING: If you change the following defines, you must also
  change the values in python_options._OptionsConstants.SUBSTRATE_TYPE
  in the file python_options.py.
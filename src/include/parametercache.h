@@ -0,0 +1,91 @@
+/*
+ Copyright (c) 2017 California Institute of Technology. All rights reserved.
+ Multistrand nucleic acid kinetic simulator
+ help@multistrand.org
+ */
+
+/* ParameterCache: the energy parameters of NupackEnergyModel, read from the
+ NUPACK parameter files and scaled to the temperature and salt of a run, kept as
+ one binary blob so that the next energy model for the same files and conditions
+ copies the tables instead of parsing the files again.
+
+ The tables as read from the files, before they are scaled, are kept too, under the
+ unscaled key: an energy model at another temperature or salt scales those, and
+ only the first energy model for the files parses them.
+
+ The blobs of a process are kept for its later energy models, the most recently
+ used PARAMETER_CACHE_ENTRIES of them. With Options.parameter_cache, they are also
+ written to that directory, a file per key, which other processes map read-only;
+ a file of another version or key, or whose tables do not match their checksum,
+ is rebuilt, not trusted.
+ */
+
+#ifndef __PARAMETERCACHE_H__
+#define __PARAMETERCACHE_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+
+#include "energymodel.h"
+
+const uint32_t PARAMETER_CACHE_VERSION = 1; // of the layout below
+const int PARAMETER_CACHE_ENTRIES = 32;
+
+// no padding, so that keys compare with memcmp.
+struct ParameterKey {
+
+	uint64_t hash_dG; // of the contents of the files
+	uint64_t hash_dH;
+	double temperature;
+	double sodium;
+	double magnesium;
+	int64_t substrate;
+
+};
+
+struct ParameterTables {
+
+	array<array<double, PAIRS_NUPACK>, PAIRS_NUPACK> stack_dG, stack_dH;
+	hairpin_energies hairpin_dG, hairpin_dH;
+	array<double, 31> bulge_dG, bulge_dH;
+	internal_energies internal_dG, internal_dH;
+	multiloop_energies multiloop_dG, multiloop_dH;
+
+	double terminal_AU, terminal_AU_dH;
+	double bimolecular_penalty, bimolecular_penalty_dH;
+	double log_loop_penalty;
+
+};
+
+struct ParameterBlob {
+
+	char magic[8]; // "MSPARAM"
+	uint32_t version;
+	uint32_t size; // sizeof(ParameterBlob), for the layout of another build
+	ParameterKey key;
+	uint64_t checksum; // of the tables
+	ParameterTables tables;
+
+};
+
+class ParameterCache {
+public:
+
+	// the key of the parameter files, read from the start; they are rewound after.
+	static ParameterKey key(FILE* dG, FILE* dH, EnergyOptions* options);
+
+	// the key of the tables of the same files before they are scaled.
+	static ParameterKey unscaled(const ParameterKey& key);
+
+	// copies the tables for the key into tables, from this process or the directory,
+	// if the directory is not empty; false if there are none.
+	static bool load(const ParameterKey& key, const string& directory, ParameterTables& tables);
+	static void store(const ParameterKey& key, const string& directory, const ParameterTables& tables);
+
+	// forgets the blobs and file hashes of this process, but not the files.
+	static void clear(void);
+
+};
+
+#endif
@@ -0,0 +1,199 @@
+/*
+ Copyright (c) 2017 California Institute of Technology. All rights reserved.
+ Multistrand nucleic acid kinetic simulator
+ help@multistrand.org
+ */
+
+/* PhaseStats: counts and times the phases of the simulation steps, for
+ Options.phase_stats; see SimSystem.phaseStats().
+
+ The phases are timed where they happen, with a PhaseTimer in scope. They nest:
+ the energy of a loop is computed while the moves of the loop are generated,
+ which happens while a move is done, so the time of a phase includes the time of
+ the phases inside it. Times are read from the time stamp counter where there is
+ one, and converted to seconds at the rate measured over the run.
+
+ The energy phases count every loop energy a move is rated with: the calls of
+ the energy model, the hairpin energies found in the table of a strand
+ (StrandTable, counted but not timed), and the multiloop and open loop energies
+ made from LoopTerms, whose set up counts as one call too.
+
+ The statistics are per thread, as MathKernels::check(). The workers of a
+ parallel run add theirs to the system they simulated, each time they go on to
+ the next one, so that every system of a sweep has its own. So is the switch,
+ PhaseStats::enabled: the thread that simulates sets it from the options of the
+ system at hand, so that runs on other threads are not counted. When the run
+ does not ask for them, a PhaseTimer costs one test of it.
+
+ With Options.phase_trace, the first PHASE_TRACE_EVENTS phases other than the
+ energy calls are also kept, and written as a Chrome trace (chrome://tracing,
+ ui.perfetto.dev) when the run is over.
+ */
+
+#ifndef __PHASESTATS_H__
+#define __PHASESTATS_H__
+
+#include <stdint.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+enum PhaseType {
+	PHASE_TRAJECTORY, // from the start state until the trajectory stops
+	PHASE_ADVANCE_TIME, // SimTimer::advanceTime
+	PHASE_SELECT, // choosing the complex and the move, or the join
+	PHASE_DO_CHOICE, // StrandComplex::doChoice
+	PHASE_JOIN, // StrandComplex::performComplexJoin
+	PHASE_GENERATE_MOVES, // Loop::generateMoves, of every loop type
+	PHASE_JOIN_FLUX, // SComplexList::getJoinFlux
+	PHASE_STOP_CHECK, // SComplexList::checkStopComplexList
+	PHASE_EXPORT, // sending states to Python or the trajectory file
+	PHASE_ENERGY_STACK, // the energy model, per loop type
+	PHASE_ENERGY_BULGE,
+	PHASE_ENERGY_INTERIOR,
+	PHASE_ENERGY_HAIRPIN,
+	PHASE_ENERGY_MULTILOOP,
+	PHASE_ENERGY_OPENLOOP,
+	PHASE_COUNT
+};
+
+const char* const phaseNames[PHASE_COUNT] = { "trajectory", "advance_time", "select", "do_choice", "join", "generate_moves", "join_flux",
+		"stop_check", "export", "energy_stack", "energy_bulge", "energy_interior", "energy_hairpin", "energy_multiloop", "energy_openloop" };
+
+const long PHASE_TRACE_EVENTS = 1 << 20; // per thread
+
+struct PhaseEvent {
+
+	int phase;
+	uint64_t begin;
+	uint64_t end;
+
+};
+
+class PhaseStats {
+public:
+
+	long calls[PHASE_COUNT] = { };
+	uint64_t ticks[PHASE_COUNT] = { };
+
+	long steps = 0;
+	long movesGenerated = 0;
+
+	// tracing: the phases in the order they ended, of this thread.
+	bool tracing = false;
+	int thread = 0;
+	std::vector<PhaseEvent> events;
+	std::vector<std::pair<int, std::vector<PhaseEvent> > > threadEvents; // of the workers, once merged
+
+	// the clocks at the start and the end of the run, to convert ticks to seconds.
+	uint64_t beginTicks = 0;
+	uint64_t endTicks = 0;
+	std::chrono::steady_clock::time_point beginTime;
+	std::chrono::steady_clock::time_point endTime;
+
+	// set on the threads of the runs that ask for statistics; otherwise nothing
+	// is counted.
+	static thread_local bool enabled;
+
+	// per thread, like MemPool.
+	static PhaseStats& current(void) {
+
+		static thread_local PhaseStats stats;
+		return stats;
+
+	}
+
+	static uint64_t now(void) {
+
+#if defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+
+	}
+
+	static void countStep(void) {
+
+		if (enabled) {
+			current().steps++;
+		}
+
+	}
+
+	static void countMove(void) {
+
+		if (enabled) {
+			current().movesGenerated++;
+		}
+
+	}
+
+	// a call that is not worth timing, such as an energy found in a table.
+	static void countCall(int phase) {
+
+		if (enabled) {
+			current().calls[phase]++;
+		}
+
+	}
+
+	void record(int phase, uint64_t begin, uint64_t end) {
+
+		calls[phase]++;
+		ticks[phase] += end - begin;
+
+		if (tracing && phase < PHASE_ENERGY_STACK && (long) events.size() < PHASE_TRACE_EVENTS) {
+			PhaseEvent event = { phase, begin, end };
+			events.push_back(event);
+		}
+
+	}
+
+	// clears the statistics of this thread for a run.
+	void start(bool trace, int threadIndex = 0);
+	void stop(void);
+
+	// adds the statistics of a worker, and takes its events.
+	void merge(PhaseStats& worker);
+
+	long energyEvaluations(void);
+	double seconds(uint64_t count);
+
+	// false if the file could not be written.
+	bool writeTrace(const std::string& path);
+
+};
+
+class PhaseTimer {
+public:
+
+	PhaseTimer(int phase) :
+			phase(phase) {
+
+		if (PhaseStats::enabled) {
+			begin = PhaseStats::now();
+		}
+
+	}
+
+	~PhaseTimer(void) {
+
+		if (PhaseStats::enabled) {
+			PhaseStats::current().record(phase, begin, PhaseStats::now());
+		}
+
+	}
+
+private:
+
+	int phase;
+	uint64_t begin = 0;
+
+};
+
+#endif
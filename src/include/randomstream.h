@@ -0,0 +1,141 @@
+/*
+ Copyright (c) 2017 California Institute of Technology. All rights reserved.
+ Multistrand nucleic acid kinetic simulator
+ help@multistrand.org
+ */
+
+/* RandomStream: the random numbers of one simulation system, from the
+ counter-based generator Philox-4x32-10 (Salmon et al., "Parallel random
+ numbers: as easy as 1, 2, 3", SC 2011).
+
+ The n-th number of a stream is a function of the key and n alone, and there is
+ no state besides the counter, so streams of separate systems do not interact.
+ Each trajectory has its own stream, keyed by its seed. The seed of trajectory
+ i of a run is trajectorySeed(initial seed, i), which does not depend on the
+ trajectories before it; trajectory 0 keeps the initial seed. A trajectory can
+ therefore be reproduced by starting a run with the seed reported for it,
+ wherever it ran.
+
+ Uniforms are generated RANDOM_BLOCK at a time.
+ */
+
+#ifndef __RANDOMSTREAM_H__
+#define __RANDOMSTREAM_H__
+
+#include <stdint.h>
+
+const int RANDOM_BLOCK = 64; // uniforms per refill, a multiple of 2
+
+class RandomStream {
+public:
+
+	RandomStream(void) {
+
+		setSeed(0);
+
+	}
+
+	void setSeed(long seed) {
+
+		key = (uint64_t) seed;
+		counter = 0;
+		used = RANDOM_BLOCK;
+
+	}
+
+	long getSeed(void) {
+
+		return (long) key;
+
+	}
+
+	// uniform in [0, 1), with 53 random bits.
+	double uniform(void) {
+
+		if (used == RANDOM_BLOCK) {
+			refill();
+		}
+
+		return block[used++];
+
+	}
+
+	// the seed of trajectory index in a run that starts from seed.
+	static long trajectorySeed(long seed, long index) {
+
+		if (index == 0) {
+			return seed;
+		}
+
+		uint32_t ctr[4] = { (uint32_t) index, (uint32_t) ((uint64_t) index >> 32), TRAJECTORY_DOMAIN, 0 };
+		philox(ctr, (uint64_t) seed);
+
+		// non-negative, since the seeds also name the output directories of the statespace builder.
+		return (long) ((((uint64_t) ctr[0] << 32) | ctr[1]) >> 1);
+
+	}
+
+	// one block of the generator: ctr is replaced by the output.
+	static void philox(uint32_t ctr[4], uint64_t seed) {
+
+		uint32_t k0 = (uint32_t) seed;
+		uint32_t k1 = (uint32_t) (seed >> 32);
+
+		for (int round = 0; round < 10; round++) {
+
+			if (round > 0) {
+				k0 += 0x9E3779B9;
+				k1 += 0xBB67AE85;
+			}
+
+			uint64_t p0 = (uint64_t) 0xD2511F53 * ctr[0];
+			uint64_t p1 = (uint64_t) 0xCD9E8D57 * ctr[2];
+
+			uint32_t c0 = (uint32_t) (p1 >> 32) ^ ctr[1] ^ k0;
+			uint32_t c2 = (uint32_t) (p0 >> 32) ^ ctr[3] ^ k1;
+
+			ctr[1] = (uint32_t) p1;
+			ctr[3] = (uint32_t) p0;
+			ctr[0] = c0;
+			ctr[2] = c2;
+		}
+
+	}
+
+private:
+
+	// the third counter word separates the uniforms from the trajectory seeds.
+	static const uint32_t UNIFORM_DOMAIN = 0;
+	static const uint32_t TRAJECTORY_DOMAIN = 1;
+
+	void refill(void) {
+
+		for (int i = 0; i < RANDOM_BLOCK; i += 2) {
+
+			uint32_t ctr[4] = { (uint32_t) counter, (uint32_t) (counter >> 32), UNIFORM_DOMAIN, 0 };
+			philox(ctr, key);
+			counter++;
+
+			block[i] = toUniform(ctr[0], ctr[1]);
+			block[i + 1] = toUniform(ctr[2], ctr[3]);
+		}
+
+		used = 0;
+
+	}
+
+	static double toUniform(uint32_t high, uint32_t low) {
+
+		uint64_t bits = (((uint64_t) high << 32) | low) >> 11;
+		return bits * (1.0 / 9007199254740992.0); // 2^-53
+
+	}
+
+	uint64_t key;
+	uint64_t counter; // of the next block
+	int used; // uniforms of the block handed out
+	double block[RANDOM_BLOCK];
+
+};
+
+#endif
@@ -0,0 +1,175 @@
+/*
+ Copyright (c) 2017 California Institute of Technology. All rights reserved.
+ Multistrand nucleic acid kinetic simulator
+ help@multistrand.org
+ */
+
+/* RateTree: a binary sum-tree over rates, used by the sum-tree selection engine.
+
+ Leaves hold the rate of one item (a loop within a complex, or a complex within
+ the complex list). Internal nodes hold the sum of their two children and are
+ recomputed from the children on every update, so the root never accumulates
+ rounding drift. Updates and selections are both O(log n). The tree and its
+ arrays come from MemPool, so growing it in the step loop does not call the
+ global allocator once the pool has warmed up.
+ */
+
+#ifndef __RATETREE_H__
+#define __RATETREE_H__
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "mempool.h"
+
+template<class T>
+class RateTree {
+public:
+
+	RateTree(void) {
+
+		capacity = 0;
+		freeCount = 0;
+
+	}
+
+	~RateTree(void) {
+
+		MemPool::deleteArray(tree);
+		MemPool::deleteArray(items);
+		MemPool::deleteArray(freeSlots);
+
+	}
+
+	RateTree(const RateTree&) = delete;
+	RateTree& operator=(const RateTree&) = delete;
+
+	MEMPOOL_OPERATORS
+
+	// adds an item and returns the slot it was given.
+	int insert(T* item, double rate) {
+
+		if (freeCount == 0) {
+			grow();
+		}
+
+		int slot = freeSlots[--freeCount];
+
+		items[slot] = item;
+		update(slot, rate);
+
+		return slot;
+	}
+
+	void remove(int slot) {
+
+		assert(slot >= 0 && slot < capacity);
+
+		update(slot, 0.0);
+		items[slot] = NULL;
+		freeSlots[freeCount++] = slot;
+
+	}
+
+	void update(int slot, double rate) {
+
+		int node = slot + capacity;
+		tree[node] = rate;
+
+		for (node = node / 2; node > 0; node = node / 2) {
+			tree[node] = tree[2 * node] + tree[2 * node + 1];
+		}
+
+	}
+
+	double getTotal(void) {
+
+		if (capacity == 0)
+			return 0.0;
+
+		return tree[1];
+	}
+
+	// Descends the tree with rchoice and returns the item whose leaf contains it.
+	// On return, rchoice holds the remainder within that leaf, so the caller
+	// can continue the selection inside the item.
+	T* choose(double& rchoice) {
+
+		assert(capacity > 0);
+
+		int node = 1;
+
+		while (node < capacity) {
+
+			double left = tree[2 * node];
+
+			// guard against rounding; never walk into an empty subtree.
+			if (rchoice < left || tree[2 * node + 1] <= 0.0) {
+				node = 2 * node;
+			} else {
+				rchoice -= left;
+				node = 2 * node + 1;
+			}
+		}
+
+		return items[node - capacity];
+
+	}
+
+	int getCount(void) {
+
+		return capacity - freeCount;
+
+	}
+
+private:
+
+	// doubles the number of leaves, and re-sums the internal nodes.
+	void grow(void) {
+
+		int newCapacity = (capacity == 0) ? 8 : 2 * capacity;
+
+		double* newTree = MemPool::newArray<double>(2 * newCapacity);
+		T** newItems = MemPool::newArray<T*>(newCapacity);
+		int* newSlots = MemPool::newArray<int>(newCapacity);
+
+		for (int i = 0; i < newCapacity; i++) {
+			newTree[newCapacity + i] = (i < capacity) ? tree[capacity + i] : 0.0;
+			newItems[i] = (i < capacity) ? items[i] : NULL;
+		}
+
+		for (int node = newCapacity - 1; node > 0; node--) {
+			newTree[node] = newTree[2 * node] + newTree[2 * node + 1];
+		}
+
+		newTree[0] = 0.0;
+
+		for (int i = 0; i < freeCount; i++) {
+			newSlots[i] = freeSlots[i];
+		}
+
+		// hand out the lowest slots first.
+		for (int slot = newCapacity - 1; slot >= capacity; slot--) {
+			newSlots[freeCount++] = slot;
+		}
+
+		MemPool::deleteArray(tree);
+		MemPool::deleteArray(items);
+		MemPool::deleteArray(freeSlots);
+
+		tree = newTree;
+		items = newItems;
+		freeSlots = newSlots;
+		capacity = newCapacity;
+
+	}
+
+	double* tree = NULL; // node 1 is the root, leaves from capacity on
+	T** items = NULL;
+	int* freeSlots = NULL; // a stack of freeCount unused slots
+	int capacity;
+	int freeCount;
+
+};
+
+#endif
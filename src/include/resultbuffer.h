@@ -0,0 +1,55 @@
+/*
+ Copyright (c) 2017 California Institute of Technology. All rights reserved.
+ Multistrand nucleic acid kinetic simulator
+ help@multistrand.org
+ */
+
+/* ResultBuffer: the results of the trajectories of a run, with one array per
+ field (seed, stop result type, stop time, collision rate, stop tag), instead of
+ a Python tuple and result object per trajectory. Used when
+ Options.columnar_results is set.
+
+ When the run is over, release() hands the arrays to Python as ResultColumn
+ objects, which own them and expose them through the buffer protocol, so that
+ numpy.frombuffer (or memoryview) reads them without a copy. The tags are
+ stored once, and each trajectory keeps the index of its tag.
+ */
+
+#ifndef __RESULTBUFFER_H__
+#define __RESULTBUFFER_H__
+
+#include <python2.7/Python.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+
+using std::string;
+
+class ResultBuffer {
+public:
+
+	void add(long seed, long type, double time, double rate, const char* tag);
+	long size(void);
+
+	// New reference: the tuple (first step, seeds, types, times, rates, tag ids, tags),
+	// where tags is a list of strings and the others are ResultColumn objects. The
+	// buffer is empty afterwards, and the tag ids start again from 0.
+	PyObject* release(bool firstStep);
+
+private:
+	std::vector<int64_t> seeds;
+	std::vector<int32_t> types;
+	std::vector<double> times;
+	std::vector<double> rates;
+	std::vector<int32_t> tagIds;
+
+	std::vector<string> tags;
+	std::map<string, int32_t> tagIndex;
+
+};
+
+// multistrand.system.ResultColumn, registered by the module.
+extern PyTypeObject ResultColumn_Type;
+
+#endif
@@ -9,12 +9,17 @@
 #define __SCOMPLEX_H__
 
 #include "loop.h"
+#include "mempool.h"
 #include <string>
+#include <vector>
 
 #include "strandordering.h"
 #include "optionlists.h"
 #include "simtimer.h"
 
+// the loops of a complex; the storage comes from MemPool, see mempool.h.
+typedef std::vector<Loop*, MemPoolAllocator<Loop*> > LoopList;
+
 class StrandComplex {
 public:
 	// Constructors. Still not sure on exactly how I want to do these. For now, they take a character sequence and structure.
@@ -22,21 +27,23 @@ public:
 	StrandComplex(char *seq, char *struc, class identList *id_list);
 	StrandComplex(StrandOrdering *newOrdering);
 	~StrandComplex(void);
+	MEMPOOL_OPERATORS
 	void cleanup(void);
 
 	// information retrieval functions
 	double getTotalFlux(void); // returns total flux for all moves within the complex
-	uint16_t getMoveCount(void); // returns total number of transitions in the complex
+	int getMoveCount(void); // returns total number of transitions in the complex
 	int getStrandCount(void); // # of strands in the complex.
 	double getEnergy(void); // returns the energy of the complex
 	double getEnthalpy(void); // return the enthalpy of the complex
+	void getLoops(LoopList& loops); // appends the loops of the complex
 	void generateMoves(void); // display function to output the dot-paren structure of all moves contained in this complex. Should be preceded by printing the sequence, possibly I should change it to just do that straight out. Used for testing purposes (comparing all moves adjacent and rates).
 	string& getSequence(void); // returns char representation of sequence
 	string& getStructure(void); // returns dot-paren notation structure for seq.
 	char *getStrandNames(void); // returns ordered list of strand names
 	BaseCount& getExteriorBases(HalfContext* = NULL);
 	int checkIDList(class identList *stoplist, int id_count);
-	int checkIDBound(char *id);
+	int checkIDBound(int nameId);
 
 	// published functions to affect the complex, these being a choice being made on the move set inside the complex, usually.
 	// Once these are working, will need to add functions to merge complexes and perhaps others. Also, performing a choice will need to be able to pop a disassociation event back to the main system. Maybe do this with exceptions?
@@ -54,9 +61,14 @@ public:
 	static StrandComplex *performComplexJoin(JoinCriteria, bool);
 	StrandOrdering* getOrdering();
 
+	void enableRateTree(void); // selects moves through a sum-tree over the loops, see ratetree.h
+
 	StrandOrdering* ordering;
 private:
+	void rebuildLoopSums(bool enableTree = false);
+
 	Loop *beginLoop;
+	LoopSums* loopSums;
 
 };
 
@@ -8,9 +8,11 @@
 
 #include <stdio.h>
 #include <iostream>
+#include <map>
 
 #include "scomplex.h"
 #include "energymodel.h"
+#include "mempool.h"
 #include "optionlists.h"
 #include "simtimer.h"
 #include "strandordering.h"
@@ -31,7 +33,7 @@ public:
 	void regenerateMoves(void);
 	double getTotalFlux(void);
 	double getJoinFlux(void);
-	uint16_t getMoveCount(void);
+	int getMoveCount(void);
 
 	BaseCount getExposedBases();
 	OpenInfo getOpenInfo();
@@ -56,8 +58,12 @@ public:
 private:
 	bool checkStopComplexList_Bound(class complexItem *stoplist);
 	bool checkStopComplexList_Structure_Disassoc(class complexItem *stoplist);
-	bool checkLooseStructure(const char *our_struc, const char *stop_struc, int count);
-	bool checkCountStructure(const char *our_struc, const char *stop_struc, int count);
+	bool checkLooseStructure(StrandOrdering *ordering, complexItem *stopItem);
+	bool checkCountStructure(StrandOrdering *ordering, complexItem *stopItem);
+	bool checkStructureDistance(StrandOrdering *ordering, complexItem *stopItem, bool wildcard);
+	void updateEntry(SComplexListEntry* entry); // fillData, and update the entry's leaf in entryTree.
+	void updateExterior(SComplexListEntry* entry); // refresh exteriorSum and joinMoveCount if the exterior changed.
+	void removeExterior(SComplexListEntry* entry);
 
 	int numOfComplexes = 0;
 	int idcounter = 0;
@@ -67,13 +73,32 @@ private:
 
 	double joinRate = 0.0;	// joinrate is the sum of collision rates in the state.
 
+	// Sum of the exterior bases over all complexes, and the number of
+	// join moves between distinct complexes. Kept current by updateExterior.
+	BaseCount exteriorSum;
+	int joinMoveCount = 0;
+
+	// entryTree holds the rate of every entry. With the sum-tree selection engine,
+	// complexes are also picked from it, and moves from the complex's loop tree.
+	bool useRateTree = false;
+	RateTree<SComplexListEntry>* entryTree = NULL;
+
 }
 ;
 
+// Cached Arrhenius collision rate between two complexes,
+// valid while both exterior versions are unchanged.
+struct CrossRate {
+	long version = -1;
+	long otherVersion = -1;
+	double rate = 0.0;
+};
+
 class SComplexListEntry {
 public:
 	SComplexListEntry(StrandComplex *newComplex, int newid);
 	~SComplexListEntry(void);
+	MEMPOOL_OPERATORS
 	void initializeComplex(void);
 	void regenerateMoves(void);
 	void fillData(EnergyModel *em);
@@ -85,6 +110,11 @@ public:
 	energyS ee_energy;
 	double energy;
 	double rate;
+	int rateSlot; // leaf in SComplexList::entryTree.
+
+	BaseCount exterior; // the exterior bases as last counted in SComplexList::joinMoveCount
+	long exteriorVersion;
+	std::map<int, CrossRate> crossRates; // keyed by the id of the other entry.
 
 	SComplexListEntry *next;
 };
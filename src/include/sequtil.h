@@ -63,7 +63,8 @@ struct BaseCount {
 	int C(void);
 
 	// the actual data structure; rest is convienience
-	vector<int> count = { 0, 0, 0, 0, 0 }; // use baseType as access
+	// a plain array, so that copying or clearing a BaseCount never allocates.
+	int count[BASETYPE_SIZE] = { 0, 0, 0, 0, 0 }; // use baseType as access
 };
 
 #endif
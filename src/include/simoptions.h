@@ -22,6 +22,7 @@
 #include <iostream>
 
 #include "energyoptions.h"
+#include "resultbuffer.h"
 #include "utility.h"
 
 using std::vector;
@@ -29,6 +30,7 @@ using std::string;
 using namespace utility;
 
 class EnergyOptions;
+class JobFile;
 
 // FD: SimOptions contains an EnergyOptions object.
 // Both simOptions and energyOptions are meant to contain static values.
@@ -75,6 +77,9 @@ public:
 	// For a first step result, also report the collision rate.
 	virtual void stopResultFirstStep(long, double, double, const char*) = 0;
 
+	// One complex of the final state, sent before the stop result.
+	virtual void sendComplexState(long, ExportData&) = 0;
+
 
 // IO Methods
 	string toString(void);
@@ -89,8 +94,29 @@ public:
 
 	bool statespaceActive = false;
 	long verbosity = 1;
+	long selectionEngine = 0; // linear scan or sum-tree, see SELECTION_ENGINE_*
+	long mathKernels = 0; // libm, tables, or both, see KERNELS_* in mathkernels.h
+	bool specializedModel = true; // see NupackEnergyModel::create
 	double ms_version = 0.0;
 
+	// keep the stop results in columns, to be handed to python when the run is over,
+	// and do not send the final states.
+	bool columnarResults = false;
+	ResultBuffer results;
+
+	// if not empty, the trajectory states are written to this file, see trajectoryfile.h.
+	string trajectoryFile;
+	long trajectoryKeyframes = 0; // if positive, the states between keyframes are written as base pair changes
+
+	// count and time the phases of the steps, see phasestats.h; if phaseTrace is
+	// not empty, the phases are also written there as a Chrome trace.
+	bool phaseStats = false;
+	string phaseTrace;
+
+	// if not empty, the energy parameters are cached in this directory, see parametercache.h.
+	string parameterCache;
+	bool logConstants = false; // write the model constants to multistrandRun.log
+
 protected:
 
 	long simulation_mode = 0;
@@ -125,6 +151,7 @@ public:
 	void stopResultNormal(long, double, char*);
 	void stopResultTime(long, double);
 	void stopResultFirstStep(long, double, double, const char*);
+	void sendComplexState(long, ExportData&);
 
 protected:
 	bool debug;
@@ -132,12 +159,14 @@ protected:
 
 };
 
-// FD: Starting multistrand without the python wrapper
-// is not implemented at this time, so the below is not functional.
+// The options of a job file (see jobfile.h), for the multistrand-sim executable. The
+// results are written to output as they come, one line per trajectory: the seed, the
+// tag and the time, and for the first step mode also the collision rate, separated
+// by tabs. The final states are not written.
 class CSimOptions: public SimOptions {
 public:
 	//constructors
-	CSimOptions();
+	CSimOptions(JobFile* job, FILE* output);
 
 	PyObject* getPythonSettings(void);
 	void generateComplexes(PyObject *alternate_start, long current_seed);
@@ -149,10 +178,63 @@ public:
 	void stopResultNormal(long, double, char*);
 	void stopResultTime(long, double);
 	void stopResultFirstStep(long, double, double, const char*);
+	void sendComplexState(long, ExportData&);
 
 protected:
-	bool debug;
-	PyObject *python_settings = NULL;
+	void writeResult(long seed, const char* tag, double time, double rate);
+
+	JobFile* job;
+	FILE* output;
+	bool headerWritten = false;
+
+};
+
+// What a trajectory of a parallel run reported, in the order it was reported.
+struct TrajectoryReport {
+
+	enum Type {
+		RESULT_ERROR, RESULT_NAN, RESULT_NORMAL, RESULT_TIME, RESULT_FIRST_STEP, COMPLEX_STATE
+	};
+
+	Type type;
+	long seed;
+	double time = 0.0;
+	double rate = 0.0;
+	string tag;
+	ExportData state; // for COMPLEX_STATE
+
+};
+
+typedef vector<TrajectoryReport> TrajectoryLog;
+
+// The options of a worker thread of SimulationSystem::StartSimulationParallel. The
+// settings are those of the options it is made from, and so are the stop conditions.
+// The start state is read through those options, taking the GIL; what a trajectory
+// reports goes to its log, which replay hands to those options once the run is over.
+class WorkerSimOptions: public SimOptions {
+public:
+	// on the thread that holds the GIL.
+	WorkerSimOptions(SimOptions* parent);
+	~WorkerSimOptions(void);
+
+	PyObject* getPythonSettings(void);
+	void generateComplexes(PyObject *alternate_start, long current_seed);
+	stopComplexes* getStopComplexes(int);
+
+	void stopResultError(long);
+	void stopResultNan(long);
+	void stopResultNormal(long, double, char*);
+	void stopResultTime(long, double);
+	void stopResultFirstStep(long, double, double, const char*);
+	void sendComplexState(long, ExportData&);
+
+	static void replay(TrajectoryLog& log, SimOptions* target);
+
+	// the log of the trajectory being simulated.
+	TrajectoryLog* log = NULL;
+
+protected:
+	SimOptions* parent;
 
 };
 
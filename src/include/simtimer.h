@@ -3,11 +3,12 @@
 #define __SIMTIMER_H__
 
 class SimOptions;
+class RandomStream;
 
 class SimTimer {
 
 public:
-	SimTimer(SimOptions& myOptions);
+	SimTimer(SimOptions& myOptions, RandomStream& myRandom);
 
 	void advanceTime(void);
 	bool wouldBeHit(const double);
@@ -33,6 +34,8 @@ public:
 private:
 
 	SimOptions* simOptions = NULL;
+	RandomStream* random = NULL;
+	long kernels = 0; // see KERNELS_* in mathkernels.h
 
 };
 
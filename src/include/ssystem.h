@@ -18,6 +18,9 @@
 #include "scomplexlist.h"
 #include "statespace.h"
 #include "moveutil.h"
+#include "randomstream.h"
+#include "trajectoryfile.h"
+#include "phasestats.h"
 
 typedef std::vector<bool> boolvector;
 typedef std::vector<bool>::iterator boolvector_iterator;
@@ -31,22 +34,49 @@ const static std::string STR_TIMEOUT = "timeout";
 
 }
 
+struct ParallelRun;
+struct ParallelPart;
+class WorkerSimOptions;
+
 class SimulationSystem {
 public:
 	SimulationSystem(SimOptions* options);
 	SimulationSystem(PyObject* system_options);
 	SimulationSystem(void);
 
+	// simulates with the energy model of another system, see StartSimulationParallel.
+	SimulationSystem(SimOptions* options, EnergyModel* model);
+
 	// helper method for constructors
-	void construct(void);
+	void construct(EnergyModel* model = NULL);
 
 	~SimulationSystem(void);
 
 	void StartSimulation(void);
+
+	// Simulates the trajectories of StartSimulation on the given number of threads (0 for
+	// one per core), which share the energy model. The Python side gets the same results,
+	// in the same order, once all trajectories are done. For the first passage time and
+	// first step modes without state output; parallelUnsupported says why not otherwise.
+	void StartSimulationParallel(int threads);
+	const char* parallelUnsupported(void);
+
+	// Simulates the trajectories of every system, as StartSimulationParallel would, on
+	// one pool of threads: a thread done with the trajectories of one system goes on
+	// with the next, so that no thread idles until the last system. Each system keeps
+	// its energy model and gets its own results. The phase statistics are of the whole
+	// run, with the settings of the first system, and every system gets them.
+	static void StartSweep(std::vector<SimulationSystem*>& systems, int threads);
+
 	void initialInfo(void);	// printing function
 	void localTransitions(void); // builds all transitions in local statespace
 
 	PyObject *calculateEnergy(PyObject *start_state, int typeflag);
+	// a tuple per state, of its energy at each temperature (Kelvin), see EnergySeries.
+	PyObject *calculateEnergyMatrix(PyObject *states, std::vector<double>& temperatures, int typeflag);
+	PyObject *allocationStats(void);
+	PyObject *kernelStats(void);
+	PyObject *phaseStats(void);
 	int isEnergymodelNull(void);
 
 private:
@@ -63,10 +93,17 @@ private:
 	int InitializeSystem(PyObject *alternate_start = NULL);
 
 	void InitializeRNG(void);
+	bool countsPhases(void);
+	void startPhases(void);
+	void finishPhases(PhaseStats& stats);
 	void generateNextRandom(void);
 	void finalizeRun(void);
 	void finalizeSimulation(void);
 
+	void runTrajectory(long index);
+	static void runWorker(ParallelRun* run, int thread);
+	static void finishPart(ParallelRun* run, ParallelPart* part, SimulationSystem* worker);
+
 	// helper function for sending current state to Python side
 	void dumpCurrentStateToPython(void);
 	void sendTrajectory_CurrentStateToPython(double current_time, double arrType = -77.0);
@@ -83,10 +120,14 @@ private:
 	StrandComplex *startState = NULL;
 	SComplexList *complexList = NULL;
 	SimOptions *simOptions = NULL;
+	TrajectoryFile *trajectoryFile = NULL; // see Options.trajectory_file
 
 	PyObject *system_options = NULL;
 
 	long current_seed = NULL;
+	long initial_seed = 0;
+	long trajectory_index = 0; // of the current trajectory since InitializeRNG
+	RandomStream random;
 	long simulation_mode;
 	long simulation_count_remaining;
 
@@ -98,6 +139,21 @@ private:
 	int noInitialMoves = 0;
 	int timeOut = 0;
 
+	// MemPool requests and calls to the global allocator made between the end of
+	// InitializeSystem and finalizeRun, summed over trajectories. For the last
+	// trajectory, the calls made by its steps: from the end of initializeList to
+	// the end of the step loop, before the final state is exported.
+	long loopAllocations = 0;
+	long loopSystemAllocations = 0;
+	long lastSystemAllocations = 0;
+	long allocationMark = 0;
+	long systemAllocationMark = 0;
+	long stepAllocationMark = 0;
+
+	// what the validation mode of the math kernels saw in the last StartSimulation.
+	MathKernels::Check kernelCheck;
+	PhaseStats phases; // of the last run, see phasestats.h
+
 	// A builder object that is only used if export is toggled
 	Builder builder;
 
@@ -8,23 +8,59 @@
 #define __STRANDORDERING_H__
 
 #include "loop.h"
+#include "mempool.h"
 #include "scomplex.h"
 #include "optionlists.h"
 #include <string>
+#include <vector>
 
 // needed for the openloop components of a strand ordering
 
 class OpenLoop;
 
+// The part of a stop structure that lines up with one strand, together with
+// the number of positions where the strand's structure currently differs.
+struct StructTarget {
+	const char* target;
+	bool wildcard; // if set, '*' in the target matches anything
+	int mismatches; // -1 if the target does not have the length of the strand
+};
+
+// A base pair made or broken, recorded for the delta-encoded trajectory files,
+// see StrandOrdering::flipLog and trajectoryfile.h.
+const char FLIP_CREATE = 'C';
+const char FLIP_DELETE = 'D';
+const char FLIP_JOIN = 'J'; // a pair made between two complexes
+const char FLIP_SPLIT = 'S'; // a pair broken between the two complexes it leaves
+
+class orderingList;
+
+struct FlipEvent {
+	char type;
+	orderingList* strands[2];
+	int positions[2]; // in the strands
+};
+
 class orderingList {
 public:
 	orderingList(int insize, int in_id, char *inTag, char *inSeq, char *inCodeSeq, char* inStruct);
 	~orderingList(void);
+	MEMPOOL_OPERATORS
 	orderingList *next, *prev;
 	char *thisTag, *thisSeq, *thisCodeSeq, *thisStruct;
 	OpenLoop *thisLoop; // corresponds to the OpenLoop to the 'left' of this strand
 	int size;
 	int uid;
+	int nameId; // interned thisTag, see identList::internName
+	int unpaired; // number of '.' in thisStruct
+	StrandTable* table; // shared by the strands with this sequence
+
+	// every change to thisStruct goes through setStruct, which keeps the mismatch counts current.
+	void setStruct(int index, char c);
+	int getMismatches(const char* target, bool wildcard);
+
+private:
+	std::vector<StructTarget> targets;
 };
 
 class StrandOrdering {
@@ -34,15 +70,28 @@ public:
 	StrandOrdering(orderingList *beginning, orderingList *ending, int numitems);
 	StrandOrdering(char *in_seq, char *in_structure, char *in_cseq, class identList *strandids);
 	~StrandOrdering(void);
+	MEMPOOL_OPERATORS
 	void cleanup(void);
 	static StrandOrdering * joinOrdering(StrandOrdering *first, StrandOrdering *second);
 	StrandOrdering *breakOrdering(Loop *firstOldBreak, Loop *secondOldBreak, Loop *firstNewBreak, Loop *secondNewBreak); // maybe id or openloop pointer
 	void reorder(OpenLoop *index); // reorder so that open loop passed is the available openloop
-	void addBasepair(char *first_bp, char *second_bp);
-	void breakBasepair(char *first_bp, char *second_bp);
+	void addBasepair(char *first_bp, char *second_bp, char flip = FLIP_CREATE);
+	void breakBasepair(char *first_bp, char *second_bp, char flip = FLIP_DELETE);
 
 	OpenLoop *checkIDList(class identList *stoplist, int count);
-	int checkIDBound(char *id);
+	int checkIDBound(int nameId);
+
+	// identList::rotationKey of the strands in this ordering.
+	unsigned long getStrandKey(void);
+
+	// For every position of getStructure(), the position it pairs with,
+	// or PAIR_NONE / PAIR_BREAK. Base pair moves update the table in O(1);
+	// it is rebuilt when the strands are reordered, joined or split.
+	std::vector<int>& getPairTable(void);
+
+	// number of positions where the structure differs from the stop structure,
+	// with the strands aligned as they are now; -1 if the lengths do not line up.
+	int structureMismatches(class complexItem *stopItem, bool wildcard);
 
 	// following three functions are used by SComplex::generateLoops
 	// to generate the loop structure of a given complex, using a flat representation of the starting sequence and structure.
@@ -76,6 +125,11 @@ public:
 	// updates and returns the current exterior base count.
 	BaseCount& getExteriorBases();
 	OpenInfo& getOpenInfo();
+
+	// The exterior bases only change when the set of open loops changes.
+	// The version is unique across orderings and changes with every such event,
+	// so callers can cache anything derived from the exterior.
+	long getExteriorVersion(void);
 	string toString(void);
 
 	// replaces the first open loop in the ordering with the second.
@@ -89,6 +143,9 @@ public:
 	// To be used to generate bimolecular rates.
 	OpenInfo openInfo;
 
+	// If set, every base pair made or broken on this thread is appended here.
+	static thread_local std::vector<FlipEvent>* flipLog;
+
 private:
 	string seq = string();
 	string struc = string();
@@ -96,6 +153,20 @@ private:
 
 	int count = 0;
 	BaseCount exteriorBases;
+	bool exteriorUpToDate = false;
+
+	void invalidateExterior(void);
+	static thread_local long lastExteriorVersion; // versions are compared within a thread only
+	long exteriorVersion = ++lastExteriorVersion;
+
+	unsigned long strandKey = 0;
+	bool strandKeyUpToDate = false;
+
+	std::vector<int> pairTable;
+	bool pairTableUpToDate = false;
+
+	int setStructChar(char *location, char c);
+	void recordFlip(char *left, char *right, char type);
 
 };
 
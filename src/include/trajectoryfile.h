@@ -0,0 +1,196 @@
+/*
+ Copyright (c) 2017 California Institute of Technology. All rights reserved.
+ Multistrand nucleic acid kinetic simulator
+ help@multistrand.org
+ */
+
+/* TrajectoryFile: writes the states exported in trajectory mode (see
+ Options.output_interval, output_time) to a binary file, instead of sending
+ them to Python one complex at a time. Used when Options.trajectory_file is set.
+
+ The file is a TrajectoryFileHeader, the strand table, and one TrajectoryRecord
+ per exported state, appended as the simulation goes. The strand table lists the
+ strands of the first exported state, one "name sequence\n" line each, padded
+ with '\n' so that the records start at headerSize, a multiple of 8. The records
+ can then be read with numpy.memmap; see multistrand.utils.readTrajectoryFile.
+
+ The structures go to a second file, the path with STRUCTURE_SUFFIX appended.
+ A state is one line there, at the offset and with the length (without '\n') of
+ its record. A keyframe has, for every complex, the indexes of its strands in
+ the strand table, separated by ',', then ':' and the structure, with '+' between
+ the strands. Complexes are separated by ' '. For example "0,1:((((+)))) 2:....".
+
+ With a keyframe interval K > 0 (Options.trajectory_keyframes), only the first
+ state of a trajectory and every K-th state after it are keyframes. The others
+ are the base pairs made and broken since the state before, as recorded by
+ StrandOrdering::flipLog, separated by ' ': the FLIP_* type, then the strand and
+ position of both bases, for example "C0:5:0:12" or "J0:3:2:10". If complexes
+ were joined or split, '|' and the complexes of the state follow, as the strand
+ indexes of each complex, for example "S0:3:2:10|0,1 2". The record of every
+ state has the index of the record of its keyframe, and TrajectoryReader
+ reconstructs a state from there.
+
+ The strands of every trajectory are matched to the table by name and sequence,
+ in order, so all trajectories of a run should start from the same strands. A
+ strand that is not in the table is written as index -1, and TrajectoryReader
+ gives an error for the states that have one.
+ */
+
+#ifndef __TRAJECTORYFILE_H__
+#define __TRAJECTORYFILE_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "strandordering.h"
+
+using std::string;
+
+class SComplexList;
+
+const char TRAJECTORY_MAGIC[8] = { 'M', 'S', 'T', 'R', 'A', 'J', '\0', '\0' };
+const uint32_t TRAJECTORY_VERSION = 2;
+
+struct TrajectoryFileHeader {
+	char magic[8]; // TRAJECTORY_MAGIC
+	uint32_t version; // TRAJECTORY_VERSION
+	uint32_t recordSize; // sizeof(TrajectoryRecord)
+	uint32_t headerSize; // bytes before the first record, including the strand table
+	uint32_t strandCount;
+	uint32_t keyframeInterval; // 0 if every state is a keyframe
+};
+
+// numpy dtype: [('time', 'f8'), ('arr_type', 'f8'), ('energy', 'f8'), ('seed', 'i8'),
+//               ('keyframe', 'u8'), ('offset', 'u8'), ('length', 'u4'), ('complexes', 'u4')]
+struct TrajectoryRecord {
+	double time;
+	double arrType; // the type of the last transition, see SimulationSystem::exportInterval
+	double energy; // summed over the complexes
+	int64_t seed; // of the trajectory
+	uint64_t keyframe; // the index of the record of the keyframe of this state
+	uint64_t offset; // of the structures of the state
+	uint32_t length;
+	uint32_t complexes;
+};
+
+class TrajectoryFile {
+public:
+
+	static const string STRUCTURE_SUFFIX;
+
+	TrajectoryFile(const string& path, long keyframeInterval = 0);
+	~TrajectoryFile(void);
+
+	// false if the files could not be opened.
+	bool isOpen(void);
+
+	void addState(SComplexList* complexList, long seed, double time, double arrType);
+	void flush(void);
+
+	long getCount(void); // of the states written
+
+	// where StrandOrdering::flipLog should point while simulating, NULL if the
+	// states are not delta-encoded.
+	std::vector<FlipEvent>* getFlipLog(void);
+
+private:
+
+	void writeHeader(SComplexList* complexList);
+	int strandIndex(orderingList* strand);
+
+	void appendComplexes(SComplexList* complexList, bool withStructures);
+	void appendDelta(SComplexList* complexList);
+	void appendNumber(long value);
+
+	string path;
+	FILE* records = NULL;
+	FILE* structures = NULL;
+
+	uint64_t offset = 0; // the size of the structure file
+	long count = 0;
+
+	long keyframeInterval = 0;
+	long lastKeyframe = 0; // record index
+	std::vector<FlipEvent> flips; // since the last state written
+
+	// the strand table, and which of its strands the strands of the current trajectory
+	// are. The strands keep their orderingList through joins and breaks.
+	std::vector<string> strandNames;
+	std::vector<string> strandSequences;
+	std::unordered_map<orderingList*, int> strandOf;
+	std::vector<bool> taken;
+	long lastSeed = 0;
+
+	string line; // reused for every state
+
+};
+
+// what TrajectoryReader::unchanged compares.
+struct FileVersion {
+	uint64_t device;
+	uint64_t inode;
+	int64_t size;
+	int64_t modified; // in ns
+};
+
+// Reconstructs the states of a trajectory file, see multistrand.system.trajectory_state.
+class TrajectoryReader {
+public:
+
+	TrajectoryReader(const string& path);
+	~TrajectoryReader(void);
+
+	// empty if the file could be read, the reason otherwise.
+	string error;
+
+	const string& getPath(void);
+	long size(void); // the number of records written so far
+
+	// false if either file was written or replaced since it was opened, for example
+	// by a new run to the same path: the state read last may then be gone.
+	bool unchanged(void);
+
+	// the state of a record, as a keyframe line. False if there is no such record, or,
+	// with the reason in stateError, if it refers to strands or bases that are not in
+	// the strand table.
+	bool state(long index, string& output);
+	string stateError;
+
+private:
+
+	bool readRecord(long index, TrajectoryRecord& record);
+	void readLine(TrajectoryRecord& record, string& output);
+
+	bool loadKeyframe(const string& keyframe);
+	bool applyDelta(const string& delta);
+	bool setComplexes(const char* text);
+	bool isBase(long strand, long position);
+	bool invalid(long index);
+	void render(string& output);
+
+	string path;
+	FILE* records = NULL;
+	FILE* structures = NULL;
+	TrajectoryFileHeader header;
+
+	// of both files when they were opened, see unchanged
+	FileVersion versions[2];
+
+	std::vector<int> strandStart; // the index of the first base of each strand, in partner
+	std::vector<int> strandSize;
+
+	// the state of record current
+	long current = -1;
+	long currentKeyframe = -1;
+	std::vector<int> partner; // of each base, -1 if unpaired
+	std::vector<std::vector<int> > complexes; // the strands of each complex, in order
+
+	string line;
+	std::vector<int> linear; // scratch for render
+
+};
+
+#endif
@@ -1,5 +1,7 @@
 from constants import OptionsConstants
 
+import struct
+
 Constants = OptionsConstants()
 
 class Interface(object):
@@ -49,33 +51,87 @@ class Interface(object):
 
         self._results = ResultList([])
         # hidden member that has a list of Result objects.
+
+        self._result_columns = []
+        self._columns_built = 0
+        # the runs with Options.columnar_results set, as tuples of ResultColumn arrays
+        # (see add_result_columns), and how many of them are in _results already.
         
     @property
     def results( self ):
+        while self._columns_built < len(self._result_columns):
+            self._build_results(self._result_columns[self._columns_built])
+            self._columns_built += 1
         return self._results
 
+    def add_result_columns( self, columns ):
+        """ Keeps the results of a run with Options.columnar_results set; the result
+        objects are made when the results property is read. """
+        self._result_columns.append(columns)
+
+    def _build_results( self, columns ):
+        first_step, seeds, types, times, rates, tag_ids, tags = columns
+        n = len(seeds)
+        # struct reads the arrays through the buffer protocol.
+        seeds, types, times, rates, tag_ids = [struct.unpack("=%d%s" % (n, c.format), buffer(c))
+                                               for c in (seeds, types, times, rates, tag_ids)]
+        for i in range(n):
+            if first_step:
+                self.add_result((seeds[i], types[i], times[i], rates[i], tags[tag_ids[i]]), res_type='firststep')
+            else:
+                self.add_result((seeds[i], types[i], times[i], tags[tag_ids[i]]), res_type='status_line')
+
+    def result_columns( self ):
+        """ The results of the runs with Options.columnar_results set, as a dict of
+        numpy arrays: 'seed', 'com_type', 'time', 'collision_rate' (zero unless in a
+        first step mode) and 'tag_id', which indexes the list 'tags'.
+        
+        For a single run the arrays share the memory of the simulator's buffers;
+        several runs are concatenated. """
+        import numpy as np
+
+        names = ['seed', 'com_type', 'time', 'collision_rate', 'tag_id']
+        tags = []
+        parts = dict((name, []) for name in names)
+
+        for columns in self._result_columns:
+            chunk_tags = columns[6]
+            for tag in chunk_tags:
+                if tag not in tags:
+                    tags.append(tag)
+            for name, column in zip(names, columns[1:6]):
+                if len(column) == 0:
+                    parts[name].append(np.zeros(0, column.format))
+                else:
+                    parts[name].append(np.frombuffer(column, column.format))
+            # the tag ids of a run index its own list of tags.
+            if chunk_tags != tags[:len(chunk_tags)]:
+                index = np.array([tags.index(tag) for tag in chunk_tags], dtype=np.int32)
+                parts['tag_id'][-1] = index[parts['tag_id'][-1]]
+
+        result = dict()
+        for name in names:
+            if len(parts[name]) == 1:
+                result[name] = parts[name][0]
+            else:
+                result[name] = np.concatenate(parts[name]) if parts[name] else np.zeros(0)
+        result['tags'] = tags
+        return result
+
     def add_result( self, val, res_type= None ):
         if res_type == "status_line":
             seed, com_type, time, tag = val
-            try:
-                start = self.start_structures[seed]
-                del self.start_structures[seed]
-            except:
-                pass
+            start = self.start_structures.pop(seed, None)
             new_result = Result( value_list=val, result_type=res_type, start_state=start )
         else:
             seed, com_type, time, rate, tag = val
-            try:
-                start = self.start_structures[seed]
-                del self.start_structures[seed]
-            except:
-                pass
+            start = self.start_structures.pop(seed, None)
             new_result = FirstStepResult( value_list = val, start_state = start)
         self._results.append( new_result )
 
     def __str__(self):
         res = "# of trajectories completed: {0}\n\
-        Most recent trajectory information:\n{1}".format( self.trajectory_count, str( self._results[-1] ))
+        Most recent trajectory information:\n{1}".format( self.trajectory_count, str( self.results[-1] ))
         return res
 
     @property
@@ -42,6 +42,15 @@ class  Literals(object):
     dangles_some = 1
     dangles_all = 2
     
+    """ Move selection engines """
+    selection_linear = 0
+    selection_sumtree = 1
+    
+    """ exp and log for the rates and the time advance """
+    kernels_libm = 0
+    kernels_tabulated = 1
+    kernels_validate = 2
+    
     """ Substrate type.    """
     substrateRNA = 1
     substrateDNA = 2
@@ -178,6 +187,41 @@ class Options(object):
         By default, the cotranscriptional mode adds one nucleotide every 1 millisecond.
         """
         
+        self.selection_engine = Literals.selection_linear
+        """
+        Selects how the next transition is chosen at every step.
+        Literals.selection_linear scans all complexes, loops and moves in order (the original behaviour).
+        Literals.selection_sumtree keeps the rates of loops and complexes in sum-trees, and picks 
+        the transition in logarithmic time. Useful for long strands and many-strand systems.
+        """
+        
+        self.math_kernels = Literals.kernels_libm
+        """
+        Selects how the rate of every candidate move and the time advance are computed.
+        Literals.kernels_libm calls exp and log (the original behaviour).
+        Literals.kernels_tabulated uses tables keyed on the energy difference, which agree
+        with libm to about 1e-14, relative.
+        Literals.kernels_validate computes both, uses the libm values, and counts the
+        differences; see SimSystem.kernelStats().
+        """
+
+        self.specialized_model = True
+        """
+        If True, the energy model is made for the dangles setting and the rate method
+        of the options, so that it does not test them for every loop energy and rate.
+        If False, the model that tests them is used; it gives the same energies and
+        rates, which test/energy_variants_check.py checks.
+        """
+
+        self.columnar_results = False
+        """
+        If True, the results of the trajectories are kept by the simulator in one array
+        per field, and handed over when the run is over; interface.result_columns()
+        returns them as numpy arrays without a copy, and interface.results builds the
+        usual result objects from them only when asked. The final states of the
+        trajectories (interface.end_states) are not recorded in this mode.
+        """
+        
         #############################################
         #                                           #
         # Data Members: Energy Model                #
@@ -287,6 +331,11 @@ class Options(object):
         self.initial_seed = None
         """ Initial random number seed to use.
         If None when simulation starts, a random seed will be chosen
+
+        The first trajectory uses this seed, and trajectory i uses a seed
+        derived from it and i alone. Each trajectory draws from its own
+        counter-based random stream keyed by its seed, so a trajectory can be
+        rerun by setting initial_seed to the seed reported in its result.
         """
         
         self.name_dict = {}
@@ -372,6 +421,68 @@ class Options(object):
         means output every state, 2 means every other state, and so on.
         """
         
+        self.trajectory_file = ""
+        """ If not empty, the states output in trajectory mode are written to this
+        file (and the structures to the file with ".structures" appended) instead of
+        full_trajectory, full_trajectory_times and full_trajectory_arrType.
+        
+        Type         Default
+        str          ""
+        
+        The file is a header, a strand table and fixed-size records that can be read
+        with numpy.memmap; see multistrand.utils.readTrajectoryFile.
+        """
+        
+        self.trajectory_keyframes = 0
+        """ If positive, only the first state of each trajectory and every
+        trajectory_keyframes-th state after it are written to trajectory_file in
+        full; the states in between are written as the base pairs made and broken
+        since the state before. multistrand.utils.trajectoryState reconstructs them.
+        
+        Type         Default
+        int          0: every state is written in full
+        """
+        
+        self.phase_stats = False
+        """ If True, the simulator counts and times the phases of every step: the
+        time advance, the choice of the transition, doing it, generating the moves
+        of the loops it changed, the energy of every loop type, the join flux, the
+        stop conditions and the export of states, and counts the moves generated
+        and the energies computed; see SimSystem.phaseStats().
+        
+        Type         Default
+        bool         False: nothing is counted
+        """
+        
+        self.phase_trace = ""
+        """ If not empty, the phases of the steps (but not the energy calls) are also
+        written to this file as a Chrome trace, to be opened in chrome://tracing or
+        ui.perfetto.dev; the first million phases of every thread are kept. Implies
+        phase_stats.
+        
+        Type         Default
+        str          ""
+        """
+        
+        self.parameter_cache = ""
+        """ If not empty, a directory where the energy parameters, read from the
+        NUPACK parameter files and adjusted to the temperature and salt, are kept
+        as binary files, which later processes map instead of reading the
+        parameter files again. Within a process they are kept either way.
+        
+        Type         Default
+        str          ""
+        """
+        
+        self.log_constants = False
+        """ If True, the constants of the model (salt, temperature, rate method,
+        scaling, parameter files) are written to multistrandRun.log in the
+        current directory, once per process.
+        
+        Type         Default
+        bool         False
+        """
+        
         self.current_interval = 0
         """ Current value of output state counter.
         
@@ -858,6 +969,19 @@ class Options(object):
             self.interface.end_states.append(self._current_end_state)
             self._current_end_state = []
             
+    @property
+    def add_result_columns(self):
+        return None
+
+    @add_result_columns.setter
+    def add_result_columns(self, val):
+        """ Takes the results of a run with columnar_results set, a 7-tuple:
+            (first step mode, seeds, stop result flags, completion times, collision rates, tag ids, tags)
+            where tags is a list of strings and the others are ResultColumn arrays."""
+        if not isinstance(val, tuple) or len(val) != 7:
+            raise ValueError("Result columns need a 7-tuple of values.")
+        self.interface.add_result_columns(val)
+
     @property
     def add_complex_state_line(self):
         return None
@@ -603,6 +603,7 @@ class MergeSim(object):
 
     numOfThreads = 2
     seed = 7713147777
+    nativeThreads = False
 
     def __init__(self, settings=None):
 
@@ -646,6 +647,12 @@ class MergeSim(object):
 
         self.numOfThreads = numOfThreads
 
+    # Run the trajectories on threads inside the simulator (SimSystem.startParallel)
+    # instead of on worker processes. For first step and first passage time modes.
+    def setNativeThreads(self, value):
+
+        self.nativeThreads = value
+
     # this can be re-done using an args[] obj.
     def setOptionsFactory(self, optionsFactory):
 
@@ -847,6 +854,9 @@ class MergeSim(object):
 
     def run(self):
 
+        if self.nativeThreads:
+            return self.runNative()
+
         # The input0 is always trials.
         self.trialsPerThread = int(
             math.ceil(float(self.factory.input0) / float(self.numOfThreads)))
@@ -996,6 +1006,60 @@ class MergeSim(object):
 
         saveResults()
 
+        return self.finishRun()
+
+    # Simulates batches of factory.input0 trajectories, each on numOfThreads threads of one
+    # SimSystem, until the termination criteria are met. One energy model is loaded per
+    # batch, and the results do not pass between processes.
+    def runNative(self):
+
+        self.trialsPerThread = int(
+            math.ceil(float(self.factory.input0) / float(self.numOfThreads)))
+        startTime = time.time()
+
+        self.nForward = multiprocessing.Value('i', 0)
+        self.nReverse = multiprocessing.Value('i', 0)
+
+        self.results = self.settings.rateFactory()
+
+        self.printStates()
+        print(self.startSimMessage())
+
+        batch = 0
+
+        while True:
+
+            instanceSeed = int(self.seed + batch * 3 * 5 * 19 + (time.time() * 10000) % (math.pow(2, 32) - 1))
+            myOptions = self.factory.new(instanceSeed)
+            myOptions.num_simulations = self.factory.input0
+
+            s = SimSystem(myOptions)
+            s.startParallel(self.numOfThreads)
+
+            myFSR = self.settings.rateFactory(myOptions.interface.results, myOptions.interface.end_states)
+            self.nForward.value += myFSR.nForward + myFSR.nForwardAlt
+            self.nReverse.value += myFSR.nReverse
+
+            self.results.merge(myFSR, deepCopy=True)
+
+            if self.settings.debug:
+                self.printTrajectories(myOptions)
+
+            if not(self.aFactory == None):
+                self.aFactory.doAnalysis(myOptions)
+
+            if self.settings.shouldTerminate(True, self.nForward, self.nReverse, startTime):
+                break
+
+            batch += 1
+
+        self.runTime = (time.time() - startTime)
+        print("Done.  %.5f seconds -- now processing results \n" % (time.time() - startTime))
+
+        return self.finishRun()
+
+    def finishRun(self):
+
         # print final results to the user
         """ is not cleak """
         if not self.settings.resultsType == MergeSimSettings.RESULTTYPE2:
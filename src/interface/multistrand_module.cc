@@ -14,6 +14,8 @@
 #include "ssystem.h"
 #include "simoptions.h"
 #include "options.h"
+#include "resultbuffer.h"
+#include "trajectoryfile.h"
 #include <string.h>
 /* for strcmp */
 
@@ -81,6 +83,31 @@ static PyObject *SimSystemObject_start(SimSystemObject *self, PyObject *args) {
 	return Py_None;
 }
 
+static PyObject *SimSystemObject_startParallel(SimSystemObject *self, PyObject *args, PyObject *keywds) {
+	int threads = 0;
+	static char *kwlist[] = { "num_threads", NULL };
+
+	if (!PyArg_ParseTupleAndKeywords(args, keywds, "|i:startParallel", kwlist, &threads))
+		return NULL;
+
+	if (self->ob_system == NULL) {
+		PyErr_SetString(PyExc_AttributeError, "The associated SimulationSystem [C++] object no longer exists, cannot start the system.");
+		return NULL;
+	}
+
+	const char* reason = self->ob_system->parallelUnsupported();
+
+	if (reason != NULL) {
+		PyErr_SetString(PyExc_ValueError, reason);
+		return NULL;
+	}
+
+	self->ob_system->StartSimulationParallel(threads);
+
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
 static PyObject *SimSystemObject_initialInfo(SimSystemObject *self, PyObject *args) {
 	if (!PyArg_ParseTuple(args, ":initialInfo"))
 		return NULL;
@@ -109,6 +136,42 @@ static PyObject *SimSystemObject_localTransitions(SimSystemObject *self, PyObjec
 	return Py_None;
 }
 
+static PyObject *SimSystemObject_allocationStats(SimSystemObject *self, PyObject *args) {
+	if (!PyArg_ParseTuple(args, ":allocationStats"))
+		return NULL;
+
+	if (self->ob_system == NULL) {
+		PyErr_SetString(PyExc_AttributeError, "The associated SimulationSystem [C++] object no longer exists, cannot query the system.");
+		return NULL;
+	}
+
+	return self->ob_system->allocationStats();
+}
+
+static PyObject *SimSystemObject_kernelStats(SimSystemObject *self, PyObject *args) {
+	if (!PyArg_ParseTuple(args, ":kernelStats"))
+		return NULL;
+
+	if (self->ob_system == NULL) {
+		PyErr_SetString(PyExc_AttributeError, "The associated SimulationSystem [C++] object no longer exists, cannot query the system.");
+		return NULL;
+	}
+
+	return self->ob_system->kernelStats();
+}
+
+static PyObject *SimSystemObject_phaseStats(SimSystemObject *self, PyObject *args) {
+	if (!PyArg_ParseTuple(args, ":phaseStats"))
+		return NULL;
+
+	if (self->ob_system == NULL) {
+		PyErr_SetString(PyExc_AttributeError, "The associated SimulationSystem [C++] object no longer exists, cannot query the system.");
+		return NULL;
+	}
+
+	return self->ob_system->phaseStats();
+}
+
 static int SimSystemObject_traverse(SimSystemObject *self, visitproc visit, void *arg) {
 	Py_VISIT(self->options);
 	return 0;
@@ -145,6 +208,16 @@ Start the simulation; only returns when the simulation has been completed. \n\
 Information is only returned from the simulation via the Options object it \n\
 was created with.\n";
 
+const char docstring_SimSystem_startParallel[] =
+		"\
+SimSystem.startParallel( self, num_threads=0 )\n\
+\n\
+Like start, but simulates the trajectories on num_threads threads (0: one per\n\
+core) that share the energy model, with the GIL released. The Options object\n\
+gets the same results as from start, in the same order, once all trajectories\n\
+are done. For the first passage time and first step modes, without\n\
+output_interval or output_time; raises ValueError otherwise.\n";
+
 const char docstring_SimSystem_initialInfo[] = "\
 SimSystem.initialInfo( self )\n\
 \n\
@@ -156,6 +229,37 @@ SimSystem.localTransitions( self )\n\
 \n\
 Given the initial state, traverses into each transition once. \n";
 
+const char docstring_SimSystem_allocationStats[] =
+		"\
+SimSystem.allocationStats( self )\n\
+\n\
+Returns a dict with the number of allocations served by the memory pool\n\
+('allocations'), and the number of calls to the global allocator\n\
+('system_allocations'), made while simulating: the chunks of the pool and the\n\
+requests too large for it. Built with -DMEMPOOL_COUNT_GLOBAL, the latter counts\n\
+every call of the global operator new, see mempool.h.\n\
+'last_system_allocations' is the count for the steps of the last trajectory,\n\
+without its setup and the export of its final state; it is zero once the pool\n\
+has warmed up.\n";
+
+const char docstring_SimSystem_kernelStats[] =
+		"\
+SimSystem.kernelStats( self )\n\
+\n\
+With options.math_kernels set to Literals.kernels_validate, returns a dict\n\
+with the number of exp and log results checked against the tables\n\
+('validated'), the number that differed by more than the tolerance\n\
+('mismatches'), and the largest relative difference ('max_relative_error').\n";
+
+const char docstring_SimSystem_phaseStats[] =
+		"\
+SimSystem.phaseStats( self )\n\
+\n\
+With options.phase_stats set, returns a dict with the number of trajectories,\n\
+steps, moves generated and energy evaluations of the last run, its wall time\n\
+('seconds'), and for every phase ('phases') the number of calls and the time\n\
+spent in it. The phases nest, see phasestats.h; the counts are zero otherwise.\n";
+
 const char docstring_SimSystem_init[] =
 		"\
 :meth:`multistrand.system.SimSystem.__init__( self, *args )`\n\
@@ -169,9 +273,13 @@ options [type=:class:`multistrand.options.Options`]  -- The options to use for\n
 \n";
 
 static PyMethodDef SimSystemObject_methods[] = { { "__init__", (PyCFunction) SimSystemObject_init, METH_COEXIST | METH_VARARGS, PyDoc_STR(
-		docstring_SimSystem_init) }, { "start", (PyCFunction) SimSystemObject_start, METH_VARARGS, PyDoc_STR(docstring_SimSystem_start) }, { "initialInfo",
+		docstring_SimSystem_init) }, { "start", (PyCFunction) SimSystemObject_start, METH_VARARGS, PyDoc_STR(docstring_SimSystem_start) }, { "startParallel",
+		(PyCFunction) (void (*)(void)) SimSystemObject_startParallel, METH_VARARGS | METH_KEYWORDS, PyDoc_STR(docstring_SimSystem_startParallel) }, { "initialInfo",
 		(PyCFunction) SimSystemObject_initialInfo, METH_VARARGS, PyDoc_STR(docstring_SimSystem_initialInfo) }, { "localTransitions",
-		(PyCFunction) SimSystemObject_localTransitions, METH_VARARGS, PyDoc_STR(docstring_SimSystem_localTransitions) }, { NULL, NULL } /* Sentinel */
+		(PyCFunction) SimSystemObject_localTransitions, METH_VARARGS, PyDoc_STR(docstring_SimSystem_localTransitions) }, { "allocationStats",
+		(PyCFunction) SimSystemObject_allocationStats, METH_VARARGS, PyDoc_STR(docstring_SimSystem_allocationStats) }, { "kernelStats",
+		(PyCFunction) SimSystemObject_kernelStats, METH_VARARGS, PyDoc_STR(docstring_SimSystem_kernelStats) }, { "phaseStats",
+		(PyCFunction) SimSystemObject_phaseStats, METH_VARARGS, PyDoc_STR(docstring_SimSystem_phaseStats) }, { NULL, NULL } /* Sentinel */
 /* Note that the dealloc, etc methods are not
  defined here, they're in the type object's
  methods table, not the basic methods table. */
@@ -246,7 +354,7 @@ static PyObject *System_initialize_energymodel(PyObject *self, PyObject *args) {
 			throw std::invalid_argument("Attempting to load ViennaRNA parameters (depreciated)");
 		//temp = new ViennaEnergyModel( options_object );
 		else
-			temp = new NupackEnergyModel(options_object);
+			temp = NupackEnergyModel::create(options_object);
 		Loop::SetEnergyModel(temp);
 	}
 	Py_INCREF(Py_None);
@@ -254,15 +362,6 @@ static PyObject *System_initialize_energymodel(PyObject *self, PyObject *args) {
 }
 
 static PyObject *System_calculate_energy(PyObject *self, PyObject *args) {
-	// TODO: there is a bug where this destroys/invalidates the incoming python objects used to initialize the state.   02-21-13 JS
-	// REPRODUCE:
-	//   let c be a valid complex, o be the options object (e.g. energy model),
-	//   and energy the name for multistrand.system.energy
-	//   then try (python):
-	//   en = energy( [c], o, 0 )
-	//   print en  # will be correct
-	//   print c   # will crash out, as object has been mangled.
-
 	SimulationSystem *temp = NULL;
 	PyObject *options_object = NULL;
 	PyObject *start_state_object = NULL;
@@ -305,6 +404,55 @@ static PyObject *System_calculate_energy(PyObject *self, PyObject *args) {
 	return energy;
 }
 
+static PyObject *System_calculate_energy_matrix(PyObject *self, PyObject *args, PyObject *keywds) {
+
+	SimulationSystem *temp = NULL;
+	PyObject *states = NULL;
+	PyObject *temperatures_object = NULL;
+	PyObject *options_object = NULL;
+	PyObject *matrix;
+	int typeflag = 0;
+
+	static char *kwlist[] = { "states", "temperatures", "options", "energy_type", NULL };
+
+	if (!PyArg_ParseTupleAndKeywords(args, keywds, "OOO|i:energy_matrix(states, temperatures, options[, energy_type=0])", kwlist, &states,
+			&temperatures_object, &options_object, &typeflag))
+		return NULL;
+
+	PyObject *sequence = PySequence_Fast(temperatures_object, "The temperatures should be a list of numbers.");
+
+	if (sequence == NULL)
+		return NULL;
+
+	std::vector<double> temperatures;
+
+	for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(sequence); i++) {
+
+		double temperature = PyFloat_AsDouble(PySequence_Fast_GET_ITEM(sequence, i));
+
+		// as Options.temperature: [0, 100] is taken to be Celsius.
+		if (0.0 < temperature && temperature < 100.0)
+			temperature += 273.15;
+
+		temperatures.push_back(temperature);
+	}
+
+	Py_DECREF(sequence);
+
+	if (PyErr_Occurred())
+		return NULL;
+
+	Py_INCREF(options_object);
+	temp = new SimulationSystem(options_object);
+
+	matrix = temp->calculateEnergyMatrix(states, temperatures, typeflag);
+
+	delete temp;
+
+	Py_DECREF(options_object);
+	return matrix;
+}
+
 static PyObject *System_calculate_rate(PyObject *self, PyObject *args, PyObject *keywds) {
 
 	SimulationSystem *temp = NULL;
@@ -339,7 +487,7 @@ static PyObject *System_calculate_rate(PyObject *self, PyObject *args, PyObject
 			throw std::invalid_argument("Attempting to load ViennaRNA parameters (depreciated)");
 //        em = new ViennaEnergyModel( options_object );
 		} else {
-			em = new NupackEnergyModel(options_object);
+			em = NupackEnergyModel::create(options_object);
 		}
 
 		if (em == NULL) {
@@ -402,6 +550,103 @@ static PyObject *System_run_system(PyObject *self, PyObject *args) {
 
 }
 
+// the reader of the last file asked for, so that reading the states in order replays each delta once.
+static TrajectoryReader* lastTrajectoryReader = NULL;
+
+static PyObject *System_run_sweep(PyObject *self, PyObject *args, PyObject *keywds) {
+
+	PyObject *options_list = NULL;
+	int threads = 0;
+	static char *kwlist[] = { "options", "num_threads", NULL };
+
+	if (!PyArg_ParseTupleAndKeywords(args, keywds, "O|i:run_sweep(options, num_threads=0)", kwlist, &options_list, &threads))
+		return NULL;
+
+	PyObject *sequence = PySequence_Fast(options_list, "The options should be a list of Options objects.");
+
+	if (sequence == NULL)
+		return NULL;
+
+	std::vector<SimulationSystem*> systems;
+	Py_ssize_t count = PySequence_Fast_GET_SIZE(sequence);
+
+	for (Py_ssize_t i = 0; i < count; i++) {
+
+		PyObject *options_object = PySequence_Fast_GET_ITEM(sequence, i);
+
+		if (strcmp(options_object->ob_type->tp_name, "Options") != 0) {
+			PyErr_Format(PyExc_TypeError, "Options %d is not an Options object.", (int) i);
+			break;
+		}
+
+		Py_INCREF(options_object);
+		systems.push_back(new SimulationSystem(options_object));
+
+		const char* reason = systems.back()->parallelUnsupported();
+
+		if (reason != NULL) {
+			PyErr_Format(PyExc_ValueError, "Options %d: %s", (int) i, reason);
+			break;
+		}
+	}
+
+	if (!PyErr_Occurred()) {
+		SimulationSystem::StartSweep(systems, threads);
+	}
+
+	for (unsigned int i = 0; i < systems.size(); i++) {
+		delete systems[i];
+		Py_DECREF(PySequence_Fast_GET_ITEM(sequence, i));
+	}
+
+	Py_DECREF(sequence);
+
+	if (PyErr_Occurred())
+		return NULL;
+
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+static PyObject *System_trajectory_state(PyObject *self, PyObject *args) {
+
+	char* path = NULL;
+	long index = 0;
+
+	if (!PyArg_ParseTuple(args, "sl:trajectory_state(path, index)", &path, &index))
+		return NULL;
+
+	// a new run to the same path makes the state read last meaningless.
+	if (lastTrajectoryReader == NULL || lastTrajectoryReader->getPath() != path || !lastTrajectoryReader->unchanged()) {
+
+		delete lastTrajectoryReader;
+		lastTrajectoryReader = new TrajectoryReader(path);
+
+	}
+
+	if (!lastTrajectoryReader->error.empty()) {
+		PyErr_SetString(PyExc_IOError, lastTrajectoryReader->error.c_str());
+		return NULL;
+	}
+
+	string state;
+
+	if (!lastTrajectoryReader->state(index, state)) {
+
+		if (!lastTrajectoryReader->stateError.empty()) {
+			PyErr_SetString(PyExc_ValueError, lastTrajectoryReader->stateError.c_str());
+		} else {
+			PyErr_Format(PyExc_IndexError, "The trajectory file has no state %ld.", index);
+		}
+
+		return NULL;
+
+	}
+
+	return PyString_FromStringAndSize(state.data(), state.size());
+
+}
+
 static PyMethodDef System_methods[] =
 		{
 				{ "energy", (PyCFunction) System_calculate_energy, METH_VARARGS,
@@ -418,6 +663,18 @@ energy_type = 3 ('Tube energy'): include dG_volume + dG_assoc.  Summed over comp
 \n\
 options = None [default]: Use the already initialized energy model.\n\
 options = ...: If not none, should be a multistrand.options.Options object, which will be used for initializing the energy model ONLY if there is not one already present.\n") },
+				{ "energy_matrix", (PyCFunction) (void (*)(void)) System_calculate_energy_matrix, METH_VARARGS | METH_KEYWORDS,
+						PyDoc_STR(
+								" \
+energy_matrix( states, temperatures, options, energy_type=0)\n\
+Computes the energy of each state at each temperature, as a tuple per state of its energies in the order of the \
+temperatures. A state is a complex, or a list of complexes whose energies are added up. The energy model is \
+made once, and its tables moved to each temperature; the loops of a state are found once, and a loop whose \
+energy is linear over the temperatures, as most are, is evaluated at three of them.\n\n\
+Parameters\n\
+temperatures: in Kelvin; as for Options.temperature, values in [0, 100] are taken to be Celsius.\n\
+options: a multistrand.options.Options object, for the energy model; its temperature is not used.\n\
+energy_type: as for energy().\n") },
 				{ "calculate_rate", (PyCFunction) System_calculate_rate, METH_VARARGS | METH_KEYWORDS,
 						PyDoc_STR(
 								" \
@@ -442,7 +699,21 @@ options [default=None]: when no options object is passed, this removes the old e
 				{ "run_system", (PyCFunction) System_run_system, METH_VARARGS, PyDoc_STR(
 						" \
 run_system( options )\n\
-Run the system defined by the passed in Options object.\n") }, { NULL } /*Sentinel*/
+Run the system defined by the passed in Options object.\n") },
+				{ "run_sweep", (PyCFunction) (void (*)(void)) System_run_sweep, METH_VARARGS | METH_KEYWORDS, PyDoc_STR(
+						" \
+run_sweep( options, num_threads=0 )\n\
+Runs the systems of a list of Options objects, for instance the same system at several temperatures, \
+salt concentrations or rate scalings, as SimSystem.startParallel would, but on one pool of num_threads \
+threads (0: one per core): a thread done with one system goes on with the next. Every Options object \
+gets its own results. The energy parameter files are read once; the energy model of each system scales \
+the same tables to its temperature and salt. Raises ValueError for options that cannot run in parallel.\n") }, { "trajectory_state", (PyCFunction) System_trajectory_state, METH_VARARGS, PyDoc_STR(
+						" \
+trajectory_state( path, index )\n\
+The state of record index of a trajectory file (see Options.trajectory_file), in the format of\n\
+a keyframe: for every complex, the indexes of its strands in the strand table, ':' and the structure.\n\
+States written as changes to the state before are reconstructed from their keyframe. Raises IndexError if\n\
+there is no such record, and ValueError if the state has a strand that is not in the strand table.\n") }, { NULL } /*Sentinel*/
 		};
 
 PyMODINIT_FUNC initsystem(void) {
@@ -451,6 +722,9 @@ PyMODINIT_FUNC initsystem(void) {
 	if (PyType_Ready(&SimSystem_Type) < 0)
 		return;
 
+	if (PyType_Ready(&ResultColumn_Type) < 0)
+		return;
+
 	m = Py_InitModule3("system", System_methods, "Base module for holding System objects.");
 	if (m == NULL)
 		return;
@@ -458,4 +732,7 @@ PyMODINIT_FUNC initsystem(void) {
 	Py_INCREF(&SimSystem_Type);
 	PyModule_AddObject(m, "SimSystem", (PyObject *) &SimSystem_Type);
 
+	Py_INCREF(&ResultColumn_Type);
+	PyModule_AddObject(m, "ResultColumn", (PyObject *) &ResultColumn_Type);
+
 }
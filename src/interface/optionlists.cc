@@ -9,6 +9,8 @@
 
 
 #include <string>
+#include <map>
+#include <mutex>
 #include "optionlists.h"
 #include "utility.h"
 //#include <python2.7/Python.h>
@@ -64,9 +66,78 @@ identList::identList(long newuid, char *newid, class identList *old) {
 	strcpy(id, newid);
 
 	uid = newuid;
+	nameId = internName(newid);
 	next = old;
 }
 
+/*
+ int identList::internName( const char *name )
+
+ Strand names are interned once, when the start state and the stop conditions
+ are parsed, so that stop conditions can compare strands by integer.
+ The worker threads of a parallel run call it as well.
+ */
+
+int identList::internName(const char *name) {
+
+	static std::map<string, int> names;
+	static std::mutex namesLock;
+
+	std::lock_guard<std::mutex> lock(namesLock);
+
+	std::map<string, int>::iterator it = names.find(string(name));
+
+	if (it != names.end()) {
+		return it->second;
+	}
+
+	int newId = (int) names.size();
+	names[string(name)] = newId;
+
+	return newId;
+
+}
+
+/*
+ unsigned long identList::rotationKey( vector<int>& nameIds )
+
+ Hashes the lexicographically smallest rotation of the list, so that two
+ complexes can only be circular permutations of each other if their keys agree.
+ */
+
+unsigned long identList::rotationKey(vector<int>& nameIds) {
+
+	int n = (int) nameIds.size();
+	int best = 0;
+
+	for (int start = 1; start < n; start++) {
+
+		for (int i = 0; i < n; i++) {
+
+			int a = nameIds[(start + i) % n];
+			int b = nameIds[(best + i) % n];
+
+			if (a != b) {
+
+				if (a < b) {
+					best = start;
+				}
+
+				break;
+			}
+		}
+	}
+
+	unsigned long key = n;
+
+	for (int i = 0; i < n; i++) {
+		key = key * 1000003 + nameIds[(best + i) % n] + 1;
+	}
+
+	return key;
+
+}
+
 std::string identList::toString() {
 
 	if (id != NULL) {
@@ -112,6 +183,8 @@ complexItem::complexItem(char *struc, class identList *strands,
 	next = old;
 	type = STOPTYPE_STRUCTURE;
 	count = 0;
+
+	compile();
 }
 
 complexItem::complexItem(char *struc, class identList *strands,
@@ -129,6 +202,8 @@ complexItem::complexItem(char *struc, class identList *strands,
 	next = old;
 	type = newtype;
 	count = 0;
+
+	compile();
 }
 
 complexItem::complexItem(char *struc, class identList *strands,
@@ -149,6 +224,46 @@ complexItem::complexItem(char *struc, class identList *strands,
 	next = old;
 	type = newtype;
 	count = newcount;
+
+	compile();
+}
+
+// sets id_count and strandKey from strand_ids, and the pair table of the structure.
+void complexItem::compile(void) {
+
+	vector<int> nameIds;
+
+	for (identList* id = strand_ids; id != NULL; id = id->next) {
+		nameIds.push_back(id->nameId);
+	}
+
+	id_count = (int) nameIds.size();
+	strandKey = identList::rotationKey(nameIds);
+
+	vector<int> open;
+	int len = strlen(structure);
+
+	pairs.assign(len, PAIR_NONE);
+
+	for (int i = 0; i < len; i++) {
+
+		if (structure[i] == '+') {
+
+			pairs[i] = PAIR_BREAK;
+
+		} else if (structure[i] == '(') {
+
+			open.push_back(i);
+
+		} else if (structure[i] == ')' && !open.empty()) {
+
+			pairs[i] = open.back();
+			pairs[open.back()] = i;
+			open.pop_back();
+
+		}
+	}
+
 }
 
 /*
@@ -0,0 +1,218 @@
+/*
+ Copyright (c) 2017 California Institute of Technology. All rights reserved.
+ Multistrand nucleic acid kinetic simulator
+ help@multistrand.org
+ */
+
+#include "resultbuffer.h"
+#include "python2.7/structmember.h"
+
+void ResultBuffer::add(long seed, long type, double time, double rate, const char* tag) {
+
+	string name(tag);
+	int32_t id;
+
+	std::map<string, int32_t>::iterator it = tagIndex.find(name);
+
+	if (it == tagIndex.end()) {
+		id = (int32_t) tags.size();
+		tags.push_back(name);
+		tagIndex[name] = id;
+	} else {
+		id = it->second;
+	}
+
+	seeds.push_back(seed);
+	types.push_back((int32_t) type);
+	times.push_back(time);
+	rates.push_back(rate);
+	tagIds.push_back(id);
+
+}
+
+long ResultBuffer::size(void) {
+
+	return seeds.size();
+
+}
+
+/* ResultColumn: a read-only array that owns its items. */
+
+typedef struct {
+
+	PyObject_HEAD
+	void* data;
+	Py_ssize_t length; // in items
+	Py_ssize_t itemSize;
+	char* format; // as in the struct module
+	void* owner; // the vector that holds the items
+	void (*release)(void*);
+
+} ResultColumnObject;
+
+template<class T>
+static void deleteColumn(void* owner) {
+
+	delete (std::vector<T>*) owner;
+
+}
+
+// takes the items of values, which is left empty.
+template<class T>
+static PyObject* newResultColumn(std::vector<T>& values, const char* format) {
+
+	ResultColumnObject* column = PyObject_New(ResultColumnObject, &ResultColumn_Type);
+
+	if (column == NULL)
+		return NULL;
+
+	std::vector<T>* owned = new std::vector<T>();
+	owned->swap(values);
+
+	column->data = owned->data();
+	column->length = owned->size();
+	column->itemSize = sizeof(T);
+	column->format = (char *) format;
+	column->owner = owned;
+	column->release = deleteColumn<T>;
+
+	return (PyObject *) column;
+
+}
+
+PyObject* ResultBuffer::release(bool firstStep) {
+
+	PyObject* tagList = PyList_New(tags.size());
+
+	if (tagList == NULL)
+		return NULL;
+
+	for (unsigned int i = 0; i < tags.size(); i++) {
+		PyList_SET_ITEM(tagList, i, PyString_FromString(tags[i].c_str()));
+		// the reference is stolen by PyList_SET_ITEM.
+	}
+
+	tags.clear();
+	tagIndex.clear();
+
+	// New reference; the N format steals the references to the columns and the list.
+	return Py_BuildValue("(NNNNNNN)", PyBool_FromLong(firstStep), newResultColumn(seeds, "q"), newResultColumn(types, "i"), newResultColumn(times, "d"),
+			newResultColumn(rates, "d"), newResultColumn(tagIds, "i"), tagList);
+
+}
+
+static void ResultColumn_dealloc(ResultColumnObject *self) {
+
+	self->release(self->owner);
+	PyObject_Del(self);
+
+}
+
+static Py_ssize_t ResultColumn_length(ResultColumnObject *self) {
+
+	return self->length;
+
+}
+
+// The buffer protocol. Views hold a reference to the column, so the items outlive them.
+static int ResultColumn_getbuffer(ResultColumnObject *self, Py_buffer *view, int flags) {
+
+	if (flags & PyBUF_WRITABLE) {
+		PyErr_SetString(PyExc_BufferError, "ResultColumn is read-only.");
+		view->obj = NULL;
+		return -1;
+	}
+
+	view->obj = (PyObject *) self;
+	Py_INCREF(self);
+
+	view->buf = self->data;
+	view->len = self->length * self->itemSize;
+	view->readonly = 1;
+	view->itemsize = self->itemSize;
+	view->format = (flags & PyBUF_FORMAT) ? self->format : NULL;
+	view->ndim = 1;
+	view->shape = (flags & PyBUF_ND) ? &self->length : NULL;
+	view->strides = ((flags & PyBUF_STRIDES) == PyBUF_STRIDES) ? &self->itemSize : NULL;
+	view->suboffsets = NULL;
+	view->internal = NULL;
+
+	return 0;
+
+}
+
+// The old buffer protocol of Python 2, for buffer() and numpy.frombuffer.
+static Py_ssize_t ResultColumn_readbuffer(ResultColumnObject *self, Py_ssize_t segment, void **ptr) {
+
+	if (segment != 0) {
+		PyErr_SetString(PyExc_SystemError, "ResultColumn has a single segment.");
+		return -1;
+	}
+
+	*ptr = self->data;
+	return self->length * self->itemSize;
+
+}
+
+static Py_ssize_t ResultColumn_segcount(ResultColumnObject *self, Py_ssize_t *lenp) {
+
+	if (lenp != NULL)
+		*lenp = self->length * self->itemSize;
+
+	return 1;
+
+}
+
+static PySequenceMethods ResultColumn_sequence = { (lenfunc) ResultColumn_length, /* sq_length */
+};
+
+static PyBufferProcs ResultColumn_buffer = { (readbufferproc) ResultColumn_readbuffer, /* bf_getreadbuffer */
+0, /* bf_getwritebuffer */
+(segcountproc) ResultColumn_segcount, /* bf_getsegcount */
+0, /* bf_getcharbuffer */
+(getbufferproc) ResultColumn_getbuffer, /* bf_getbuffer */
+0, /* bf_releasebuffer */
+};
+
+static PyMemberDef ResultColumn_members[] = { { "format", T_STRING, offsetof(ResultColumnObject, format), READONLY,
+		"The type of the items, as in the struct module." }, { "itemsize", T_PYSSIZET, offsetof(ResultColumnObject, itemSize), READONLY,
+		"The size of an item in bytes." }, { NULL } /* Sentinel */
+};
+
+const char docstring_ResultColumn[] =
+		"\
+A read-only array of trajectory results, see Options.columnar_results.\n\
+\n\
+Supports the buffer protocol: numpy.frombuffer(column, column.format) and\n\
+memoryview(column) read the items without copying them.\n";
+
+PyTypeObject ResultColumn_Type = {
+PyVarObject_HEAD_INIT(NULL, 0) "multistrand.system.ResultColumn", /* tp_name */
+sizeof(ResultColumnObject), /* tp_basicsize */
+0, /* tp_itemsize */
+(destructor) ResultColumn_dealloc, /* tp_dealloc */
+0, /* tp_print */
+0, /* tp_getattr */
+0, /* tp_setattr */
+0, /* tp_compare */
+0, /* tp_repr */
+0, /* tp_as_number */
+&ResultColumn_sequence, /* tp_as_sequence */
+0, /* tp_as_mapping */
+0, /* tp_hash */
+0, /* tp_call */
+0, /* tp_str */
+0, /* tp_getattro */
+0, /* tp_setattro */
+&ResultColumn_buffer, /* tp_as_buffer */
+Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER, /* tp_flags */
+PyDoc_STR(docstring_ResultColumn), /* tp_doc */
+0, /* tp_traverse */
+0, /* tp_clear */
+0, /* tp_richcompare */
+0, /* tp_weaklistoffset */
+0, /* tp_iter */
+0, /* tp_iternext */
+0, /* tp_methods */
+ResultColumn_members, /* tp_members */
+};
@@ -1,5 +1,5 @@
 
-import os, random
+import os, random, struct
 
 import numpy as np
 
@@ -209,3 +209,54 @@ def generate_sequence(n, allowed_bases=['G', 'C', 'T', 'A'], base_probability=No
                       for i in range(n)]
                      )
 
+
+
+trajectoryRecord = np.dtype([('time', 'f8'), ('arr_type', 'f8'), ('energy', 'f8'), ('seed', 'i8'),
+                             ('keyframe', 'u8'), ('offset', 'u8'), ('length', 'u4'), ('complexes', 'u4')])
+""" The records of a trajectory file, see Options.trajectory_file. """
+
+
+def readTrajectoryFile(path):
+    """ Opens a file written with Options.trajectory_file set, without reading it into memory.
+
+    Returns (strands, records, structures): strands is the list of (name, sequence) of
+    the strand table, records a numpy.memmap of trajectoryRecord, one per state, and
+    structures a numpy.memmap of the bytes of the structure file; see trajectoryState.
+    """
+
+    with open(path, "rb") as f:
+        head = f.read(28)
+        magic, version, recordSize, headerSize, strandCount, keyframes = struct.unpack("=8sIIIII", head)
+        if magic != "MSTRAJ\0\0" or version != 2 or recordSize != trajectoryRecord.itemsize:
+            raise ValueError("%s is not a trajectory file of this version of Multistrand." % path)
+        table = f.read(headerSize - len(head)).split("\n")
+
+    strands = [tuple(line.split(" ")) for line in table[:strandCount]]
+
+    if os.path.getsize(path) > headerSize:
+        records = np.memmap(path, dtype=trajectoryRecord, mode="r", offset=headerSize)
+    else:
+        records = np.zeros(0, dtype=trajectoryRecord)
+
+    structurePath = path + ".structures"
+    if os.path.getsize(structurePath) > 0:
+        structures = np.memmap(structurePath, dtype=np.uint8, mode="r")
+    else:
+        structures = np.zeros(0, dtype=np.uint8)
+
+    return strands, records, structures
+
+
+def trajectoryState(path, index):
+    """ The state of record index of a trajectory file, as a list of
+    (strand indexes in the strand table, dot-paren structure), one per complex.
+    Delta-encoded states (Options.trajectory_keyframes) are reconstructed from
+    their keyframe; reading the states in order replays each change once. """
+
+    from system import trajectory_state
+
+    state = []
+    for complex in trajectory_state(path, index).split(" "):
+        strands, structure = complex.split(":")
+        state.append(([int(i) for i in strands.split(",")], structure))
+    return state
@@ -9,17 +9,129 @@
 
 #include <stdio.h>
 #include <assert.h>
+#include <math.h>
 #include "loop.h"
 #include <typeinfo>
 
 #include "utility.h"
 #include "moveutil.h"
+#include "phasestats.h"
 #include <simoptions.h>
 #include <energyoptions.h>
 
 using std::string;
 
-EnergyModel* Loop::energyModel = NULL;
+thread_local EnergyModel* Loop::energyModel = NULL;
+
+/*
+
+ LoopSums
+
+ */
+
+LoopSums::LoopSums(void) {
+
+}
+
+LoopSums::~LoopSums(void) {
+
+	if (tree != NULL)
+		delete tree;
+
+}
+
+void LoopSums::accumulate(double& sum, double& compensation, double value) {
+
+	double total = sum + value;
+
+	if (fabs(sum) >= fabs(value))
+		compensation += (sum - total) + value;
+	else
+		compensation += (value - total) + sum;
+
+	sum = total;
+
+}
+
+void LoopSums::add(Loop* loop) {
+
+	accumulate(flux, fluxCompensation, loop->totalRate);
+	accumulate(energy, energyCompensation, loop->getEnergy());
+	updates++;
+
+	if (tree != NULL) {
+		loop->rateSlot = tree->insert(loop, loop->totalRate);
+	}
+
+}
+
+void LoopSums::remove(Loop* loop) {
+
+	accumulate(flux, fluxCompensation, -loop->totalRate);
+	accumulate(energy, energyCompensation, -loop->getEnergy());
+	updates++;
+
+	if (tree != NULL) {
+		tree->remove(loop->rateSlot);
+		loop->rateSlot = -1;
+	}
+
+}
+
+void LoopSums::changeRate(Loop* loop, double oldRate, double newRate) {
+
+	accumulate(flux, fluxCompensation, newRate - oldRate);
+	updates++;
+
+	if (tree != NULL) {
+		tree->update(loop->rateSlot, newRate);
+	}
+
+}
+
+// only valid once every loop has been detached.
+void LoopSums::clear(void) {
+
+	flux = fluxCompensation = 0.0;
+	energy = energyCompensation = 0.0;
+	updates = 0;
+
+}
+
+double LoopSums::getFlux(void) {
+
+	if (tree != NULL)
+		return tree->getTotal();
+
+	return flux + fluxCompensation;
+
+}
+
+double LoopSums::getEnergy(void) {
+
+	return energy + energyCompensation;
+
+}
+
+bool LoopSums::needsRebuild(void) {
+
+	return updates > REBUILD_INTERVAL;
+
+}
+
+// only valid while no loop is attached.
+void LoopSums::enableTree(void) {
+
+	if (tree == NULL)
+		tree = new RateTree<Loop>();
+
+}
+
+RateTree<Loop>* LoopSums::getTree(void) {
+
+	return tree;
+
+}
 
 struct RateArr;
 
@@ -34,6 +146,27 @@ inline double Loop::getEnergy(void) {
 	}
 }
 
+double Loop::getEnergy(EnergyModel *model) {
+
+	if (model == energyModel) {
+		return getEnergy();
+	}
+
+	EnergyModel* own = energyModel;
+	double ownEnergy = energy;
+
+	energyModel = model;
+	calculateEnergy();
+
+	double result = energy;
+
+	energyModel = own;
+	energy = ownEnergy;
+
+	return result;
+
+}
+
 inline double Loop::getEnthalpy(void) {
 
 	if (enthalpyComputed)
@@ -124,10 +257,10 @@ double Loop::returnFlux(Loop *comefrom) {
 	return total;
 }
 
-uint16_t Loop::getMoveCount(Loop* comefrom) {
+int Loop::getMoveCount(Loop* comefrom) {
 
 	assert(moves != NULL);
-	uint16_t output = moves->getCount();
+	int output = moves->getCount();
 
 	for (int loop = 0; loop < curAdjacent; loop++) {
 
@@ -154,10 +287,6 @@ void Loop::firstGen(Loop *comefrom) {
 
 }
 
-inline double Loop::getTotalRate(void) {
-	return totalRate;
-}
-
 Loop::Loop(void) {
 	numAdjacent = 0;
 	curAdjacent = 0;
@@ -175,6 +304,8 @@ Loop::~Loop(void) {
 
 	int counter;
 
+	detachSums();
+
 	if (adjacentLoops != NULL) {
 		for (counter = 0; counter < curAdjacent; counter++) {
 			if (adjacentLoops[counter] != NULL) {
@@ -182,7 +313,7 @@ Loop::~Loop(void) {
 				adjacentLoops[counter] = NULL; // Hah, take that!
 			}
 		}
-		delete[] adjacentLoops;
+		MemPool::deleteArray(adjacentLoops);
 		adjacentLoops = NULL;
 	}
 	if (moves != NULL) {
@@ -191,6 +322,42 @@ Loop::~Loop(void) {
 	}
 }
 
+void Loop::setTotalRate(double rate) {
+
+	if (loopSums != NULL) {
+		loopSums->changeRate(this, totalRate, rate);
+	}
+
+	totalRate = rate;
+
+}
+
+void Loop::attachSums(LoopSums* sums) {
+
+	if (loopSums == sums) {
+		return;
+	}
+
+	detachSums();
+
+	loopSums = sums;
+	loopSums->add(this);
+
+}
+
+void Loop::detachSums(void) {
+
+	if (loopSums != NULL) {
+		loopSums->remove(this);
+		loopSums = NULL;
+	}
+
+}
+
+Move *Loop::getLocalChoice(SimTimer& timer) {
+	return moves->getChoiceIndexed(timer);
+}
+
 void Loop::initAdjacency(int index) {
 	add_index = index;
 }
@@ -254,8 +421,8 @@ void Loop::performComplexSplit(Move *move, Loop **firstOpen, Loop **secondOpen)
 
 	for (flipflop = 0; flipflop < 2; flipflop++) {
 
-		sidelen = new int[sizes[flipflop] + 1];
-		seqs = new char *[sizes[flipflop] + 1];
+		sidelen = MemPool::newArray<int>(sizes[flipflop] + 1);
+		seqs = MemPool::newArray<char*>(sizes[flipflop] + 1);
 
 		for (loop = 0; loop < sizes[flipflop] + 1; loop++) {
 			if (loop < index[flipflop]) {
@@ -386,7 +553,7 @@ void Loop::generateAndSaveDeleteMove(Loop* input, int position) {
 
 		RateEnv rateEnv = RateEnv(tempRate.rate, energyModel, tempRate.left, tempRate.right);
 
-		moves->addMove(new Move(MOVE_DELETE | MOVE_1, rateEnv, this, input, position));
+		moves->addMove(Move(MOVE_DELETE | MOVE_1, rateEnv, this, input, position));
 
 	}
 
@@ -494,7 +661,7 @@ RateArr Loop::generateDeleteMoveRate(Loop *start, Loop *end) {
 
 		// resulting will be a hairpin loop equal to the previous plus an extra base on each side.
 
-		new_energy = energyModel->HairpinEnergy(start_->seqs[s_index], end_->hairpinsize + 2);
+		new_energy = energyModel->CachedHairpinEnergy(start_->seqs[s_index], end_->hairpinsize + 2);
 		old_energy = start->getEnergy() + end->getEnergy();
 
 		tempRate = energyModel->returnRate(old_energy, new_energy, 0);
@@ -528,8 +695,8 @@ RateArr Loop::generateDeleteMoveRate(Loop *start, Loop *end) {
 		// FD: e_index is the index of the attached loop for multiloop end_
 		// FD: s_index is the index of the attached loop for stackloop start_
 
-		int *sidelens = new int[end_->numAdjacent];
-		char **seqs = new char *[end_->numAdjacent];
+		int *sidelens = MemPool::newArray<int>(end_->numAdjacent);
+		char **seqs = MemPool::newArray<char*>(end_->numAdjacent);
 
 		for (int loop = 0; loop < end_->numAdjacent; loop++) {
 			if (loop != e_index) {
@@ -553,8 +720,8 @@ RateArr Loop::generateDeleteMoveRate(Loop *start, Loop *end) {
 		left = stackMove;
 		right = energyModel->getPrefactorsMulti(e_index, end_->numAdjacent, end_->sidelen);
 
-		delete[] sidelens;
-		delete[] seqs;
+		MemPool::deleteArray(sidelens);
+		MemPool::deleteArray(seqs);
 
 		return RateArr(tempRate / 2.0, left, right);
 	}
@@ -578,8 +745,8 @@ RateArr Loop::generateDeleteMoveRate(Loop *start, Loop *end) {
 		}
 		// note e_index has different meaning now for openloops.
 
-		int *sidelens = new int[end_->numAdjacent + 1];
-		char **seqs = new char *[end_->numAdjacent + 1];
+		int *sidelens = MemPool::newArray<int>(end_->numAdjacent + 1);
+		char **seqs = MemPool::newArray<char*>(end_->numAdjacent + 1);
 
 		for (int loop = 0; loop < end_->numAdjacent + 1; loop++) {
 			if (loop == e_index) {
@@ -610,8 +777,8 @@ RateArr Loop::generateDeleteMoveRate(Loop *start, Loop *end) {
 		left = energyModel->prefactorOpen(e_index, (end_->numAdjacent + 1), end_->sidelen);
 		right = stackMove;
 
-		delete[] sidelens;
-		delete[] seqs;
+		MemPool::deleteArray(sidelens);
+		MemPool::deleteArray(seqs);
 
 		return RateArr(tempRate / 2.0, left, right);
 
@@ -680,7 +847,7 @@ RateArr Loop::generateDeleteMoveRate(Loop *start, Loop *end) {
 
 		// resulting will be a hairpin loop with previous size, plus interior loop's sizes (both) plus 2 (for the pairing that's now unpaired)
 
-		new_energy = energyModel->HairpinEnergy(start_->int_seq[s_index], end_->hairpinsize + 2 + start_->sizes[0] + start_->sizes[1]);
+		new_energy = energyModel->CachedHairpinEnergy(start_->int_seq[s_index], end_->hairpinsize + 2 + start_->sizes[0] + start_->sizes[1]);
 		old_energy = start->getEnergy() + end->getEnergy();
 		tempRate = energyModel->returnRate(old_energy, new_energy, 0);
 
@@ -710,8 +877,8 @@ RateArr Loop::generateDeleteMoveRate(Loop *start, Loop *end) {
 		}
 		// note e_index has different meaning now for multiloops.
 
-		int *sidelens = new int[end_->numAdjacent];
-		char **seqs = new char *[end_->numAdjacent];
+		int *sidelens = MemPool::newArray<int>(end_->numAdjacent);
+		char **seqs = MemPool::newArray<char*>(end_->numAdjacent);
 
 		for (int loop = 0; loop < end_->numAdjacent; loop++) {
 			if (loop != e_index) {
@@ -736,8 +903,8 @@ RateArr Loop::generateDeleteMoveRate(Loop *start, Loop *end) {
 		left = energyModel->getPrefactorsMulti(e_index, end_->numAdjacent, end_->sidelen);
 		right = loopMove;
 
-		delete[] sidelens;
-		delete[] seqs;
+		MemPool::deleteArray(sidelens);
+		MemPool::deleteArray(seqs);
 
 		return RateArr(tempRate / 2.0, left, right);
 
@@ -761,8 +928,8 @@ RateArr Loop::generateDeleteMoveRate(Loop *start, Loop *end) {
 		}
 		// note e_index has different meaning now for openloops.
 
-		int *sidelens = new int[end_->numAdjacent + 1];
-		char **seqs = new char *[end_->numAdjacent + 1];
+		int *sidelens = MemPool::newArray<int>(end_->numAdjacent + 1);
+		char **seqs = MemPool::newArray<char*>(end_->numAdjacent + 1);
 
 		for (int loop = 0; loop < end_->numAdjacent + 1; loop++) {
 			if (loop == e_index) {
@@ -790,8 +957,8 @@ RateArr Loop::generateDeleteMoveRate(Loop *start, Loop *end) {
 
 		}
 
-		delete[] sidelens;
-		delete[] seqs;
+		MemPool::deleteArray(sidelens);
+		MemPool::deleteArray(seqs);
 
 		return RateArr(tempRate / 2.0, left, right);
 	}
@@ -833,7 +1000,7 @@ RateArr Loop::generateDeleteMoveRate(Loop *start, Loop *end) {
 
 		// resulting will be a hairpin loop with previous size, plus interior loop's sizes (both) plus 2 (for the pairing that's now unpaired)
 
-		new_energy = energyModel->HairpinEnergy(start_->bulge_seq[s_index], end_->hairpinsize + 2 + start_->bulgesize[0] + start_->bulgesize[1]);
+		new_energy = energyModel->CachedHairpinEnergy(start_->bulge_seq[s_index], end_->hairpinsize + 2 + start_->bulgesize[0] + start_->bulgesize[1]);
 		old_energy = start->getEnergy() + end->getEnergy();
 		tempRate = energyModel->returnRate(old_energy, new_energy, 0);
 
@@ -863,8 +1030,8 @@ RateArr Loop::generateDeleteMoveRate(Loop *start, Loop *end) {
 		}
 		// note e_index has different meaning now for multiloops.
 
-		int *sidelens = new int[end_->numAdjacent];
-		char **seqs = new char *[end_->numAdjacent];
+		int *sidelens = MemPool::newArray<int>(end_->numAdjacent);
+		char **seqs = MemPool::newArray<char*>(end_->numAdjacent);
 
 		for (int loop = 0; loop < end_->numAdjacent; loop++) {
 			if (loop != e_index) {
@@ -892,8 +1059,8 @@ RateArr Loop::generateDeleteMoveRate(Loop *start, Loop *end) {
 
 		}
 
-		delete[] sidelens;
-		delete[] seqs;
+		MemPool::deleteArray(sidelens);
+		MemPool::deleteArray(seqs);
 		return RateArr(tempRate / 2.0, left, right);
 
 	}
@@ -916,8 +1083,8 @@ RateArr Loop::generateDeleteMoveRate(Loop *start, Loop *end) {
 		}
 		// note e_index has different meaning now for openloops.
 
-		int *sidelens = new int[end_->numAdjacent + 1];
-		char **seqs = new char *[end_->numAdjacent + 1];
+		int *sidelens = MemPool::newArray<int>(end_->numAdjacent + 1);
+		char **seqs = MemPool::newArray<char*>(end_->numAdjacent + 1);
 
 		for (int loop = 0; loop < end_->numAdjacent + 1; loop++) {
 			if (loop == e_index) {
@@ -944,8 +1111,8 @@ RateArr Loop::generateDeleteMoveRate(Loop *start, Loop *end) {
 
 		}
 
-		delete[] sidelens;
-		delete[] seqs;
+		MemPool::deleteArray(sidelens);
+		MemPool::deleteArray(seqs);
 
 		return RateArr(tempRate / 2.0, left, right);
 
@@ -1029,8 +1196,8 @@ RateArr Loop::generateDeleteMoveRate(Loop *start, Loop *end) {
 
 		else if (end_->numAdjacent > 3)  // multiloop case
 				{
-			int *sidelens = new int[end_->numAdjacent - 1];
-			char **seqs = new char *[end_->numAdjacent - 1];
+			int *sidelens = MemPool::newArray<int>(end_->numAdjacent - 1);
+			char **seqs = MemPool::newArray<char*>(end_->numAdjacent - 1);
 
 			for (int loop = 0; loop < end_->numAdjacent; loop++) {
 				if (loop != e_index) {
@@ -1065,8 +1232,8 @@ RateArr Loop::generateDeleteMoveRate(Loop *start, Loop *end) {
 
 			}
 
-			delete[] sidelens;
-			delete[] seqs;
+			MemPool::deleteArray(sidelens);
+			MemPool::deleteArray(seqs);
 
 			return RateArr(tempRate / 2.0, left, right);
 
@@ -1087,8 +1254,8 @@ RateArr Loop::generateDeleteMoveRate(Loop *start, Loop *end) {
 		}
 		// note e_index has different meaning now for openloops.
 
-		int *sidelens = new int[end_->numAdjacent];
-		char **seqs = new char *[end_->numAdjacent];
+		int *sidelens = MemPool::newArray<int>(end_->numAdjacent);
+		char **seqs = MemPool::newArray<char*>(end_->numAdjacent);
 
 		for (int loop = 0; loop < end_->numAdjacent + 1; loop++) {
 			if (loop < e_index) {
@@ -1117,8 +1284,8 @@ RateArr Loop::generateDeleteMoveRate(Loop *start, Loop *end) {
 
 		}
 
-		delete[] sidelens;
-		delete[] seqs;
+		MemPool::deleteArray(sidelens);
+		MemPool::deleteArray(seqs);
 		return RateArr(tempRate / 2.0, left, right);
 
 	}
@@ -1148,8 +1315,8 @@ RateArr Loop::generateDeleteMoveRate(Loop *start, Loop *end) {
 		}
 		// note e_index has different meaning now for multiloops.
 
-		int *sidelens = new int[end_->numAdjacent + start_->numAdjacent - 2];
-		char **seqs = new char *[end_->numAdjacent + start_->numAdjacent - 2];
+		int *sidelens = MemPool::newArray<int>(end_->numAdjacent + start_->numAdjacent - 2);
+		char **seqs = MemPool::newArray<char*>(end_->numAdjacent + start_->numAdjacent - 2);
 
 		index = 0;
 		for (int loop = 0; loop < start_->numAdjacent; loop++) {
@@ -1188,8 +1355,8 @@ RateArr Loop::generateDeleteMoveRate(Loop *start, Loop *end) {
 
 		}
 
-		delete[] sidelens;
-		delete[] seqs;
+		MemPool::deleteArray(sidelens);
+		MemPool::deleteArray(seqs);
 
 		return RateArr(tempRate / 2.0, left, right);
 
@@ -1215,8 +1382,8 @@ RateArr Loop::generateDeleteMoveRate(Loop *start, Loop *end) {
 		}
 		// note e_index has different meaning now for multiloops.
 
-		int *sidelens = new int[end_->numAdjacent + start_->numAdjacent - 1];
-		char **seqs = new char *[end_->numAdjacent + start_->numAdjacent - 1];
+		int *sidelens = MemPool::newArray<int>(end_->numAdjacent + start_->numAdjacent - 1);
+		char **seqs = MemPool::newArray<char*>(end_->numAdjacent + start_->numAdjacent - 1);
 
 		index = 0;
 		for (int loop = 0; loop <= start_->numAdjacent; loop++) {
@@ -1264,8 +1431,8 @@ RateArr Loop::generateDeleteMoveRate(Loop *start, Loop *end) {
 
 		}
 
-		delete[] sidelens;
-		delete[] seqs;
+		MemPool::deleteArray(sidelens);
+		MemPool::deleteArray(seqs);
 
 		return RateArr(tempRate / 2.0, left, right);
 
@@ -1303,8 +1470,8 @@ RateArr Loop::generateDeleteMoveRate(Loop *start, Loop *end) {
 
 		for (flipflop = 0; flipflop < 2; flipflop++) {
 
-			sidelen = new int[sizes[flipflop] + 1];
-			seqs = new char *[sizes[flipflop] + 1];
+			sidelen = MemPool::newArray<int>(sizes[flipflop] + 1);
+			seqs = MemPool::newArray<char*>(sizes[flipflop] + 1);
 
 			for (loop = 0; loop < sizes[flipflop] + 1; loop++) {
 				if (loop < index[flipflop]) {
@@ -1325,8 +1492,8 @@ RateArr Loop::generateDeleteMoveRate(Loop *start, Loop *end) {
 			//initialize the new openloops, and connect them correctly, then initialize their moves, etc.
 			new_energies[flipflop] = energyModel->OpenloopEnergy(sizes[flipflop], sidelen, seqs);
 
-			delete[] sidelen;
-			delete[] seqs;
+			MemPool::deleteArray(sidelen);
+			MemPool::deleteArray(seqs);
 		}
 
 		old_energy = start->getEnergy() + end->getEnergy();
@@ -1599,8 +1766,8 @@ Loop *Loop::performDeleteMove(Move *move) {
 		}
 		// note e_index has different meaning now for multiloops.
 
-		int *sidelens = new int[end_->numAdjacent];
-		char **seqs = new char *[end_->numAdjacent];
+		int *sidelens = MemPool::newArray<int>(end_->numAdjacent);
+		char **seqs = MemPool::newArray<char*>(end_->numAdjacent);
 
 		for (int loop = 0; loop < end_->numAdjacent; loop++) {
 			if (loop != e_index) {
@@ -1675,8 +1842,8 @@ Loop *Loop::performDeleteMove(Move *move) {
 //		cout << "End is " << endl;
 //		cout << end_->typeInternalsToString() << endl;
 
-		int *sidelens = new int[end_->numAdjacent + 1];
-		char **seqs = new char *[end_->numAdjacent + 1];
+		int *sidelens = MemPool::newArray<int>(end_->numAdjacent + 1);
+		char **seqs = MemPool::newArray<char*>(end_->numAdjacent + 1);
 
 		for (int loop = 0; loop < end_->numAdjacent + 1; loop++) {
 			if (loop == e_index) {
@@ -1876,8 +2043,8 @@ Loop *Loop::performDeleteMove(Move *move) {
 		}
 		// note e_index has different meaning now for multiloops.
 
-		int *sidelens = new int[end_->numAdjacent];
-		char **seqs = new char *[end_->numAdjacent];
+		int *sidelens = MemPool::newArray<int>(end_->numAdjacent);
+		char **seqs = MemPool::newArray<char*>(end_->numAdjacent);
 
 		for (int loop = 0; loop < end_->numAdjacent; loop++) {
 			if (loop != e_index) {
@@ -1942,8 +2109,8 @@ Loop *Loop::performDeleteMove(Move *move) {
 		}
 		// note e_index has different meaning now for openloops.
 
-		int *sidelens = new int[end_->numAdjacent + 1];
-		char **seqs = new char *[end_->numAdjacent + 1];
+		int *sidelens = MemPool::newArray<int>(end_->numAdjacent + 1);
+		char **seqs = MemPool::newArray<char*>(end_->numAdjacent + 1);
 
 		for (int loop = 0; loop < end_->numAdjacent + 1; loop++) {
 			if (loop == e_index) {
@@ -2094,8 +2261,8 @@ Loop *Loop::performDeleteMove(Move *move) {
 		}
 		// note e_index has different meaning now for multiloops.
 
-		int *sidelens = new int[end_->numAdjacent];
-		char **seqs = new char *[end_->numAdjacent];
+		int *sidelens = MemPool::newArray<int>(end_->numAdjacent);
+		char **seqs = MemPool::newArray<char*>(end_->numAdjacent);
 
 		for (int loop = 0; loop < end_->numAdjacent; loop++) {
 			if (loop != e_index) {
@@ -2159,8 +2326,8 @@ Loop *Loop::performDeleteMove(Move *move) {
 		}
 		// note e_index has different meaning now for openloops.
 
-		int *sidelens = new int[end_->numAdjacent + 1];
-		char **seqs = new char *[end_->numAdjacent + 1];
+		int *sidelens = MemPool::newArray<int>(end_->numAdjacent + 1);
+		char **seqs = MemPool::newArray<char*>(end_->numAdjacent + 1);
 
 		for (int loop = 0; loop < end_->numAdjacent + 1; loop++) {
 			if (loop == e_index) {
@@ -2305,8 +2472,8 @@ Loop *Loop::performDeleteMove(Move *move) {
 
 		else if (end_->numAdjacent > 3)              // multiloop case
 				{
-			int* sidelens = new int[end_->numAdjacent - 1];
-			char** seqs = new char*[end_->numAdjacent - 1];
+			int* sidelens = MemPool::newArray<int>(end_->numAdjacent - 1);
+			char** seqs = MemPool::newArray<char*>(end_->numAdjacent - 1);
 
 			if (utility::debugTraces) {
 
@@ -2375,8 +2542,8 @@ Loop *Loop::performDeleteMove(Move *move) {
 		}
 		// note e_index has different meaning now for openloops.
 
-		int *sidelens = new int[end_->numAdjacent];
-		char **seqs = new char *[end_->numAdjacent];
+		int *sidelens = MemPool::newArray<int>(end_->numAdjacent);
+		char **seqs = MemPool::newArray<char*>(end_->numAdjacent);
 
 		for (int loop = 0; loop < end_->numAdjacent + 1; loop++) {
 			if (loop < e_index) {
@@ -2439,8 +2606,8 @@ Loop *Loop::performDeleteMove(Move *move) {
 		}
 		// note e_index has different meaning now for multiloops.
 
-		int *sidelens = new int[end_->numAdjacent + start_->numAdjacent - 2];
-		char **seqs = new char *[end_->numAdjacent + start_->numAdjacent - 2];
+		int *sidelens = MemPool::newArray<int>(end_->numAdjacent + start_->numAdjacent - 2);
+		char **seqs = MemPool::newArray<char*>(end_->numAdjacent + start_->numAdjacent - 2);
 
 		index = 0;
 		for (int loop = 0; loop < start_->numAdjacent; loop++) {
@@ -2516,8 +2683,8 @@ Loop *Loop::performDeleteMove(Move *move) {
 		}
 		// note e_index has different meaning now for multiloops.
 
-		int *sidelens = new int[end_->numAdjacent + start_->numAdjacent - 1];
-		char **seqs = new char *[end_->numAdjacent + start_->numAdjacent - 1];
+		int *sidelens = MemPool::newArray<int>(end_->numAdjacent + start_->numAdjacent - 1);
+		char **seqs = MemPool::newArray<char*>(end_->numAdjacent + start_->numAdjacent - 1);
 
 		index = 0;
 		for (int loop = 0; loop <= start_->numAdjacent; loop++) {
@@ -2612,6 +2779,7 @@ void StackLoop::calculateEnthalpy(void) {
 }
 
 void StackLoop::generateMoves(void) {
+	PhaseTimer phase(PHASE_GENERATE_MOVES);
 	generateDeleteMoves();
 }
 
@@ -2624,7 +2792,7 @@ void StackLoop::generateDeleteMoves(void) {
 	generateAndSaveDeleteMove(adjacentLoops[0], 0);
 	generateAndSaveDeleteMove(adjacentLoops[1], 1);
 
-	totalRate = moves->getRate();
+	setTotalRate(moves->getRate());
 }
 
 void StackLoop::printMove(Loop *comefrom, char *structure_p, char *seq_p) {
@@ -2708,7 +2876,7 @@ char *StackLoop::verifyLoop(char *incoming_sequence, Loop *from) {
 
 StackLoop::StackLoop(void) {
 	numAdjacent = 2;
-	adjacentLoops = new Loop *[2];
+	adjacentLoops = MemPool::newArray<Loop*>(2);
 	identity = 'S';
 }
 
@@ -2716,7 +2884,7 @@ StackLoop::StackLoop(char *seq1, char *seq2, Loop *left, Loop *right) // left an
 		{
 
 	numAdjacent = 2;
-	adjacentLoops = new Loop *[2];
+	adjacentLoops = MemPool::newArray<Loop*>(2);
 	adjacentLoops[0] = left;
 	adjacentLoops[1] = right;
 	curAdjacent = (left == NULL ? 0 : 1) + (right == NULL ? 0 : 1);
@@ -2748,7 +2916,7 @@ string StackLoop::typeInternalsToString(void) {
 
 HairpinLoop::HairpinLoop(void) {
 	numAdjacent = 1;
-	adjacentLoops = new Loop *[1];
+	adjacentLoops = MemPool::newArray<Loop*>(1);
 
 	hairpinsize = 0;
 	hairpin_seq = NULL;
@@ -2757,7 +2925,7 @@ HairpinLoop::HairpinLoop(void) {
 
 HairpinLoop::HairpinLoop(int size, char *hairpin_sequence, Loop *previous) {
 	numAdjacent = 1;
-	adjacentLoops = new Loop *[1];
+	adjacentLoops = MemPool::newArray<Loop*>(1);
 	adjacentLoops[0] = previous;
 	if (previous != NULL)
 		curAdjacent = 1;
@@ -2781,7 +2949,7 @@ void HairpinLoop::calculateEnergy(void) {
 
 	assert(energyModel != NULL);
 
-	energy = energyModel->HairpinEnergy(hairpin_seq, hairpinsize);
+	energy = energyModel->CachedHairpinEnergy(hairpin_seq, hairpinsize);
 }
 
 void HairpinLoop::calculateEnthalpy(void) {
@@ -2866,8 +3034,10 @@ double HairpinLoop::doChoice(Move *move, Loop **returnLoop) {
 
 void HairpinLoop::generateMoves(void) {
 
+	PhaseTimer phase(PHASE_GENERATE_MOVES);
+
 	double energies[2];
-	int pt = 0;
+	PartnerScan partners(energyModel);
 	int loop, loop2;
 	double tempRate = 0;
 	RateEnv rateEnv;
@@ -2879,7 +3049,7 @@ void HairpinLoop::generateMoves(void) {
 			delete moves;
 
 		moves = new MoveList(0);
-		totalRate = 0.0;
+		setTotalRate(0.0);
 		generateDeleteMoves();
 		return;
 	} else {
@@ -2889,64 +3059,60 @@ void HairpinLoop::generateMoves(void) {
 
 		// Indice 0 is the starting hairpin base. hairpinsize+1 is the ending hairpin base. Thus we want to start at hairpin indice 1, and go to hairpinsize - 3. (which could pair to indice hairpinsize)
 		for (loop = 1; loop <= hairpinsize - 4; loop++)
-			for (loop2 = loop + 4; loop2 <= hairpinsize; loop2++) {
+			for (partners.start(hairpin_seq, loop + 4, hairpinsize, hairpin_seq[loop]); (loop2 = partners.next()) >= 0;) {
 
-				pt = pairtypes[hairpin_seq[loop]][hairpin_seq[loop2]];
+				// the two could pair. Work out energies of the resulting pair of loops.
+				// Case handling time.
+				// possibilities: new stack + hairpin.
+				//                bulge + hairpin
+				//                interior + hairpin
 
-				if (pt != 0) { // the two could pair. Work out energies of the resulting pair of loops.
+				// new stack + hairpin
+				if (loop == 1 && loop2 == hairpinsize) {
 
-					// Case handling time.
-					// possibilities: new stack + hairpin.
-					//                bulge + hairpin
-					//                interior + hairpin
-
-					// new stack + hairpin
-					if (loop == 1 && loop2 == hairpinsize) {
-
-						energies[0] = energyModel->StackEnergy(hairpin_seq[0], hairpin_seq[hairpinsize + 1], hairpin_seq[loop], hairpin_seq[loop2]);
-						energies[1] = energyModel->HairpinEnergy(&hairpin_seq[1], hairpinsize - 2);
-						tempRate = energyModel->returnRate(getEnergy(), (energies[0] + energies[1]), 0);
+					energies[0] = energyModel->StackEnergy(hairpin_seq[0], hairpin_seq[hairpinsize + 1], hairpin_seq[loop], hairpin_seq[loop2]);
+					energies[1] = energyModel->CachedHairpinEnergy(&hairpin_seq[1], hairpinsize - 2);
+					tempRate = energyModel->returnRate(getEnergy(), (energies[0] + energies[1]), 0);
 
-						// stack and hairpin, so this is loop and stack
-						rateEnv = RateEnv(tempRate, energyModel, loopMove, stackMove);
-						moves->addMove(new Move(MOVE_CREATE | MOVE_1, rateEnv, this, loop, loop2));
+					// stack and hairpin, so this is loop and stack
+					rateEnv = RateEnv(tempRate, energyModel, loopMove, stackMove);
+					moves->addMove(Move(MOVE_CREATE | MOVE_1, rateEnv, this, loop, loop2));
 
-					}
-					// bulge + hairpin
-					else if (loop == 1 || loop2 == hairpinsize) {
-						// total bulge size is the difference between either loop and 1 (if that's the edge that has the bulge), or hairpinsize and loop2 (if that's the edge that moved). One must have moved with the other stationary to have a bulge, so the sum will always total whichever moved.
-						energies[0] = energyModel->BulgeEnergy(hairpin_seq[0], hairpin_seq[hairpinsize + 1], hairpin_seq[loop], hairpin_seq[loop2],
-								(loop - 1) + (hairpinsize - loop2));
+				}
+				// bulge + hairpin
+				else if (loop == 1 || loop2 == hairpinsize) {
+					// total bulge size is the difference between either loop and 1 (if that's the edge that has the bulge), or hairpinsize and loop2 (if that's the edge that moved). One must have moved with the other stationary to have a bulge, so the sum will always total whichever moved.
+					energies[0] = energyModel->BulgeEnergy(hairpin_seq[0], hairpin_seq[hairpinsize + 1], hairpin_seq[loop], hairpin_seq[loop2],
+							(loop - 1) + (hairpinsize - loop2));
 
-						// loop2 - loop - 1 is the new hairpin size.
+					// loop2 - loop - 1 is the new hairpin size.
 
-						energies[1] = energyModel->HairpinEnergy(&hairpin_seq[loop], loop2 - loop - 1);
+					energies[1] = energyModel->CachedHairpinEnergy(&hairpin_seq[loop], loop2 - loop - 1);
 
-						tempRate = energyModel->returnRate(getEnergy(), (energies[0] + energies[1]), 0);
+					tempRate = energyModel->returnRate(getEnergy(), (energies[0] + energies[1]), 0);
 
-						// new bulgeloop + hairpin: this is openMove and stackLoopMove
+					// new bulgeloop + hairpin: this is openMove and stackLoopMove
 
-						rateEnv = RateEnv(tempRate, energyModel, loopMove, stackLoopMove);
-						moves->addMove(new Move(MOVE_CREATE | MOVE_2, rateEnv, this, loop, loop2));
+					rateEnv = RateEnv(tempRate, energyModel, loopMove, stackLoopMove);
+					moves->addMove(Move(MOVE_CREATE | MOVE_2, rateEnv, this, loop, loop2));
 
-					} else // interior loop + hairpin case.
-					{
+				} else // interior loop + hairpin case.
+				{
 
-						energies[0] = energyModel->InteriorEnergy(hairpin_seq, &hairpin_seq[loop2], loop - 1, hairpinsize - loop2);
+					energies[0] = energyModel->InteriorEnergy(hairpin_seq, &hairpin_seq[loop2], loop - 1, hairpinsize - loop2);
 
-						// loop2 - loop - 1 is the new hairpin size.
-						energies[1] = energyModel->HairpinEnergy(&hairpin_seq[loop], loop2 - loop - 1);
-						tempRate = energyModel->returnRate(getEnergy(), (energies[0] + energies[1]), 0);
+					// loop2 - loop - 1 is the new hairpin size.
+					energies[1] = energyModel->CachedHairpinEnergy(&hairpin_seq[loop], loop2 - loop - 1);
+					tempRate = energyModel->returnRate(getEnergy(), (energies[0] + energies[1]), 0);
 
-						// interiorLoop + hairpin, so this is open + open
+					// interiorLoop + hairpin, so this is open + open
 
-						rateEnv = RateEnv(tempRate, energyModel, loopMove, loopMove);
+					rateEnv = RateEnv(tempRate, energyModel, loopMove, loopMove);
 
-						moves->addMove(new Move(MOVE_CREATE | MOVE_3, rateEnv, this, loop, loop2));
-					}
+					moves->addMove(Move(MOVE_CREATE | MOVE_3, rateEnv, this, loop, loop2));
 				}
 			}
-		totalRate = moves->getRate();
+		setTotalRate(moves->getRate());
 	}
 
 // Shift moves
@@ -2960,7 +3126,7 @@ void HairpinLoop::generateDeleteMoves(void) {
 
 	generateAndSaveDeleteMove(adjacentLoops[0], 0);
 
-	totalRate = moves->getRate();
+	setTotalRate(moves->getRate());
 }
 
 void HairpinLoop::printMove(Loop *comefrom, char *structure_p, char *seq_p) {
@@ -3008,7 +3174,7 @@ char *HairpinLoop::verifyLoop(char *incoming_sequence, Loop *from) {
 
 BulgeLoop::BulgeLoop(void) {
 	numAdjacent = 2;
-	adjacentLoops = new Loop *[2];
+	adjacentLoops = MemPool::newArray<Loop*>(2);
 
 	bulgesize[0] = 0;
 	bulgesize[1] = 0;
@@ -3020,7 +3186,7 @@ BulgeLoop::BulgeLoop(void) {
 BulgeLoop::BulgeLoop(int size1, int size2, char *bulge_sequence1, char *bulge_sequence2, Loop *left, Loop *right) {
 	numAdjacent = 2;
 	curAdjacent = 0;
-	adjacentLoops = new Loop *[2];
+	adjacentLoops = MemPool::newArray<Loop*>(2);
 	adjacentLoops[0] = left;
 	adjacentLoops[1] = right;
 	if (left != NULL)
@@ -3086,8 +3252,8 @@ double BulgeLoop::doChoice(Move *move, Loop **returnLoop) {
 	Loop *newLoop[2];
 	int pt, loop, loop2;
 
-	int *sidelen = new int[3];
-	char **seqs = new char *[3];
+	int *sidelen = MemPool::newArray<int>(3);
+	char **seqs = MemPool::newArray<char*>(3);
 	int bsize = bulgesize[0] + bulgesize[1];
 	int bside = (bulgesize[0] == 0) ? 1 : 0;
 
@@ -3135,8 +3301,12 @@ double BulgeLoop::doChoice(Move *move, Loop **returnLoop) {
 }
 
 void BulgeLoop::generateMoves(void) {
+
+	PhaseTimer phase(PHASE_GENERATE_MOVES);
+
 	double energies[2];
-	int loop, loop2, pt;
+	int loop, loop2;
+	PartnerScan partners(energyModel);
 	double tempRate;
 	RateEnv rateEnv;
 	int bsize = bulgesize[0] + bulgesize[1];
@@ -3148,7 +3318,7 @@ void BulgeLoop::generateMoves(void) {
 			delete moves;
 
 		moves = new MoveList(0);
-		totalRate = 0.0;
+		setTotalRate(0.0);
 		generateDeleteMoves();
 		return;
 	} else {
@@ -3158,64 +3328,60 @@ void BulgeLoop::generateMoves(void) {
 
 		// Indice 0 is the starting bulge base. bulgesize+1 is the ending hairpin base. Thus we want to start at hairpin indice 1, and go to hairpinsize - 4. (which could pair to indice hairpinsize)
 		for (loop = 1; loop <= bsize - 4; loop++)
-			for (loop2 = loop + 4; loop2 <= bsize; loop2++) {
-
-				pt = pairtypes[bulge_seq[bside][loop]][bulge_seq[bside][loop2]];
+			for (partners.start(bulge_seq[bside], loop + 4, bsize, bulge_seq[bside][loop]); (loop2 = partners.next()) >= 0;) {
 
-				if (pt != 0) { // the two could pair. Work out energies of the resulting pair of loops.
+				// the two could pair. Work out energies of the resulting pair of loops.
+				// Case handling time.
+				// it will always be a multiloop and hairpin.
 
-					// Case handling time.
-					// it will always be a multiloop and hairpin.
+				// Multiloop energy - CHECK THIS/FIXME
+				int sidelen[3];
+				char *sequences[3];
 
-					// Multiloop energy - CHECK THIS/FIXME
-					int sidelen[3];
-					char *sequences[3];
+				if (bside == 0) {
+					sidelen[0] = loop - 1;
+					sequences[0] = bulge_seq[0];
 
-					if (bside == 0) {
-						sidelen[0] = loop - 1;
-						sequences[0] = bulge_seq[0];
+					sidelen[1] = bsize - loop2;
+					sequences[1] = &bulge_seq[0][loop2];
 
-						sidelen[1] = bsize - loop2;
-						sequences[1] = &bulge_seq[0][loop2];
+					sidelen[2] = 0;
+					sequences[2] = bulge_seq[1];
 
-						sidelen[2] = 0;
-						sequences[2] = bulge_seq[1];
-
-					} else {
-						sidelen[0] = 0;
-						sequences[0] = bulge_seq[0];
+				} else {
+					sidelen[0] = 0;
+					sequences[0] = bulge_seq[0];
 
-						sidelen[1] = loop - 1;
-						sequences[1] = bulge_seq[1];
+					sidelen[1] = loop - 1;
+					sequences[1] = bulge_seq[1];
 
-						sidelen[2] = bsize - loop2;
-						sequences[2] = &bulge_seq[1][loop2];
+					sidelen[2] = bsize - loop2;
+					sequences[2] = &bulge_seq[1][loop2];
 
-					}
-					// need to add sequence info -definate FIXME for dangles != 0
-					energies[0] = energyModel->MultiloopEnergy(3, sidelen, sequences);
-					// loop2 - loop + 1 is the new hairpin size.
-					energies[1] = energyModel->HairpinEnergy(&bulge_seq[bside][loop], loop2 - loop - 1);
+				}
+				// need to add sequence info -definate FIXME for dangles != 0
+				energies[0] = energyModel->MultiloopEnergy(3, sidelen, sequences);
+				// loop2 - loop + 1 is the new hairpin size.
+				energies[1] = energyModel->CachedHairpinEnergy(&bulge_seq[bside][loop], loop2 - loop - 1);
 
-					tempRate = energyModel->returnRate(getEnergy(), (energies[0] + energies[1]), 0);
+				tempRate = energyModel->returnRate(getEnergy(), (energies[0] + energies[1]), 0);
 
-					// hairpin and multiloop, so this is loopMove and something
+				// hairpin and multiloop, so this is loopMove and something
 
-					MoveType multiMove = stackMove; // default init value;
+				MoveType multiMove = stackMove; // default init value;
 
-					if (bside == 0) {
-						multiMove = energyModel->prefactorInternal(sidelen[0], sidelen[1]);
-					} else {
-						multiMove = energyModel->prefactorInternal(sidelen[1], sidelen[2]);
-					}
+				if (bside == 0) {
+					multiMove = energyModel->prefactorInternal(sidelen[0], sidelen[1]);
+				} else {
+					multiMove = energyModel->prefactorInternal(sidelen[1], sidelen[2]);
+				}
 
-					rateEnv = RateEnv(tempRate, energyModel, loopMove, multiMove);
+				rateEnv = RateEnv(tempRate, energyModel, loopMove, multiMove);
 
-					moves->addMove(new Move(MOVE_CREATE, rateEnv, this, loop, loop2));
-				}
+				moves->addMove(Move(MOVE_CREATE, rateEnv, this, loop, loop2));
 			}
 	}
-	totalRate = moves->getRate();
+	setTotalRate(moves->getRate());
 
 	generateDeleteMoves();
 }
@@ -3229,7 +3395,7 @@ void BulgeLoop::generateDeleteMoves(void) {
 	generateAndSaveDeleteMove(adjacentLoops[0], 0);
 	generateAndSaveDeleteMove(adjacentLoops[1], 1);
 
-	totalRate = moves->getRate();
+	setTotalRate(moves->getRate());
 }
 
 void BulgeLoop::printMove(Loop *comefrom, char *structure_p, char *seq_p) {
@@ -3291,7 +3457,7 @@ char *BulgeLoop::verifyLoop(char *incoming_sequence, Loop *from) {
 
 InteriorLoop::InteriorLoop(void) {
 	numAdjacent = 2;
-	adjacentLoops = new Loop *[2];
+	adjacentLoops = MemPool::newArray<Loop*>(2);
 
 	sizes[0] = sizes[1] = 0;
 	int_seq[0] = int_seq[1] = NULL;
@@ -3300,7 +3466,7 @@ InteriorLoop::InteriorLoop(void) {
 
 InteriorLoop::InteriorLoop(int size1, int size2, char *int_seq1, char *int_seq2, Loop *left, Loop *right) {
 	numAdjacent = 2;
-	adjacentLoops = new Loop *[2];
+	adjacentLoops = MemPool::newArray<Loop*>(2);
 
 	adjacentLoops[0] = left;
 	adjacentLoops[1] = right;
@@ -3371,8 +3537,8 @@ void InteriorLoop::calculateEnthalpy(void) {
 double InteriorLoop::doChoice(Move *move, Loop **returnLoop) {
 	Loop *newLoop[2];
 	int loop, loop2;
-	int *sidelen = new int[3];
-	char **seqs = new char *[3];
+	int *sidelen = MemPool::newArray<int>(3);
+	char **seqs = MemPool::newArray<char*>(3);
 
 	if (move->type & MOVE_CREATE) {
 		if (move->type & MOVE_1) {
@@ -3478,23 +3644,26 @@ double InteriorLoop::doChoice(Move *move, Loop **returnLoop) {
 
 			*returnLoop = newLoop[0];
 
-			delete[] seqs;
-			delete[] sidelen;
+			MemPool::deleteArray(seqs);
+			MemPool::deleteArray(sidelen);
 			return ((newLoop[0]->getTotalRate() + newLoop[1]->getTotalRate()) - totalRate);
 		} else {
-			delete[] seqs;
-			delete[] sidelen;
+			MemPool::deleteArray(seqs);
+			MemPool::deleteArray(sidelen);
 		}
 	} else {
-		delete[] seqs;
-		delete[] sidelen;
+		MemPool::deleteArray(seqs);
+		MemPool::deleteArray(sidelen);
 	}
 	return -totalRate;
 }
 
 void InteriorLoop::generateMoves(void) {
+
+	PhaseTimer phase(PHASE_GENERATE_MOVES);
+
 	double energies[2];
-	int pt = 0;
+	PartnerScan partners(energyModel);
 	int loop, loop2;
 	double tempRate = 0;
 	RateEnv rateEnv;
@@ -3520,100 +3689,89 @@ void InteriorLoop::generateMoves(void) {
 // Loop #1: Side 0 only Creation Moves
 	for (loop = 1; loop <= sizes[0] - 4; loop++) {
 
-		for (loop2 = loop + 4; loop2 <= sizes[0]; loop2++) { // each possibility will always result in a new hairpin + multiloop.
+		for (partners.start(int_seq[0], loop + 4, sizes[0], int_seq[0][loop]); (loop2 = partners.next()) >= 0;) { // each possibility will always result in a new hairpin + multiloop.
 
-			pt = pairtypes[int_seq[0][loop]][int_seq[0][loop2]];
+			energies[0] = energyModel->CachedHairpinEnergy(&int_seq[0][loop], loop2 - loop - 1);
 
-			if (pt != 0) {
-				energies[0] = energyModel->HairpinEnergy(&int_seq[0][loop], loop2 - loop - 1);
+			// Multiloop energy
+			int sidelen[3] = { loop - 1, sizes[0] - loop2, sizes[1] };
+			char *sequences[3] = { &int_seq[0][0], &int_seq[0][loop2], &int_seq[1][0] };
 
-				// Multiloop energy
-				int sidelen[3] = { loop - 1, sizes[0] - loop2, sizes[1] };
-				char *sequences[3] = { &int_seq[0][0], &int_seq[0][loop2], &int_seq[1][0] };
-
-				energies[1] = energyModel->MultiloopEnergy(3, sidelen, sequences);
-				tempRate = energyModel->returnRate(getEnergy(), (energies[0] + energies[1]), 0);
+			energies[1] = energyModel->MultiloopEnergy(3, sidelen, sequences);
+			tempRate = energyModel->returnRate(getEnergy(), (energies[0] + energies[1]), 0);
 
 //				// hairpin and multiloop, so this is loopMove and something
 
-				MoveType multiMove = energyModel->prefactorInternal(sidelen[0], sidelen[1]);
-				rateEnv = RateEnv(tempRate, energyModel, multiMove, loopMove);
+			MoveType multiMove = energyModel->prefactorInternal(sidelen[0], sidelen[1]);
+			rateEnv = RateEnv(tempRate, energyModel, multiMove, loopMove);
 
-				moves->addMove(new Move(MOVE_CREATE | MOVE_1, rateEnv, this, loop, loop2));
-			}
+			moves->addMove(Move(MOVE_CREATE | MOVE_1, rateEnv, this, loop, loop2));
 		}
 	}
 
 // Loop #2: Side 1 only Creation Moves
 	for (loop = 1; loop <= sizes[1] - 4; loop++)
-		for (loop2 = loop + 4; loop2 <= sizes[1]; loop2++) { // each possibility will always result in a new hairpin + multiloop.
-			pt = pairtypes[int_seq[1][loop]][int_seq[1][loop2]];
-			if (pt != 0) {
-				energies[0] = energyModel->HairpinEnergy(&int_seq[1][loop], loop2 - loop - 1);
+		for (partners.start(int_seq[1], loop + 4, sizes[1], int_seq[1][loop]); (loop2 = partners.next()) >= 0;) { // each possibility will always result in a new hairpin + multiloop.
+			energies[0] = energyModel->CachedHairpinEnergy(&int_seq[1][loop], loop2 - loop - 1);
 
-				// Multiloop energy - CHECK THIS
-				int sidelen[3] = { sizes[0], loop - 1, sizes[1] - loop2 };
-				char *sequences[3] = { &int_seq[0][0], &int_seq[1][0], &int_seq[1][loop2] };
+			// Multiloop energy - CHECK THIS
+			int sidelen[3] = { sizes[0], loop - 1, sizes[1] - loop2 };
+			char *sequences[3] = { &int_seq[0][0], &int_seq[1][0], &int_seq[1][loop2] };
 
-				energies[1] = energyModel->MultiloopEnergy(3, sidelen, sequences);
-				tempRate = energyModel->returnRate(getEnergy(), (energies[0] + energies[1]), 0);
+			energies[1] = energyModel->MultiloopEnergy(3, sidelen, sequences);
+			tempRate = energyModel->returnRate(getEnergy(), (energies[0] + energies[1]), 0);
 
-				// hairpin and multiloop, so this is loopMove and something
+			// hairpin and multiloop, so this is loopMove and something
 
-				MoveType multiMove = energyModel->prefactorInternal(sidelen[1], sidelen[2]);
-				rateEnv = RateEnv(tempRate, energyModel, loopMove, multiMove);
+			MoveType multiMove = energyModel->prefactorInternal(sidelen[1], sidelen[2]);
+			rateEnv = RateEnv(tempRate, energyModel, loopMove, multiMove);
 
-				moves->addMove(new Move(MOVE_CREATE | MOVE_2, rateEnv, this, loop, loop2));
-			}
+			moves->addMove(Move(MOVE_CREATE | MOVE_2, rateEnv, this, loop, loop2));
 		}
 
 // Loop #3: Side 0 to Side 1 crossing moves ONLY
 
 	for (loop = 1; loop <= sizes[0]; loop++)
-		for (loop2 = 1; loop2 <= sizes[1]; loop2++) {
-
-			pt = pairtypes[int_seq[0][loop]][int_seq[1][loop2]];
-			if (pt != 0) {
-				// Need to check conditions for each side in order to determine what the two new loops types would be.
-				// adjacent to first pair side:
-
-				MoveType leftMove = stackMove;
-				MoveType rightMove = stackMove;
+		for (partners.start(int_seq[1], 1, sizes[1], int_seq[0][loop]); (loop2 = partners.next()) >= 0;) {
+			// Need to check conditions for each side in order to determine what the two new loops types would be.
+			// adjacent to first pair side:
 
-				if (loop == 1 && loop2 == sizes[1]) {			// stack
-					energies[0] = energyModel->StackEnergy(int_seq[0][0], int_seq[1][sizes[1] + 1], int_seq[0][loop], int_seq[1][loop2]);
-				} else if (loop == 1 || loop2 == sizes[1]) {		// bulge
-					energies[0] = energyModel->BulgeEnergy(int_seq[0][0], int_seq[1][sizes[1] + 1], int_seq[0][loop], int_seq[1][loop2],
-							(loop - 1) + (sizes[1] - loop2));
-					leftMove = stackLoopMove;
-				} else {  // interior
-					energies[0] = energyModel->InteriorEnergy(int_seq[0], &int_seq[1][loop2], loop - 1, sizes[1] - loop2);
-					leftMove = loopMove;
-				}
+			MoveType leftMove = stackMove;
+			MoveType rightMove = stackMove;
+
+			if (loop == 1 && loop2 == sizes[1]) {			// stack
+				energies[0] = energyModel->StackEnergy(int_seq[0][0], int_seq[1][sizes[1] + 1], int_seq[0][loop], int_seq[1][loop2]);
+			} else if (loop == 1 || loop2 == sizes[1]) {		// bulge
+				energies[0] = energyModel->BulgeEnergy(int_seq[0][0], int_seq[1][sizes[1] + 1], int_seq[0][loop], int_seq[1][loop2],
+						(loop - 1) + (sizes[1] - loop2));
+				leftMove = stackLoopMove;
+			} else {  // interior
+				energies[0] = energyModel->InteriorEnergy(int_seq[0], &int_seq[1][loop2], loop - 1, sizes[1] - loop2);
+				leftMove = loopMove;
+			}
 
-				// other side
-				if (loop == sizes[0] && loop2 == 1) { // stack
-					energies[1] = energyModel->StackEnergy(int_seq[0][loop], int_seq[1][loop2], int_seq[0][sizes[0] + 1], int_seq[1][0]);
-				} else if (loop == sizes[0] || loop2 == 1) { // bulge
-					energies[1] = energyModel->BulgeEnergy(int_seq[0][loop], int_seq[1][loop2], int_seq[0][sizes[0] + 1], int_seq[1][0],
-							(loop2 - 1) + (sizes[0] - loop));
-					rightMove = stackLoopMove;
-				} else { // interior
-					energies[1] = energyModel->InteriorEnergy(&int_seq[0][loop], int_seq[1], sizes[0] - loop, loop2 - 1);
-					rightMove = loopMove;
-				}
+			// other side
+			if (loop == sizes[0] && loop2 == 1) { // stack
+				energies[1] = energyModel->StackEnergy(int_seq[0][loop], int_seq[1][loop2], int_seq[0][sizes[0] + 1], int_seq[1][0]);
+			} else if (loop == sizes[0] || loop2 == 1) { // bulge
+				energies[1] = energyModel->BulgeEnergy(int_seq[0][loop], int_seq[1][loop2], int_seq[0][sizes[0] + 1], int_seq[1][0],
+						(loop2 - 1) + (sizes[0] - loop));
+				rightMove = stackLoopMove;
+			} else { // interior
+				energies[1] = energyModel->InteriorEnergy(&int_seq[0][loop], int_seq[1], sizes[0] - loop, loop2 - 1);
+				rightMove = loopMove;
+			}
 
-				tempRate = energyModel->returnRate(getEnergy(), (energies[0] + energies[1]), 0);
+			tempRate = energyModel->returnRate(getEnergy(), (energies[0] + energies[1]), 0);
 
-				// interior loop is closing, so this could be anything.
-				rateEnv = RateEnv(tempRate, energyModel, leftMove, rightMove);
+			// interior loop is closing, so this could be anything.
+			rateEnv = RateEnv(tempRate, energyModel, leftMove, rightMove);
 
-				moves->addMove(new Move(MOVE_CREATE | MOVE_3, rateEnv, this, loop, loop2));
-			}
+			moves->addMove(Move(MOVE_CREATE | MOVE_3, rateEnv, this, loop, loop2));
 		}
 
 // totaling the rate
-	totalRate = moves->getRate();
+	setTotalRate(moves->getRate());
 
 // Shift moves
 
@@ -3630,7 +3788,7 @@ void InteriorLoop::generateDeleteMoves(void) {
 	generateAndSaveDeleteMove(adjacentLoops[0], 0);
 	generateAndSaveDeleteMove(adjacentLoops[1], 1);
 
-	totalRate = moves->getRate();
+	setTotalRate(moves->getRate());
 
 }
 
@@ -3704,7 +3862,7 @@ MultiLoop::MultiLoop(void) {
 
 MultiLoop::MultiLoop(int branches, int *sidelengths, char **sequences) {
 	numAdjacent = branches;
-	adjacentLoops = new Loop *[branches];
+	adjacentLoops = MemPool::newArray<Loop*>(branches);
 	for (int loop = 0; loop < branches; loop++) {
 		adjacentLoops[loop] = NULL;
 	}
@@ -3715,8 +3873,8 @@ MultiLoop::MultiLoop(int branches, int *sidelengths, char **sequences) {
 
 MultiLoop::~MultiLoop(void) {
 
-	delete[] sidelen;
-	delete[] seqs;
+	MemPool::deleteArray(sidelen);
+	MemPool::deleteArray(seqs);
 
 }
 
@@ -3784,8 +3942,8 @@ double MultiLoop::doChoice(Move *move, Loop **returnLoop) {
 
 		if (move->type & MOVE_1) {
 			//single side, hairpin + multi with 1 higher mag.
-			sidelengths = new int[numAdjacent + 1];
-			sequences = new char *[numAdjacent + 1];
+			sidelengths = MemPool::newArray<int>(numAdjacent + 1);
+			sequences = MemPool::newArray<char*>(numAdjacent + 1);
 
 			pt = pairtypes[seqs[loop3][loop]][seqs[loop3][loop2]];
 
@@ -3831,8 +3989,8 @@ double MultiLoop::doChoice(Move *move, Loop **returnLoop) {
 			//adjacent sides, one of: stack    + multi with same mag
 			//                        bulge    + multi with same mag
 			//                        interior + multi with same mag
-			sidelengths = new int[numAdjacent];
-			sequences = new char *[numAdjacent];
+			sidelengths = MemPool::newArray<int>(numAdjacent);
+			sequences = MemPool::newArray<char*>(numAdjacent);
 
 			loop4 = (loop3 + 1) % numAdjacent;
 			pt = pairtypes[seqs[loop3][loop]][seqs[loop4][loop2]];
@@ -3906,8 +4064,8 @@ double MultiLoop::doChoice(Move *move, Loop **returnLoop) {
 		if (move->type & MOVE_3) {
 			//non-adjacent sides, multi + open loop
 
-			sidelengths = new int[loop4 - loop3 + 1];
-			sequences = new char *[loop4 - loop3 + 1];
+			sidelengths = MemPool::newArray<int>(loop4 - loop3 + 1);
+			sequences = MemPool::newArray<char*>(loop4 - loop3 + 1);
 
 			pt = pairtypes[seqs[loop3][loop]][seqs[loop4][loop2]];
 
@@ -3932,8 +4090,8 @@ double MultiLoop::doChoice(Move *move, Loop **returnLoop) {
 
 			newLoop[0] = new MultiLoop(loop4 - loop3 + 1, sidelengths, sequences);
 
-			sidelengths = new int[numAdjacent - (loop4 - loop3 - 1)];
-			sequences = new char *[numAdjacent - (loop4 - loop3 - 1)];
+			sidelengths = MemPool::newArray<int>(numAdjacent - (loop4 - loop3 - 1));
+			sequences = MemPool::newArray<char*>(numAdjacent - (loop4 - loop3 - 1));
 
 			for (temploop = 0, tempindex = 0; temploop < numAdjacent - (loop4 - loop3 - 1); tempindex++) {
 				if (tempindex == loop3) {
@@ -3989,12 +4147,14 @@ double MultiLoop::doChoice(Move *move, Loop **returnLoop) {
 
 void MultiLoop::generateMoves(void) {
 
+	PhaseTimer phase(PHASE_GENERATE_MOVES);
+
 	if (utility::debugTraces) {
 		cout << "Multiloop generating moves!" << endl;
 	}
 
 	int loop, loop2, loop3, loop4, temploop, tempindex, loops[4];
-	int pt;
+	PartnerScan partners(energyModel);
 	double tempRate;
 	RateEnv rateEnv;
 	double energies[2];
@@ -4011,129 +4171,112 @@ void MultiLoop::generateMoves(void) {
 //     #3: creation move between sides resulting in two multiloops.
 // #2a-#2c can only happen for adjacent sides, #3 only happens for non-adjacent sides (and is always the case for such). We separate these into cases #2a-#2c and #3 .
 
-// these pointers are needed to set up all of the multiloop energy calls.
+// sideLengths holds the side lengths of the multiloop that a move leaves, for the prefactors.
+// The energies of the multiloops that a move leaves come from the terms of this loop.
 	int *sideLengths = NULL;
-	char **sequences = NULL;
+	bool filled;
 
 // the most storage we'll need is for case #1, which will have a multiloop of 1 greater magnitude.
-	sideLengths = new int[numAdjacent + 1];
-	sequences = new char *[numAdjacent + 1];
+	sideLengths = MemPool::newArray<int>(numAdjacent + 1);
+	LoopTerms terms(energyModel, false, numAdjacent, sidelen, seqs);
 
 // Case #1: Single Side only Creation Moves
 	for (loop3 = 0; loop3 < numAdjacent; loop3++) {
+		filled = false;
 		for (loop = 1; loop <= sidelen[loop3] - 4; loop++) {
-			for (loop2 = loop + 4; loop2 <= sidelen[loop3]; loop2++) { // each possibility is a hairpin and multiloop, see above.
+			for (partners.start(seqs[loop3], loop + 4, sidelen[loop3], seqs[loop3][loop]); (loop2 = partners.next()) >= 0;) { // each possibility is a hairpin and multiloop, see above.
 
 				//FD: loop3 is the strand that will split.
 				//FD: loop and loop2 are the nucleotide indices.
 				//FD: Loop2 - loop is at least 4, e.g. this is the hairpin length.
 				//FD: the length of the right-side remaining loop is sidelen[loop3]-loop2;
 
-				pt = pairtypes[seqs[loop3][loop]][seqs[loop3][loop2]];
-
-				if (pt != 0) {
-
-					energies[0] = energyModel->HairpinEnergy(&seqs[loop3][loop], loop2 - loop - 1);
-
-					for (temploop = 0, tempindex = 0; temploop < numAdjacent + 1; temploop++, tempindex++) {
-						if (temploop == loop3) {
-
-							sideLengths[temploop] = loop - 1;
-							sequences[temploop] = seqs[temploop];
-							sideLengths[temploop + 1] = sidelen[temploop] - loop2;
-							sequences[temploop + 1] = &seqs[temploop][loop2];
-
-							// FD: This places an additional side to the multiloop.
-							// FD: The left-side retains loop3 location, the right-side is now indexed at loop3+1.
-
-							temploop = temploop + 1;
-
-						} else {
-
-							sideLengths[temploop] = sidelen[tempindex];
-							sequences[temploop] = seqs[tempindex];
+				energies[0] = energyModel->CachedHairpinEnergy(&seqs[loop3][loop], loop2 - loop - 1);
 
+				// only the two sides that loop3 splits into differ between the moves in this side.
+				if (!filled) {
+					for (temploop = 0; temploop < numAdjacent + 1; temploop++) {
+						if (temploop < loop3) {
+							sideLengths[temploop] = sidelen[temploop];
+						} else if (temploop > loop3 + 1) {
+							sideLengths[temploop] = sidelen[temploop - 1];
 						}
 					}
-					energies[1] = energyModel->MultiloopEnergy(numAdjacent + 1, sideLengths, sequences);
+					filled = true;
+				}
 
-					tempRate = energyModel->returnRate(getEnergy(), (energies[0] + energies[1]), 0);
+				// FD: This places an additional side to the multiloop.
+				// FD: The left-side retains loop3 location, the right-side is now indexed at loop3+1.
+				sideLengths[loop3] = loop - 1;
+				sideLengths[loop3 + 1] = sidelen[loop3] - loop2;
 
-					// multiLoop is closing, so this an loopMove and something else
-					MoveType rightMove = energyModel->prefactorInternal(sideLengths[loop3], sideLengths[loop3]);
+				energies[1] = terms.outerEnergy(loop3, loop, loop3, loop2);
 
-					rateEnv = RateEnv(tempRate, energyModel, loopMove, rightMove);
+				tempRate = energyModel->returnRate(getEnergy(), (energies[0] + energies[1]), 0);
 
-					moves->addMove(new Move(MOVE_CREATE | MOVE_1, rateEnv, this, loop, loop2, loop3));
-				}
+				// multiLoop is closing, so this an loopMove and something else
+				MoveType rightMove = energyModel->prefactorInternal(sideLengths[loop3], sideLengths[loop3]);
+
+				rateEnv = RateEnv(tempRate, energyModel, loopMove, rightMove);
+
+				moves->addMove(Move(MOVE_CREATE | MOVE_1, rateEnv, this, loop, loop2, loop3));
 			}
 		}
 	}
 
 // Case #2a-c: adjacent loop creation moves
 	for (loop3 = 0; loop3 <= numAdjacent - 1; loop3++) { // CHECK: is numAdjacent really correct? it could be numAdjacent+1
+		filled = false;
+		loop4 = (loop3 + 1) % numAdjacent;
 		for (loop = 1; loop <= sidelen[loop3]; loop++) {
-			for (loop2 = 1; loop2 <= sidelen[(loop3 + 1) % numAdjacent]; loop2++) { // each possibility is a hairpin and open loop, see above.
-				loop4 = (loop3 + 1) % numAdjacent;
-
-				pt = pairtypes[seqs[loop3][loop]][seqs[loop4][loop2]];
+			for (partners.start(seqs[loop4], 1, sidelen[loop4], seqs[loop3][loop]); (loop2 = partners.next()) >= 0;) { // each possibility is a hairpin and open loop, see above.
 
-				if (pt != 0) {
+				MoveType leftMove = stackMove;
 
-					MoveType leftMove = stackMove;
+				// three cases for which type of move:
+				// #2a: stack
+				if (loop == sidelen[loop3] && loop2 == 1) {
 
-					// three cases for which type of move:
-					// #2a: stack
-					if (loop == sidelen[loop3] && loop2 == 1) {
+					energies[0] = energyModel->StackEnergy(seqs[loop3][loop], seqs[loop4][loop2], seqs[loop3][sidelen[loop3] + 1], seqs[loop4][0]);
 
-						energies[0] = energyModel->StackEnergy(seqs[loop3][loop], seqs[loop4][loop2], seqs[loop3][sidelen[loop3] + 1], seqs[loop4][0]);
+				} else if (loop == sidelen[loop3] || loop2 == 1) { // #2b: bulge
 
-					} else if (loop == sidelen[loop3] || loop2 == 1) { // #2b: bulge
-
-						if (loop2 == 1) {
-							energies[0] = energyModel->BulgeEnergy(seqs[loop3][loop], seqs[loop4][loop2], seqs[loop3][sidelen[loop3] + 1], seqs[loop4][0],
-									sidelen[loop3] - loop);
-						} else {
-							energies[0] = energyModel->BulgeEnergy(seqs[loop3][loop], seqs[loop4][loop2], seqs[loop3][sidelen[loop3] + 1], seqs[loop4][0],
-									loop2 - 1);
-						}
+					if (loop2 == 1) {
+						energies[0] = energyModel->BulgeEnergy(seqs[loop3][loop], seqs[loop4][loop2], seqs[loop3][sidelen[loop3] + 1], seqs[loop4][0],
+								sidelen[loop3] - loop);
+					} else {
+						energies[0] = energyModel->BulgeEnergy(seqs[loop3][loop], seqs[loop4][loop2], seqs[loop3][sidelen[loop3] + 1], seqs[loop4][0],
+								loop2 - 1);
+					}
 
-						leftMove = stackLoopMove;
+					leftMove = stackLoopMove;
 
-					} else {				 					// #2c: interior
+				} else {				 					// #2c: interior
 
-						energies[0] = energyModel->InteriorEnergy(&seqs[loop3][loop], seqs[loop4], sidelen[loop3] - loop, loop2 - 1);
-						leftMove = loopMove;
+					energies[0] = energyModel->InteriorEnergy(&seqs[loop3][loop], seqs[loop4], sidelen[loop3] - loop, loop2 - 1);
+					leftMove = loopMove;
 
-					}
+				}
 
+				//FD: This is computing the sideLengths for the remaining loops.
+				if (!filled) {
 					for (temploop = 0; temploop < numAdjacent; temploop++) {
-						if (temploop == loop3) {
-							//FD: This is computing the sideLengths for the remaining loops.
+						sideLengths[temploop] = sidelen[temploop];
+					}
+					filled = true;
+				}
 
-							sideLengths[temploop] = loop - 1;
-							sequences[temploop] = seqs[temploop];
+				sideLengths[loop3] = loop - 1;
+				sideLengths[loop4] = sidelen[loop4] - loop2;
 
-						} else {
+				energies[1] = terms.outerEnergy(loop3, loop, loop4, loop2);
+				tempRate = energyModel->returnRate(getEnergy(), (energies[0] + energies[1]), 0);
 
-							if (temploop == loop4) {
-								sideLengths[temploop] = sidelen[temploop] - loop2;
-								sequences[temploop] = &seqs[temploop][loop2];
-							} else {
-								sideLengths[temploop] = sidelen[temploop];
-								sequences[temploop] = seqs[temploop];
-							}
-						}
-					}
-					energies[1] = energyModel->MultiloopEnergy(numAdjacent, sideLengths, sequences);
-					tempRate = energyModel->returnRate(getEnergy(), (energies[0] + energies[1]), 0);
+				// multiLoop is forming an stack/bulge/interior, which is something and something else
+				MoveType rightMove = energyModel->prefactorInternal(sideLengths[loop3], sideLengths[loop4]);
 
-					// multiLoop is forming an stack/bulge/interior, which is something and something else
-					MoveType rightMove = energyModel->prefactorInternal(sideLengths[loop3], sideLengths[loop4]);
-
-					rateEnv = RateEnv(tempRate, energyModel, leftMove, rightMove);
-					moves->addMove(new Move(MOVE_CREATE | MOVE_2, rateEnv, this, loop, loop2, loop3));
-				}
+				rateEnv = RateEnv(tempRate, energyModel, leftMove, rightMove);
+				moves->addMove(Move(MOVE_CREATE | MOVE_2, rateEnv, this, loop, loop2, loop3));
 			}
 		}
 	}
@@ -4152,68 +4295,59 @@ void MultiLoop::generateMoves(void) {
 
 			for (loop = 1; loop <= sidelen[loop3]; loop++) {
 
-				for (loop2 = 1; loop2 <= sidelen[loop4]; loop2++) {
-
-					pt = pairtypes[seqs[loop3][loop]][seqs[loop4][loop2]];
+				for (partners.start(seqs[loop4], 1, sidelen[loop4], seqs[loop3][loop]); (loop2 = partners.next()) >= 0;) {
 
-					if (pt != 0) { // result is a multiloop and multi loop.
-								   // Multiloop
+					// result is a multiloop and multi loop.
+							   // Multiloop
 
-						for (temploop = 0, tempindex = 0; temploop < (loop4 - loop3 + 1); tempindex++) // note that loop4 - loop3 is the number of pairings that got included in the multiloop. The extra closing pair makes the +1.
-								{
-							if (tempindex == loop3) {
-								sideLengths[temploop] = sidelen[tempindex] - loop;
-								sequences[temploop] = &seqs[tempindex][loop];
-								temploop++;
-							}
-
-							if (tempindex > loop3 && tempindex < loop4) {
-								sideLengths[temploop] = sidelen[tempindex];
-								sequences[temploop] = seqs[tempindex];
-								temploop++;
-							}
+					for (temploop = 0, tempindex = 0; temploop < (loop4 - loop3 + 1); tempindex++) // note that loop4 - loop3 is the number of pairings that got included in the multiloop. The extra closing pair makes the +1.
+							{
+						if (tempindex == loop3) {
+							sideLengths[temploop] = sidelen[tempindex] - loop;
+							temploop++;
+						}
 
-							if (tempindex == loop4) {
-								sideLengths[temploop] = loop2 - 1;
-								sequences[temploop] = seqs[tempindex];
-								temploop++;
-							}
+						if (tempindex > loop3 && tempindex < loop4) {
+							sideLengths[temploop] = sidelen[tempindex];
+							temploop++;
 						}
 
-						energies[0] = energyModel->MultiloopEnergy(loop4 - loop3 + 1, sideLengths, sequences);
-						MoveType leftMove = energyModel->prefactorInternal(sideLengths[loop3], sideLengths[loop4]);
+						if (tempindex == loop4) {
+							sideLengths[temploop] = loop2 - 1;
+							temploop++;
+						}
+					}
 
-						// Multi loop
-						for (temploop = 0, tempindex = 0; temploop < numAdjacent - (loop4 - loop3 - 1); tempindex++) {
-							if (tempindex == loop3) {
-								sideLengths[temploop] = loop - 1;
-								sequences[temploop] = seqs[tempindex];
-								temploop++;
-							} else if (tempindex == loop4) {
-								sideLengths[temploop] = sidelen[tempindex] - loop2;
-								sequences[temploop] = &seqs[tempindex][loop2];
-								temploop++;
-							} else if (!((tempindex > loop3) && (tempindex < loop4))) {
-								sideLengths[temploop] = sidelen[tempindex];
-								sequences[temploop] = seqs[tempindex];
-								temploop++;
-							}
+					energies[0] = terms.innerEnergy(loop3, loop, loop4, loop2);
+					MoveType leftMove = energyModel->prefactorInternal(sideLengths[loop3], sideLengths[loop4]);
 
+					// Multi loop
+					for (temploop = 0, tempindex = 0; temploop < numAdjacent - (loop4 - loop3 - 1); tempindex++) {
+						if (tempindex == loop3) {
+							sideLengths[temploop] = loop - 1;
+							temploop++;
+						} else if (tempindex == loop4) {
+							sideLengths[temploop] = sidelen[tempindex] - loop2;
+							temploop++;
+						} else if (!((tempindex > loop3) && (tempindex < loop4))) {
+							sideLengths[temploop] = sidelen[tempindex];
+							temploop++;
 						}
-						energies[1] = energyModel->MultiloopEnergy(numAdjacent - (loop4 - loop3 - 1), sideLengths, sequences);
-						tempRate = energyModel->returnRate(getEnergy(), (energies[0] + energies[1]), 0);
-						loops[0] = loop;
-						loops[1] = loop2;
-						loops[2] = loop3;
-						loops[3] = loop4;
 
-						// multiLoop is splitting into two multiLoops. Which is something, and something else
+					}
+					energies[1] = terms.outerEnergy(loop3, loop, loop4, loop2);
+					tempRate = energyModel->returnRate(getEnergy(), (energies[0] + energies[1]), 0);
+					loops[0] = loop;
+					loops[1] = loop2;
+					loops[2] = loop3;
+					loops[3] = loop4;
 
-						MoveType rightMove = energyModel->prefactorInternal(sideLengths[loop3], sideLengths[loop4]);
+					// multiLoop is splitting into two multiLoops. Which is something, and something else
 
-						rateEnv = RateEnv(tempRate, energyModel, leftMove, rightMove);
-						moves->addMove(new Move(MOVE_CREATE | MOVE_3, rateEnv, this, loops));
-					}
+					MoveType rightMove = energyModel->prefactorInternal(sideLengths[loop3], sideLengths[loop4]);
+
+					rateEnv = RateEnv(tempRate, energyModel, leftMove, rightMove);
+					moves->addMove(Move(MOVE_CREATE | MOVE_3, rateEnv, this, loops));
 
 				}
 
@@ -4223,11 +4357,9 @@ void MultiLoop::generateMoves(void) {
 
 	}
 
-	totalRate = moves->getRate();
+	setTotalRate(moves->getRate());
 	if (sideLengths != NULL)
-		delete[] sideLengths;
-	if (sequences != NULL)
-		delete[] sequences;
+		MemPool::deleteArray(sideLengths);
 
 	generateDeleteMoves();
 }
@@ -4243,7 +4375,7 @@ void MultiLoop::generateDeleteMoves(void) {
 
 	}
 
-	totalRate = moves->getRate();
+	setTotalRate(moves->getRate());
 }
 
 void MultiLoop::printMove(Loop *comefrom, char *structure_p, char *seq_p) {
@@ -4317,8 +4449,8 @@ OpenLoop::OpenLoop(void) {
 }
 
 OpenLoop::~OpenLoop(void) {
-	delete[] sidelen;
-	delete[] seqs;
+	MemPool::deleteArray(sidelen);
+	MemPool::deleteArray(seqs);
 }
 
 OpenLoop::OpenLoop(int branches, int *sidelengths, char **sequences) {
@@ -4327,7 +4459,7 @@ OpenLoop::OpenLoop(int branches, int *sidelengths, char **sequences) {
 
 	if (branches > 0) {
 
-		adjacentLoops = new Loop *[branches];
+		adjacentLoops = MemPool::newArray<Loop*>(branches);
 		for (int loop = 0; loop < branches; loop++) {
 			adjacentLoops[loop] = NULL;
 		}
@@ -4406,8 +4538,8 @@ double OpenLoop::doChoice(Move *move, Loop **returnLoop) {
 
 		if (move->type & MOVE_1) {
 			//single side, hairpin + open with 1 higher mag.
-			sidelengths = new int[numAdjacent + 2];
-			sequences = new char *[numAdjacent + 2];
+			sidelengths = MemPool::newArray<int>(numAdjacent + 2);
+			sequences = MemPool::newArray<char*>(numAdjacent + 2);
 
 			pt = pairtypes[seqs[loop3][loop]][seqs[loop3][loop2]];
 
@@ -4455,8 +4587,8 @@ double OpenLoop::doChoice(Move *move, Loop **returnLoop) {
 			//adjacent sides, one of: stack    + open with same mag
 			//                        bulge    + open with same mag
 			//                        interior + open with same mag
-			sidelengths = new int[numAdjacent + 1];
-			sequences = new char *[numAdjacent + 1];
+			sidelengths = MemPool::newArray<int>(numAdjacent + 1);
+			sequences = MemPool::newArray<char*>(numAdjacent + 1);
 
 			pt = pairtypes[seqs[loop3][loop]][seqs[loop3 + 1][loop2]];
 
@@ -4519,8 +4651,8 @@ double OpenLoop::doChoice(Move *move, Loop **returnLoop) {
 		if (move->type & MOVE_3) {
 			//non-adjacent sides, multi + open loop
 
-			sidelengths = new int[loop4 - loop3 + 1];
-			sequences = new char *[loop4 - loop3 + 1];
+			sidelengths = MemPool::newArray<int>(loop4 - loop3 + 1);
+			sequences = MemPool::newArray<char*>(loop4 - loop3 + 1);
 
 			pt = pairtypes[seqs[loop3][loop]][seqs[loop4][loop2]];
 
@@ -4545,8 +4677,8 @@ double OpenLoop::doChoice(Move *move, Loop **returnLoop) {
 
 			newLoop[0] = new MultiLoop(loop4 - loop3 + 1, sidelengths, sequences);
 
-			sidelengths = new int[numAdjacent - (loop4 - loop3 - 1) + 1];
-			sequences = new char *[numAdjacent - (loop4 - loop3 - 1) + 1];
+			sidelengths = MemPool::newArray<int>(numAdjacent - (loop4 - loop3 - 1) + 1);
+			sequences = MemPool::newArray<char*>(numAdjacent - (loop4 - loop3 - 1) + 1);
 
 			for (temploop = 0, tempindex = 0; temploop <= numAdjacent - (loop4 - loop3 - 1); tempindex++) {
 				if (tempindex == loop3) {
@@ -4601,13 +4733,15 @@ double OpenLoop::doChoice(Move *move, Loop **returnLoop) {
 
 void OpenLoop::generateMoves(void) {
 
+	PhaseTimer phase(PHASE_GENERATE_MOVES);
+
 	if (utility::debugTraces || false) {
 		cout << "\n OpenLoop generating moves!" << endl;
 		cout << this->typeInternalsToString();
 	}
 
 	int loop, loop2, loop3, loop4, temploop, tempindex, loops[4];
-	int pairType;
+	PartnerScan partners(energyModel);
 	double tempRate;
 	RateEnv rateEnv;
 	double energies[2];
@@ -4639,10 +4773,12 @@ void OpenLoop::generateMoves(void) {
 // DNA/RNA notation convention is 5' to 3' end. Enzymes can only attach new nucleotides at the 3' end.
 
 	int *sideLengths = NULL;
-	char **sequences = NULL;
+	bool filled;
 
-	sideLengths = new int[numAdjacent + 2];
-	sequences = new char *[numAdjacent + 2];
+// sideLengths holds the side lengths of the open loop that a move leaves, for the prefactors.
+// The energies of the loops that a move leaves come from the terms of this loop.
+	sideLengths = MemPool::newArray<int>(numAdjacent + 2);
+	LoopTerms terms(energyModel, true, numAdjacent, sidelen, seqs);
 
 // for cotranscriptional mode, assume a single sequence
 	const char* initialPointer = &seqs[0][0];
@@ -4651,31 +4787,33 @@ void OpenLoop::generateMoves(void) {
 	for (loop3 = 0; loop3 < numAdjacent + 1; loop3++) {
 
 		char* mySequence = seqs[loop3]; // this is the sequence of the strand that we use
+		filled = false;
 
 		for (loop = 1; loop < sidelen[loop3] - 3; loop++) {
 
-			for (loop2 = loop + 4; loop2 <= sidelen[loop3]; loop2++) { // each possibility is a hairpin and open loop, see above.
-
-				pairType = pairtypes[mySequence[loop]][mySequence[loop2]];
+			for (partners.start(mySequence, loop + 4, sidelen[loop3], mySequence[loop]); (loop2 = partners.next()) >= 0;) { // each possibility is a hairpin and open loop, see above.
 
 				// FD: Allowed combinations are non-zero.  G-T stacks are sometimes allowed. Hairpin loops are size 3 or more.
-				if (pairType != 0 && nucleotideIsActive(mySequence, initialPointer, loop, loop2)) {
+				if (nucleotideIsActive(mySequence, initialPointer, loop, loop2)) {
 
-					energies[0] = energyModel->HairpinEnergy(&mySequence[loop], loop2 - loop - 1);
+					energies[0] = energyModel->CachedHairpinEnergy(&mySequence[loop], loop2 - loop - 1);
 
-					for (temploop = 0, tempindex = 0; temploop < numAdjacent + 2; temploop++, tempindex++) {
-						if (temploop == loop3) {
-							sideLengths[temploop] = loop - 1;
-							sequences[temploop] = seqs[temploop];
-							sideLengths[temploop + 1] = sidelen[temploop] - loop2;
-							sequences[temploop + 1] = seqs[temploop] + loop2;
-							temploop = temploop + 1;
-						} else {
-							sideLengths[temploop] = sidelen[tempindex];
-							sequences[temploop] = seqs[tempindex];
+					// only the two sides that loop3 splits into differ between the moves in this side.
+					if (!filled) {
+						for (temploop = 0; temploop < numAdjacent + 2; temploop++) {
+							if (temploop < loop3) {
+								sideLengths[temploop] = sidelen[temploop];
+							} else if (temploop > loop3 + 1) {
+								sideLengths[temploop] = sidelen[temploop - 1];
+							}
 						}
+						filled = true;
 					}
-					energies[1] = energyModel->OpenloopEnergy(numAdjacent + 1, sideLengths, sequences);
+
+					sideLengths[loop3] = loop - 1;
+					sideLengths[loop3 + 1] = sidelen[loop3] - loop2;
+
+					energies[1] = terms.outerEnergy(loop3, loop, loop3, loop2);
 					tempRate = energyModel->returnRate(getEnergy(), (energies[0] + energies[1]), 0);
 
 					// if the new Arrhenius model is used, modify the existing rate based on the local context.
@@ -4686,21 +4824,19 @@ void OpenLoop::generateMoves(void) {
 					MoveType rightMove = energyModel->prefactorOpen(loop3, numAdjacent + 2, sideLengths);
 					rateEnv = RateEnv(tempRate, energyModel, loopMove, rightMove);
 
-					Move *tmove = new Move(MOVE_CREATE | MOVE_1, rateEnv, this, loop, loop2, loop3);
-					moves->addMove(tmove);
+					moves->addMove(Move(MOVE_CREATE | MOVE_1, rateEnv, this, loop, loop2, loop3));
 				}
 			}
 		}
 	}
 
 // Case #2a-c: adjacent loop creation moves
-	for (loop3 = 0; loop3 < numAdjacent; loop3++) // CHECK: is numAdjacent really correct? it could be numAdjacent+1
+	for (loop3 = 0; loop3 < numAdjacent; loop3++) { // CHECK: is numAdjacent really correct? it could be numAdjacent+1
+		filled = false;
 		for (loop = 1; loop <= sidelen[loop3]; loop++)
-			for (loop2 = 1; loop2 <= sidelen[loop3 + 1]; loop2++) { // each possibility is a hairpin and open loop, see above.
+			for (partners.start(seqs[loop3 + 1], 1, sidelen[loop3 + 1], seqs[loop3][loop]); (loop2 = partners.next()) >= 0;) { // each possibility is a hairpin and open loop, see above.
 
-				pairType = pairtypes[seqs[loop3][loop]][seqs[loop3 + 1][loop2]];
-
-				if (pairType != 0 && this->nucleotideIsActive(seqs[loop3], initialPointer, loop)
+				if (this->nucleotideIsActive(seqs[loop3], initialPointer, loop)
 						&& this->nucleotideIsActive(seqs[loop3 + 1], initialPointer, loop2)) {
 
 					// three cases for which type of move:
@@ -4734,21 +4870,17 @@ void OpenLoop::generateMoves(void) {
 
 					}
 
-					for (temploop = 0; temploop < numAdjacent + 1; temploop++) {
-						if (temploop == loop3) {
-							sideLengths[temploop] = loop - 1;
-							sequences[temploop] = seqs[temploop];
-						} else {
-							if (temploop == loop3 + 1) {
-								sideLengths[temploop] = sidelen[temploop] - loop2;
-								sequences[temploop] = &seqs[temploop][loop2];
-							} else {
-								sideLengths[temploop] = sidelen[temploop];
-								sequences[temploop] = seqs[temploop];
-							}
+					if (!filled) {
+						for (temploop = 0; temploop < numAdjacent + 1; temploop++) {
+							sideLengths[temploop] = sidelen[temploop];
 						}
+						filled = true;
 					}
-					energies[1] = energyModel->OpenloopEnergy(numAdjacent, sideLengths, sequences);
+
+					sideLengths[loop3] = loop - 1;
+					sideLengths[loop3 + 1] = sidelen[loop3 + 1] - loop2;
+
+					energies[1] = terms.outerEnergy(loop3, loop, loop3 + 1, loop2);
 
 					tempRate = energyModel->returnRate(getEnergy(), (energies[0] + energies[1]), 0);
 
@@ -4760,9 +4892,10 @@ void OpenLoop::generateMoves(void) {
 					MoveType rightMove = energyModel->prefactorOpen(loop3, numAdjacent + 1, sideLengths);
 
 					rateEnv = RateEnv(tempRate, energyModel, leftMove, rightMove);
-					moves->addMove(new Move(MOVE_CREATE | MOVE_2, rateEnv, this, loop, loop2, loop3));
+					moves->addMove(Move(MOVE_CREATE | MOVE_2, rateEnv, this, loop, loop2, loop3));
 				}
 			}
+	}
 
 // Case #3: non-adjacent loop creation moves (2d)
 // Revamped so it actually works. Algorithm follows:
@@ -4773,52 +4906,44 @@ void OpenLoop::generateMoves(void) {
 
 			for (loop = 1; loop <= sidelen[loop3]; loop++) { // new version with all sequences in openloop starting at 1.
 
-				for (loop2 = 1; loop2 <= sidelen[loop4]; loop2++) {
-
-					pairType = pairtypes[seqs[loop3][loop]][seqs[loop4][loop2]];
+				for (partners.start(seqs[loop4], 1, sidelen[loop4], seqs[loop3][loop]); (loop2 = partners.next()) >= 0;) {
 
-					if (pairType != 0 && this->nucleotideIsActive(seqs[loop3], initialPointer, loop)
+					if (this->nucleotideIsActive(seqs[loop3], initialPointer, loop)
 							&& this->nucleotideIsActive(seqs[loop4], initialPointer, loop2)) { // result is a multiloop and open loop.
 
 						for (temploop = 0, tempindex = 0; temploop < (loop4 - loop3 + 1); tempindex++) { // note that loop4 - loop3 is the number of pairings that got included in the multiloop. The extra closing pair makes the +1.
 
 							if (tempindex == loop3) {
 								sideLengths[temploop] = sidelen[tempindex] - loop;
-								sequences[temploop] = &seqs[tempindex][loop];
 								temploop++;
 							}
 							if (tempindex > loop3 && tempindex < loop4) {
 								sideLengths[temploop] = sidelen[tempindex];
-								sequences[temploop] = seqs[tempindex];
 								temploop++;
 							}
 							if (tempindex == loop4) {
 								sideLengths[temploop] = loop2 - 1;
-								sequences[temploop] = seqs[tempindex];
 								temploop++;
 							}
 						}
 
-						energies[0] = energyModel->MultiloopEnergy(loop4 - loop3 + 1, sideLengths, sequences);
+						energies[0] = terms.innerEnergy(loop3, loop, loop4, loop2);
 						MoveType leftMove = energyModel->prefactorInternal(sideLengths[loop3], sideLengths[loop4]);
 
 						// Open loop
 						for (temploop = 0, tempindex = 0; temploop <= numAdjacent - (loop4 - loop3 - 1); tempindex++) {
 							if (tempindex == loop3) {
 								sideLengths[temploop] = loop - 1;
-								sequences[temploop] = seqs[tempindex];
 								temploop++;
 							} else if (tempindex == loop4) {
 								sideLengths[temploop] = sidelen[tempindex] - loop2;
-								sequences[temploop] = &seqs[tempindex][loop2];
 								temploop++;
 							} else if (!((tempindex > loop3) && (tempindex < loop4))) {
 								sideLengths[temploop] = sidelen[tempindex];
-								sequences[temploop] = seqs[tempindex];
 								temploop++;
 							}
 						}
-						energies[1] = energyModel->OpenloopEnergy(numAdjacent - (loop4 - loop3 - 1), sideLengths, sequences);
+						energies[1] = terms.outerEnergy(loop3, loop, loop4, loop2);
 						tempRate = energyModel->returnRate(getEnergy(), (energies[0] + energies[1]), 0);
 
 						// openLoop is splitting off . Which is something, and something else
@@ -4832,19 +4957,17 @@ void OpenLoop::generateMoves(void) {
 
 						rateEnv = RateEnv(tempRate, energyModel, leftMove, rightMove);
 
-						moves->addMove(new Move(MOVE_CREATE | MOVE_3, rateEnv, this, loops));
+						moves->addMove(Move(MOVE_CREATE | MOVE_3, rateEnv, this, loops));
 					}
 
 				}
 			}
 		}
 
-	totalRate = moves->getRate();
+	setTotalRate(moves->getRate());
 
 	if (sideLengths != NULL)
-		delete[] sideLengths;
-	if (sequences != NULL)
-		delete[] sequences;
+		MemPool::deleteArray(sideLengths);
 
 	generateDeleteMoves();
 }
@@ -4859,7 +4982,7 @@ void OpenLoop::generateDeleteMoves(void) {
 
 	}
 
-	totalRate = moves->getRate();
+	setTotalRate(moves->getRate());
 }
 
 void OpenLoop::printMove(Loop *comefrom, char *structure_p, char *seq_p) {
@@ -5130,8 +5253,8 @@ void OpenLoop::performComplexJoin(OpenLoop **oldLoops, OpenLoop **newLoops, char
 	sizes[1] = seqnum[1] + 1 + (oldLoops[0]->numAdjacent - seqnum[0]);
 
 	for (toggle = 0; toggle <= 1; toggle++) {
-		sidelen = new int[sizes[toggle] + 1];
-		seqs = new char *[sizes[toggle] + 1];
+		sidelen = MemPool::newArray<int>(sizes[toggle] + 1);
+		seqs = MemPool::newArray<char*>(sizes[toggle] + 1);
 
 		for (loop = 0; loop < sizes[toggle] + 1; loop++) {
 			if (loop < seqnum[toggle]) {
@@ -10,11 +10,13 @@
 #include <string>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
 #include "move.h"
 #include "loop.h"
 #include "utility.h"
 #include "energyoptions.h"
 #include "energymodel.h"
+#include "phasestats.h"
 
 using std::string;
 
@@ -219,171 +221,168 @@ string Move::toString(bool useArr) {
 //
 ///* MoveList */
 
-MoveList::MoveList(int initial_size) {
-	totalrate = 0.0;
-	moves_size = initial_size;
-	if (moves_size >= 1) {
-		moves = new Move *[moves_size];
+/*
 
-		for (moves_index = 0; moves_index < moves_size; moves_index++)
-			moves[moves_index] = NULL;
+ MoveArray
 
-		moves_index = 0;
-	} else {
-		moves = NULL;
-		moves_size = 0;
-		moves_index = 0;
+ */
+
+void MoveArray::add(const Move& move) {
+
+	if (count == size) {
+		grow((size > 0) ? 2 * size : 2);
 	}
 
-	del_moves = NULL;
-	del_moves_size = 0;
-	del_moves_index = 0;
-	int_index = 0;
+	new (&moves[count]) Move(move);
+	rates[count] = move.rate.rate;
+	cumul[count] = rates[count] + ((count > 0) ? cumul[count - 1] : 0.0);
+	count++;
+
 }
 
-MoveList::~MoveList(void) {
-	int iter = 0;
-	// must remove all moves in the movelist.
-	while (iter < moves_index) {
-		if (moves[iter] != NULL) {
-			delete moves[iter];
-			moves[iter] = NULL;
-		}
-		iter++;
-	}
-	if (moves != NULL)
-		delete[] moves;
-
-	iter = 0;
-	while (iter < del_moves_index) {
-		if (del_moves[iter] != NULL) {
-			delete del_moves[iter];
-			del_moves[iter] = NULL;
-		}
-		iter++;
+void MoveArray::grow(int newSize) {
+
+	Move* newMoves = MemPool::newArray<Move>(newSize);
+	double* newRates = MemPool::newArray<double>(newSize);
+	double* newCumul = MemPool::newArray<double>(newSize);
+
+	for (int i = 0; i < count; i++) {
+		new (&newMoves[i]) Move(moves[i]);
+		moves[i].~Move();
+		newRates[i] = rates[i];
+		newCumul[i] = cumul[i];
 	}
-	if (del_moves != NULL)
-		delete[] del_moves;
+
+	MemPool::deleteArray(moves);
+	MemPool::deleteArray(rates);
+	MemPool::deleteArray(cumul);
+
+	moves = newMoves;
+	rates = newRates;
+	cumul = newCumul;
+	size = newSize;
+
 }
 
-void MoveList::resetDeleteMoves(void) {
-	int iter = 0;
-	while (iter < del_moves_index) {
-		if (del_moves[iter] != NULL) {
-			delete del_moves[iter];
-			del_moves[iter] = NULL;
-		}
-		iter++;
+void MoveArray::clear(void) {
+
+	for (int i = 0; i < count; i++) {
+		moves[i].~Move();
 	}
-	if (del_moves != NULL)
-		delete[] del_moves;
 
-	if (del_moves == NULL) {
-		del_moves = new Move *[2];
-		del_moves_size = 2;
+	count = 0;
+
+}
+
+void MoveArray::release(void) {
+
+	clear();
+
+	MemPool::deleteArray(moves);
+	MemPool::deleteArray(rates);
+	MemPool::deleteArray(cumul);
+
+	moves = NULL;
+	rates = NULL;
+	cumul = NULL;
+	size = 0;
+
+}
+
+/*
+
+ MoveList
+
+ */
+
+MoveList::MoveList(int initial_size) {
+
+	totalrate = 0.0;
+	int_index = 0;
+
+	if (initial_size >= 1) {
+		create.grow(initial_size);
 	}
-	del_moves_index = 0;
+
+}
+
+MoveList::~MoveList(void) {
+
+	create.release();
+	del.release();
+
+}
+
+void MoveList::resetDeleteMoves(void) {
+
+	del.clear();
+
 }
 
 void MoveList::printAllMoves(bool useArr) {
 
-	for (int i = 0; i < moves_index; i++) {
+	for (int i = 0; i < create.count; i++) {
 
 		cout << "Move" << i << " ";
-		cout << moves[i]->toString(useArr);
+		cout << create.moves[i].toString(useArr);
 
 	}
 
-	for (int i = 0; i < del_moves_index; i++) {
+	for (int i = 0; i < del.count; i++) {
 
-		cout << "Move" << i + moves_index << " ";
-		cout << del_moves[i]->toString(useArr);
+		cout << "Move" << i + create.count << " ";
+		cout << del.moves[i].toString(useArr);
 
 	}
 
 }
 
-void MoveList::addMove(Move *newmove) {
-	int type = newmove->getType();
+void MoveList::addMove(const Move& newmove) {
 
-	if (!(type & MOVE_DELETE)) {
-
-		moves[moves_index] = newmove;
-		totalrate += newmove->getRate();
-		moves_index++;
-		// next add would be an overflow.
-		if (moves_index == moves_size) {
-			Move **temp = moves;
-			moves = new Move *[moves_size * 2];
-			for (int loop = 0; loop < moves_size * 2; loop++) {
-				if (loop < moves_size) {
-					moves[loop] = temp[loop];
-					temp[loop] = NULL;
-				} else
-					moves[loop] = NULL;
-			}
-			moves_size = moves_size * 2;
-			delete[] temp;
-		}
-	} else // if type is delete move
-	{
-		totalrate += newmove->getRate();
-		if (del_moves == NULL) {
-			del_moves = new Move *[2];
-			del_moves_size = 2;
-			del_moves_index = 0;
-		}
-		// we do the bounds checking in the opposite order as before, as we want the size for deletion moves to default to 2 and not expand except when we are assured we need more, as opposed to creation moves where we pretty much always will need more. Though perhaps I should change it there also so as to remove an extra operation in the end position cases.
-		if (del_moves_index == del_moves_size) {
-			Move **temp = del_moves;
-			del_moves = new Move *[del_moves_size * 2];
-			for (int loop = 0; loop < del_moves_size * 2; loop++) {
-				if (loop < del_moves_size) {
-					del_moves[loop] = temp[loop];
-					temp[loop] = NULL;
-				} else
-					del_moves[loop] = NULL;
-			}
-			del_moves_size = del_moves_size * 2;
-			delete[] temp;
-		}
+	PhaseStats::countMove();
+	totalrate += newmove.rate.rate;
 
-		del_moves[del_moves_index] = newmove;
-		del_moves_index++;
+	if (newmove.type & MOVE_DELETE) {
+		del.add(newmove);
+	} else {
+		create.add(newmove);
 	}
+
 }
 
 Move *MoveList::getMove(Move *iterator) {
 	if (iterator == NULL)
 		int_index = 0;
 
-	if (int_index == moves_size)
+	if (int_index == create.count)
 		return NULL;
 
-	return moves[int_index++];
+	return &create.moves[int_index++];
 }
 
 Move *MoveList::getChoice(SimTimer& timer) {
 
 	double tmp;
 
-	for (int index = 0; index < moves_index + del_moves_index; index++) {
+	for (int index = 0; index < create.count + del.count; index++) {
 
-		if (index < moves_index) {
+		if (index < create.count) {
 
-			tmp = moves[index]->getRate();
+			tmp = create.rates[index];
 
 		} else {
-			tmp = del_moves[index - moves_index]->getRate();
+
+			tmp = del.rates[index - create.count];
 
 		}
-		if (timer.wouldBeHit(tmp) && index < moves_index) {
 
-			return moves[index];
+		if (timer.wouldBeHit(tmp) && index < create.count) {
+
+			return &create.moves[index];
 
 		} else if (timer.wouldBeHit(tmp)) {
 
-			return del_moves[index - moves_index];
+			return &del.moves[index - create.count];
 
 		} else {
 			timer.checkHit(tmp);
@@ -393,6 +392,44 @@ Move *MoveList::getChoice(SimTimer& timer) {
 	assert(0); // should never call for a move from a container unless it will get one.
 	return NULL;
 }
+
+// Same distribution as getChoice, but bisects the running sums instead of scanning.
+// Creation moves come first, then deletion moves, as in getChoice.
+Move *MoveList::getChoiceIndexed(SimTimer& timer) {
+
+	double createRate = (create.count > 0) ? create.cumul[create.count - 1] : 0.0;
+
+	MoveArray* list = &create;
+
+	if (timer.rchoice >= createRate && del.count > 0) {
+
+		timer.checkHit(createRate);
+		list = &del;
+
+	}
+
+	double* cumul = list->cumul;
+	int count = list->count;
+
+	assert(count > 0);
+
+	// totalrate is summed in a different order, so rchoice may overshoot by a rounding error.
+	double target = std::min(timer.rchoice, cumul[count - 1]);
+	int index;
+
+	if (target < cumul[count - 1]) {
+		index = std::upper_bound(cumul, cumul + count, target) - cumul;
+	} else {
+		index = std::lower_bound(cumul, cumul + count, cumul[count - 1]) - cumul;
+	}
+
+	if (index > 0) {
+		timer.checkHit(cumul[index - 1]);
+	}
+
+	return &list->moves[index];
+
+}
 /*
 
  MoveContainer
@@ -411,9 +448,9 @@ double MoveContainer::getRate(void) {
 	return totalrate;
 }
 
-uint16_t MoveList::getCount(void) {
+int MoveList::getCount(void) {
 
-	return moves_index + del_moves_index;
+	return create.count + del.count;
 
 }
 
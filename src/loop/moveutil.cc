@@ -78,10 +78,12 @@ string moveutil::primeToDesc(int input) {
 
 std::ostream& operator<<(std::ostream &ss, OpenInfo& m) {
 
-	for (std::pair<HalfContext, BaseCount> value : m.tally) {
+	for (int i = 0; i < HALFCONTEXT_COUNT; i++) {
 
-		ss << value.first << " ";
-		ss << value.second << "   --   ";
+		HalfContext con = HalfContext::fromIndex(i);
+
+		ss << con << " ";
+		ss << m.tally[i] << "   --   ";
 
 	}
 
@@ -96,7 +98,10 @@ std::ostream& operator<<(std::ostream &ss, OpenInfo& m) {
 
 void OpenInfo::clear(void) {
 
-	tally.clear();
+	for (int i = 0; i < HALFCONTEXT_COUNT; i++) {
+		tally[i].clear();
+	}
+
 	numExposedInternal = 0;
 	numExposed = 0;
 
@@ -105,56 +110,27 @@ void OpenInfo::clear(void) {
 // simply store the vector of halfContext onto the list we already have
 void OpenInfo::increment(QuartContext left, char base, QuartContext right) {
 
-	HalfContext con = HalfContext(left, right);
-
-	if (tally.count(con)) { // if count > 0 then proceed
-
-		tally.find(con)->second.count[base]++;
-
-	} else {
-
-		BaseCount count = BaseCount();
-		count.count[base]++;
-		tally.insert(std::pair<HalfContext, BaseCount>(con, count));
-
-	}
+	tally[HalfContext(left, right).index()].count[base]++;
 
 }
 
 void OpenInfo::increment(HalfContext con, BaseCount& count) {
 
-	if (tally.count(con)) {
-
-		// if found, increment from the reference
-
-		tally.find(con)->second.increment(count);
-
-	} else { // if not found, don't store the reference, make a new object.
-
-		BaseCount countNew = BaseCount();
-		countNew.increment(count);
-
-		tally.insert(std::pair<HalfContext, BaseCount>(con, countNew));
-
-	}
+	tally[con.index()].increment(count);
 
 }
 
 void OpenInfo::decrement(HalfContext con, BaseCount& count) {
 
-	assert(tally.count(con));
-
-	tally.find(con)->second.decrement(count);
+	tally[con.index()].decrement(count);
 
 }
 
 void OpenInfo::increment(OpenInfo& other) {
 
-	map<HalfContext, BaseCount> tally;
+	for (int i = 0; i < HALFCONTEXT_COUNT; i++) {
 
-	for (std::pair<HalfContext, BaseCount> myPair : other.tally) {
-
-		increment(myPair.first, myPair.second);
+		tally[i].increment(other.tally[i]);
 
 	}
 
@@ -165,11 +141,9 @@ void OpenInfo::increment(OpenInfo& other) {
 
 void OpenInfo::decrement(OpenInfo& other) {
 
-	map<HalfContext, BaseCount> tally;
-
-	for (std::pair<HalfContext, BaseCount> myPair : other.tally) {
+	for (int i = 0; i < HALFCONTEXT_COUNT; i++) {
 
-		decrement(myPair.first, myPair.second);
+		tally[i].decrement(other.tally[i]);
 
 	}
 
@@ -179,31 +153,23 @@ void OpenInfo::decrement(OpenInfo& other) {
 }
 
 // simply compute the crossed-rate between these exposed nucleotides.
+// The join rate for each pair of half-contexts is precomputed by the energy model.
 
 double OpenInfo::crossRate(OpenInfo& other, EnergyModel& eModel) {
 
 	double output = 0.0;
 
-	for (std::pair<HalfContext, BaseCount> here : tally) {
-
-		HalfContext& top = here.first;
-		BaseCount& countTop = here.second;
+	for (int i = 0; i < HALFCONTEXT_COUNT; i++) {
 
-		for (std::pair<HalfContext, BaseCount> there : other.tally) {
+		BaseCount& countTop = tally[i];
 
-			HalfContext& bot = there.first;
-			BaseCount& countBot = there.second;
+		for (int j = 0; j < HALFCONTEXT_COUNT; j++) {
 
-			int crossings = countTop.multiCount(countBot);
+			int crossings = countTop.multiCount(other.tally[j]);
 
 			if (crossings > 0) {
 
-				MoveType left = moveutil::combineBi(top.left, bot.right);
-				MoveType right = moveutil::combineBi(top.right, bot.left);
-
-				double joinRate = eModel.applyPrefactors(eModel.getJoinRate(), left, right);
-
-				double rate = crossings * joinRate;
+				double rate = crossings * eModel.getContextJoinRate(i, j);
 
 				output += rate;
 
@@ -406,6 +372,12 @@ std::ostream & operator<<(std::ostream & os, HalfContext & m) {
 
 }
 
+HalfContext HalfContext::fromIndex(int index) {
+
+	return HalfContext(QuartContext(index / HALFCONTEXT_SIZE), QuartContext(index % HALFCONTEXT_SIZE));
+
+}
+
 bool HalfContext::operator==(const HalfContext& other) const {
 
 	return ((left == other.left) && (right == other.right)) || ((left == other.right) && (right == other.left));
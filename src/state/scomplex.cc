@@ -17,7 +17,6 @@
 
 using std::cout;
 
-BaseCount emptyBaseCount;
 
 // JS: i'd like to optimize this lookup. It really should be just a bitwise
 //  or, and an array lookup, the extra function call annoys me.
@@ -35,6 +34,7 @@ StrandComplex::StrandComplex(char *seq, char *struc) {
 		tempcseq[loop] = baseLookup(tempcseq[loop]);
 
 	beginLoop = NULL;
+	loopSums = new LoopSums();
 	ordering = new StrandOrdering(tempseq, tempstruct, tempcseq);
 	delete[] tempseq;
 	delete[] tempstruct;
@@ -55,6 +55,7 @@ StrandComplex::StrandComplex(char *seq, char *struc, class identList *id_list) {
 	}
 
 	beginLoop = NULL;
+	loopSums = new LoopSums();
 	ordering = new StrandOrdering(tempseq, tempstruct, tempcseq, id_list);
 	delete[] tempseq;
 	delete[] tempstruct;
@@ -65,6 +66,7 @@ StrandComplex::StrandComplex(char *seq, char *struc, class identList *id_list) {
 StrandComplex::StrandComplex(StrandOrdering *newOrdering) {
 	ordering = newOrdering;
 	beginLoop = ordering->getLoop();
+	loopSums = new LoopSums();
 
 }
 
@@ -72,6 +74,7 @@ StrandComplex::~StrandComplex(void) {
 	// we cannot delete this here now, as they could be associated with a strandordering that will live on when the complex dies.
 	if (ordering != NULL)
 		delete ordering;
+	delete loopSums;
 }
 
 typedef std::vector<Loop*> LoopVector;
@@ -109,8 +112,8 @@ int StrandComplex::checkIDList(class identList *stoplist, int id_count) {
 	return 1;
 }
 
-int StrandComplex::checkIDBound(char *id) {
-	return ordering->checkIDBound(id);
+int StrandComplex::checkIDBound(int nameId) {
+	return ordering->checkIDBound(nameId);
 }
 
 StrandComplex *StrandComplex::performComplexJoin(JoinCriteria crit, bool useArr) {
@@ -154,7 +157,7 @@ StrandComplex *StrandComplex::performComplexJoin(JoinCriteria crit, bool useArr)
 	OpenLoop::performComplexJoin(loops, new_loops, types, index, crit.half, useArr);
 
 	// add the base pair into the output structure.
-	new_ordering->addBasepair(locations[0], locations[1]);
+	new_ordering->addBasepair(locations[0], locations[1], FLIP_JOIN);
 
 	// replace the old open loops with the new ones in the ordering
 	new_ordering->replaceOpenLoop(loops[0], new_loops[0]);
@@ -169,6 +172,9 @@ StrandComplex *StrandComplex::performComplexJoin(JoinCriteria crit, bool useArr)
 	loops[1]->cleanupAdjacent();
 	delete loops[1];
 
+	// the loops of complexes[1] now belong to complexes[0].
+	complexes[0]->rebuildLoopSums();
+
 	delete complexes[1]->ordering;
 	complexes[1]->ordering = NULL;
 	return complexes[1];
@@ -208,7 +214,7 @@ StrandComplex * StrandComplex::doChoice(Move * move) {
 		Loop *newLoop[2] = { NULL, NULL };
 		StrandOrdering *newOrdering = NULL;
 
-		ordering->breakBasepair(move->getAffected(0)->getLocation(move, 0), move->getAffected(1)->getLocation(move, 1));
+		ordering->breakBasepair(move->getAffected(0)->getLocation(move, 0), move->getAffected(1)->getLocation(move, 1), FLIP_SPLIT);
 		Loop::performComplexSplit(move, &newLoop[0], &newLoop[1]);
 
 		// We now have open loop pointers to the two resulting open loops.
@@ -222,7 +228,16 @@ StrandComplex * StrandComplex::doChoice(Move * move) {
 			cout << "Going to break the complex!! 3/3 ********************** " << std::endl;
 		}
 
-		return (new StrandComplex(newOrdering)); // newComplex
+		StrandComplex* newComplex = new StrandComplex(newOrdering);
+
+		if (loopSums->getTree() != NULL) {
+			newComplex->loopSums->enableTree();
+		}
+
+		newComplex->rebuildLoopSums();
+		rebuildLoopSums();
+
+		return newComplex;
 
 	} else {
 		if (move->getType() & MOVE_CREATE) // FD: test if we have a create-basepair move
@@ -244,10 +259,76 @@ StrandComplex * StrandComplex::doChoice(Move * move) {
 				assert(0);
 		}
 		beginLoop->verifyLoop( NULL, NULL);
+
+		// the new loops are temp and, for a creation move, its neighbour.
+		temp->attachSums(loopSums);
+		for (int i = 0; i < temp->getCurAdjacent(); i++) {
+			if (temp->getAdjacent(i) != NULL) {
+				temp->getAdjacent(i)->attachSums(loopSums);
+			}
+		}
+
+		if (loopSums->needsRebuild()) {
+			rebuildLoopSums();
+		}
 	}
 	return NULL;
 }
 
+void StrandComplex::enableRateTree(void) {
+
+	rebuildLoopSums(true);
+
+}
+
+void StrandComplex::getLoops(LoopList& loops) {
+
+	typedef std::pair<Loop*, Loop*> Step; // loop, and the loop we came from.
+
+	std::vector<Step, MemPoolAllocator<Step> > todo;
+	todo.push_back(std::make_pair(beginLoop, (Loop*) NULL));
+
+	while (todo.size() > 0) {
+
+		Loop* current = todo.back().first;
+		Loop* from = todo.back().second;
+		todo.pop_back();
+
+		loops.push_back(current);
+
+		for (int i = 0; i < current->getCurAdjacent(); i++) {
+			Loop* next = current->getAdjacent(i);
+			if (next != NULL && next != from) {
+				todo.push_back(std::make_pair(next, current));
+			}
+		}
+	}
+
+}
+
+// Re-sums flux and energy from scratch. Also picks up loops that were
+// created by a split or join, or that came from another complex.
+void StrandComplex::rebuildLoopSums(bool enableTree) {
+
+	LoopList loops;
+	getLoops(loops);
+
+	for (Loop* loop : loops) {
+		loop->detachSums();
+	}
+
+	loopSums->clear();
+
+	if (enableTree) {
+		loopSums->enableTree();
+	}
+
+	for (Loop* loop : loops) {
+		loop->attachSums(loopSums);
+	}
+
+}
+
 // used by generateLoops to handle loop traversals well.
 struct intlist {
 	int data;
@@ -432,8 +513,8 @@ int StrandComplex::generateLoops(void) {
 
 			openloopcount = 0;
 			// listlength is at least one.
-			OL_sidelengths = (int *) new int[listlength + 1];
-			OL_sequences = (char **) new char *[listlength + 1];
+			OL_sidelengths = (int *) MemPool::newArray<int>(listlength + 1);
+			OL_sequences = (char **) MemPool::newArray<char*>(listlength + 1);
 			// deletion for these is handled in the OpenLoop destructor.
 			temp_intlist = templist;
 
@@ -503,8 +584,8 @@ int StrandComplex::generateLoops(void) {
 
 			if (listlength != 0) {
 
-				OL_sidelengths = (int *) new int[listlength + 1];
-				OL_sequences = (char **) new char *[listlength + 1];
+				OL_sidelengths = (int *) MemPool::newArray<int>(listlength + 1);
+				OL_sequences = (char **) MemPool::newArray<char*>(listlength + 1);
 				// deletion for these is handled in the OpenLoop destructor.
 				temp_intlist = templist;
 				/*	      OL_pairtypes[0] = stacklist->pairtype;
@@ -526,8 +607,8 @@ int StrandComplex::generateLoops(void) {
 
 			} else {
 
-				OL_sidelengths = (int *) new int[listlength + 1];
-				OL_sequences = (char **) new char *[listlength + 1];
+				OL_sidelengths = (int *) MemPool::newArray<int>(listlength + 1);
+				OL_sequences = (char **) MemPool::newArray<char*>(listlength + 1);
 				OL_sidelengths[0] = seqlen;
 				OL_sequences[0] = ordering->convertIndex(-1);
 				newLoop = new OpenLoop(0, OL_sidelengths, OL_sequences); // open chain
@@ -537,8 +618,8 @@ int StrandComplex::generateLoops(void) {
 				{
 			int *ML_sidelengths;
 			char **ML_sequences;
-			ML_sidelengths = (int *) new int[listlength];
-			ML_sequences = (char **) new char *[listlength];
+			ML_sidelengths = (int *) MemPool::newArray<int>(listlength);
+			ML_sequences = (char **) MemPool::newArray<char*>(listlength);
 			// deletion for these is handled in the OpenLoop destructor.
 			temp_intlist = templist;
 			// JS: Possibly a problem here, need to make sure sequences get paired correctly with lengths. FIXME
@@ -623,6 +704,7 @@ int StrandComplex::generateLoops(void) {
 		delete[] structure;
 	if (charsequence != NULL)
 		delete[] charsequence;
+	return 0;
 }
 
 void StrandComplex::printAllMoves(void) {
@@ -669,10 +751,10 @@ StrandOrdering * StrandComplex::getOrdering() {
 }
 
 double StrandComplex::getTotalFlux(void) {
-	return beginLoop->returnFlux(NULL);
+	return loopSums->getFlux();
 }
 
-uint16_t StrandComplex::getMoveCount(void) {
+int StrandComplex::getMoveCount(void) {
 	return beginLoop->getMoveCount(NULL);
 }
 
@@ -701,15 +783,7 @@ BaseCount& StrandComplex::getExteriorBases(HalfContext* lowerHalf) {
 
 		OpenInfo& info = ordering->getOpenInfo();
 
-		if (info.tally.count(*lowerHalf)) {
-
-			return info.tally.find(*lowerHalf)->second;
-
-		} else {
-
-			return emptyBaseCount;
-
-		}
+		return info.tally[lowerHalf->index()];
 
 	}
 
@@ -717,7 +791,7 @@ BaseCount& StrandComplex::getExteriorBases(HalfContext* lowerHalf) {
 
 double StrandComplex::getEnergy(void) {
 
-	return beginLoop->returnEnergies( NULL);
+	return loopSums->getEnergy();
 
 }
 
@@ -729,9 +803,12 @@ double StrandComplex::getEnthalpy(void) {
 
 void StrandComplex::generateMoves(void) {
 	beginLoop->firstGen( NULL);
+	rebuildLoopSums();
 }
 
 Move *StrandComplex::getChoice(SimTimer& timer) {
+	if (loopSums->getTree() != NULL)
+		return loopSums->getTree()->choose(timer.rchoice)->getLocalChoice(timer);
 	return beginLoop->getChoice(timer, NULL);
 }
 
@@ -16,6 +16,8 @@
 #include <simoptions.h>
 #include <utility.h>
 #include <moveutil.h>
+#include <options.h>
+#include "phasestats.h"
 #include <assert.h>
 
 typedef std::vector<int> intvec;
@@ -35,6 +37,8 @@ SComplexListEntry::SComplexListEntry(StrandComplex *newComplex, int newid) {
 	ee_energy.nTdS = 0;
 	next = NULL;
 	id = newid;
+	rateSlot = -1;
+	exteriorVersion = -1;
 }
 
 SComplexListEntry::~SComplexListEntry(void) {
@@ -128,6 +132,11 @@ void SComplexListEntry::dumpComplexEntryToPython(ExportData& data) {
 SComplexList::SComplexList(EnergyModel *energyModel) {
 
 	eModel = energyModel;
+	entryTree = new RateTree<SComplexListEntry>();
+
+	if (eModel->simOptions != NULL && eModel->simOptions->selectionEngine == SELECTION_ENGINE_SUMTREE) {
+		useRateTree = true;
+	}
 
 }
 
@@ -140,6 +149,7 @@ SComplexList::~SComplexList(void) {
 	}
 	if (first != NULL)
 		delete first;
+	delete entryTree;
 }
 
 /* 
@@ -157,6 +167,8 @@ SComplexListEntry *SComplexList::addComplex(StrandComplex *newComplex) {
 	numOfComplexes++;
 	idcounter++;
 
+	first->rateSlot = entryTree->insert(first, first->rate);
+
 	return first;
 }
 
@@ -170,11 +182,15 @@ void SComplexList::initializeList(void) {
 
 		temp->initializeComplex();
 
+		if (useRateTree) {
+			temp->thisComplex->enableRateTree();
+		}
+
 		if (utility::debugTraces) {
 			cout << "Done initializing a complex!" << endl;
 		}
 
-		temp->fillData(eModel);
+		updateEntry(temp);
 
 	}
 
@@ -189,7 +205,7 @@ void SComplexList::regenerateMoves(void) {
 	for (SComplexListEntry* temp = first; temp != NULL; temp = temp->next) {
 
 		temp->regenerateMoves();
-		temp->fillData(eModel);
+		updateEntry(temp);
 
 	}
 
@@ -201,13 +217,8 @@ void SComplexList::regenerateMoves(void) {
 
 double SComplexList::getTotalFlux(void) {
 
-	double total = 0.0;
-
-	for (SComplexListEntry *temp = first; temp != NULL; temp = temp->next) {
-
-		total += temp->rate;
-
-	}
+	// the entry rates are kept summed in entryTree by updateEntry.
+	double total = entryTree->getTotal();
 
 	joinRate = getJoinFlux();
 	total += joinRate;
@@ -257,6 +268,8 @@ OpenInfo SComplexList::getOpenInfo() {
 
 double SComplexList::getJoinFlux(void) {
 
+	PhaseTimer phase(PHASE_JOIN_FLUX);
+
 // We now compute the exterior nucleotide moves.
 	if (numOfComplexes <= 1) {
 		return 0.0;
@@ -269,19 +282,15 @@ double SComplexList::getJoinFlux(void) {
 	}
 
 	double output = 0.0;
-	int moveCount = 0;
-
-	BaseCount totalBases = getExposedBases();
 
 	for (SComplexListEntry* temp = first; temp != NULL; temp = temp->next) {
 
-		BaseCount& ext_bases = temp->thisComplex->getExteriorBases();
-		totalBases.decrement(ext_bases);
-
-		moveCount += totalBases.multiCount(ext_bases);
+		updateExterior(temp);
 
 	}
 
+	int moveCount = joinMoveCount;
+
 	if (eModel->inspection) {
 		return moveCount;
 	}
@@ -298,9 +307,42 @@ double SComplexList::getJoinFlux(void) {
 
 }
 
-uint16_t SComplexList::getMoveCount(void) {
+// Only complexes whose exterior changed since the last call are recounted.
+// Moving one complex from exterior e to e' changes the pair count by
+// (sum - e) * e' - (sum - e) * e, which is exact in integers.
+void SComplexList::updateExterior(SComplexListEntry* entry) {
+
+	StrandOrdering* ordering = entry->thisComplex->getOrdering();
+
+	if (entry->exteriorVersion == ordering->getExteriorVersion()) {
+		return;
+	}
+
+	BaseCount& current = ordering->getExteriorBases();
+
+	exteriorSum.decrement(entry->exterior);
+	joinMoveCount -= exteriorSum.multiCount(entry->exterior);
+	joinMoveCount += exteriorSum.multiCount(current);
+	exteriorSum.increment(current);
+
+	entry->exterior = current;
+	entry->exteriorVersion = ordering->getExteriorVersion();
+
+}
+
+void SComplexList::removeExterior(SComplexListEntry* entry) {
+
+	exteriorSum.decrement(entry->exterior);
+	joinMoveCount -= exteriorSum.multiCount(entry->exterior);
+
+	entry->exterior.clear();
+	entry->exteriorVersion = -1;
+
+}
 
-	uint16_t output = 0;
+int SComplexList::getMoveCount(void) {
+
+	int output = 0;
 
 	for (SComplexListEntry* temp = first; temp != NULL; temp = temp->next) {
 
@@ -345,11 +387,22 @@ double SComplexList::computeArrBiRate(SComplexListEntry* input) {
 
 	StrandOrdering* orderIn = input->thisComplex->getOrdering();
 
-	// now start computing rates with the remaining entries
+	// now start computing rates with the remaining entries,
+	// recomputing only pairs where either exterior has changed.
 	while (temp != NULL) {
 
 		StrandOrdering* otherOrder = temp->thisComplex->getOrdering();
-		output += cycleCrossRateArr(orderIn, otherOrder);
+		CrossRate& cached = input->crossRates[temp->id];
+
+		if (cached.version != orderIn->getExteriorVersion() || cached.otherVersion != otherOrder->getExteriorVersion()) {
+
+			cached.rate = cycleCrossRateArr(orderIn, otherOrder);
+			cached.version = orderIn->getExteriorVersion();
+			cached.otherVersion = otherOrder->getExteriorVersion();
+
+		}
+
+		output += cached.rate;
 
 		temp = temp->next;
 	}
@@ -421,6 +474,8 @@ double SComplexList::doBasicChoice(SimTimer& myTimer) {
 	Move *tempmove;
 	double arrType;
 
+	PhaseStats::countStep();
+
 	if (utility::debugTraces) {
 
 		cout << "Doing a basic choice, timer =  " << myTimer << endl;
@@ -438,38 +493,53 @@ double SComplexList::doBasicChoice(SimTimer& myTimer) {
 
 	}
 
-	temp = first;
 	StrandComplex *pickedComplex = NULL;
 
-	while (temp != NULL) {
-		if (myTimer.wouldBeHit(temp->rate) && pickedComplex == NULL) {
-			pickedComplex = temp->thisComplex;
-			temp2 = temp;
+	{
+		PhaseTimer phase(PHASE_SELECT);
+
+		temp = first;
+
+		if (useRateTree) {
+			temp2 = entryTree->choose(myTimer.rchoice);
+			pickedComplex = temp2->thisComplex;
+			temp = NULL;
 		}
-		if (pickedComplex == NULL) {
 
-			myTimer.checkHit(temp->rate);
+		while (temp != NULL) {
+			if (myTimer.wouldBeHit(temp->rate) && pickedComplex == NULL) {
+				pickedComplex = temp->thisComplex;
+				temp2 = temp;
+			}
+			if (pickedComplex == NULL) {
+
+				myTimer.checkHit(temp->rate);
 
+			}
+			temp = temp->next;
 		}
-		temp = temp->next;
-	}
-// POST: pickedComplex points to the complex that contains the executable move
+		// POST: pickedComplex points to the complex that contains the executable move
 
-	assert(pickedComplex != NULL);
+		assert(pickedComplex != NULL);
+
+		tempmove = pickedComplex->getChoice(myTimer);
+	}
 
-	tempmove = pickedComplex->getChoice(myTimer);
 	arrType = tempmove->getArrType();
 
-	newComplex = pickedComplex->doChoice(tempmove);
+	{
+		PhaseTimer phase(PHASE_DO_CHOICE);
+		newComplex = pickedComplex->doChoice(tempmove);
+	}
 
 	if (newComplex != NULL) {
 
 		temp = addComplex(newComplex);
-		temp->fillData(eModel);
+		updateEntry(temp);
 
 	}
 
-	temp2->fillData(eModel);
+	updateEntry(temp2);
 
 	// FD Oct 20, 2017.
 	// If co-transcriptional mode is activated, and the time indicates a new nucleotide has been added,
@@ -489,6 +559,13 @@ double SComplexList::doBasicChoice(SimTimer& myTimer) {
 
 }
 
+void SComplexList::updateEntry(SComplexListEntry* entry) {
+
+	entry->fillData(eModel);
+	entryTree->update(entry->rateSlot, entry->rate);
+
+}
+
 /*
  SComplexList::doJoinChoice( double choice )
  */
@@ -507,14 +584,18 @@ double SComplexList::doJoinChoice(SimTimer& timer) {
 		cout << toString();
 	}
 
-	if (!eModel->useArrhenius()) {
+	{
+		PhaseTimer phase(PHASE_SELECT);
 
-		crit = cycleForJoinChoice(timer);
+		if (!eModel->useArrhenius()) {
 
-	} else {
+			crit = cycleForJoinChoice(timer);
+
+		} else {
 
-		crit = cycleForJoinChoiceArr(timer);
+			crit = cycleForJoinChoiceArr(timer);
 
+		}
 	}
 
 	if (utility::debugTraces) {
@@ -529,18 +610,26 @@ double SComplexList::doJoinChoice(SimTimer& timer) {
 
 	SComplexListEntry *temp2 = NULL;
 	StrandComplex *deleted;
+	int deletedId = -1;
+
+	{
+		PhaseTimer phase(PHASE_JOIN);
+		deleted = StrandComplex::performComplexJoin(crit, eModel->useArrhenius());
+	}
 
-	deleted = StrandComplex::performComplexJoin(crit, eModel->useArrhenius());
 	for (SComplexListEntry* temp = first; temp != NULL; temp = temp->next) {
 
 		if (temp->thisComplex == crit.complexes[0]) {
-			temp->fillData(eModel);
+			updateEntry(temp);
 		}
 
 		if (temp->next != NULL) {
 
 			if (temp->next->thisComplex == deleted) {
 				temp2 = temp->next;
+				entryTree->remove(temp2->rateSlot);
+				removeExterior(temp2);
+				deletedId = temp2->id;
 				temp->next = temp2->next;
 				temp2->next = NULL;
 				delete temp2;
@@ -552,6 +641,9 @@ double SComplexList::doJoinChoice(SimTimer& timer) {
 
 	if (first->thisComplex == deleted) {
 		temp2 = first;
+		entryTree->remove(temp2->rateSlot);
+		removeExterior(temp2);
+		deletedId = temp2->id;
 		first = first->next;
 		temp2->next = NULL;
 		delete temp2;
@@ -559,6 +651,10 @@ double SComplexList::doJoinChoice(SimTimer& timer) {
 	}
 	numOfComplexes--;
 
+	for (SComplexListEntry* temp = first; temp != NULL; temp = temp->next) {
+		temp->crossRates.erase(deletedId);
+	}
+
 	return crit.arrType;
 
 }
@@ -645,18 +741,19 @@ JoinCriteria SComplexList::cycleForJoinChoiceArr(SimTimer& timer) {
 
 		if (baseSum.numExposed > 0) {
 
-			for (std::pair<HalfContext, BaseCount> con : baseSum.tally) {
+			for (int i = 0; i < HALFCONTEXT_COUNT; i++) {
 
-				for (std::pair<HalfContext, BaseCount> ton : external.tally) {
+				BaseCount& conCount = baseSum.tally[i];
 
-					int combinations = con.second.multiCount(ton.second);
+				for (int j = 0; j < HALFCONTEXT_COUNT; j++) {
 
-					if (combinations > 0) {
+					BaseCount& tonCount = external.tally[j];
 
-						MoveType left = moveutil::combineBi(con.first.left, ton.first.right);
-						MoveType right = moveutil::combineBi(con.first.right, ton.first.left);
+					int combinations = conCount.multiCount(tonCount);
 
-						double joinRate = eModel->applyPrefactors(eModel->getJoinRate(), left, right);
+					if (combinations > 0) {
+
+						double joinRate = eModel->getContextJoinRate(i, j);
 
 						double rate = joinRate * combinations;
 
@@ -667,16 +764,22 @@ JoinCriteria SComplexList::cycleForJoinChoiceArr(SimTimer& timer) {
 
 							for (BaseType base : { baseA, baseT, baseG, baseC }) {
 
-								int combinations = con.second.count[base] * ton.second.count[5 - base];
+								int combinations = conCount.count[base] * tonCount.count[5 - base];
 
 								if (choice_int < combinations) {
 
 									// return the joining criteria;
 
-									JoinCriteria crit = findJoinNucleotides(base, choice_int, ton.second, temp, &con.first);
+									HalfContext con = HalfContext::fromIndex(i);
+									HalfContext ton = HalfContext::fromIndex(j);
+
+									JoinCriteria crit = findJoinNucleotides(base, choice_int, tonCount, temp, &con);
 
-									crit.half[0] = ton.first;
-									crit.half[1] = con.first;
+									crit.half[0] = ton;
+									crit.half[1] = con;
+
+									MoveType left = moveutil::combineBi(con.left, ton.right);
+									MoveType right = moveutil::combineBi(con.right, ton.left);
 
 									crit.arrType = (double) moveutil::getPrimeCode(left, right);
 
@@ -716,6 +819,8 @@ JoinCriteria SComplexList::cycleForJoinChoiceArr(SimTimer& timer) {
  */
 bool SComplexList::checkStopComplexList(class complexItem *stoplist) {
 
+	PhaseTimer phase(PHASE_STOP_CHECK);
+
 	if (stoplist->type == STOPTYPE_BOUND) {
 
 		return checkStopComplexList_Bound(stoplist);
@@ -776,7 +881,7 @@ bool SComplexList::checkStopComplexList_Bound(class complexItem *stoplist) {
 		entry_traverse = first;
 		k_flag = 0;
 		while (entry_traverse != NULL && k_flag == 0) {
-			k_flag += entry_traverse->thisComplex->checkIDBound(id_traverse->id);
+			k_flag += entry_traverse->thisComplex->checkIDBound(id_traverse->nameId);
 			entry_traverse = entry_traverse->next;
 		}
 		if (k_flag == 0)
@@ -790,9 +895,7 @@ bool SComplexList::checkStopComplexList_Bound(class complexItem *stoplist) {
 bool SComplexList::checkStopComplexList_Structure_Disassoc(class complexItem *stoplist) {
 	class SComplexListEntry *entry_traverse = first;
 	class complexItem *traverse = stoplist;
-	int id_count = 0;
 	bool successflag = false;
-	class identList *id_traverse = stoplist->strand_ids;
 
 	// We are checking each entry in the list of stop complexes, verifying that it exists within our list of complexes.
 	// So the outer iteration is over the stop complexes, and the inner iteration is over the complexes existant in our system.
@@ -802,23 +905,21 @@ bool SComplexList::checkStopComplexList_Structure_Disassoc(class complexItem *st
 	traverse = stoplist;
 	while (traverse != NULL) {
 
-		// count how many strands are in the stop complex. This gets used as a fast check later.
-		id_count = 0;
-		id_traverse = traverse->strand_ids;
-
-		while (id_traverse != NULL) {
-			id_count++;
-			id_traverse = id_traverse->next;
-		}
-
 		entry_traverse = first;
 		successflag = false;
 		while (entry_traverse != NULL && successflag == 0) {
+
+			StrandOrdering* ordering = entry_traverse->thisComplex->ordering;
+
 			// iterate check for current stop complex (traverse) in our list of system complexes (entry_traverse)
-			if (entry_traverse->thisComplex->checkIDList(traverse->strand_ids, id_count) > 0) {
+			// the strand keys only agree if the strands could be a circular permutation of the stop complex,
+			// the number of strands in the stop complex (id_count) is a fast check as well.
+			if (ordering->getStrandKey() == traverse->strandKey && entry_traverse->thisComplex->checkIDList(traverse->strand_ids, traverse->id_count) > 0) {
 				// if the system complex being checked has the correct circular permutation of strand ids, continue with our checks, otherwise it doesn't match.
+				// The strands are now aligned with the stop complex, and every strand keeps a running count
+				// of the positions where it differs from the stop structure, so most checks avoid the string compare.
 				if (traverse->type == STOPTYPE_STRUCTURE) {
-					if (strcmp(entry_traverse->thisComplex->getStructure().c_str(), traverse->structure) == 0) {
+					if (ordering->structureMismatches(traverse, false) == 0) {
 						// if the structures match exactly, we have a successful match.
 						successflag = true;
 					}
@@ -826,10 +927,18 @@ bool SComplexList::checkStopComplexList_Structure_Disassoc(class complexItem *st
 					// for DISASSOC type checking, we only need the strand id lists to match correctly.
 					successflag = true;
 				} else if (traverse->type == STOPTYPE_LOOSE_STRUCTURE) {
-					successflag = checkLooseStructure(entry_traverse->thisComplex->getStructure().c_str(), traverse->structure, traverse->count);
+					// every mismatched position costs at least one unit of distance.
+					if (ordering->structureMismatches(traverse, true) <= traverse->count) {
+						successflag = checkLooseStructure(ordering, traverse);
+					}
 					// the structure matches loosely (see definitions)
 				} else if (traverse->type == STOPTYPE_PERCENT_OR_COUNT_STRUCTURE) {
-					successflag = checkCountStructure(entry_traverse->thisComplex->getStructure().c_str(), traverse->structure, traverse->count);
+					int mismatches = ordering->structureMismatches(traverse, false);
+					if (mismatches == 0 && traverse->count >= 0) {
+						successflag = true;
+					} else if (mismatches <= traverse->count) {
+						successflag = checkCountStructure(ordering, traverse);
+					}
 					// this structure matches to within a % of the correct base pairs, note that %'s are converted to raw base counts by the IO system.
 				}
 			}
@@ -848,117 +957,90 @@ bool SComplexList::checkStopComplexList_Structure_Disassoc(class complexItem *st
 /*
  Methods used for checking loose structure definitions and counting structure defs.
 
- int SComplexList::checkLooseStructure( char *our_struc, char *stop_struc, int count );
- int SComplexList::checkCountStructure( char *our_struc, char *stop_struc, int count );
+ bool SComplexList::checkLooseStructure( StrandOrdering *ordering, complexItem *stopItem );
+ bool SComplexList::checkCountStructure( StrandOrdering *ordering, complexItem *stopItem );
+
+ Both walk the pair tables of the complex and the stop structure, so partners are
+ looked up directly instead of being tracked on a stack of open positions.
+ In the loose version, '*' in the stop structure matches any character.
 
  */
 
-bool SComplexList::checkLooseStructure(const char *our_struc, const char *stop_struc, int count) {
-	int loop, len;
-	intvec our_pairs, stop_pairs;
-	int remaining_distance = count;
+bool SComplexList::checkLooseStructure(StrandOrdering *ordering, complexItem *stopItem) {
 
-	len = strlen(our_struc);
-	if (len != strlen(stop_struc))
-		return false;  // something weird happened, as it should have the
-// same ID list...
+	return checkStructureDistance(ordering, stopItem, true);
 
-	for (loop = 0; loop < len; loop++) {
-		if (stop_struc[loop] != '*')
-			if (our_struc[loop] != stop_struc[loop]) {
-				remaining_distance--;
-			}
+}
 
-		if (our_struc[loop] == '(')
-			our_pairs.push_back(loop);
-		if (stop_struc[loop] == '(')
-			stop_pairs.push_back(loop);
+bool SComplexList::checkCountStructure(StrandOrdering *ordering, complexItem *stopItem) {
 
-		if (our_struc[loop] == ')' && stop_struc[loop] == ')') {
-			if (our_pairs.back() != stop_pairs.back()) {
-				remaining_distance--; // for position loop, which had
-									  // ),) but they were paired wrong
-				if (our_struc[stop_pairs.back()] == '(')
-					remaining_distance--; // for the position we were
-										  // paired with in stop_struc,
-										  // because it was ( in our_struc
-										  // as well, but paired wrong
-			}
-			our_pairs.pop_back();
-			stop_pairs.pop_back();
-		} else {
-			if (our_struc[loop] == ')')
-				our_pairs.pop_back();
-			if (stop_struc[loop] == ')') {
-				if (our_struc[stop_pairs.back()] == '(')
-					remaining_distance--;  // for the position we were
-										   // paired with in stop_struc,
-										   // because it was ( in our
-										   // struc but paired wrong. Note
-										   // we have already subtracted
-										   // for current position loop,
-										   // as our_struc[loop] !=
-										   // stop_struc[loop] in this
-										   // conditional block.
-				stop_pairs.pop_back();
-			}
-		}
+	return checkStructureDistance(ordering, stopItem, false);
 
-		if (remaining_distance < 0)
-			return false;
+}
+
+// the dot-paren character for a position in a pair table.
+static char pairChar(vector<int>& pairs, int position) {
+
+	if (position < 0) {
+		return '\0';
 	}
-	return true;
+
+	int partner = pairs[position];
+
+	if (partner == PAIR_BREAK) {
+		return '+';
+	} else if (partner == PAIR_NONE) {
+		return '.';
+	} else if (partner > position) {
+		return '(';
+	} else {
+		return ')';
+	}
+
 }
 
-bool SComplexList::checkCountStructure(const char *our_struc, const char *stop_struc, int count) {
+bool SComplexList::checkStructureDistance(StrandOrdering *ordering, complexItem *stopItem, bool wildcard) {
 
-	int loop, len;
-	intvec our_pairs, stop_pairs;
-	int remaining_distance = count;
+	vector<int>& our_pairs = ordering->getPairTable();
+	vector<int>& stop_pairs = stopItem->pairs;
+	const char *stop_struc = stopItem->structure;
+	int remaining_distance = stopItem->count;
 
-	len = strlen(our_struc);
-	if (len != strlen(stop_struc))
+	int len = our_pairs.size();
+	if (len != (int) stop_pairs.size())
 		return false;  // something weird happened, as it should have the
 // same ID list...
 
-	for (loop = 0; loop < len; loop++) {
-		if (our_struc[loop] != stop_struc[loop]) {
+	for (int loop = 0; loop < len; loop++) {
+
+		char our = pairChar(our_pairs, loop);
+		char stop = stop_struc[loop];
+
+		if (!(wildcard && stop == '*') && our != stop) {
 			remaining_distance--;
 		}
 
-		if (our_struc[loop] == '(')
-			our_pairs.push_back(loop);
-		if (stop_struc[loop] == '(')
-			stop_pairs.push_back(loop);
-
-		if (our_struc[loop] == ')' && stop_struc[loop] == ')') {
-			if (our_pairs.back() != stop_pairs.back()) {
+		if (our == ')' && stop == ')') {
+			if (our_pairs[loop] != stop_pairs[loop]) {
 				remaining_distance--; // for position loop, which had
 									  // ),) but they were paired wrong
-				if (our_struc[stop_pairs.back()] == '(')
+				if (pairChar(our_pairs, stop_pairs[loop]) == '(')
 					remaining_distance--; // for the position we were
 										  // paired with in stop_struc,
 										  // because it was ( in our_struc
 										  // as well, but paired wrong
 			}
-			our_pairs.pop_back();
-			stop_pairs.pop_back();
-		} else {
-			if (our_struc[loop] == ')')
-				our_pairs.pop_back();
-			if (stop_struc[loop] == ')') {
-				if (our_struc[stop_pairs.back()] == '(')
-					remaining_distance--;  // for the position we were
-										   // paired with in stop_struc,
-										   // because it was ( in our
-										   // struc but paired wrong. Note
-										   // we have already subtracted
-										   // for current position loop,
-										   // as our_struc[loop] !=
-										   // stop_struc[loop] in this
-										   // conditional block.
-				stop_pairs.pop_back();
-			}
+		} else if (stop == ')') {
+			if (pairChar(our_pairs, stop_pairs[loop]) == '(')
+				remaining_distance--;  // for the position we were
+									   // paired with in stop_struc,
+									   // because it was ( in our
+									   // struc but paired wrong. Note
+									   // we have already subtracted
+									   // for current position loop,
+									   // as our_struc[loop] !=
+									   // stop_struc[loop] in this
+									   // conditional block.
 		}
 
 		if (remaining_distance < 0)
@@ -34,6 +34,7 @@ orderingList::orderingList(int insize, int n_id, char *inTag, char *inSeq, char
 	assert(thisStruct != NULL);
 
 	strncpy(thisTag, inTag, strlen(inTag) + 1);
+	nameId = identList::internName(thisTag);
 	strncpy(thisSeq, inSeq, size);
 	strncpy(thisCodeSeq, inCodeSeq, size);
 	strncpy(thisStruct, inStruct, size);
@@ -41,12 +42,24 @@ orderingList::orderingList(int insize, int n_id, char *inTag, char *inSeq, char
 	thisCodeSeq[size] = '\0';
 	thisStruct[size] = '\0';
 
+	unpaired = 0;
+	for (int i = 0; i < size; i++) {
+		if (thisStruct[i] == '.')
+			unpaired++;
+	}
+
+	table = NULL;
+	if (Loop::GetEnergyModel() != NULL)
+		table = Loop::GetEnergyModel()->addStrand(thisCodeSeq, size);
+
 	next = prev = NULL;
 	thisLoop = NULL;
 
 }
 
 orderingList::~orderingList(void) {
+	if (table != NULL)
+		table->model->removeStrand(thisCodeSeq, table);
 	if (thisTag != NULL)
 		delete[] thisTag;
 	if (thisSeq != NULL)
@@ -88,6 +101,63 @@ void StrandOrdering::cleanup(void) {
 	}
 }
 
+void orderingList::setStruct(int index, char c) {
+
+	char old = thisStruct[index];
+
+	for (StructTarget& t : targets) {
+
+		if (t.mismatches < 0 || (t.wildcard && t.target[index] == '*')) {
+			continue;
+		}
+
+		t.mismatches += (c != t.target[index]) - (old != t.target[index]);
+
+	}
+
+	unpaired += (c == '.') - (old == '.');
+	thisStruct[index] = c;
+
+}
+
+// The first request for a target counts the mismatches; after that, setStruct keeps the count.
+int orderingList::getMismatches(const char* target, bool wildcard) {
+
+	for (StructTarget& t : targets) {
+
+		if (t.target == target && t.wildcard == wildcard) {
+			return t.mismatches;
+		}
+
+	}
+
+	StructTarget t;
+	t.target = target;
+	t.wildcard = wildcard;
+	t.mismatches = 0;
+
+	for (int i = 0; i < size; i++) {
+
+		if (target[i] == '\0' || target[i] == '+') {
+			t.mismatches = -1;
+			break;
+		}
+
+		if (thisStruct[i] != target[i] && !(wildcard && target[i] == '*')) {
+			t.mismatches++;
+		}
+
+	}
+
+	targets.push_back(t);
+
+	return t.mismatches;
+
+}
+
+thread_local long StrandOrdering::lastExteriorVersion = 0;
+thread_local std::vector<FlipEvent>* StrandOrdering::flipLog = NULL;
+
 StrandOrdering::StrandOrdering(void) {
 
 }
@@ -265,7 +335,9 @@ StrandOrdering* StrandOrdering::joinOrdering(StrandOrdering *first, StrandOrderi
 	second->first = NULL;
 	second->last = NULL;
 
-	first->openInfo.upToDate = false;
+	first->invalidateExterior();
+	first->strandKeyUpToDate = false;
+	first->pairTableUpToDate = false;
 
 	return first;
 }
@@ -292,7 +364,7 @@ void StrandOrdering::reorder(OpenLoop *index) {
 				count++;
 			if (traverse_second->thisStruct[loop] == ')') {
 				if (count == 0)
-					traverse_second->thisStruct[loop] = '(';
+					traverse_second->setStruct(loop, '(');
 				else
 					count--;
 			}
@@ -306,7 +378,7 @@ void StrandOrdering::reorder(OpenLoop *index) {
 				count++;
 			if (traverse_second->thisStruct[loop] == '(') {
 				if (count == 0)
-					traverse_second->thisStruct[loop] = ')';
+					traverse_second->setStruct(loop, ')');
 				else
 					count--;
 			}
@@ -323,6 +395,7 @@ void StrandOrdering::reorder(OpenLoop *index) {
 
 	seq.clear();
 	struc.clear();
+	pairTableUpToDate = false;
 
 	if (strandnames != NULL) {
 		delete[] strandnames;
@@ -346,7 +419,7 @@ OpenLoop *StrandOrdering::checkIDList(class identList * stoplist, int id_count)
 		return NULL;
 
 	while (num_matched < id_count && id_traverse != NULL) {
-		if (strcmp(traverse->thisTag, id_traverse->id) == 0) {
+		if (traverse->nameId == id_traverse->nameId) {
 			if (num_matched == 0)
 				thingtoreturn = traverse->thisLoop;
 			num_matched++;
@@ -371,27 +444,153 @@ OpenLoop *StrandOrdering::checkIDList(class identList * stoplist, int id_count)
 
 }
 
+unsigned long StrandOrdering::getStrandKey(void) {
+
+	if (!strandKeyUpToDate) {
+
+		vector<int> nameIds;
+
+		for (orderingList* traverse = first; traverse != NULL; traverse = traverse->next) {
+			nameIds.push_back(traverse->nameId);
+		}
+
+		strandKey = identList::rotationKey(nameIds);
+		strandKeyUpToDate = true;
+
+	}
+
+	return strandKey;
+
+}
+
+int StrandOrdering::structureMismatches(class complexItem *stopItem, bool wildcard) {
+
+	const char* target = stopItem->structure;
+	int output = 0;
+
+	for (orderingList* traverse = first; traverse != NULL; traverse = traverse->next) {
+
+		int mismatches = traverse->getMismatches(target, wildcard);
+
+		// strands are separated by '+', and the last one ends the stop structure.
+		char end = (traverse == last) ? '\0' : '+';
+
+		if (mismatches < 0 || target[traverse->size] != end) {
+			return -1;
+		}
+
+		output += mismatches;
+		target += traverse->size + 1;
+
+	}
+
+	return output;
+
+}
+
+// changes the character at location, which points into one of the strands' thisStruct,
+// and returns its position in getStructure().
+int StrandOrdering::setStructChar(char *location, char c) {
+
+	int offset = 0;
+
+	for (orderingList* traverse = first; traverse != NULL; traverse = traverse->next) {
+
+		if (location >= traverse->thisStruct && location < traverse->thisStruct + traverse->size) {
+
+			traverse->setStruct(location - traverse->thisStruct, c);
+			return offset + (location - traverse->thisStruct);
+
+		}
+
+		offset += traverse->size + 1;
+
+	}
+
+	assert(0);
+	return -1;
+
+}
+
+void StrandOrdering::recordFlip(char *left, char *right, char type) {
+
+	FlipEvent event;
+	event.type = type;
+
+	char* location[2] = { left, right };
+
+	for (int i = 0; i < 2; i++) {
+		for (orderingList* traverse = first; traverse != NULL; traverse = traverse->next) {
+
+			if (location[i] >= traverse->thisStruct && location[i] < traverse->thisStruct + traverse->size) {
+
+				event.strands[i] = traverse;
+				event.positions[i] = location[i] - traverse->thisStruct;
+				break;
+
+			}
+		}
+	}
+
+	flipLog->push_back(event);
+
+}
+
+vector<int>& StrandOrdering::getPairTable(void) {
+
+	if (pairTableUpToDate) {
+		return pairTable;
+	}
+
+	pairTable.clear();
+	vector<int> open;
+
+	for (orderingList* traverse = first; traverse != NULL; traverse = traverse->next) {
+
+		if (traverse != first) {
+			pairTable.push_back(PAIR_BREAK);
+		}
+
+		for (int i = 0; i < traverse->size; i++) {
+
+			int position = (int) pairTable.size();
+			pairTable.push_back(PAIR_NONE);
+
+			if (traverse->thisStruct[i] == '(') {
+
+				open.push_back(position);
+
+			} else if (traverse->thisStruct[i] == ')') {
+
+				assert(!open.empty());
+
+				pairTable[position] = open.back();
+				pairTable[open.back()] = position;
+				open.pop_back();
+
+			}
+		}
+	}
+
+	pairTableUpToDate = true;
+
+	return pairTable;
+
+}
+
 /*
 
- int StrandOrdering::checkIDBound( char *id )
+ int StrandOrdering::checkIDBound( int nameId )
 
  */
 
-int StrandOrdering::checkIDBound(char *id) {
+int StrandOrdering::checkIDBound(int nameId) {
 
 	orderingList *traverse = first;
 
-	unsigned int loop;
-	int flag;
 	while (traverse != NULL) {
-		if (strcmp(traverse->thisTag, id) == 0) {
-			flag = 0;
-			for (loop = 0; loop < strlen(traverse->thisStruct) && (flag == 0); loop++)
-				if (traverse->thisStruct[loop] == '.')
-					flag = 1;
-
-			if (flag == 0)
-				return 1;
+		if (traverse->nameId == nameId && traverse->unpaired == 0) {
+			return 1;
 		}
 		traverse = traverse->next;
 	}
@@ -409,7 +608,7 @@ void StrandOrdering::generateFlatSequence(char **sequence, char **structure, cha
 	int cpos = 0;
 	orderingList *traverse = first;
 
-	openInfo.upToDate = false;
+	invalidateExterior();
 
 	for (index = 0; index < count; index++, traverse = traverse->next) {
 		totallength += traverse->size;
@@ -528,69 +727,24 @@ OpenLoop* StrandOrdering::getIndex(JoinCriteria& crit, int site, char **location
 
 			assert(traverse->thisLoop != NULL);
 
-			map<HalfContext, BaseCount>& myTally = traverse->thisLoop->getOpenInfo().tally;
-
-//			if (!myTally.count(crit.half[site])) {
-//
-//				OpenInfo& openInfo = traverse->thisLoop->getOpenInfo();
-//
-//				cout << "printing myTally ************************* \n";
-////				cout << baseCount << "\n";
-//
-//				cout << "site= " << site << "\n";
-//				cout << "crit-half[site]= " << crit.half[site] << "\n";
-//
-//				cout << " *index       = " << *index << "\n";
-//				cout << " OpenInfo     = " << openInfo << " " << std::endl;
-//				cout << "(int) type    = " << (int) type << std::endl;
-//
-//			}
-
-//			assert(openInfo.tally.count(crit.half[site]));
-
-//			assert(myTally.count(crit.half[site]));
-
-//			assert(traverse->thisLoop->getOpenInfo().tally.count(crit.half[site]));
-
-//			BaseCount& baseCount = openInfo.tally.find(crit.half[site])->second;
-
-			//BaseCount& baseCount = traverse->thisLoop->getOpenInfo().tally.find(crit.half[site])->second;
-
-//			if (utility::debugTraces) {
-//
-//				cout << "printing baseCount ************************* \n";
-//				cout << baseCount << "\n";
-//
-//				cout << "site= " << site << "\n";
-//				cout << "crit-half[site]= " << crit.half[site] << "\n";
-//
-//				cout << " *index               = " << *index << "\n";
-//				cout << "baseCount.count[type] = " << baseCount.count[type] << "\n";
-//				cout << "(int) type            = " << (int) type << std::endl;
-//
-//			}
-
-			if (myTally.count(crit.half[site])) { // FD: there is at least one of the correct type in this openLoop
-
-				BaseCount& baseCount = myTally.find(crit.half[site])->second;
-
-				if (*index < baseCount.count[type]) {
+			// contexts that do not occur in this loop hold a zero count.
+			BaseCount& baseCount = traverse->thisLoop->getOpenInfo().tally[crit.half[site].index()];
 
-					if (utility::debugTraces) {
+			if (*index < baseCount.count[type]) {
 
-						cout << traverse->thisLoop->toString() << endl;
+				if (utility::debugTraces) {
 
-					}
+					cout << traverse->thisLoop->toString() << endl;
 
-					*location = traverse->thisLoop->getBase(type, *index, crit.half[site]);
+				}
 
-					return traverse->thisLoop;
+				*location = traverse->thisLoop->getBase(type, *index, crit.half[site]);
 
-				} else {
+				return traverse->thisLoop;
 
-					*index = *index - baseCount.count[type];
+			} else {
 
-				}
+				*index = *index - baseCount.count[type];
 
 			}
 
@@ -608,7 +762,7 @@ OpenLoop* StrandOrdering::getIndex(JoinCriteria& crit, int site, char **location
 
 void StrandOrdering::addOpenLoop(OpenLoop *newLoop, int index) {
 
-	openInfo.upToDate = false;
+	invalidateExterior();
 
 	int cpos, cstrand;
 	orderingList *traverse;
@@ -634,7 +788,9 @@ StrandOrdering *StrandOrdering::breakOrdering(Loop *firstOldBreak, Loop *secondO
 	orderingList *temp = NULL, *temp2 = NULL, *traverse, *extra = NULL;
 	StrandOrdering *newOrdering;
 
-	openInfo.upToDate = false;
+	invalidateExterior();
+	strandKeyUpToDate = false;
+	pairTableUpToDate = false;
 
 	int numitems = 0;
 	for (traverse = first; traverse != NULL; traverse = traverse->next) {
@@ -689,6 +845,7 @@ StrandOrdering *StrandOrdering::breakOrdering(Loop *firstOldBreak, Loop *secondO
 	return newOrdering;
 }
 
+// Builds whichever of seq and struc has been cleared. Base pair moves only clear struc.
 void StrandOrdering::setSeqStruc(void) {
 
 	int totallength = 0, index = 0;
@@ -699,18 +856,26 @@ void StrandOrdering::setSeqStruc(void) {
 	totallength += count - 1;
 	//  printf("Total sequence length w/breaks: %d\n",totallength);
 
+	bool buildSeq = seq.empty();
+	bool buildStruc = struc.empty();
+
+	if (buildSeq)
+		seq.reserve(totallength);
+	if (buildStruc)
+		struc.reserve(totallength);
+
 	for (index = 0, traverse = first; index < count; index++, traverse = traverse->next) {
 
-		seq.append(traverse->thisSeq, traverse->size);
-		struc.append(traverse->thisStruct, traverse->size);
+		if (buildSeq)
+			seq.append(traverse->thisSeq, traverse->size);
+		if (buildStruc)
+			struc.append(traverse->thisStruct, traverse->size);
 
 		if (index != count - 1) {
-			seq.append("+");
-			struc.append("+");
-
-		} else {
-			seq.append("\0");
-			struc.append("\0");
+			if (buildSeq)
+				seq.append("+");
+			if (buildStruc)
+				struc.append("+");
 		}
 	}
 
@@ -768,7 +933,7 @@ Loop *StrandOrdering::getLoop(void) {
 
 void StrandOrdering::replaceOpenLoop(Loop *oldLoop, Loop *newLoop) {
 
-	openInfo.upToDate = false;
+	invalidateExterior();
 
 	orderingList *traverse = NULL;
 	for (traverse = first; traverse != NULL; traverse = traverse->next) {
@@ -784,6 +949,10 @@ void StrandOrdering::replaceOpenLoop(Loop *oldLoop, Loop *newLoop) {
 BaseCount& StrandOrdering::getExteriorBases() {
 	orderingList *traverse = NULL;
 
+	if (exteriorUpToDate) {
+		return exteriorBases;
+	}
+
 	exteriorBases.clear();
 
 	for (traverse = first; traverse != NULL; traverse = traverse->next) {
@@ -796,9 +965,24 @@ BaseCount& StrandOrdering::getExteriorBases() {
 
 	}
 
+	exteriorUpToDate = true;
+
 	return exteriorBases;
 }
 
+long StrandOrdering::getExteriorVersion(void) {
+	return exteriorVersion;
+}
+
+// Called whenever an open loop enters or leaves the ordering.
+void StrandOrdering::invalidateExterior(void) {
+
+	openInfo.upToDate = false;
+	exteriorUpToDate = false;
+	exteriorVersion = ++lastExteriorVersion;
+
+}
+
 OpenInfo& StrandOrdering::getOpenInfo(void) {
 
 	if (openInfo.upToDate) {
@@ -811,9 +995,7 @@ OpenInfo& StrandOrdering::getOpenInfo(void) {
 
 	for (orderingList * traverse = first; traverse != NULL; traverse = traverse->next) {
 
-		OpenInfo info = traverse->thisLoop->getOpenInfo();
-
-		openInfo.increment(info);
+		openInfo.increment(traverse->thisLoop->getOpenInfo());
 
 	}
 
@@ -848,15 +1030,13 @@ string StrandOrdering::toString(void) {
 
 }
 
-void StrandOrdering::addBasepair(char *first_bp, char *second_bp) {
+void StrandOrdering::addBasepair(char *first_bp, char *second_bp, char flip) {
 
 	char *id[2] = { NULL, NULL };
 	char *temp;
 	orderingList *traverse = NULL;
 	int iflag = 0;
 
-	openInfo.upToDate = false;
-
 	for (traverse = first; traverse != NULL; traverse = traverse->next, iflag = 0) {
 		if (((first_bp - traverse->thisCodeSeq) < traverse->size) && ((first_bp - traverse->thisCodeSeq) >= 0)) {
 			if (id[0] == NULL)
@@ -879,29 +1059,34 @@ void StrandOrdering::addBasepair(char *first_bp, char *second_bp) {
 		}
 	}
 	assert(*id[0] == '.' && *id[1] == '.');
-	*id[0] = '(';
-	*id[1] = ')';
+	int left = setStructChar(id[0], '(');
+	int right = setStructChar(id[1], ')');
 
-	seq.clear();
+	if (flipLog != NULL) {
+		recordFlip(id[0], id[1], flip);
+	}
+
+	if (pairTableUpToDate) {
+		pairTable[left] = right;
+		pairTable[right] = left;
+	}
+
+	// the sequence is unchanged.
 	struc.clear();
 
 	return;
 }
 
 //
-void StrandOrdering::breakBasepair(char *first_bp, char *second_bp) {
+void StrandOrdering::breakBasepair(char *first_bp, char *second_bp, char flip) {
 
 	char *id[2] = { NULL, NULL };
 	char *temp = NULL;
 	orderingList *traverse = NULL;
 	int iflag = 0;
 
-	openInfo.upToDate = false;
-
 	for (traverse = first; traverse != NULL; traverse = traverse->next, iflag = 0) {
 
-		traverse->thisLoop->openInfo.upToDate = false;
-
 		if (((first_bp - traverse->thisCodeSeq) < traverse->size) && ((first_bp - traverse->thisCodeSeq) >= 0)) {
 			if (id[0] == NULL)
 				id[0] = &traverse->thisStruct[first_bp - traverse->thisCodeSeq];
@@ -925,10 +1110,19 @@ void StrandOrdering::breakBasepair(char *first_bp, char *second_bp) {
 
 // FD: id points to the characters in thisStruct that will change from ( and ) to . and .
 	assert((*id[0] == '(' && *id[1] == ')'));
-	*id[0] = '.';
-	*id[1] = '.';
+	int left = setStructChar(id[0], '.');
+	int right = setStructChar(id[1], '.');
 
-	seq.clear();
+	if (flipLog != NULL) {
+		recordFlip(id[0], id[1], flip);
+	}
+
+	if (pairTableUpToDate) {
+		pairTable[left] = PAIR_NONE;
+		pairTable[right] = PAIR_NONE;
+	}
+
+	// the sequence is unchanged.
 	struc.clear();
 
 	return;
@@ -0,0 +1,762 @@
+/*
+Copyright (c) 2017 California Institute of Technology. All rights reserved.
+Multistrand nucleic acid kinetic simulator
+help@multistrand.org
+*/
+
+/* multistrand-bench: microbenchmarks of the energy kernels, the move generation
+ of every loop type, base pair deletion, complex joins, whole steps of the
+ simulation and the construction of the energy model, without Python. Built with 'make multistrand-bench'.
+
+ usage: multistrand-bench [--seed N] [--repeats N] [--scale X] [--filter TEXT] [--kernels NAME] [--output FILE]
+
+ The inputs are drawn from a RandomStream keyed by the seed, so that a seed
+ always gives the same sequences, moves and trajectories. Every benchmark runs
+ once to warm up and then --repeats times; --scale multiplies the number of
+ operations of a run. Only the benchmarks whose name contains TEXT are run.
+ --kernels sets the exp and log of the rates (#MathKernels: libm, tabulated or
+ validate), to compare the move generation with and without the tables.
+
+ The results are written as JSON, to standard output if no file is given:
+ for every benchmark the operations of a run, the median, minimum and maximum
+ time of an operation in nanoseconds, and a checksum of what was computed
+ (energies, rates or times) that stays the same between builds as long as the
+ energy model and the inputs do.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "energymodel.h"
+#include "parametercache.h"
+#include "simoptions.h"
+#include "jobfile.h"
+#include "optionlists.h"
+#include "scomplex.h"
+#include "scomplexlist.h"
+#include "loop.h"
+#include "move.h"
+#include "moveutil.h"
+#include "sequtil.h"
+#include "simtimer.h"
+#include "randomstream.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// The settings of the benchmarks; the start state is the one of the simulation
+// steps: a toehold exchange, the invader is free.
+static const char* const benchmarkJob = "#Strands\n"
+		"substrate,GTGGGTACCGCACGTCACTCACCTCG\n"
+		"incumbent,CGAGGTGAGTGACGTGCGGT\n"
+		"invader,CGAGGTGAGTGACGTGCGGTACCCAC\n"
+		"#StartStructure\n"
+		"substrate,incumbent\n"
+		"......((((((((((((((((((((+))))))))))))))))))))\n"
+		"invader\n"
+		"..........................\n"
+		"##\n"
+		"#Temperature=25.0\n"
+		"#Sodium=1.0\n"
+		"#Intra=6.1e7\n" // Options.JSKawasaki25
+		"#Inter=1.29e6\n"
+		"#Verbosity=0\n";
+
+// a strand that folds into every type of loop: stacks, two hairpins, an
+// interior loop, a bulge, a multiloop and the open loop.
+static const char* const loopStructure = "....((((((..((((...((((....)))).))))...((((..((((.....))))))))..))))))....";
+
+struct BenchmarkSettings {
+
+	long seed = 1;
+	int repeats = 7;
+	double scale = 1.0;
+	const char* filter = "";
+	const char* kernels = NULL; // the #MathKernels of the job, if set
+
+};
+
+struct BenchmarkResult {
+
+	string name;
+	long operations; // per run
+	vector<double> times; // ns per operation, one per run
+	double checksum;
+
+};
+
+static BenchmarkSettings settings;
+static vector<BenchmarkResult> results;
+
+static double elapsed(Clock::time_point begin) {
+
+	return std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+
+}
+
+static long operations(long count) {
+
+	return std::max(1L, (long) (count * settings.scale));
+
+}
+
+// run(checksum) does operations operations and returns the nanoseconds they
+// took, so that it can leave out its own set up.
+template<typename Run>
+static void measure(const char* name, long operations, Run run) {
+
+	if (strstr(name, settings.filter) == NULL) {
+		return;
+	}
+
+	BenchmarkResult result;
+	result.name = name;
+	result.operations = operations;
+
+	for (int i = -1; i < settings.repeats; i++) {
+
+		double checksum = 0.0;
+		double time = run(checksum);
+
+		if (i >= 0) {
+			result.times.push_back(time / operations);
+		}
+
+		result.checksum = checksum;
+	}
+
+	results.push_back(result);
+
+}
+
+/* Energy kernels: the loops are drawn at random and closed by Watson-Crick
+ pairs, and every base is between padding, as they are in a strand. */
+
+static char randomBase(RandomStream& random) {
+
+	return (char) (baseA + (int) (random.uniform() * 4));
+
+}
+
+static char complement(char base) {
+
+	return (char) (5 - base);
+
+}
+
+static int randomSize(RandomStream& random, int low, int high) {
+
+	return low + (int) (random.uniform() * (high - low + 1));
+
+}
+
+// appends first, length random unpaired bases and last, and then padding.
+static void appendSide(vector<char>& buffer, RandomStream& random, char first, int length, char last) {
+
+	buffer.push_back(first);
+
+	for (int i = 0; i < length; i++) {
+		buffer.push_back(randomBase(random));
+	}
+
+	buffer.push_back(last);
+	buffer.push_back(baseNone);
+
+}
+
+// the sides of a loop, as offsets into one buffer.
+struct KernelInput {
+
+	vector<int> sides;
+	vector<int> lengths;
+
+};
+
+class KernelInputs {
+public:
+
+	vector<char> buffer;
+	vector<KernelInput> inputs;
+
+	// the sides of input i.
+	vector<char*> sides(int i) {
+
+		vector<char*> pointers;
+
+		for (int offset : inputs[i].sides) {
+			pointers.push_back(&buffer[offset]);
+		}
+
+		return pointers;
+
+	}
+
+};
+
+static const int KERNEL_INPUTS = 256;
+
+static void benchmarkEnergy(EnergyModel* model, RandomStream& random) {
+
+	KernelInputs hairpins, interiors, multiloops, openloops;
+
+	for (int i = 0; i < KERNEL_INPUTS; i++) {
+
+		KernelInput hairpin;
+		char close = randomBase(random);
+		hairpin.lengths.push_back(randomSize(random, 3, 20));
+		hairpins.buffer.push_back(baseNone);
+		hairpin.sides.push_back(hairpins.buffer.size());
+		appendSide(hairpins.buffer, random, close, hairpin.lengths[0], complement(close));
+		hairpins.inputs.push_back(hairpin);
+
+		// seq1 closes with the pair (seq1[0], seq2[size2+1]) and opens the next with (seq1[size1+1], seq2[0]).
+		KernelInput interior;
+		char outer = randomBase(random);
+		char inner = randomBase(random);
+		interior.lengths.push_back(randomSize(random, 1, 6));
+		interior.lengths.push_back(randomSize(random, 1, 6));
+		interiors.buffer.push_back(baseNone);
+		interior.sides.push_back(interiors.buffer.size());
+		appendSide(interiors.buffer, random, outer, interior.lengths[0], inner);
+		interior.sides.push_back(interiors.buffer.size());
+		appendSide(interiors.buffer, random, complement(inner), interior.lengths[1], complement(outer));
+		interiors.inputs.push_back(interior);
+
+		// side k ends with the base that pairs with the first base of side k + 1, cyclically.
+		KernelInput multiloop;
+		vector<char> ends(randomSize(random, 3, 6));
+
+		for (unsigned int k = 0; k < ends.size(); k++) {
+			ends[k] = randomBase(random);
+		}
+
+		for (unsigned int k = 0; k < ends.size(); k++) {
+			multiloop.lengths.push_back(randomSize(random, 0, 6));
+			multiloops.buffer.push_back(baseNone);
+			multiloop.sides.push_back(multiloops.buffer.size());
+			appendSide(multiloops.buffer, random, complement(ends[(k + ends.size() - 1) % ends.size()]), multiloop.lengths[k], ends[k]);
+		}
+
+		multiloops.inputs.push_back(multiloop);
+
+		// as a multiloop, with the ends of the strand on the first and last side.
+		KernelInput openloop;
+		ends.resize(randomSize(random, 1, 4));
+
+		for (unsigned int k = 0; k < ends.size(); k++) {
+			ends[k] = randomBase(random);
+		}
+
+		for (unsigned int k = 0; k <= ends.size(); k++) {
+			openloop.lengths.push_back(randomSize(random, 0, 6));
+			openloops.buffer.push_back(baseNone);
+			openloop.sides.push_back(openloops.buffer.size());
+			appendSide(openloops.buffer, random, (k > 0) ? complement(ends[k - 1]) : (char) baseNone, openloop.lengths[k],
+					(k < ends.size()) ? ends[k] : (char) baseNone);
+		}
+
+		openloops.inputs.push_back(openloop);
+	}
+
+	long rounds = operations(2000);
+
+	measure("energy/HairpinEnergy", rounds * KERNEL_INPUTS, [&](double& checksum) {
+
+		vector<char*> seq;
+		for (int i = 0; i < KERNEL_INPUTS; i++) {
+			seq.push_back(hairpins.sides(i)[0]);
+		}
+
+		Clock::time_point begin = Clock::now();
+		for (long r = 0; r < rounds; r++) {
+			for (int i = 0; i < KERNEL_INPUTS; i++) {
+				checksum += model->HairpinEnergy(seq[i], hairpins.inputs[i].lengths[0]);
+			}
+		}
+		return elapsed(begin);
+
+	});
+
+	measure("energy/InteriorEnergy", rounds * KERNEL_INPUTS, [&](double& checksum) {
+
+		vector<vector<char*> > seq;
+		for (int i = 0; i < KERNEL_INPUTS; i++) {
+			seq.push_back(interiors.sides(i));
+		}
+
+		Clock::time_point begin = Clock::now();
+		for (long r = 0; r < rounds; r++) {
+			for (int i = 0; i < KERNEL_INPUTS; i++) {
+				vector<int>& lengths = interiors.inputs[i].lengths;
+				checksum += model->InteriorEnergy(seq[i][0], seq[i][1], lengths[0], lengths[1]);
+			}
+		}
+		return elapsed(begin);
+
+	});
+
+	measure("energy/MultiloopEnergy", rounds * KERNEL_INPUTS, [&](double& checksum) {
+
+		vector<vector<char*> > seq;
+		for (int i = 0; i < KERNEL_INPUTS; i++) {
+			seq.push_back(multiloops.sides(i));
+		}
+
+		Clock::time_point begin = Clock::now();
+		for (long r = 0; r < rounds; r++) {
+			for (int i = 0; i < KERNEL_INPUTS; i++) {
+				vector<int>& lengths = multiloops.inputs[i].lengths;
+				checksum += model->MultiloopEnergy(lengths.size(), &lengths[0], &seq[i][0]);
+			}
+		}
+		return elapsed(begin);
+
+	});
+
+	measure("energy/OpenloopEnergy", rounds * KERNEL_INPUTS, [&](double& checksum) {
+
+		vector<vector<char*> > seq;
+		for (int i = 0; i < KERNEL_INPUTS; i++) {
+			seq.push_back(openloops.sides(i));
+		}
+
+		Clock::time_point begin = Clock::now();
+		for (long r = 0; r < rounds; r++) {
+			for (int i = 0; i < KERNEL_INPUTS; i++) {
+				vector<int>& lengths = openloops.inputs[i].lengths;
+				checksum += model->OpenloopEnergy(lengths.size() - 1, &lengths[0], &seq[i][0]);
+			}
+		}
+		return elapsed(begin);
+
+	});
+
+}
+
+/* Complexes: built as SimulationSystem::InitializeSystem builds them, and
+ taken apart as SComplexList does. */
+
+static string randomSequence(RandomStream& random, const char* structure) {
+
+	static const char letters[] = "NACGT";
+	string sequence(strlen(structure), 'N');
+	vector<int> open;
+
+	for (unsigned int i = 0; i < sequence.size(); i++) {
+
+		if (structure[i] == ')') {
+			sequence[i] = letters[(int) complement(baseLookup(sequence[open.back()]))];
+			open.pop_back();
+		} else {
+			sequence[i] = letters[(int) randomBase(random)];
+		}
+
+		if (structure[i] == '(') {
+			open.push_back(i);
+		}
+	}
+
+	return sequence;
+
+}
+
+// a complex of one strand; the strand ordering takes the identList.
+static StrandComplex* newComplex(const string& sequence, const string& structure, long uid, const char* name) {
+
+	StrandComplex* complex = new StrandComplex((char*) sequence.c_str(), (char*) structure.c_str(), new identList(uid, (char*) name));
+
+	complex->generateLoops();
+	complex->generateMoves();
+
+	return complex;
+
+}
+
+static void deleteComplex(StrandComplex* complex) {
+
+	complex->cleanup();
+	delete complex;
+
+}
+
+// the loops of the given type, from the loop walk of the simulator.
+static vector<Loop*> loopsOf(StrandComplex* complex, char type) {
+
+	LoopList all;
+	vector<Loop*> loops;
+
+	complex->getLoops(all);
+
+	for (Loop* loop : all) {
+		if (loop->getType() == type) {
+			loops.push_back(loop);
+		}
+	}
+
+	return loops;
+
+}
+
+static void benchmarkMoves(SimOptions* options, RandomStream& random) {
+
+	string structure = loopStructure;
+	string sequence = randomSequence(random, loopStructure);
+	StrandComplex* complex = newComplex(sequence, structure, 0, "loops");
+
+	static const char types[] = { 'S', 'H', 'B', 'I', 'M', 'O' };
+	static const char* const names[] = { "moves/StackLoop::generateMoves", "moves/HairpinLoop::generateMoves", "moves/BulgeLoop::generateMoves",
+			"moves/InteriorLoop::generateMoves", "moves/MultiLoop::generateMoves", "moves/OpenLoop::generateMoves" };
+
+	for (int t = 0; t < 6; t++) {
+
+		vector<Loop*> loops = loopsOf(complex, types[t]);
+		long rounds = operations(types[t] == 'S' ? 2000 : 20000);
+
+		measure(names[t], rounds * loops.size(), [&](double& checksum) {
+
+			Clock::time_point begin = Clock::now();
+			for (long r = 0; r < rounds; r++) {
+				for (Loop* loop : loops) {
+					loop->generateMoves();
+					checksum += loop->getTotalRate();
+				}
+			}
+			return elapsed(begin);
+
+		});
+	}
+
+	deleteComplex(complex);
+
+	// a stack of a fresh copy of the strand, and one of its delete moves, are drawn for every operation.
+	long count = operations(2000);
+
+	measure("moves/Loop::performDeleteMove", count, [&](double& checksum) {
+
+		RandomStream draws;
+		SimTimer timer(*options, draws);
+		draws.setSeed(settings.seed);
+		double time = 0.0;
+
+		for (long i = 0; i < count; i++) {
+
+			StrandComplex* complex = newComplex(sequence, structure, 0, "loops");
+			vector<Loop*> stacks;
+
+			for (Loop* loop : loopsOf(complex, 'S')) {
+				if (loop->getTotalRate() > 0.0) {
+					stacks.push_back(loop);
+				}
+			}
+
+			Loop* stack = stacks[(int) (draws.uniform() * stacks.size())];
+			timer.rchoice = draws.uniform() * stack->getTotalRate();
+			Move* move = stack->getLocalChoice(timer);
+
+			// through StrandComplex::doChoice, which also updates the strand ordering.
+			Clock::time_point begin = Clock::now();
+			complex->doChoice(move);
+			time += elapsed(begin);
+
+			checksum += complex->getEnergy();
+			deleteComplex(complex);
+		}
+
+		return time;
+
+	});
+
+	// joins a fresh pair of unstructured strands at random complementary bases.
+	string first = randomSequence(random, string(30, '.').c_str());
+	string second = randomSequence(random, string(30, '.').c_str());
+	string unpaired(30, '.');
+
+	measure("moves/StrandComplex::performComplexJoin", count, [&](double& checksum) {
+
+		RandomStream draws;
+		draws.setSeed(settings.seed);
+		double time = 0.0;
+
+		for (long i = 0; i < count; i++) {
+
+			JoinCriteria crit;
+			crit.complexes[0] = newComplex(first, unpaired, 1, "first");
+			crit.complexes[1] = newComplex(second, unpaired, 2, "second");
+
+			BaseCount& firstBases = crit.complexes[0]->getExteriorBases();
+			BaseCount& secondBases = crit.complexes[1]->getExteriorBases();
+			int base;
+
+			do {
+				base = randomBase(draws);
+			} while (firstBases.count[(int) complement(base)] == 0 || secondBases.count[base] == 0);
+
+			crit.types[0] = complement(base);
+			crit.types[1] = base;
+			crit.index[0] = (int) (draws.uniform() * firstBases.count[(int) complement(base)]);
+			crit.index[1] = (int) (draws.uniform() * secondBases.count[base]);
+
+			Clock::time_point begin = Clock::now();
+			StrandComplex* deleted = StrandComplex::performComplexJoin(crit, false);
+			time += elapsed(begin);
+
+			checksum += crit.complexes[0]->getEnergy();
+			delete deleted;
+			deleteComplex(crit.complexes[0]);
+		}
+
+		return time;
+
+	});
+
+}
+
+// steps of SimulationSystem::SimulationLoop_Standard, from the start state of the
+// job, a three-way branch migration, or from its substrate and invader apart, which
+// hybridize.
+static void benchmarkSteps(SimOptions* options, EnergyModel* model, const char* name, bool hybridization) {
+
+	long steps = operations(50000);
+
+	measure(name, steps, [&](double& checksum) {
+
+		RandomStream random;
+		random.setSeed(settings.seed);
+		SimTimer timer(*options, random);
+
+		SComplexList* complexList = new SComplexList(model);
+
+		if (hybridization) {
+
+			string substrate = "GTGGGTACCGCACGTCACTCACCTCG", invader = "CGAGGTGAGTGACGTGCGGTACCCAC";
+			string unpaired(26, '.');
+
+			complexList->addComplex(new StrandComplex((char*) substrate.c_str(), (char*) unpaired.c_str(), new identList(1, (char*) "substrate")));
+			complexList->addComplex(new StrandComplex((char*) invader.c_str(), (char*) unpaired.c_str(), new identList(2, (char*) "invader")));
+
+		} else {
+
+			options->generateComplexes(NULL, settings.seed);
+
+			for (unsigned int i = 0; i < options->myComplexes->size(); i++) {
+				complex_input& input = options->myComplexes->at(i);
+				complexList->addComplex(new StrandComplex((char*) input.sequence.c_str(), (char*) input.structure.c_str(), input.list));
+			}
+		}
+
+		Clock::time_point begin = Clock::now();
+
+		complexList->initializeList();
+		timer.rate = complexList->getTotalFlux();
+
+		for (long i = 0; i < steps; i++) {
+			timer.advanceTime();
+			complexList->doBasicChoice(timer);
+			timer.rate = complexList->getTotalFlux();
+		}
+
+		double time = elapsed(begin);
+
+		checksum = timer.stime + complexList->getCount();
+		delete complexList;
+
+		return time;
+
+	});
+
+}
+
+/* Construction of the energy model: reading the parameter files, from the tables
+ this process kept, and from a parameter cache file, as the first model of a new
+ process would. The checksum is the energy of random stacks in the models built. */
+
+static void removeDirectory(const string& directory) {
+
+	DIR* dir = opendir(directory.c_str());
+
+	if (dir != NULL) {
+
+		struct dirent* entry;
+
+		while ((entry = readdir(dir)) != NULL) {
+			if (entry->d_name[0] != '.') {
+				remove((directory + "/" + entry->d_name).c_str());
+			}
+		}
+
+		closedir(dir);
+	}
+
+	rmdir(directory.c_str());
+
+}
+
+static void benchmarkStartup(SimOptions* options, RandomStream& random) {
+
+	long count = operations(20);
+	char pairs[16][4];
+
+	for (int i = 0; i < 16; i++) {
+		pairs[i][0] = randomBase(random);
+		pairs[i][1] = complement(pairs[i][0]);
+		pairs[i][2] = randomBase(random);
+		pairs[i][3] = complement(pairs[i][2]);
+	}
+
+	char directoryName[] = "/tmp/multistrand-bench-XXXXXX";
+	string directory = (mkdtemp(directoryName) != NULL) ? directoryName : "";
+	string parameterCache = options->parameterCache;
+
+	// mode 0: parsed, 1: kept by the process, 2: mapped from the file
+	auto construct = [&](int mode, double& checksum) {
+
+		options->parameterCache = (mode == 2) ? directory : "";
+		double time = 0.0;
+
+		for (long i = 0; i < count; i++) {
+
+			if (mode != 1) {
+				ParameterCache::clear();
+			}
+
+			Clock::time_point begin = Clock::now();
+			EnergyModel* energyModel = NupackEnergyModel::create(options);
+			time += elapsed(begin);
+
+			for (int p = 0; p < 16; p++) {
+				checksum += energyModel->StackEnergy(pairs[p][0], pairs[p][1], pairs[p][2], pairs[p][3]);
+			}
+
+			delete energyModel;
+		}
+
+		return time;
+
+	};
+
+	measure("startup/NupackEnergyModel (parsed)", count, [&](double& checksum) {
+		return construct(0, checksum);
+	});
+
+	measure("startup/NupackEnergyModel (cached)", count, [&](double& checksum) {
+		return construct(1, checksum);
+	});
+
+	if (!directory.empty()) {
+
+		measure("startup/NupackEnergyModel (mapped)", count, [&](double& checksum) {
+			return construct(2, checksum);
+		});
+
+		removeDirectory(directory);
+	}
+
+	options->parameterCache = parameterCache;
+
+}
+
+static void writeResults(FILE* output) {
+
+	fprintf(output, "{\n  \"seed\": %ld,\n  \"repeats\": %d,\n  \"scale\": %.17g,\n  \"benchmarks\": [", settings.seed, settings.repeats, settings.scale);
+
+	for (unsigned int i = 0; i < results.size(); i++) {
+
+		BenchmarkResult& result = results[i];
+		vector<double> times = result.times;
+		std::sort(times.begin(), times.end());
+
+		fprintf(output, "%s\n    {\"name\": \"%s\", \"operations\": %ld, \"median_ns\": %.6g, \"min_ns\": %.6g, \"max_ns\": %.6g, \"checksum\": %.17g}",
+				(i > 0) ? "," : "", result.name.c_str(), result.operations, times[times.size() / 2], times.front(), times.back(), result.checksum);
+	}
+
+	fprintf(output, "\n  ]\n}\n");
+
+}
+
+static int usage(const char* program) {
+
+	fprintf(stderr, "usage: %s [--seed N] [--repeats N] [--scale X] [--filter TEXT] [--kernels NAME] [--output FILE]\n", program);
+	return 2;
+
+}
+
+int main(int argc, char **argv) {
+
+	const char* outputPath = NULL;
+
+	for (int i = 1; i < argc; i++) {
+
+		bool value = i + 1 < argc;
+
+		if (strcmp(argv[i], "--seed") == 0 && value) {
+			settings.seed = atol(argv[++i]);
+		} else if (strcmp(argv[i], "--repeats") == 0 && value) {
+			settings.repeats = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--scale") == 0 && value) {
+			settings.scale = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--filter") == 0 && value) {
+			settings.filter = argv[++i];
+		} else if (strcmp(argv[i], "--kernels") == 0 && value) {
+			settings.kernels = argv[++i];
+		} else if ((strcmp(argv[i], "--output") == 0 || strcmp(argv[i], "-o") == 0) && value) {
+			outputPath = argv[++i];
+		} else {
+			return usage(argv[0]);
+		}
+	}
+
+	if (settings.repeats < 1 || settings.scale <= 0.0) {
+		return usage(argv[0]);
+	}
+
+	string jobText = benchmarkJob;
+
+	if (settings.kernels != NULL) {
+		jobText += string("#MathKernels=") + settings.kernels + "\n";
+	}
+
+	std::istringstream text(jobText);
+	JobFile job(text, "benchmarks");
+	FILE* discard = fopen("/dev/null", "w");
+	CSimOptions* options = new CSimOptions(&job, discard);
+
+	if (!job.error.empty()) {
+		fprintf(stderr, "%s", job.error.c_str());
+		return 1;
+	}
+
+	EnergyModel* model = NupackEnergyModel::create(options);
+	Loop::SetEnergyModel(model);
+
+	RandomStream random;
+	random.setSeed(settings.seed);
+
+	benchmarkEnergy(model, random);
+	benchmarkMoves(options, random);
+	benchmarkSteps(options, model, "steps/SComplexList::doBasicChoice", false);
+	benchmarkSteps(options, model, "steps/SComplexList::doBasicChoice (hybridization)", true);
+	benchmarkStartup(options, random);
+
+	FILE* output = stdout;
+
+	if (outputPath != NULL && (output = fopen(outputPath, "w")) == NULL) {
+		fprintf(stderr, "Could not open the result file %s\n", outputPath);
+		return 1;
+	}
+
+	writeResults(output);
+
+	if (output != stdout) {
+		fclose(output);
+	}
+
+	return 0;
+
+}
@@ -13,6 +13,7 @@ help@multistrand.org
 #include "energyoptions.h"
 #include "moveutil.h"
 #include "sequtil.h"
+#include "jobfile.h"
 
 #include <vector>
 #include <iostream>
@@ -110,6 +111,47 @@ string EnergyOptions::toString(void) {
 
 }
 
+// The warnings go to stderr: multistrand-sim writes its results to stdout.
+void EnergyOptions::checkSettings(void) {
+
+	if(!usingArrhenius() && biScale < 0.0){
+		cerr << "Warning! bimolecular_scaling is unset or negative!" << endl;
+		cerr <<	"Please set them using multistrand::utils::XPMetropolis37() or similar,"<< endl;
+		cerr <<	"or set Options.bimolecular_scaling directly."<< endl;
+		cerr << "Reverting to bimolecular_scaling = 5.0e6"<< endl;
+
+		biScale = 1400000.0;
+
+	}
+
+	if(!usingArrhenius() && uniScale < 0.0){
+		cerr << "Warning! unimolecular_scaling is unset or negative!"<< endl;
+		cerr <<	"Please set them using multistrand::utils::XPMetropolis37() or similar,"<< endl;
+		cerr <<	"or set Options.bimolecular_scaling directly."<< endl;
+		cerr << "Reverting to unimolecular_scaling = 5.0e6"<< endl;
+
+		uniScale = 5000000.0;
+
+	}
+
+	if (magnesium < 0.00 || magnesium > 0.2) {
+
+		cerr << "Magnesium concentration (" << magnesium << " M) is out of bounds (0.0 M - 0.2 M). Setting Na+/Mg2+ to 1.0 M / 0.0 M" << endl;
+		sodium = 1.0;
+		magnesium = 0.0;
+
+	}
+
+	if (sodium < 0.01 || sodium > 1.3) {
+
+		cerr << "Sodium concentration (" << sodium << " M) is out of bounds (0.01 M - 1.3 M). Setting Na+/Mg2+ to 1.0 M / 0.0 M" << endl;
+		sodium = 1.0;
+		magnesium = 0.0;
+
+	}
+
+}
+
 PEnergyOptions::PEnergyOptions(PyObject* input) :
 		EnergyOptions() {
 
@@ -128,27 +170,6 @@ PEnergyOptions::PEnergyOptions(PyObject* input) :
 
 	getDoubleAttr(python_settings, join_concentration, &joinConcentration);
 
-
-	if(!usingArrhenius() && biScale < 0.0){
-		cout << "Warning! bimolecular_scaling is unset or negative!" << endl;
-		cout <<	"Please set them using multistrand::utils::XPMetropolis37() or similar,"<< endl;
-		cout <<	"or set Options.bimolecular_scaling directly."<< endl;
-		cout << "Reverting to bimolecular_scaling = 5.0e6"<< endl;
-
-		biScale = 1400000.0;
-
-	}
-
-	if(!usingArrhenius() && uniScale < 0.0){
-		cout << "Warning! unimolecular_scaling is unset or negative!"<< endl;
-		cout <<	"Please set them using multistrand::utils::XPMetropolis37() or similar,"<< endl;
-		cout <<	"or set Options.bimolecular_scaling directly."<< endl;
-		cout << "Reverting to unimolecular_scaling = 5.0e6"<< endl;
-
-		uniScale = 5000000.0;
-
-	}
-
 	if (usingArrhenius()){
 
 		uniScale = 1.0;
@@ -206,21 +227,7 @@ PEnergyOptions::PEnergyOptions(PyObject* input) :
 	getDoubleAttr(python_settings, sodium, &sodium);
 	getDoubleAttr(python_settings, magnesium, &magnesium);
 
-	if (magnesium < 0.00 || magnesium > 0.2) {
-
-		cout << "Magnesium concentration (" << magnesium << " M) is out of bounds (0.0 M - 0.2 M). Setting Na+/Mg2+ to 1.0 M / 0.0 M" << endl;
-		sodium = 1.0;
-		magnesium = 0.0;
-
-	}
-
-	if (sodium < 0.01 || sodium > 1.3) {
-
-		cout << "Sodium concentration (" << sodium << " M) is out of bounds (0.01 M - 1.3 M). Setting Na+/Mg2+ to 1.0 M / 0.0 M" << endl;
-		sodium = 1.0;
-		magnesium = 0.0;
-
-	}
+	checkSettings();
 
 }
 
@@ -238,28 +245,94 @@ void PEnergyOptions::getParameterFile(char* input, PyObject* tempString) {
 
 // CENERGYOPTIONS
 
-CEnergyOptions::CEnergyOptions() :
+CEnergyOptions::CEnergyOptions(JobFile* job) :
 		EnergyOptions() {
 
-// extended constructor, inherits from regular energyOptions
+// the defaults of the Python options
 
-// some basic default values;
 	temperature = 310.15;
-	dangles = 1;
+	dangles = DANGLES_SOME;
 	logml = 0;
-	gtenable = 1;
-	kinetic_rate_method = 1;
+	gtenable = true;
+	kinetic_rate_method = RATE_METHOD_KAWASAKI;
+	substrate_type = SUBSTRATE_DNA;
+
+	biScale = -1.0;
+	uniScale = -1.0;
+
+	joinConcentration = 1.0;
+
+	// Celsius between 0 and 100, as Options.temperature.
+	double celsius = -1.0;
+	job->getDouble("Temperature", &celsius);
+
+	if (celsius >= 0.0 && celsius <= 100.0) {
+		temperature = celsius + 273.15;
+	} else if (celsius >= 0.0) {
+		temperature = celsius;
+	}
+
+	static const char* const dangleNames[] = { "None", "Some", "All" };
+	static const long dangleValues[] = { DANGLES_NONE, DANGLES_SOME, DANGLES_ALL };
+	job->getChoice("Dangles", dangleNames, dangleValues, 3, &dangles);
+
+	static const char* const rateNames[] = { "Metropolis", "Kawasaki", "Arrhenius" };
+	static const long rateValues[] = { RATE_METHOD_METROPOLIS, RATE_METHOD_KAWASAKI, RATE_METHOD_ARRHENIUS };
+	job->getChoice("Ratemethod", rateNames, rateValues, 3, &kinetic_rate_method);
+
+	static const char* const substrateNames[] = { "DNA", "RNA", "NUPACK_DNA_2_3", "NUPACK_RNA_2_3" };
+	static const long substrateValues[] = { SUBSTRATE_DNA, SUBSTRATE_RNA, SUBSTRATE_DNA, SUBSTRATE_RNA };
+	job->getChoice("Energymodel", substrateNames, substrateValues, 4, &substrate_type);
+
+	job->getLong("LogML", &logml);
+	job->getBool("GTenable", &gtenable);
+
+	job->getDouble("Inter", &biScale);
+	job->getDouble("Intra", &uniScale);
+	job->getDouble("JoinConcentration", &joinConcentration);
+
+	if (usingArrhenius()) {
+
+		uniScale = 1.0;
+
+		for (int i = 0; i < MOVETYPE_SIZE; i++) {
+
+			job->getDouble(("lnA" + moveutil::MoveToString[i]).c_str(), &AValues[i]);
+			job->getDouble(("E" + moveutil::MoveToString[i]).c_str(), &EValues[i]);
+
+		}
+
+		AEnd = AValues[endMove];
+		ALoop = AValues[loopMove];
+		AStack = AValues[stackMove];
+		AStackStack = AValues[stackStackMove];
+		ALoopEnd = AValues[loopEndMove];
+		AStackEnd = AValues[stackEndMove];
+		AStackLoop = AValues[stackLoopMove];
+
+		EEnd = EValues[endMove];
+		ELoop = EValues[loopMove];
+		EStack = EValues[stackMove];
+		EStackStack = EValues[stackStackMove];
+		ELoopEnd = EValues[loopEndMove];
+		EStackEnd = EValues[stackEndMove];
+		EStackLoop = EValues[stackLoopMove];
+
+		job->getDouble("dSA", &dSA);
+		job->getDouble("dHA", &dHA);
+
+	}
 
-	biScale = 1.38e+06;
-	uniScale = 1.5e+08;
+	job->getDouble("Sodium", &sodium);
+	job->getDouble("Magnesium", &magnesium);
 
-	joinConcentration = 1e-06;
+	checkSettings();
 
 }
 
 bool CEnergyOptions::compareSubstrateType(long type) {
 
-	return (SUBSTRATE_DNA == type); // only test TRUE for when substrate is DNA.
+	return (substrate_type == type);
 
 }
 
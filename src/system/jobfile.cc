@@ -0,0 +1,446 @@
+/*
+ Copyright (c) 2017 California Institute of Technology. All rights reserved.
+ Multistrand nucleic acid kinetic simulator
+ help@multistrand.org
+ */
+
+#include "jobfile.h"
+#include "optionlists.h"
+
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cctype>
+
+enum JobSection {
+	SECTION_NONE, SECTION_STRANDS, SECTION_START, SECTION_STOP
+};
+
+// the lines of a complex, kept until all strands are known.
+struct JobLines {
+
+	string names;
+	string structure;
+	int lineNumber;
+	int condition; // the stop condition, -1 for the start state
+
+};
+
+static string trim(const string& text) {
+
+	size_t begin = text.find_first_not_of(" \t\r\n");
+
+	if (begin == string::npos) {
+		return string("");
+	}
+
+	size_t end = text.find_last_not_of(" \t\r\n");
+
+	return text.substr(begin, end - begin + 1);
+
+}
+
+static string lowerCase(const string& text) {
+
+	string output = text;
+
+	for (unsigned int i = 0; i < output.size(); i++) {
+		output[i] = tolower(output[i]);
+	}
+
+	return output;
+
+}
+
+JobFile::JobFile(const string& path) :
+		path(path) {
+
+	std::ifstream input(path.c_str());
+
+	if (!input) {
+		error = "Could not open the job file " + path + "\n";
+		return;
+	}
+
+	read(input);
+
+}
+
+JobFile::JobFile(std::istream& input, const string& name) :
+		path(name) {
+
+	read(input);
+
+}
+
+void JobFile::read(std::istream& input) {
+
+	JobSection section = SECTION_NONE;
+	vector<JobLines> complexes;
+	JobLines current;
+	bool haveNames = false;
+
+	string line;
+	int lineNumber = 0;
+
+	while (std::getline(input, line)) {
+
+		lineNumber++;
+		line = trim(line);
+
+		if (line.empty()) {
+			continue;
+		}
+
+		if (line[0] == '#') {
+
+			if (haveNames) {
+				addError(current.lineNumber, "the complex has no structure");
+				haveNames = false;
+			}
+
+			if (section == SECTION_STOP && !complexes.empty() && complexes.back().condition == (int) stopConditions.size()) {
+				addError(complexes.back().lineNumber, "the stop condition has no tag");
+				stopConditions.push_back(JobStopCondition());
+			}
+
+			string key = trim(line.substr(1));
+			string lower = lowerCase(key);
+			size_t equals = key.find('=');
+
+			section = SECTION_NONE;
+
+			if (lower == "strands") {
+				section = SECTION_STRANDS;
+			} else if (lower == "startstructure") {
+				section = SECTION_START;
+			} else if (lower == "stopstructures") {
+				section = SECTION_STOP;
+			} else if (equals != string::npos) {
+				settings[trim(lower.substr(0, equals))] = trim(key.substr(equals + 1));
+			} else if (!key.empty() && key[0] != '#') {
+				addError(lineNumber, "unknown section #" + key);
+			}
+
+			continue;
+		}
+
+		if (section == SECTION_STRANDS) {
+
+			size_t comma = line.find(',');
+
+			if (comma == string::npos) {
+				addError(lineNumber, "expected name,sequence");
+				continue;
+			}
+
+			JobStrand strand;
+			strand.name = trim(line.substr(0, comma));
+			strand.sequence = trim(line.substr(comma + 1));
+			strands.push_back(strand);
+
+		} else if (section == SECTION_STOP && line.compare(0, 4, "TAG:") == 0) {
+
+			if (haveNames || complexes.empty() || complexes.back().condition != (int) stopConditions.size()) {
+				addError(lineNumber, "the stop condition has no complexes");
+				haveNames = false;
+			}
+
+			JobStopCondition condition;
+			condition.tag = trim(line.substr(4));
+			stopConditions.push_back(condition);
+
+		} else if (section == SECTION_START || section == SECTION_STOP) {
+
+			if (!haveNames) {
+				current.names = line;
+				current.lineNumber = lineNumber;
+				current.condition = (section == SECTION_START) ? -1 : (int) stopConditions.size();
+				haveNames = true;
+			} else {
+				current.structure = line;
+				complexes.push_back(current);
+				haveNames = false;
+			}
+
+		} else {
+
+			addError(lineNumber, "the line is not in a section");
+
+		}
+	}
+
+	if (haveNames) {
+		addError(current.lineNumber, "the complex has no structure");
+	}
+
+	if (!complexes.empty() && complexes.back().condition == (int) stopConditions.size()) {
+		addError(complexes.back().lineNumber, "the stop condition has no tag");
+		stopConditions.push_back(JobStopCondition());
+	}
+
+	for (unsigned int i = 0; i < complexes.size(); i++) {
+
+		JobLines& lines = complexes[i];
+		JobComplex complex;
+
+		if (!readComplex(lines.names, lines.structure, lines.lineNumber, complex, lines.condition >= 0)) {
+			continue;
+		}
+
+		if (lines.condition < 0) {
+			startState.push_back(complex);
+		} else {
+			stopConditions[lines.condition].complexes.push_back(complex);
+		}
+	}
+
+	if (strands.empty()) {
+		addError(0, "no strands are given (#Strands)");
+	}
+
+	if (startState.empty() && error.empty()) {
+		addError(0, "no start state is given (#StartStructure)");
+	}
+
+}
+
+// Looks up the strands and checks that the structure fits them.
+bool JobFile::readComplex(const string& names, const string& structureLine, int lineNumber, JobComplex& complex, bool stopComplex) {
+
+	std::stringstream nameStream(names);
+	string name;
+
+	while (std::getline(nameStream, name, ',')) {
+
+		name = trim(name);
+		int index = -1;
+
+		for (unsigned int i = 0; i < strands.size() && index < 0; i++) {
+			if (strands[i].name == name) {
+				index = i;
+			}
+		}
+
+		if (index < 0) {
+			addError(lineNumber, "unknown strand " + name);
+			return false;
+		}
+
+		complex.strands.push_back(index);
+	}
+
+	std::stringstream structureStream(structureLine);
+	string type;
+
+	structureStream >> complex.structure;
+
+	if (structureStream >> type) {
+
+		static const char* const typeNames[] = { "exact", "bound", "dissoc", "loose", "count" };
+		static const long typeValues[] = { STOPTYPE_STRUCTURE, STOPTYPE_BOUND, STOPTYPE_DISASSOC, STOPTYPE_LOOSE_STRUCTURE,
+				STOPTYPE_PERCENT_OR_COUNT_STRUCTURE };
+
+		complex.type = -1;
+
+		for (int i = 0; i < 5; i++) {
+			if (lowerCase(type) == typeNames[i]) {
+				complex.type = typeValues[i];
+			}
+		}
+
+		if (!stopComplex || complex.type < 0) {
+			addError(lineNumber + 1, "unexpected " + type + " after the structure");
+			return false;
+		}
+
+		if (structureStream >> complex.count) {
+		} else if (complex.type == STOPTYPE_LOOSE_STRUCTURE || complex.type == STOPTYPE_PERCENT_OR_COUNT_STRUCTURE) {
+			addError(lineNumber + 1, "the " + type + " stop type needs a count");
+			return false;
+		}
+	}
+
+	// one part per strand, of the length of its sequence
+	std::stringstream parts(complex.structure);
+	string part;
+	unsigned int strand = 0;
+	bool fits = true;
+
+	while (std::getline(parts, part, '+')) {
+
+		if (strand >= complex.strands.size() || part.size() != strands[complex.strands[strand]].sequence.size()) {
+			fits = false;
+		}
+
+		strand++;
+	}
+
+	if (!fits || strand != complex.strands.size() || complex.structure[complex.structure.size() - 1] == '+') {
+		addError(lineNumber + 1, "the structure does not match the strands " + names);
+		return false;
+	}
+
+	return true;
+
+}
+
+void JobFile::addError(int lineNumber, const string& message) {
+
+	std::stringstream ss;
+
+	ss << path;
+
+	if (lineNumber > 0) {
+		ss << ":" << lineNumber;
+	}
+
+	ss << ": " << message << "\n";
+
+	error += ss.str();
+
+}
+
+const string* JobFile::find(const char* key) {
+
+	string lower = lowerCase(string(key));
+	std::map<string, string>::iterator it = settings.find(lower);
+
+	if (it == settings.end()) {
+		return NULL;
+	}
+
+	used[lower] = true;
+
+	return &it->second;
+
+}
+
+bool JobFile::has(const char* key) {
+
+	return find(key) != NULL;
+
+}
+
+void JobFile::getString(const char* key, string& value) {
+
+	const string* text = find(key);
+
+	if (text != NULL) {
+		value = *text;
+	}
+
+}
+
+void JobFile::getDouble(const char* key, double* value) {
+
+	const string* text = find(key);
+
+	if (text == NULL) {
+		return;
+	}
+
+	char* end = NULL;
+	double number = strtod(text->c_str(), &end);
+
+	if (text->empty() || *end != '\0') {
+		addError(0, "#" + string(key) + " is not a number: " + *text);
+		return;
+	}
+
+	*value = number;
+
+}
+
+void JobFile::getLong(const char* key, long* value) {
+
+	const string* text = find(key);
+
+	if (text == NULL) {
+		return;
+	}
+
+	char* end = NULL;
+	long number = strtol(text->c_str(), &end, 10);
+
+	if (text->empty() || *end != '\0') {
+		addError(0, "#" + string(key) + " is not an integer: " + *text);
+		return;
+	}
+
+	*value = number;
+
+}
+
+void JobFile::getBool(const char* key, bool* value) {
+
+	const string* text = find(key);
+
+	if (text == NULL) {
+		return;
+	}
+
+	string lower = lowerCase(*text);
+
+	if (lower == "1" || lower == "true" || lower == "yes") {
+		*value = true;
+	} else if (lower == "0" || lower == "false" || lower == "no") {
+		*value = false;
+	} else {
+		addError(0, "#" + string(key) + " is not true or false: " + *text);
+	}
+
+}
+
+void JobFile::getChoice(const char* key, const char* const names[], const long values[], int count, long* value) {
+
+	const string* text = find(key);
+
+	if (text == NULL) {
+		return;
+	}
+
+	string lower = lowerCase(*text);
+
+	for (int i = 0; i < count; i++) {
+
+		if (lower == lowerCase(string(names[i]))) {
+			*value = values[i];
+			return;
+		}
+	}
+
+	char* end = NULL;
+	long number = strtol(text->c_str(), &end, 10);
+
+	if (text->empty() || *end != '\0') {
+
+		string expected;
+
+		for (int i = 0; i < count; i++) {
+			expected += (i > 0) ? ", " : "";
+			expected += names[i];
+		}
+
+		addError(0, "#" + string(key) + " is not one of " + expected + ": " + *text);
+		return;
+	}
+
+	*value = number;
+
+}
+
+vector<string> JobFile::unusedSettings(void) {
+
+	vector<string> unused;
+
+	for (std::map<string, string>::iterator it = settings.begin(); it != settings.end(); ++it) {
+
+		if (used.find(it->first) == used.end()) {
+			unused.push_back(it->first);
+		}
+	}
+
+	return unused;
+
+}
@@ -0,0 +1,213 @@
+/*
+ Copyright (c) 2017 California Institute of Technology. All rights reserved.
+ Multistrand nucleic acid kinetic simulator
+ help@multistrand.org
+ */
+
+/* The parts of MemPool that are off the hot path: getting and freeing chunks, and
+ the blocks that come back from other threads.
+
+ With -DMEMPOOL_COUNT_GLOBAL, the global operator new and delete are replaced so
+ that MemPool::systemAllocations counts every call of the global allocator on the
+ thread, also those made outside the pool. They take their memory from malloc, as
+ the ones of the C++ library do. They replace the operators of the whole process,
+ so they are for checks such as allocation_check.py, and left out otherwise. */
+
+#include "mempool.h"
+
+#include <stdlib.h>
+
+void MemPool::State::grow(void) {
+
+	// the chunk is aligned to its size, so that a block finds its pool in the
+	// first granule. The tail of the previous chunk is left unused.
+	void* chunk = NULL;
+
+	if (posix_memalign(&chunk, MEMPOOL_CHUNK, MEMPOOL_CHUNK) != 0)
+		throw std::bad_alloc();
+
+	*(State**) chunk = this;
+	chunks.push_back(chunk);
+	systemAllocations++;
+
+	cursor = (char*) chunk + MEMPOOL_GRANULE;
+	chunkEnd = (char*) chunk + MEMPOOL_CHUNK;
+
+}
+
+void MemPool::State::trim(void) {
+
+	if (remotePending.load(std::memory_order_relaxed))
+		drain();
+
+	if (live != 0)
+		return;
+
+	freeChunks();
+
+	for (size_t i = 0; i < MEMPOOL_CLASSES; i++) {
+		freeList[i] = NULL;
+	}
+
+	cursor = NULL;
+	chunkEnd = NULL;
+
+}
+
+void MemPool::State::freeChunks(void) {
+
+	for (size_t i = 0; i < chunks.size(); i++) {
+		free(chunks[i]);
+	}
+
+	chunks.clear();
+
+}
+
+void MemPool::State::drain(void) {
+
+	std::lock_guard<std::mutex> guard(lock);
+	drainLocked();
+
+}
+
+void MemPool::State::drainLocked(void) {
+
+	void* block = remote;
+
+	remote = NULL;
+	remotePending.store(false, std::memory_order_relaxed);
+
+	while (block != NULL) {
+
+		void* next = ((void**) block)[0];
+		size_t sizeClass = ((size_t*) block)[1];
+
+		*(void**) block = freeList[sizeClass];
+		freeList[sizeClass] = block;
+		live--;
+
+		block = next;
+	}
+
+}
+
+void MemPool::State::releaseRemote(void* block, size_t sizeClass) {
+
+	bool last = false;
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+
+		if (orphaned) {
+
+			// the thread of the pool has ended; nothing reuses the block.
+			live--;
+			last = (live == 0);
+
+		} else {
+
+			((void**) block)[0] = remote;
+			((size_t*) block)[1] = sizeClass;
+			remote = block;
+			remotePending.store(true, std::memory_order_relaxed);
+
+		}
+	}
+
+	if (last)
+		delete this;
+
+}
+
+void MemPool::State::retire(void) {
+
+	bool last;
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+
+		drainLocked();
+		orphaned = true;
+		last = (live == 0);
+	}
+
+	if (last)
+		delete this;
+
+}
+
+#ifdef MEMPOOL_COUNT_GLOBAL
+
+thread_local long MemPool::globalAllocations = 0;
+
+void* operator new(size_t size) {
+
+	MemPool::globalAllocations++;
+
+	if (size == 0)
+		size = 1;
+
+	void* block;
+
+	while ((block = malloc(size)) == NULL) {
+
+		std::new_handler handler = std::get_new_handler();
+
+		if (handler == NULL)
+			throw std::bad_alloc();
+
+		handler();
+	}
+
+	return block;
+
+}
+
+void* operator new[](size_t size) {
+
+	return ::operator new(size);
+
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+
+	try {
+		return ::operator new(size);
+	} catch (...) {
+		return NULL;
+	}
+
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+
+	return ::operator new(size, std::nothrow);
+
+}
+
+void operator delete(void* block) noexcept {
+
+	free(block);
+
+}
+
+void operator delete[](void* block) noexcept {
+
+	free(block);
+
+}
+
+void operator delete(void* block, const std::nothrow_t&) noexcept {
+
+	free(block);
+
+}
+
+void operator delete[](void* block, const std::nothrow_t&) noexcept {
+
+	free(block);
+
+}
+
+#endif
@@ -0,0 +1,125 @@
+/*
+ Copyright (c) 2017 California Institute of Technology. All rights reserved.
+ Multistrand nucleic acid kinetic simulator
+ help@multistrand.org
+ */
+
+#include "phasestats.h"
+
+#include <stdio.h>
+
+thread_local bool PhaseStats::enabled = false;
+
+void PhaseStats::start(bool trace, int threadIndex) {
+
+	for (int i = 0; i < PHASE_COUNT; i++) {
+		calls[i] = 0;
+		ticks[i] = 0;
+	}
+
+	steps = 0;
+	movesGenerated = 0;
+
+	tracing = trace;
+	thread = threadIndex;
+	events.clear();
+	threadEvents.clear();
+
+	beginTime = std::chrono::steady_clock::now();
+	beginTicks = now();
+	endTicks = beginTicks;
+	endTime = beginTime;
+
+}
+
+void PhaseStats::stop(void) {
+
+	endTicks = now();
+	endTime = std::chrono::steady_clock::now();
+
+}
+
+void PhaseStats::merge(PhaseStats& worker) {
+
+	for (int i = 0; i < PHASE_COUNT; i++) {
+		calls[i] += worker.calls[i];
+		ticks[i] += worker.ticks[i];
+	}
+
+	steps += worker.steps;
+	movesGenerated += worker.movesGenerated;
+
+	if (!worker.events.empty()) {
+		threadEvents.push_back(std::make_pair(worker.thread, std::vector<PhaseEvent>()));
+		threadEvents.back().second.swap(worker.events);
+	}
+
+}
+
+long PhaseStats::energyEvaluations(void) {
+
+	long count = 0;
+
+	for (int i = PHASE_ENERGY_STACK; i <= PHASE_ENERGY_OPENLOOP; i++) {
+		count += calls[i];
+	}
+
+	return count;
+
+}
+
+double PhaseStats::seconds(uint64_t count) {
+
+	double elapsed = std::chrono::duration<double>(endTime - beginTime).count();
+
+	if (endTicks <= beginTicks || elapsed <= 0.0) {
+		return 0.0;
+	}
+
+	return count * elapsed / (endTicks - beginTicks);
+
+}
+
+static void writeEvents(FILE* file, PhaseStats& stats, int thread, std::vector<PhaseEvent>& events, bool& first) {
+
+	fprintf(file, "%s\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s %d\"}}", first ? "" : ",", thread,
+			(thread == 0) ? "simulation" : "worker", thread);
+	first = false;
+
+	for (PhaseEvent& event : events) {
+
+		// microseconds since the start of the run
+		double begin = 1e6 * stats.seconds(event.begin - stats.beginTicks);
+		double duration = 1e6 * stats.seconds(event.end - event.begin);
+
+		fprintf(file, ",\n{\"name\": \"%s\", \"cat\": \"multistrand\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+				phaseNames[event.phase], thread, begin, duration);
+	}
+
+}
+
+bool PhaseStats::writeTrace(const std::string& path) {
+
+	FILE* file = fopen(path.c_str(), "w");
+
+	if (file == NULL) {
+		return false;
+	}
+
+	bool first = true;
+
+	fprintf(file, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+
+	if (!events.empty() || threadEvents.empty()) {
+		writeEvents(file, *this, thread, events, first);
+	}
+
+	for (unsigned int i = 0; i < threadEvents.size(); i++) {
+		writeEvents(file, *this, threadEvents[i].first, threadEvents[i].second, first);
+	}
+
+	fprintf(file, "\n]}\n");
+
+	return fclose(file) == 0;
+
+}
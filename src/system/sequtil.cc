@@ -51,7 +51,9 @@ std::ostream& operator<<(std::ostream& ss, BaseCount& input) {
 
 void BaseCount::clear(void) {
 
-	count = {0,0,0,0,0};
+	for (int i = 0; i < BASETYPE_SIZE; i++) {
+		count[i] = 0;
+	}
 
 }
 
@@ -15,6 +15,7 @@
 #include "simoptions.h"
 #include "energyoptions.h"
 #include "scomplex.h"
+#include "jobfile.h"
 
 #include <time.h>
 #include <vector>
@@ -22,6 +23,7 @@
 #include <string>
 #include <sstream>
 #include <cstring>
+#include <mutex>
 
 using std::vector;
 using std::string;
@@ -34,7 +36,9 @@ SimOptions::SimOptions(void) {
 
 SimOptions::~SimOptions(void) {
 
-// empty deconstructor
+	if (myStopComplexes != NULL) {
+		delete myStopComplexes;
+	}
 
 }
 
@@ -78,7 +82,22 @@ PSimOptions::PSimOptions(PyObject* input) :
 
 	getLongAttr(python_settings, verbosity, &verbosity);
 	getBoolAttr(python_settings, activestatespace, &statespaceActive);
+	getLongAttr(python_settings, selection_engine, &selectionEngine);
+	getLongAttr(python_settings, math_kernels, &mathKernels);
+	getBoolAttr(python_settings, specialized_model, &specializedModel);
 	getDoubleAttr(python_settings, ms_version, &ms_version);
+	getBoolAttr(python_settings, columnar_results, &columnarResults);
+
+	PyObject* pyo = NULL;
+	trajectoryFile = getStringAttr(python_settings, trajectory_file, pyo);
+	Py_XDECREF(pyo);
+	getLongAttr(python_settings, trajectory_keyframes, &trajectoryKeyframes);
+	getBoolAttr(python_settings, phase_stats, &phaseStats);
+	phaseTrace = getStringAttr(python_settings, phase_trace, pyo);
+	Py_XDECREF(pyo);
+	parameterCache = getStringAttr(python_settings, parameter_cache, pyo);
+	Py_XDECREF(pyo);
+	getBoolAttr(python_settings, log_constants, &logConstants);
 
 	debug = false;	// this is the main switch for simOptions debug, for now.
 
@@ -286,9 +305,15 @@ void PSimOptions::generateComplexes(PyObject *alternate_start, long current_seed
 	return;
 }
 
+// The stop conditions are parsed from python once, and the same list is returned
+// for every step and every trajectory. The list is owned by SimOptions.
 stopComplexes* PSimOptions::getStopComplexes(int) {
 
-	myStopComplexes = getStopComplexList(python_settings, 0);
+	if (myStopComplexes == NULL) {
+
+		myStopComplexes = getStopComplexList(python_settings, 0);
+
+	}
 
 	return myStopComplexes;
 
@@ -296,7 +321,13 @@ stopComplexes* PSimOptions::getStopComplexes(int) {
 
 void PSimOptions::stopResultError(long seed) {
 
-	if (!statespaceActive) {
+	if (statespaceActive) {
+		return;
+	}
+
+	if (columnarResults) {
+		results.add(seed, STOPRESULT_ERROR, 0.0, 0.0, result_type::STR_ERROR.c_str());
+	} else {
 		printStatusLine(python_settings, seed, STOPRESULT_ERROR, 0.0, result_type::STR_ERROR.c_str());
 	}
 
@@ -304,7 +335,13 @@ void PSimOptions::stopResultError(long seed) {
 
 void PSimOptions::stopResultNan(long seed) {
 
-	if (!statespaceActive) {
+	if (statespaceActive) {
+		return;
+	}
+
+	if (columnarResults) {
+		results.add(seed, STOPRESULT_NAN, 0.0, 0.0, result_type::STR_NAN.c_str());
+	} else {
 		printStatusLine(python_settings, seed, STOPRESULT_NAN, 0.0, result_type::STR_NAN.c_str());
 	}
 
@@ -312,7 +349,13 @@ void PSimOptions::stopResultNan(long seed) {
 
 void PSimOptions::stopResultNormal(long seed, double time, char* message) {
 
-	if (!statespaceActive) {
+	if (statespaceActive) {
+		return;
+	}
+
+	if (columnarResults) {
+		results.add(seed, STOPRESULT_NORMAL, time, 0.0, message);
+	} else {
 		printStatusLine(python_settings, seed, STOPRESULT_NORMAL, time, message);
 	}
 
@@ -320,7 +363,13 @@ void PSimOptions::stopResultNormal(long seed, double time, char* message) {
 
 void PSimOptions::stopResultTime(long seed, double time) {
 
-	if (!statespaceActive) {
+	if (statespaceActive) {
+		return;
+	}
+
+	if (columnarResults) {
+		results.add(seed, STOPRESULT_TIME, time, 0.0, result_type::STR_TIMEOUT.c_str());
+	} else {
 		printStatusLine(python_settings, seed, STOPRESULT_TIME, time, result_type::STR_TIMEOUT.c_str());
 	}
 
@@ -328,93 +377,362 @@ void PSimOptions::stopResultTime(long seed, double time) {
 
 void PSimOptions::stopResultFirstStep(long seed, double stopTime, double rate, const char* message) {
 
-	if (!statespaceActive) {
+	if (statespaceActive) {
+		return;
+	}
+
+	if (columnarResults) {
+		results.add(seed, STOPRESULT_NORMAL, stopTime, rate, message);
+	} else {
 		printStatusLine_First_Bimolecular(python_settings, seed, STOPRESULT_NORMAL, stopTime, rate, message);
 	}
 }
 
+void PSimOptions::sendComplexState(long seed, ExportData& data) {
+
+	if (!columnarResults) {
+		printComplexStateLine(python_settings, seed, data);
+	}
+
+}
+
 ///// CSIMOPTIONS
-CSimOptions::CSimOptions(void) {
+CSimOptions::CSimOptions(JobFile* jobFile, FILE* resultFile) :
+		SimOptions(), job(jobFile), output(resultFile) {
 
-	// initializers calling python object -- these can use a super object getter.
-	// Not clear at the moment if calling all settings is possible without crashing.
-	fixedRandomSeed = true;
+	// the defaults of the Python options
+	simulation_mode = SIMULATION_MODE_NORMAL;
+	simulation_count = 1;
+	o_interval = -1;
+	o_time = -1.0;
+	max_sim_time = 600.0;
 
-	seed = 7777;
+	energyOptions = new CEnergyOptions(job);
 
-	energyOptions = new CEnergyOptions();
+	static const char* const modeNames[] = { "first_passage_time", "first_step", "trajectory" };
+	static const long modeValues[] = { SIMULATION_MODE_NORMAL, SIMULATION_MODE_FIRST_BIMOLECULAR, SIMULATION_MODE_FLAG_TRAJECTORY };
+	job->getChoice("SimulationMode", modeNames, modeValues, 3, &simulation_mode);
 
-	simulation_mode = 16;
-	simulation_count = 1000;
-	o_time = 0;
-	o_interval = 0;
-	stop_count = 1;
-	stop_options = 1;
-	max_sim_time = 0.1;
+	job->getLong("NumSims", &simulation_count);
+	job->getDouble("SimTime", &max_sim_time);
+	job->getLong("OutputInterval", &o_interval);
+	job->getDouble("OutputTime", &o_time);
 
-	debug = false;	// this is the main switch for simOptions debug, for now.
+	fixedRandomSeed = job->has("Seed");
+	job->getLong("Seed", &seed);
+
+	bool useStopConditions = !job->stopConditions.empty();
+	job->getBool("StopOptions", &useStopConditions);
+	stop_options = useStopConditions;
+	stop_count = job->stopConditions.size();
+
+	job->getLong("Verbosity", &verbosity);
+
+	static const char* const engineNames[] = { "linear", "sumtree" };
+	static const long engineValues[] = { SELECTION_ENGINE_LINEAR, SELECTION_ENGINE_SUMTREE };
+	job->getChoice("SelectionEngine", engineNames, engineValues, 2, &selectionEngine);
+
+	static const char* const kernelNames[] = { "libm", "tabulated", "validate" };
+	static const long kernelValues[] = { KERNELS_LIBM, KERNELS_TABULATED, KERNELS_VALIDATE };
+	job->getChoice("MathKernels", kernelNames, kernelValues, 3, &mathKernels);
+	job->getBool("SpecializedModel", &specializedModel);
+
+	job->getString("TrajectoryFile", trajectoryFile);
+	job->getLong("TrajectoryKeyframes", &trajectoryKeyframes);
+	job->getBool("PhaseStats", &phaseStats);
+	job->getString("PhaseTrace", phaseTrace);
+	job->getString("ParameterCache", parameterCache);
+	job->getBool("LogConstants", &logConstants);
 
 }
 
 PyObject* CSimOptions::getPythonSettings() {
 
-	cout << "getPythonSettings, cannot proceed \n";
-	abort();
 	return NULL;
 
 }
 
+// The strands of the start state get the same unique ids in every trajectory, as the
+// strands of a Python start state do.
 void CSimOptions::generateComplexes(PyObject *alternate_start, long current_seed) {
 
-	myComplexes = new vector<complex_input>(0); // wipe the pointer to the previous object;
+	if (myComplexes != NULL) {
+		delete myComplexes;
+	}
 
-//	// setting default value
-//	char* mySeq = "GTTAGACTCGGAGGTGGTAGCAATGGATCAG+CTGATCCATTGCTACCACCTCCGAGTCTAACCATATC+GATATGGTTAGACTCGGAGGTGGTAGCAATG";
-//	char* myStructure = ".........................((((((+))))))(((((((((((((((((((((((((((((((+)))))))))))))))))))))))))))))))";
-//	identList* myIdentity1 = new identList(1337, "myID-1", NULL);
-//	identList* myIdentity2 = new identList(1338, "myID-2", myIdentity1);
-//	identList* myIdentity3 = new identList(1339, "myID-3", myIdentity2);
-//
-//	complex_input myInput = complex_input(mySeq, myStructure, NULL);
-//
-//	myComplexes->push_back(myInput);
+	myComplexes = new vector<complex_input>(0);
+
+	long uid = 0;
+
+	for (unsigned int i = 0; i < job->startState.size(); i++) {
+
+		JobComplex& complex = job->startState[i];
+		string sequence;
+		identList* id = NULL;
+
+		for (unsigned int k = 0; k < complex.strands.size(); k++) {
+
+			sequence += (k > 0) ? "+" : "";
+			sequence += job->strands[complex.strands[k]].sequence;
+
+		}
+
+		for (int k = complex.strands.size() - 1; k >= 0; k--) {
+
+			id = new identList(uid + k, (char *) job->strands[complex.strands[k]].name.c_str(), id);
+
+		}
+
+		uid += complex.strands.size();
+
+		myComplexes->push_back(complex_input((char *) sequence.c_str(), (char *) complex.structure.c_str(), id));
+
+	}
+
+	seed = current_seed;
 
 }
 
+// Built once, as for PSimOptions. The unique ids of the strands are their index in
+// the strand table; the stop conditions compare the names only.
 stopComplexes* CSimOptions::getStopComplexes(int) {
 
-	cout << "getStopComplexes, cannot proceed \n";
-	abort();
-	return NULL;
+	if (myStopComplexes == NULL) {
+
+		for (int i = job->stopConditions.size() - 1; i >= 0; i--) {
+
+			JobStopCondition& condition = job->stopConditions[i];
+			complexItem* items = NULL;
+
+			for (int j = condition.complexes.size() - 1; j >= 0; j--) {
+
+				JobComplex& complex = condition.complexes[j];
+				identList* id = NULL;
+
+				for (int k = complex.strands.size() - 1; k >= 0; k--) {
+
+					id = new identList(complex.strands[k], (char *) job->strands[complex.strands[k]].name.c_str(), id);
+
+				}
+
+				items = new complexItem((char *) complex.structure.c_str(), id, items, complex.type, complex.count);
+
+			}
+
+			myStopComplexes = new stopComplexes((char *) condition.tag.c_str(), items, myStopComplexes);
+
+		}
+	}
+
+	return myStopComplexes;
+
+}
+
+void CSimOptions::writeResult(long seed, const char* tag, double time, double rate) {
+
+	bool firstStep = (simulation_mode & SIMULATION_MODE_FLAG_FIRST_BIMOLECULAR) != 0;
+
+	if (!headerWritten) {
+		fprintf(output, firstStep ? "#seed\ttag\ttime\tcollision_rate\n" : "#seed\ttag\ttime\n");
+		headerWritten = true;
+	}
+
+	if (firstStep) {
+		fprintf(output, "%ld\t%s\t%.17g\t%.17g\n", seed, tag, time, rate);
+	} else {
+		fprintf(output, "%ld\t%s\t%.17g\n", seed, tag, time);
+	}
+
 }
 
 void CSimOptions::stopResultError(long seed) {
 
-	cout << "stopResultError, cannot send to python \n";
+	writeResult(seed, result_type::STR_ERROR.c_str(), 0.0, 0.0);
 
 }
 
 void CSimOptions::stopResultNan(long seed) {
 
-	cout << "stopResultNan, cannot send to python \n";
+	writeResult(seed, result_type::STR_NAN.c_str(), 0.0, 0.0);
 
 }
 
 void CSimOptions::stopResultNormal(long seed, double time, char* message) {
 
-	cout << "stopResultNormal, cannot send to python \n";
+	writeResult(seed, message, time, 0.0);
 
 }
 
 void CSimOptions::stopResultTime(long seed, double time) {
 
-	cout << "stopResultTime, cannot send to python \n";
+	writeResult(seed, result_type::STR_TIMEOUT.c_str(), time, 0.0);
 
 }
 
 void CSimOptions::stopResultFirstStep(long seed, double stopTime, double rate, const char* message) {
 
-	cout << "stopResultBimolecular, cannot send to python \n";
+	writeResult(seed, message, stopTime, rate);
 
 }
 
+// multistrand-sim writes the results only, not the end states.
+void CSimOptions::sendComplexState(long, ExportData&) {
+
+}
+
+///// WORKERSIMOPTIONS
+WorkerSimOptions::WorkerSimOptions(SimOptions* parentOptions) :
+		SimOptions(*parentOptions), parent(parentOptions) {
+
+	myComplexes = NULL;
+	myStopComplexes = NULL;
+	trajectoryFile.clear(); // the states of the workers are not exported
+
+	// parsed once, here, and shared with the parent and the other workers.
+	if (stop_options && stop_count > 0) {
+		myStopComplexes = parent->getStopComplexes(0);
+	}
+
+}
+
+WorkerSimOptions::~WorkerSimOptions(void) {
+
+	myStopComplexes = NULL; // the parent deletes it
+
+}
+
+PyObject* WorkerSimOptions::getPythonSettings(void) {
+
+	return NULL;
+
+}
+
+// The parent reads the start state, and records its structures for the seed. The
+// complexes are taken over before the lock is released, as the other workers use the
+// same parent. The GIL alone does not do: reading the start state runs Python code,
+// which can hand the GIL to another worker halfway. The lock is taken first, so that
+// no worker waits for it while holding the GIL.
+void WorkerSimOptions::generateComplexes(PyObject *alternate_start, long current_seed) {
+
+	static std::mutex parentLock;
+	std::lock_guard<std::mutex> guard(parentLock);
+
+	bool python = (parent->getPythonSettings() != NULL);
+	PyGILState_STATE gil;
+
+	if (python) {
+		gil = PyGILState_Ensure();
+	}
+
+	try {
+		parent->generateComplexes(alternate_start, current_seed);
+	} catch (...) {
+		if (python) {
+			PyGILState_Release(gil);
+		}
+		throw;
+	}
+
+	if (myComplexes != NULL) {
+		delete myComplexes;
+	}
+
+	myComplexes = parent->myComplexes;
+	parent->myComplexes = NULL;
+
+	if (python) {
+		PyGILState_Release(gil);
+	}
+
+}
+
+stopComplexes* WorkerSimOptions::getStopComplexes(int) {
+
+	return myStopComplexes;
+
+}
+
+static void logReport(TrajectoryLog* log, TrajectoryReport::Type type, long seed, double time, double rate, const char* tag) {
+
+	TrajectoryReport report;
+
+	report.type = type;
+	report.seed = seed;
+	report.time = time;
+	report.rate = rate;
+
+	if (tag != NULL) {
+		report.tag = tag;
+	}
+
+	log->push_back(report);
+
+}
+
+void WorkerSimOptions::stopResultError(long seed) {
+
+	logReport(log, TrajectoryReport::RESULT_ERROR, seed, 0.0, 0.0, NULL);
+
+}
+
+void WorkerSimOptions::stopResultNan(long seed) {
+
+	logReport(log, TrajectoryReport::RESULT_NAN, seed, 0.0, 0.0, NULL);
+
+}
+
+void WorkerSimOptions::stopResultNormal(long seed, double time, char* message) {
+
+	logReport(log, TrajectoryReport::RESULT_NORMAL, seed, time, 0.0, message);
+
+}
+
+void WorkerSimOptions::stopResultTime(long seed, double time) {
+
+	logReport(log, TrajectoryReport::RESULT_TIME, seed, time, 0.0, NULL);
+
+}
+
+void WorkerSimOptions::stopResultFirstStep(long seed, double stopTime, double rate, const char* message) {
+
+	logReport(log, TrajectoryReport::RESULT_FIRST_STEP, seed, stopTime, rate, message);
+
+}
+
+void WorkerSimOptions::sendComplexState(long seed, ExportData& data) {
+
+	logReport(log, TrajectoryReport::COMPLEX_STATE, seed, 0.0, 0.0, NULL);
+	log->back().state = data;
+
+}
+
+// Sends the reports of one trajectory on, as if it had been simulated with target.
+void WorkerSimOptions::replay(TrajectoryLog& log, SimOptions* target) {
+
+	for (unsigned int i = 0; i < log.size(); i++) {
+
+		TrajectoryReport& report = log[i];
+
+		switch (report.type) {
+		case TrajectoryReport::RESULT_ERROR:
+			target->stopResultError(report.seed);
+			break;
+		case TrajectoryReport::RESULT_NAN:
+			target->stopResultNan(report.seed);
+			break;
+		case TrajectoryReport::RESULT_NORMAL:
+			target->stopResultNormal(report.seed, report.time, (char *) report.tag.c_str());
+			break;
+		case TrajectoryReport::RESULT_TIME:
+			target->stopResultTime(report.seed, report.time);
+			break;
+		case TrajectoryReport::RESULT_FIRST_STEP:
+			target->stopResultFirstStep(report.seed, report.time, report.rate, report.tag.c_str());
+			break;
+		case TrajectoryReport::COMPLEX_STATE:
+			target->sendComplexState(report.seed, report.state);
+			break;
+		}
+	}
+
+}
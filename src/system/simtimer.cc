@@ -1,8 +1,11 @@
 #include "simoptions.h"
 #include "simtimer.h"
+#include "mathkernels.h"
+#include "randomstream.h"
+#include "phasestats.h"
 
 
-SimTimer::SimTimer(SimOptions& myOptions) {
+SimTimer::SimTimer(SimOptions& myOptions, RandomStream& myRandom) {
 
 	maxsimtime = myOptions.getMaxSimTime();
 	stopcount = myOptions.getStopCount();
@@ -10,14 +13,35 @@ SimTimer::SimTimer(SimOptions& myOptions) {
 
 	// saving the pointer to enable access to cotranscriptional timing values
 	simOptions = &myOptions;
+	random = &myRandom;
+	kernels = myOptions.mathKernels;
 
 }
 
 // advances the simulation time according to the set rate
 void SimTimer::advanceTime(void) {
 
-	rchoice = rate * drand48();
-	stime += (log(1. / (1.0 - drand48())) / rate);
+	PhaseTimer phase(PHASE_ADVANCE_TIME);
+
+	rchoice = rate * random->uniform();
+
+	if (kernels == KERNELS_LIBM) {
+
+		stime += (log(1. / (1.0 - random->uniform())) / rate);
+
+	} else {
+
+		double u = 1. / (1.0 - random->uniform());
+		double step = MathKernels::log(u);
+
+		if (kernels == KERNELS_VALIDATE) {
+			double exact = log(u);
+			MathKernels::compare(step, exact);
+			step = exact;
+		}
+
+		stime += step / rate;
+	}
 
 }
 
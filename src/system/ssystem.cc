@@ -8,12 +8,19 @@
 #include "ssystem.h"
 #include "simoptions.h"
 #include "statespace.h"
+#include "energyseries.h"
 
 #include <string.h>
 #include <time.h>
 #include <stdlib.h>
 #include <vector>
+#include <algorithm>
 #include <iostream>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <exception>
+#include <memory>
 
 SimulationSystem::SimulationSystem(PyObject *system_o) {
 
@@ -21,7 +28,10 @@ SimulationSystem::SimulationSystem(PyObject *system_o) {
 	simOptions = new PSimOptions(system_o);
 
 	construct();
-	energyModel->writeConstantsToFile();
+
+	if (simOptions->logConstants) {
+		energyModel->writeConstantsToFile();
+	}
 
 }
 
@@ -31,11 +41,23 @@ SimulationSystem::SimulationSystem(SimOptions* options) {
 	simOptions = options;
 
 	construct();
-	energyModel->writeConstantsToFile();
+
+	if (simOptions->logConstants) {
+		energyModel->writeConstantsToFile();
+	}
 
 }
 
-void SimulationSystem::construct(void) {
+SimulationSystem::SimulationSystem(SimOptions* options, EnergyModel* model) {
+
+	system_options = NULL;
+	simOptions = options;
+
+	construct(model);
+
+}
+
+void SimulationSystem::construct(EnergyModel* model) {
 
 // We no longer need the below line; we are guaranteed that options
 // will have a good reference for the lifetime of our object, as the
@@ -44,10 +66,16 @@ void SimulationSystem::construct(void) {
 	simulation_mode = simOptions->getSimulationMode();
 	simulation_count_remaining = simOptions->getSimulationCount();
 
-	if (simOptions->statespaceActive) {
+	if (model != NULL) {
+		energyModel = model;
+		Loop::SetEnergyModel(energyModel);
+	} else if (simOptions->statespaceActive) {
 		energyModel = Loop::GetEnergyModel();
+	} else if (simOptions->getPythonSettings() != NULL) {
+		energyModel = NupackEnergyModel::create(simOptions->getPythonSettings());
+		Loop::SetEnergyModel(energyModel);
 	} else {
-		energyModel = new NupackEnergyModel(simOptions->getPythonSettings());
+		energyModel = NupackEnergyModel::create(simOptions);
 		Loop::SetEnergyModel(energyModel);
 	}
 
@@ -55,6 +83,10 @@ void SimulationSystem::construct(void) {
 	exportStatesInterval = (simOptions->getOInterval() > 0);
 	exportStatesTime = (simOptions->getOTime() >= 0);
 
+	if (!simOptions->trajectoryFile.empty() && !simOptions->statespaceActive) {
+		trajectoryFile = new TrajectoryFile(simOptions->trajectoryFile, simOptions->trajectoryKeyframes);
+	}
+
 	builder = Builder(simOptions);
 
 }
@@ -85,6 +117,16 @@ SimulationSystem::~SimulationSystem(void) {
 	}
 	complexList = NULL;
 
+	// the tables first, so that the pool can hand back the chunks of their rows.
+	if (energyModel != NULL)
+		energyModel->trimStrandTables();
+
+	MemPool::trim();
+
+	if (trajectoryFile != NULL) {
+		delete trajectoryFile;
+	}
+
 // the remaining members are not our responsibility, we null them out
 // just in case something thread-unsafe happens.
 
@@ -113,6 +155,14 @@ SimulationSystem::~SimulationSystem(void) {
 void SimulationSystem::StartSimulation(void) {
 
 	InitializeRNG();
+	MathKernels::check() = MathKernels::Check();
+	startPhases();
+
+	// only the states exported along a trajectory are written as changes; without
+	// them the log would grow for the whole run.
+	if (trajectoryFile != NULL && (exportStatesInterval || exportStatesTime)) {
+		StrandOrdering::flipLog = trajectoryFile->getFlipLog();
+	}
 
 	if (simulation_mode & SIMULATION_MODE_FLAG_FIRST_BIMOLECULAR) {
 		StartSimulation_FirstStep();
@@ -123,6 +173,9 @@ void SimulationSystem::StartSimulation(void) {
 	} else
 		StartSimulation_Standard();
 
+	kernelCheck = MathKernels::check();
+	PhaseStats::enabled = false;
+	finishPhases(PhaseStats::current());
 	finalizeSimulation();
 
 }
@@ -130,6 +183,9 @@ void SimulationSystem::StartSimulation(void) {
 void SimulationSystem::StartSimulation_FirstStep(void) {
 
 	while (simulation_count_remaining > 0) {
+
+		PhaseTimer phase(PHASE_TRAJECTORY);
+
 		if (InitializeSystem() != 0)
 			return;
 
@@ -143,6 +199,9 @@ void SimulationSystem::StartSimulation_FirstStep(void) {
 void SimulationSystem::StartSimulation_Standard(void) {
 
 	while (simulation_count_remaining > 0) {
+
+		PhaseTimer phase(PHASE_TRAJECTORY);
+
 		if (InitializeSystem() != 0)
 			return;
 
@@ -156,6 +215,9 @@ void SimulationSystem::StartSimulation_Standard(void) {
 void SimulationSystem::StartSimulation_Transition(void) {
 
 	while (simulation_count_remaining > 0) {
+
+		PhaseTimer phase(PHASE_TRAJECTORY);
+
 		if (InitializeSystem() != 0) {
 			return;
 		}
@@ -170,6 +232,8 @@ void SimulationSystem::StartSimulation_Trajectory(void) {
 
 	while (simulation_count_remaining > 0) {
 
+		PhaseTimer phase(PHASE_TRAJECTORY);
+
 		if (InitializeSystem() != 0) {
 
 			cout << "system not initialized; returning \n";
@@ -182,10 +246,324 @@ void SimulationSystem::StartSimulation_Trajectory(void) {
 	}
 }
 
+// The trajectories of one system of a parallel run, and what the workers counted.
+struct ParallelPart {
+
+	SimulationSystem* system = NULL;
+	long first = 0; // the index of its first trajectory in the run
+	std::vector<TrajectoryLog> logs; // by trajectory index
+	std::vector<WorkerSimOptions*> options; // by worker, until the worker takes them
+
+	// summed over the workers, under the lock of the run.
+	int noInitialMoves = 0;
+	int timeOut = 0;
+	long loopAllocations = 0;
+	long loopSystemAllocations = 0;
+	MathKernels::Check kernelCheck;
+	PhaseStats phases; // started for the system, with the phases of the workers added
+
+	long lastSystemAllocations = 0; // of the last trajectory
+	bool countsPhases = false; // PhaseStats::enabled of the workers on this part
+
+};
+
+// What the workers of StartSweep share: the trajectories of every system, handed out
+// in the order of the systems.
+struct ParallelRun {
+
+	std::vector<ParallelPart> parts;
+	long count = 0; // of all the parts
+	std::atomic<long> next { 0 }; // the next trajectory to simulate
+	std::atomic<bool> failed { false };
+
+	std::mutex lock;
+	std::exception_ptr error;
+
+};
+
+const char* SimulationSystem::parallelUnsupported(void) {
+
+	if (simulation_mode & (SIMULATION_MODE_FLAG_TRAJECTORY | SIMULATION_MODE_FLAG_TRANSITION)) {
+		return "The trajectory and transition modes cannot run in parallel.";
+	}
+
+	if (simOptions->statespaceActive || simOptions->cotranscriptional) {
+		return "Statespace building and cotranscriptional folding cannot run in parallel.";
+	}
+
+	if (exportStatesInterval || exportStatesTime || simOptions->getPrintIntialFirstStep()) {
+		return "States cannot be exported (output_interval, output_time) in a parallel run.";
+	}
+
+	return NULL;
+
+}
+
+void SimulationSystem::StartSimulationParallel(int threads) {
+
+	std::vector<SimulationSystem*> systems(1, this);
+	StartSweep(systems, threads);
+
+}
+
+void SimulationSystem::StartSweep(std::vector<SimulationSystem*>& systems, int threads) {
+
+	if (systems.empty()) {
+		return;
+	}
+
+	ParallelRun run;
+	run.parts.resize(systems.size());
+
+	for (unsigned int i = 0; i < systems.size(); i++) {
+
+		ParallelPart& part = run.parts[i];
+
+		part.system = systems[i];
+		part.system->InitializeRNG();
+		part.first = run.count;
+		part.logs.resize(part.system->simulation_count_remaining);
+
+		run.count += part.logs.size();
+
+		// each system counts its phases as its own options ask.
+		part.countsPhases = part.system->countsPhases();
+		part.phases.start(!part.system->simOptions->phaseTrace.empty());
+
+	}
+
+	if (threads <= 0) {
+		threads = std::thread::hardware_concurrency();
+	}
+
+	if (threads > run.count) {
+		threads = run.count;
+	}
+
+	if (threads < 1) {
+		threads = 1;
+	}
+
+	bool python = false;
+
+	for (ParallelPart& part : run.parts) {
+
+		for (int i = 0; i < threads; i++) {
+			part.options.push_back(new WorkerSimOptions(part.system->simOptions));
+		}
+
+		python = python || (part.system->simOptions->getPythonSettings() != NULL);
+
+	}
+
+	// the workers take the GIL to read the start state, if there is Python.
+	PyThreadState* pythonState = NULL;
+
+	if (python) {
+		PyEval_InitThreads();
+		pythonState = PyEval_SaveThread();
+	}
+
+	std::vector<std::thread> workers;
+
+	for (int i = 0; i < threads; i++) {
+		workers.push_back(std::thread(&SimulationSystem::runWorker, &run, i));
+	}
+
+	for (int i = 0; i < threads; i++) {
+		workers[i].join();
+	}
+
+	if (pythonState != NULL) {
+		PyEval_RestoreThread(pythonState);
+	}
+
+	// of the workers that did not get to a part.
+	for (ParallelPart& part : run.parts) {
+		for (WorkerSimOptions* options : part.options) {
+			delete options;
+		}
+	}
+
+	if (run.error) {
+		std::rethrow_exception(run.error);
+	}
+
+	for (ParallelPart& part : run.parts) {
+
+		SimulationSystem* system = part.system;
+
+		for (unsigned long i = 0; i < part.logs.size(); i++) {
+
+			WorkerSimOptions::replay(part.logs[i], system->simOptions);
+
+			if (system->system_options != NULL) {
+				pingAttr(system->system_options, increment_trajectory_count);
+			}
+		}
+
+		system->noInitialMoves += part.noInitialMoves;
+		system->timeOut += part.timeOut;
+		system->loopAllocations += part.loopAllocations;
+		system->loopSystemAllocations += part.loopSystemAllocations;
+		system->lastSystemAllocations = part.lastSystemAllocations;
+		system->kernelCheck = part.kernelCheck;
+		system->finishPhases(part.phases);
+
+	}
+
+	for (SimulationSystem* system : systems) {
+
+		// as if the trajectories had been simulated here.
+		system->trajectory_index = system->simulation_count_remaining - 1;
+		system->simulation_count_remaining = 0;
+		system->generateNextRandom();
+
+		system->finalizeSimulation();
+
+	}
+
+}
+
+// A worker thread of StartSweep: simulates the trajectory with the next index until
+// there are none left, with a system of its own for the part of that index. Strands
+// register with a registry of this thread for the energy model of the part.
+void SimulationSystem::runWorker(ParallelRun* run, int thread) {
+
+	MathKernels::check() = MathKernels::Check();
+
+	ParallelPart* part = NULL;
+	WorkerSimOptions* options = NULL;
+	std::unique_ptr<StrandRegistry> strands;
+	std::unique_ptr<SimulationSystem> worker;
+
+	try {
+
+		long index;
+
+		while (!run->failed && (index = run->next++) < run->count) {
+
+			if (part == NULL || index >= part->first + (long) part->logs.size()) {
+
+				if (part != NULL) {
+					finishPart(run, part, worker.get());
+				}
+
+				unsigned int next = (part == NULL) ? 0 : (part - &run->parts[0]) + 1;
+
+				while (index >= run->parts[next].first + (long) run->parts[next].logs.size()) {
+					next++;
+				}
+
+				part = &run->parts[next];
+
+				PhaseStats::enabled = part->countsPhases;
+				PhaseStats::current().start(part->phases.tracing, thread + 1);
+
+				worker.reset();
+				strands.reset(new StrandRegistry(part->system->energyModel));
+				EnergyModel::useWorkerStrands(strands.get());
+
+				options = part->options[thread];
+				part->options[thread] = NULL; // the worker system deletes them
+
+				worker.reset(new SimulationSystem(options, part->system->energyModel));
+				worker->initial_seed = part->system->initial_seed;
+
+			}
+
+			long trajectory = index - part->first;
+
+			options->log = &part->logs[trajectory];
+			worker->runTrajectory(trajectory);
+
+			if (trajectory == (long) part->logs.size() - 1) {
+				part->lastSystemAllocations = worker->lastSystemAllocations;
+			}
+		}
+
+		if (part != NULL) {
+			finishPart(run, part, worker.get());
+		}
+
+	} catch (...) {
+
+		std::lock_guard<std::mutex> guard(run->lock);
+
+		if (!run->error) {
+			run->error = std::current_exception();
+		}
+
+		run->failed = true;
+
+	}
+
+	worker.reset();
+	strands.reset();
+	EnergyModel::useWorkerStrands(NULL);
+	PhaseStats::enabled = false;
+
+}
+
+// Adds what the worker counted to its part, and what the math kernels of this thread
+// checked, and the phases it timed, since the last part.
+void SimulationSystem::finishPart(ParallelRun* run, ParallelPart* part, SimulationSystem* worker) {
+
+	MathKernels::Check& check = MathKernels::check();
+	std::lock_guard<std::mutex> guard(run->lock);
+
+	part->noInitialMoves += worker->noInitialMoves;
+	part->timeOut += worker->timeOut;
+	part->loopAllocations += worker->loopAllocations;
+	part->loopSystemAllocations += worker->loopSystemAllocations;
+
+	part->kernelCheck.count += check.count;
+	part->kernelCheck.mismatches += check.mismatches;
+
+	if (check.maxError > part->kernelCheck.maxError) {
+		part->kernelCheck.maxError = check.maxError;
+	}
+
+	check = MathKernels::Check();
+
+	part->phases.merge(PhaseStats::current());
+
+}
+
+// Simulates trajectory index of the run that started from initial_seed.
+void SimulationSystem::runTrajectory(long index) {
+
+	trajectory_index = index;
+	current_seed = RandomStream::trajectorySeed(initial_seed, index);
+	random.setSeed(current_seed);
+
+	PhaseTimer phase(PHASE_TRAJECTORY);
+
+	if (InitializeSystem() != 0)
+		return;
+
+	lastSystemAllocations = 0; // set when the steps end; a trajectory may stop before
+
+	if (simulation_mode & SIMULATION_MODE_FLAG_FIRST_BIMOLECULAR) {
+		SimulationLoop_FirstStep();
+	} else {
+		SimulationLoop_Standard();
+	}
+
+	finalizeRun();
+
+}
+
 void SimulationSystem::finalizeRun(void) {
 
+	loopSystemAllocations += MemPool::systemAllocations() - systemAllocationMark;
+	loopAllocations += MemPool::allocations() - allocationMark;
+
 	simulation_count_remaining--;
-	pingAttr(system_options, increment_trajectory_count);
+
+	if (system_options != NULL) {
+		pingAttr(system_options, increment_trajectory_count);
+	}
 
 	generateNextRandom();
 
@@ -213,17 +591,36 @@ void SimulationSystem::finalizeSimulation(void) {
 
 	}
 
+	if (trajectoryFile != NULL) {
+
+		trajectoryFile->flush();
+		StrandOrdering::flipLog = NULL;
+
+	}
+
+	if (simOptions->columnarResults && system_options != NULL) {
+
+		bool firstStep = (simOptions->getSimulationMode() & SIMULATION_MODE_FLAG_FIRST_BIMOLECULAR) != 0;
+		pushResultColumns(system_options, simOptions->results.release(firstStep));
+
+	}
+
 }
 
 void SimulationSystem::SimulationLoop_Standard(void) {
 
-	SimTimer myTimer(*simOptions);
+	SimTimer myTimer(*simOptions, random);
 	stopComplexes *traverse = NULL, *first = NULL;
 
 	bool checkresult = false;
 
 	complexList->initializeList();
 	myTimer.rate = complexList->getTotalFlux();
+	stepAllocationMark = MemPool::systemAllocations();
+
+	if (myTimer.stopoptions && myTimer.stopcount > 0) {
+		first = simOptions->getStopComplexes(0);
+	}
 
 	do {
 
@@ -257,7 +654,6 @@ void SimulationSystem::SimulationLoop_Standard(void) {
 				}
 
 				checkresult = false;
-				first = simOptions->getStopComplexes(0);
 				checkresult = complexList->checkStopComplexList(first->citem);
 				traverse = first;
 
@@ -265,17 +661,12 @@ void SimulationSystem::SimulationLoop_Standard(void) {
 					traverse = traverse->next;
 					checkresult = complexList->checkStopComplexList(traverse->citem);
 				}
-				// Note: we cannot delete first here if checkresult != 0,
-				// as traverse->tag may be needed. It will get checked at
-				// that point and deleted once traverse->tag is used,
-				// later.
-				if (!checkresult) {
-					delete first;
-				}
 			}
 		}
 	} while (myTimer.stime < myTimer.maxsimtime && !checkresult);
 
+	lastSystemAllocations = MemPool::systemAllocations() - stepAllocationMark;
+
 	if (myTimer.stime == NAN) {
 
 		simOptions->stopResultNan(current_seed);
@@ -284,7 +675,6 @@ void SimulationSystem::SimulationLoop_Standard(void) {
 
 		dumpCurrentStateToPython();
 		simOptions->stopResultNormal(current_seed, myTimer.stime, traverse->tag);
-		delete first;
 
 	} else { // stime >= maxsimtime
 
@@ -296,7 +686,7 @@ void SimulationSystem::SimulationLoop_Standard(void) {
 
 void SimulationSystem::SimulationLoop_Trajectory() {
 
-	SimTimer myTimer(*simOptions);
+	SimTimer myTimer(*simOptions, random);
 	stopComplexes *traverse = NULL, *first = NULL;
 
 	bool stopFlag = false;
@@ -367,15 +757,11 @@ void SimulationSystem::SimulationLoop_Trajectory() {
 		simOptions->stopResultTime(current_seed, myTimer.stime);
 
 	}
-
-	if (first != NULL) {
-		delete first;
-	}
 }
 
 void SimulationSystem::SimulationLoop_Transition(void) {
 
-	SimTimer myTimer(*simOptions);
+	SimTimer myTimer(*simOptions, random);
 	stopComplexes *traverse = NULL, *first = NULL;
 
 	bool checkresult = false;
@@ -412,7 +798,6 @@ void SimulationSystem::SimulationLoop_Transition(void) {
 		transition_states[idx] = checkresult;
 		traverse = traverse->next;
 	}
-	delete first;
 	sendTransitionStateVectorToPython(transition_states, myTimer.stime);
 // start
 
@@ -430,7 +815,6 @@ void SimulationSystem::SimulationLoop_Transition(void) {
 			myTimer.rate = complexList->getTotalFlux();
 
 			// check if our transition state membership vector has changed
-			first = simOptions->getStopComplexes(0);
 			checkresult = false;
 			traverse = first;
 
@@ -455,10 +839,7 @@ void SimulationSystem::SimulationLoop_Transition(void) {
 				transition_states[idx] = checkresult;
 				traverse = traverse->next;
 			}
-			delete first; // we can do this now as we no longer need to
-						  // save the stoplist until the loop exits, due
-						  // to moving printStatusLine to immediately upon
-						  // finding the stopping condition.
+
 			if (state_changed) {
 				sendTransitionStateVectorToPython(transition_states, myTimer.stime);
 				state_changed = false;
@@ -485,7 +866,7 @@ void SimulationSystem::SimulationLoop_Transition(void) {
 
 void SimulationSystem::SimulationLoop_FirstStep(void) {
 
-	SimTimer myTimer(*simOptions);
+	SimTimer myTimer(*simOptions, random);
 	stopComplexes *traverse = NULL, *first = NULL;
 
 	bool stopFlag = false;
@@ -496,6 +877,11 @@ void SimulationSystem::SimulationLoop_FirstStep(void) {
 	long current_state_count = 0;
 
 	complexList->initializeList();
+	stepAllocationMark = MemPool::systemAllocations();
+
+	if (myTimer.stopcount > 0 && myTimer.stopoptions) {
+		first = simOptions->getStopComplexes(0);
+	}
 
 	myTimer.rate = complexList->getJoinFlux();
 
@@ -566,7 +952,6 @@ void SimulationSystem::SimulationLoop_FirstStep(void) {
 		if (myTimer.stopcount > 0 && myTimer.stopoptions) {
 
 			stopFlag = false;
-			first = simOptions->getStopComplexes(0);
 			traverse = first;
 			stopFlag = complexList->checkStopComplexList(traverse->citem);
 
@@ -574,17 +959,15 @@ void SimulationSystem::SimulationLoop_FirstStep(void) {
 				traverse = traverse->next;
 				stopFlag = complexList->checkStopComplexList(traverse->citem);
 			}
-
-			if (!stopFlag && first != NULL)
-				delete first;
 		}
 
 	} while (myTimer.stime < myTimer.maxsimtime && !stopFlag);
 
+	lastSystemAllocations = MemPool::systemAllocations() - stepAllocationMark;
+
 	if (stopFlag) {
 		dumpCurrentStateToPython();
 		simOptions->stopResultFirstStep(current_seed, myTimer.stime, frate, traverse->tag);
-		delete first;
 	} else {
 		timeOut++;
 		dumpCurrentStateToPython();
@@ -600,13 +983,14 @@ void SimulationSystem::SimulationLoop_FirstStep(void) {
 ///////////////////////////////////////////////////////////
 void SimulationSystem::dumpCurrentStateToPython(void) {
 
+	PhaseTimer phase(PHASE_EXPORT);
 	SComplexListEntry *temp = complexList->getFirst();
 	ExportData data;
 
 	while (temp != NULL) {
 
 		temp->dumpComplexEntryToPython(data);
-		printComplexStateLine(simOptions->getPythonSettings(), current_seed, data);
+		simOptions->sendComplexState(current_seed, data);
 
 		temp = temp->next;
 	}
@@ -620,6 +1004,8 @@ void SimulationSystem::dumpCurrentStateToPython(void) {
 /////////////////////////////////////////////////////////////////////////////////////
 
 void SimulationSystem::sendTransitionStateVectorToPython(boolvector transition_states, double current_time) {
+
+	PhaseTimer phase(PHASE_EXPORT);
 	PyObject *mylist = PyList_New((Py_ssize_t) transition_states.size());
 // we now have a new reference here that we'll need to DECREF.
 
@@ -666,6 +1052,15 @@ void SimulationSystem::sendTransitionStateVectorToPython(boolvector transition_s
 
 void SimulationSystem::sendTrajectory_CurrentStateToPython(double current_time, double arrType) {
 
+	PhaseTimer phase(PHASE_EXPORT);
+
+	if (trajectoryFile != NULL && trajectoryFile->isOpen()) {
+
+		trajectoryFile->addState(complexList, current_seed, current_time, arrType);
+		return;
+
+	}
+
 	ExportData data;
 	ExportData mergedData;
 
@@ -735,6 +1130,9 @@ int SimulationSystem::InitializeSystem(PyObject *alternate_start) {
 
 	}
 
+	allocationMark = MemPool::allocations();
+	systemAllocationMark = MemPool::systemAllocations();
+
 	return 0;
 }
 
@@ -757,12 +1155,16 @@ void SimulationSystem::InitializeRNG(void) {
 		}
 	}
 // now initialize this generator using our random seed, so that we can reproduce as necessary.
-	srand48(current_seed);
+	initial_seed = current_seed;
+	trajectory_index = 0;
+	random.setSeed(current_seed);
 }
 
+// the stream of the next trajectory depends only on the initial seed and its index, see RandomStream.
 void SimulationSystem::generateNextRandom(void) {
-	current_seed = lrand48();
-	srand48(current_seed);
+	trajectory_index++;
+	current_seed = RandomStream::trajectorySeed(initial_seed, trajectory_index);
+	random.setSeed(current_seed);
 }
 
 PyObject *SimulationSystem::calculateEnergy(PyObject *start_state, int typeflag) {
@@ -771,7 +1173,9 @@ PyObject *SimulationSystem::calculateEnergy(PyObject *start_state, int typeflag)
 
 // calc based on current state, do not clean up anything.
 	if (start_state != Py_None) {
+		Py_INCREF(start_state);
 		InitializeSystem(start_state);
+		// the reference is released by generateComplexes.
 		complexList->initializeList();
 	}
 
@@ -789,6 +1193,142 @@ PyObject *SimulationSystem::calculateEnergy(PyObject *start_state, int typeflag)
 	return retval;
 }
 
+// The states are read one after the other, as the start state of an energy call; each
+// is a complex, or a list of them whose energies are added up.
+PyObject *SimulationSystem::calculateEnergyMatrix(PyObject *states, std::vector<double>& temperatures, int typeflag) {
+
+	NupackEnergyModel* model = dynamic_cast<NupackEnergyModel*>(energyModel);
+
+	if (model == NULL) {
+		PyErr_SetString(PyExc_AttributeError, "The energy model cannot be moved to other temperatures.");
+		return NULL;
+	}
+
+	PyObject* sequence = PySequence_Fast(states, "The states should be a list of complexes, or of lists of complexes.");
+	// New Reference, released below.
+
+	if (sequence == NULL) {
+		return NULL;
+	}
+
+	EnergySeries series(model, temperatures);
+	std::vector<double> energies(temperatures.size());
+
+	Py_ssize_t count = PySequence_Fast_GET_SIZE(sequence);
+	PyObject* retval = PyTuple_New(count);
+	// New Reference, we return it.
+
+	for (Py_ssize_t index = 0; index < count; index++) {
+
+		PyObject* state = PySequence_Fast_GET_ITEM(sequence, index);
+		// Borrowed reference.
+
+		if (PyList_Check(state)) {
+			Py_INCREF(state);
+		} else if (PyTuple_Check(state)) {
+			state = PySequence_List(state);
+		} else {
+			state = Py_BuildValue("[O]", state);
+		}
+
+		InitializeSystem(state);
+		// the reference is released by generateComplexes.
+
+		if (PyErr_Occurred()) {
+			Py_DECREF(retval);
+			Py_DECREF(sequence);
+			return NULL;
+		}
+
+		std::fill(energies.begin(), energies.end(), 0.0);
+
+		for (SComplexListEntry* entry = complexList->getFirst(); entry != NULL; entry = entry->next) {
+
+			entry->thisComplex->generateLoops();
+			series.addComplex(entry->thisComplex, typeflag, energies.data());
+
+		}
+
+		PyObject* row = PyTuple_New(energies.size());
+
+		for (unsigned int i = 0; i < energies.size(); i++) {
+			PyTuple_SET_ITEM(row, i, PyFloat_FromDouble(energies[i]));
+		}
+
+		PyTuple_SET_ITEM(retval, index, row);
+		// the references are stolen by PyTuple_SET_ITEM.
+
+	}
+
+	Py_DECREF(sequence);
+
+	return retval;
+
+}
+
+PyObject *SimulationSystem::allocationStats(void) {
+
+	// New Reference, we return it.
+	return Py_BuildValue("{s:l,s:l,s:l}", "allocations", loopAllocations, "system_allocations", loopSystemAllocations, "last_system_allocations",
+			lastSystemAllocations);
+
+}
+
+bool SimulationSystem::countsPhases(void) {
+
+	return simOptions->phaseStats || !simOptions->phaseTrace.empty();
+
+}
+
+// Counts and times the phases on this thread for the runs that ask for it; the
+// statistics of the thread are cleared either way.
+void SimulationSystem::startPhases(void) {
+
+	PhaseStats::enabled = countsPhases();
+	PhaseStats::current().start(!simOptions->phaseTrace.empty());
+
+}
+
+// Keeps the statistics of the run, and writes its trace.
+void SimulationSystem::finishPhases(PhaseStats& stats) {
+
+	stats.stop();
+	phases = std::move(stats);
+
+	if (!simOptions->phaseTrace.empty() && !phases.writeTrace(simOptions->phaseTrace)) {
+		cerr << "Could not write the phase trace to " << simOptions->phaseTrace << "\n";
+	}
+
+}
+
+PyObject *SimulationSystem::phaseStats(void) {
+
+	PyObject* phaseDict = PyDict_New();
+
+	for (int i = 0; i < PHASE_COUNT; i++) {
+
+		PyObject* entry = Py_BuildValue("{s:l,s:d}", "calls", phases.calls[i], "seconds", phases.seconds(phases.ticks[i]));
+		PyDict_SetItemString(phaseDict, phaseNames[i], entry);
+		Py_DECREF(entry);
+
+	}
+
+	double seconds = std::chrono::duration<double>(phases.endTime - phases.beginTime).count();
+
+	// New Reference, we return it; "N" takes the reference to phaseDict.
+	return Py_BuildValue("{s:l,s:l,s:l,s:l,s:d,s:N}", "trajectories", phases.calls[PHASE_TRAJECTORY], "steps", phases.steps, "moves_generated",
+			phases.movesGenerated, "energy_evaluations", phases.energyEvaluations(), "seconds", seconds, "phases", phaseDict);
+
+}
+
+PyObject *SimulationSystem::kernelStats(void) {
+
+	// New Reference, we return it.
+	return Py_BuildValue("{s:l,s:l,s:d}", "validated", kernelCheck.count, "mismatches", kernelCheck.mismatches, "max_relative_error",
+			kernelCheck.maxError);
+
+}
+
 void SimulationSystem::exportTime(double& simTime, double& lastExportTime) {
 
 	if (simTime - lastExportTime > simOptions->getOTime()) {
@@ -853,23 +1393,24 @@ void SimulationSystem::localTransitions(void) {
 
 	assert(simOptions->statespaceActive);
 	energyModel->inspection = true;
+	energyModel->computeContextJoinRates();
 
 	InitializeRNG(); // the output dir will be '0' if unset
 	InitializeSystem();
 	complexList->initializeList();
 	complexList->updateOpenInfo();
 
-	uint16_t N = complexList->getMoveCount();
-	uint16_t collisions = round(complexList->getJoinFlux());
+	int N = complexList->getMoveCount();
+	int collisions = round(complexList->getJoinFlux());
 
-	for (uint16_t i = 0; i < (N + collisions); i++) {
+	for (int i = 0; i < (N + collisions); i++) {
 
 		InitializeSystem();
 		complexList->initializeList();
 		complexList->updateOpenInfo();
 		complexList->getTotalFlux();	 // required to set joinrate
 
-		SimTimer myTimer(*simOptions);
+		SimTimer myTimer(*simOptions, random);
 		myTimer.rchoice = i + 0.01;
 
 		// export the initial state
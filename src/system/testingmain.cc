@@ -4,35 +4,132 @@ Multistrand nucleic acid kinetic simulator
 help@multistrand.org
 */
 
+/* multistrand-sim: runs the simulation of a job file (see jobfile.h) without
+ Python, and writes the results to a file (see CSimOptions). Built with
+ 'make multistrand-sim'.
+
+ usage: multistrand-sim [--threads N] [--output FILE] JOBFILE
+
+ The results go to standard output if no file is given. With N other than 1,
+ the trajectories are simulated on N threads (0 for one per core) when the
+ mode allows it, see SimulationSystem::StartSimulationParallel. The states of
+ the trajectory mode, and those of output_interval and output_time, are written
+ to the #TrajectoryFile of the job.
+ */
+
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <math.h>
-#include <assert.h>
-#include <time.h>
+#include <exception>
 #include "ssystem.h"
+#include "simoptions.h"
+#include "jobfile.h"
+#include "options.h"
 
-//#define DEBUG
+static int usage(const char* program) {
 
-/* ------------------------------------------------------------------------
+	fprintf(stderr, "usage: %s [--threads N] [--output FILE] JOBFILE\n", program);
+	return 2;
 
+}
 
- Testing Main
+int main(int argc, char **argv) {
 
+	const char* jobPath = NULL;
+	const char* outputPath = NULL;
+	int threads = 1;
 
- ------------------------------------------------------------------------ */
+	for (int i = 1; i < argc; i++) {
 
-int main(int argc, char **argv) {
-	std::cout << "Working in Main \n";
-	std::cout.flush();
+		if ((strcmp(argv[i], "--threads") == 0 || strcmp(argv[i], "-t") == 0) && i + 1 < argc) {
+			threads = atoi(argv[++i]);
+		} else if ((strcmp(argv[i], "--output") == 0 || strcmp(argv[i], "-o") == 0) && i + 1 < argc) {
+			outputPath = argv[++i];
+		} else if (argv[i][0] == '-' || jobPath != NULL) {
+			return usage(argv[0]);
+		} else {
+			jobPath = argv[i];
+		}
+	}
+
+	if (jobPath == NULL) {
+		return usage(argv[0]);
+	}
+
+	JobFile job(jobPath);
+
+	if (!job.error.empty()) {
+		fprintf(stderr, "%s", job.error.c_str());
+		return 1;
+	}
+
+	FILE* output = stdout;
+
+	if (outputPath != NULL && (output = fopen(outputPath, "w")) == NULL) {
+		fprintf(stderr, "Could not open the result file %s\n", outputPath);
+		return 1;
+	}
+
+	CSimOptions* options = new CSimOptions(&job, output);
+
+	if (!job.error.empty()) {
+		fprintf(stderr, "%s", job.error.c_str());
+		return 1;
+	}
+
+	vector<string> unused = job.unusedSettings();
 
-//  SimulationSystem *ssystem;
-//  ssystem = new SimulationSystem( argc, argv );
-//  ssystem->StartSimulation();
-//  delete ssystem;
+	for (unsigned int i = 0; i < unused.size(); i++) {
+		fprintf(stderr, "Warning: unknown setting #%s is ignored.\n", unused[i].c_str());
+	}
 
+	long mode = options->getSimulationMode();
+	bool exportStates = (mode & SIMULATION_MODE_FLAG_TRAJECTORY) || options->getOInterval() > 0 || options->getOTime() >= 0;
+
+	if (mode & SIMULATION_MODE_FLAG_TRANSITION) {
+		fprintf(stderr, "The transition mode needs Python.\n");
+		return 1;
+	}
+
+	// without Python, the states can only go to the trajectory file.
+	if (exportStates) {
+
+		FILE* test = NULL;
+
+		if (options->trajectoryFile.empty() || (test = fopen(options->trajectoryFile.c_str(), "wb")) == NULL) {
+			fprintf(stderr, "The states of the trajectory mode, #OutputInterval and #OutputTime need a #TrajectoryFile that can be written.\n");
+			return 1;
+		}
+
+		fclose(test);
+	}
+
+	try {
+
+		SimulationSystem* system = new SimulationSystem(options);
+
+		if (threads != 1 && system->parallelUnsupported() == NULL) {
+			system->StartSimulationParallel(threads);
+		} else {
+			if (threads != 1) {
+				fprintf(stderr, "%s Simulating on one thread.\n", system->parallelUnsupported());
+			}
+			system->StartSimulation();
+		}
+
+		delete system;
+
+	} catch (std::exception& e) {
+
+		fprintf(stderr, "%s\n", e.what());
+		return 1;
+
+	}
+
+	if (output != stdout) {
+		fclose(output);
+	}
 
 	return 0;
 
 }
-
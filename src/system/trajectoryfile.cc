@@ -0,0 +1,716 @@
+/*
+ Copyright (c) 2017 California Institute of Technology. All rights reserved.
+ Multistrand nucleic acid kinetic simulator
+ help@multistrand.org
+ */
+
+#include <scomplexlist.h>
+#include <scomplex.h>
+#include <trajectoryfile.h>
+
+#include <string.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <iostream>
+
+const string TrajectoryFile::STRUCTURE_SUFFIX = ".structures";
+
+// the stdio buffer of each file
+const size_t TRAJECTORY_BUFFER = 1 << 20;
+
+TrajectoryFile::TrajectoryFile(const string& path, long keyframeInterval) :
+		path(path), keyframeInterval(keyframeInterval) {
+
+	records = fopen(path.c_str(), "wb");
+	structures = fopen((path + STRUCTURE_SUFFIX).c_str(), "wb");
+
+	if (records == NULL || structures == NULL) {
+
+		std::cerr << "Could not open the trajectory file " << path << ", the states are sent to Python instead. \n";
+
+		if (records != NULL) {
+			fclose(records);
+		}
+		if (structures != NULL) {
+			fclose(structures);
+		}
+		records = NULL;
+		structures = NULL;
+		return;
+
+	}
+
+	setvbuf(records, NULL, _IOFBF, TRAJECTORY_BUFFER);
+	setvbuf(structures, NULL, _IOFBF, TRAJECTORY_BUFFER);
+
+}
+
+TrajectoryFile::~TrajectoryFile(void) {
+
+	if (records != NULL) {
+		fclose(records);
+	}
+
+	if (structures != NULL) {
+		fclose(structures);
+	}
+
+}
+
+bool TrajectoryFile::isOpen(void) {
+
+	return records != NULL;
+
+}
+
+long TrajectoryFile::getCount(void) {
+
+	return count;
+
+}
+
+std::vector<FlipEvent>* TrajectoryFile::getFlipLog(void) {
+
+	if (records == NULL || keyframeInterval <= 0) {
+		return NULL;
+	}
+
+	return &flips;
+
+}
+
+void TrajectoryFile::flush(void) {
+
+	if (records != NULL) {
+		fflush(records);
+		fflush(structures);
+	}
+
+}
+
+// The strand table is the strands of the first state, in the order of the complex list.
+void TrajectoryFile::writeHeader(SComplexList* complexList) {
+
+	string table;
+
+	for (SComplexListEntry* entry = complexList->getFirst(); entry != NULL; entry = entry->next) {
+		for (orderingList* strand = entry->thisComplex->ordering->first; strand != NULL; strand = strand->next) {
+
+			strandNames.push_back(strand->thisTag);
+			strandSequences.push_back(strand->thisSeq);
+
+			table += strand->thisTag;
+			table += " ";
+			table += strand->thisSeq;
+			table += "\n";
+
+		}
+	}
+
+	TrajectoryFileHeader header;
+
+	memcpy(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic));
+	header.version = TRAJECTORY_VERSION;
+	header.recordSize = sizeof(TrajectoryRecord);
+	header.strandCount = strandNames.size();
+	header.keyframeInterval = (keyframeInterval > 0) ? keyframeInterval : 0;
+
+	while ((sizeof(TrajectoryFileHeader) + table.size()) % 8 != 0) {
+		table += "\n";
+	}
+
+	header.headerSize = sizeof(TrajectoryFileHeader) + table.size();
+
+	fwrite(&header, sizeof(header), 1, records);
+	fwrite(table.data(), 1, table.size(), records);
+
+}
+
+// the strand table index of a strand of the current trajectory.
+int TrajectoryFile::strandIndex(orderingList* strand) {
+
+	std::unordered_map<orderingList*, int>::iterator it = strandOf.find(strand);
+
+	if (it != strandOf.end()) {
+		return it->second;
+	}
+
+	for (unsigned int i = 0; i < strandNames.size(); i++) {
+
+		if (!taken[i] && strandNames[i] == strand->thisTag && strandSequences[i] == strand->thisSeq) {
+
+			taken[i] = true;
+			strandOf[strand] = i;
+			return i;
+
+		}
+	}
+
+	std::cerr << "The strand " << strand->thisTag << " is not in the strand table of " << path << ". \n";
+
+	strandOf[strand] = -1;
+	return -1;
+
+}
+
+void TrajectoryFile::appendNumber(long value) {
+
+	char number[24];
+	snprintf(number, sizeof(number), "%ld", value);
+	line += number;
+
+}
+
+// the strands of every complex, and, for a keyframe, their structures.
+void TrajectoryFile::appendComplexes(SComplexList* complexList, bool withStructures) {
+
+	for (SComplexListEntry* entry = complexList->getFirst(); entry != NULL; entry = entry->next) {
+
+		if (entry != complexList->getFirst()) {
+			line += ' ';
+		}
+
+		orderingList* first = entry->thisComplex->ordering->first;
+
+		for (orderingList* strand = first; strand != NULL; strand = strand->next) {
+
+			if (strand != first) {
+				line += ',';
+			}
+
+			appendNumber(strandIndex(strand));
+
+		}
+
+		if (!withStructures) {
+			continue;
+		}
+
+		line += ':';
+
+		for (orderingList* strand = first; strand != NULL; strand = strand->next) {
+
+			if (strand != first) {
+				line += '+';
+			}
+
+			line.append(strand->thisStruct, strand->size);
+
+		}
+	}
+
+}
+
+void TrajectoryFile::appendDelta(SComplexList* complexList) {
+
+	bool moved = false; // if complexes were joined or split
+
+	for (unsigned int i = 0; i < flips.size(); i++) {
+
+		FlipEvent& flip = flips[i];
+
+		if (i > 0) {
+			line += ' ';
+		}
+
+		line += flip.type;
+		appendNumber(strandIndex(flip.strands[0]));
+		line += ':';
+		appendNumber(flip.positions[0]);
+		line += ':';
+		appendNumber(strandIndex(flip.strands[1]));
+		line += ':';
+		appendNumber(flip.positions[1]);
+
+		moved = moved || flip.type == FLIP_JOIN || flip.type == FLIP_SPLIT;
+
+	}
+
+	if (moved) {
+
+		line += '|';
+		appendComplexes(complexList, false);
+
+	}
+
+}
+
+void TrajectoryFile::addState(SComplexList* complexList, long seed, double time, double arrType) {
+
+	if (records == NULL) {
+		return;
+	}
+
+	if (count == 0) {
+		writeHeader(complexList);
+	}
+
+	bool newTrajectory = (count == 0 || seed != lastSeed);
+
+	if (newTrajectory) {
+
+		// the strands of the events of the trajectory before are gone.
+		flips.clear();
+		strandOf.clear();
+		taken.assign(strandNames.size(), false);
+		lastSeed = seed;
+
+	}
+
+	bool keyframe = newTrajectory || keyframeInterval <= 0 || count - lastKeyframe >= keyframeInterval;
+
+	if (keyframe) {
+		lastKeyframe = count;
+	}
+
+	TrajectoryRecord record;
+
+	record.time = time;
+	record.arrType = arrType;
+	record.energy = 0.0;
+	record.seed = seed;
+	record.keyframe = lastKeyframe;
+	record.offset = offset;
+	record.complexes = 0;
+
+	for (SComplexListEntry* entry = complexList->getFirst(); entry != NULL; entry = entry->next) {
+
+		record.energy += entry->energy;
+		record.complexes++;
+
+	}
+
+	line.clear();
+
+	if (keyframe) {
+		appendComplexes(complexList, true);
+	} else {
+		appendDelta(complexList);
+	}
+
+	flips.clear();
+
+	record.length = line.size();
+
+	line += '\n';
+
+	fwrite(line.data(), 1, line.size(), structures);
+	fwrite(&record, sizeof(record), 1, records);
+
+	offset += line.size();
+	count++;
+
+}
+
+// TrajectoryReader
+
+static bool fileVersion(const string& path, FileVersion& version) {
+
+	struct stat status;
+
+	if (stat(path.c_str(), &status) != 0) {
+		return false;
+	}
+
+#ifdef __APPLE__
+	const struct timespec& modified = status.st_mtimespec;
+#else
+	const struct timespec& modified = status.st_mtim;
+#endif
+
+	version.device = status.st_dev;
+	version.inode = status.st_ino;
+	version.size = status.st_size;
+	version.modified = (int64_t) modified.tv_sec * 1000000000 + modified.tv_nsec;
+
+	return true;
+
+}
+
+TrajectoryReader::TrajectoryReader(const string& path) :
+		path(path) {
+
+	memset(versions, 0, sizeof(versions));
+	fileVersion(path, versions[0]);
+	fileVersion(path + TrajectoryFile::STRUCTURE_SUFFIX, versions[1]);
+
+	records = fopen(path.c_str(), "rb");
+	structures = fopen((path + TrajectoryFile::STRUCTURE_SUFFIX).c_str(), "rb");
+
+	if (records == NULL || structures == NULL) {
+		error = "Could not open the trajectory file " + path + ".";
+		return;
+	}
+
+	if (fread(&header, sizeof(header), 1, records) != 1 || memcmp(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic)) != 0
+			|| header.version != TRAJECTORY_VERSION || header.recordSize != sizeof(TrajectoryRecord)) {
+		error = path + " is not a trajectory file of this version of Multistrand.";
+		return;
+	}
+
+	string table(header.headerSize - sizeof(header), '\0');
+
+	if (fread(&table[0], 1, table.size(), records) != table.size()) {
+		error = "The strand table of " + path + " is incomplete.";
+		return;
+	}
+
+	// the lines are "name sequence"
+	size_t start = 0;
+	int bases = 0;
+
+	for (uint32_t i = 0; i < header.strandCount; i++) {
+
+		size_t end = table.find('\n', start);
+		size_t space = table.rfind(' ', end);
+
+		if (end == string::npos || space == string::npos || space < start) {
+			error = "The strand table of " + path + " is incomplete.";
+			return;
+		}
+
+		strandStart.push_back(bases);
+		strandSize.push_back(end - space - 1);
+		bases += end - space - 1;
+
+		start = end + 1;
+
+	}
+
+	partner.assign(bases, -1);
+
+}
+
+TrajectoryReader::~TrajectoryReader(void) {
+
+	if (records != NULL) {
+		fclose(records);
+	}
+
+	if (structures != NULL) {
+		fclose(structures);
+	}
+
+}
+
+const string& TrajectoryReader::getPath(void) {
+
+	return path;
+
+}
+
+bool TrajectoryReader::unchanged(void) {
+
+	FileVersion now[2];
+
+	if (!fileVersion(path, now[0]) || !fileVersion(path + TrajectoryFile::STRUCTURE_SUFFIX, now[1])) {
+		return false;
+	}
+
+	for (int i = 0; i < 2; i++) {
+		if (now[i].device != versions[i].device || now[i].inode != versions[i].inode || now[i].size != versions[i].size
+				|| now[i].modified != versions[i].modified) {
+			return false;
+		}
+	}
+
+	return true;
+
+}
+
+long TrajectoryReader::size(void) {
+
+	if (!error.empty()) {
+		return 0;
+	}
+
+	// the writer may still be appending.
+	fseek(records, 0, SEEK_END);
+	return (ftell(records) - header.headerSize) / header.recordSize;
+
+}
+
+bool TrajectoryReader::readRecord(long index, TrajectoryRecord& record) {
+
+	fseek(records, header.headerSize + index * header.recordSize, SEEK_SET);
+	return fread(&record, sizeof(record), 1, records) == 1;
+
+}
+
+void TrajectoryReader::readLine(TrajectoryRecord& record, string& output) {
+
+	output.resize(record.length);
+	fseek(structures, record.offset, SEEK_SET);
+
+	if (record.length > 0 && fread(&output[0], 1, record.length, structures) != record.length) {
+		output.clear();
+	}
+
+}
+
+bool TrajectoryReader::state(long index, string& output) {
+
+	TrajectoryRecord record;
+
+	stateError.clear();
+
+	if (!error.empty() || index < 0 || index >= size() || !readRecord(index, record)) {
+		return false;
+	}
+
+	long from = current + 1;
+
+	// otherwise the state is reached from the state read last.
+	if (current < 0 || currentKeyframe != (long) record.keyframe || index < current) {
+
+		TrajectoryRecord keyframe;
+
+		if (record.keyframe > (uint64_t) index || !readRecord(record.keyframe, keyframe)) {
+			return invalid(index);
+		}
+
+		readLine(keyframe, line);
+
+		if (!loadKeyframe(line)) {
+			return invalid(index);
+		}
+
+		currentKeyframe = record.keyframe;
+		from = record.keyframe + 1;
+
+	}
+
+	for (long i = from; i <= index; i++) {
+
+		TrajectoryRecord delta;
+		readRecord(i, delta);
+		readLine(delta, line);
+
+		if (!applyDelta(line)) {
+			return invalid(index);
+		}
+
+	}
+
+	current = index;
+	render(output);
+
+	return true;
+
+}
+
+// The state read last is gone, so the next one starts from its keyframe.
+bool TrajectoryReader::invalid(long index) {
+
+	char number[24];
+	snprintf(number, sizeof(number), "%ld", index);
+
+	stateError = "The state " + string(number) + " of " + path + " refers to a strand or base that is not in its strand table.";
+	current = -1;
+
+	return false;
+
+}
+
+bool TrajectoryReader::isBase(long strand, long position) {
+
+	return strand >= 0 && strand < (long) strandSize.size() && position >= 0 && position < strandSize[strand];
+
+}
+
+bool TrajectoryReader::loadKeyframe(const string& keyframe) {
+
+	partner.assign(partner.size(), -1);
+
+	if (!setComplexes(keyframe.c_str())) {
+		return false;
+	}
+
+	// the structure of each complex follows its strands
+	size_t start = 0;
+	std::vector<int> open;
+
+	for (unsigned int c = 0; c < complexes.size(); c++) {
+
+		size_t colon = keyframe.find(':', start);
+
+		if (colon == string::npos) {
+			return false;
+		}
+
+		size_t position = colon + 1;
+
+		for (unsigned int s = 0; s < complexes[c].size(); s++) {
+
+			int strand = complexes[c][s];
+
+			if (position + strandSize[strand] > keyframe.size()) {
+				return false;
+			}
+
+			for (int i = 0; i < strandSize[strand]; i++, position++) {
+
+				int base = strandStart[strand] + i;
+
+				if (keyframe[position] == '(') {
+					open.push_back(base);
+				} else if (keyframe[position] == ')') {
+					if (open.empty()) {
+						return false;
+					}
+					partner[base] = open.back();
+					partner[open.back()] = base;
+					open.pop_back();
+				}
+			}
+
+			position++; // the '+', or the ' ' after the complex
+		}
+
+		start = position;
+
+	}
+
+	return open.empty();
+
+}
+
+// the complexes of "0,1:((+)) 2:..." or "0,1 2"
+bool TrajectoryReader::setComplexes(const char* text) {
+
+	complexes.clear();
+	complexes.push_back(std::vector<int>());
+
+	while (*text != '\0') {
+
+		char* end;
+		long strand = strtol(text, &end, 10);
+
+		if (end == text || !isBase(strand, 0)) {
+			return false;
+		}
+
+		complexes.back().push_back(strand);
+		text = end;
+
+		if (*text == ':') { // skip the structure
+			text = strchr(text, ' ');
+			if (text == NULL) {
+				return true;
+			}
+		}
+
+		if (*text == ' ') {
+			complexes.push_back(std::vector<int>());
+		}
+
+		if (*text != '\0') {
+			text++;
+		}
+	}
+
+	return true;
+
+}
+
+bool TrajectoryReader::applyDelta(const string& delta) {
+
+	const char* text = delta.c_str();
+
+	while (*text != '\0' && *text != '|') {
+
+		char type = *text++;
+		long values[4];
+
+		for (int i = 0; i < 4; i++) {
+			char* end;
+			values[i] = strtol(text, &end, 10);
+			text = (*end == ':') ? end + 1 : end;
+		}
+
+		if (!isBase(values[0], values[1]) || !isBase(values[2], values[3])) {
+			return false;
+		}
+
+		int left = strandStart[values[0]] + values[1];
+		int right = strandStart[values[2]] + values[3];
+
+		if (type == FLIP_CREATE || type == FLIP_JOIN) {
+			partner[left] = right;
+			partner[right] = left;
+		} else {
+			partner[left] = -1;
+			partner[right] = -1;
+		}
+
+		if (*text == ' ') {
+			text++;
+		}
+	}
+
+	if (*text == '|') {
+		return setComplexes(text + 1);
+	}
+
+	return true;
+
+}
+
+// the keyframe line of the current state: a pair is '(' at its first base in the
+// order of the strands of the complex.
+void TrajectoryReader::render(string& output) {
+
+	output.clear();
+	linear.resize(partner.size());
+
+	for (unsigned int c = 0; c < complexes.size(); c++) {
+
+		if (c > 0) {
+			output += ' ';
+		}
+
+		int position = 0;
+
+		for (unsigned int s = 0; s < complexes[c].size(); s++) {
+
+			int strand = complexes[c][s];
+
+			if (s > 0) {
+				output += ',';
+			}
+
+			char number[24];
+			snprintf(number, sizeof(number), "%d", strand);
+			output += number;
+
+			for (int i = 0; i < strandSize[strand]; i++) {
+				linear[strandStart[strand] + i] = position++;
+			}
+		}
+
+		output += ':';
+
+		for (unsigned int s = 0; s < complexes[c].size(); s++) {
+
+			int strand = complexes[c][s];
+
+			if (s > 0) {
+				output += '+';
+			}
+
+			for (int i = 0; i < strandSize[strand]; i++) {
+
+				int base = strandStart[strand] + i;
+
+				if (partner[base] < 0) {
+					output += '.';
+				} else if (linear[partner[base]] > linear[base]) {
+					output += '(';
+				} else {
+					output += ')';
+				}
+			}
+		}
+	}
+
+}
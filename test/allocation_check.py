@@ -0,0 +1,71 @@
+from multistrand.objects import Complex, Domain, Strand
+from multistrand.options import Options, Literals
+from multistrand.system import SimSystem
+
+import unittest
+
+""" Checks that the simulation loop stops calling the global allocator once the
+    memory pool has grown to the size of a trajectory. Runs a number of
+    three-way branch migration trajectories, with either selection engine, and
+    fails if the steps of the last one called the global allocator, as counted
+    by SimSystem.allocationStats(): the calls made by the pool, or every call of
+    the global operator new when the module is built with
+    CFLAGS=-DMEMPOOL_COUNT_GLOBAL.
+
+    usage: python allocation_check.py
+"""
+
+
+def branch_migration():
+
+    toehold = Domain(name="toehold", sequence="GTGGGT")
+    bm = Domain(name="bm", sequence="ACCGCACGTCACTCACCTCG")
+
+    substrate = toehold + bm
+    incumbent = Strand(name="incumbent", domains=[bm.C])
+    incoming = substrate.C
+
+    start = Complex(strands=[substrate, incumbent, incoming],
+                    structure="((((((((((((((((((((((((((+))))))))))))))))))))+....................))))))")
+
+    return [start]
+
+
+def run(num_simulations, engine):
+
+    o = Options(simulation_mode=Literals.first_passage_time, num_simulations=num_simulations, temperature=25.0)
+    o.DNA23Metropolis()
+    o.simulation_time = 1e-3
+    o.start_state = branch_migration()
+    o.initial_seed = 1777
+    o.verbosity = 0
+    o.selection_engine = engine
+
+    s = SimSystem(o)
+    s.start()
+
+    return s.allocationStats()
+
+
+class AllocationTestCase(unittest.TestCase):
+
+    def check(self, engine):
+
+        stats = run(20, engine)
+
+        self.assertGreater(stats["allocations"], 0)
+        self.assertEqual(stats["last_system_allocations"], 0,
+                         "the steps of the last trajectory made {0} calls to the global allocator".format(stats["last_system_allocations"]))
+
+    def test_linear(self):
+        """ the linear selection engine """
+        self.check(Literals.selection_linear)
+
+    def test_sumtree(self):
+        """ the sum-tree selection engine """
+        self.check(Literals.selection_sumtree)
+
+
+if __name__ == '__main__':
+
+    unittest.main(verbosity=2)
@@ -0,0 +1,143 @@
+from multistrand.options import Literals
+from multistrand.system import SimSystem
+
+from parallel_check import setup
+
+import subprocess
+import unittest
+import os
+import time
+import sys
+
+""" Checks that multistrand-sim (make multistrand-sim), given a job file written
+    from the Options of parallel_check, gives the same results as SimSystem.start,
+    for the first step and first passage time modes, and that a job without scalings
+    writes its results to stdout and the warning to stderr. Fails if the results
+    differ. The time taken, including the start of the process, is printed after
+    the tests.
+
+    usage: python cli_check.py [trajectories, default 200] [executable, default ../multistrand-sim]
+"""
+
+num_simulations = 200
+executable = "../multistrand-sim"
+
+times = []  # printed after the tests
+
+stopTypes = ["exact", "bound", "dissoc", "loose", "count"]
+
+
+def write_job(o, path):
+
+    strands = []
+    lines = []
+
+    def names(complex):
+        for s in complex.strand_list:
+            if (s.name, s.sequence) not in strands:
+                strands.append((s.name, s.sequence))
+        return ",".join(s.name for s in complex.strand_list)
+
+    lines.append("#StartStructure")
+    for c in o.start_state:
+        lines.append(names(c))
+        lines.append(c.structure)
+
+    lines.append("#StopStructures")
+    for stop in o.stop_conditions:
+        for c, stoptype, count in stop.complex_items:
+            lines.append(names(c))
+            lines.append("{0}  {1} {2}".format(c._fixed_structure, stopTypes[stoptype], count))
+        lines.append("TAG: " + stop.tag)
+    lines.append("##")
+
+    settings = [("SimulationMode", o.simulation_mode), ("NumSims", o.num_simulations), ("SimTime", repr(o.simulation_time)),
+                ("Seed", o.initial_seed), ("Temperature", repr(o.temperature)), ("Ratemethod", o.rate_method),
+                ("Dangles", o.dangles), ("Energymodel", o.substrate_type), ("Intra", repr(o.unimolecular_scaling)),
+                ("Inter", repr(o.bimolecular_scaling)), ("JoinConcentration", repr(o.join_concentration)),
+                ("Sodium", repr(o.sodium)), ("Magnesium", repr(o.magnesium)), ("Verbosity", o.verbosity)]
+
+    job = ["#Strands"] + ["{0},{1}".format(name, sequence) for name, sequence in strands] + lines
+    job += ["#{0}={1}".format(key, value) for key, value in settings]
+
+    with open(path, "w") as f:
+        f.write("\n".join(job) + "\n")
+
+
+def read_results(lines, first_step):
+
+    results = []
+
+    for line in lines:
+        if line.startswith("#"):
+            continue
+        fields = line.rstrip("\n").split("\t")
+        rate = float(fields[3]) if first_step else None
+        results.append((int(fields[0]), fields[1], float(fields[2]), rate))
+
+    return results
+
+
+class CommandLineTestCase(unittest.TestCase):
+
+    def check(self, mode, name):
+
+        o = setup(mode, num_simulations)
+        write_job(o, "cli_check.job")
+
+        begin = time.time()
+        SimSystem(o).start()
+        python_time = time.time() - begin
+
+        first_step = mode == Literals.first_step
+        python = [(r.seed, r.tag, r.time, r.collision_rate if first_step else None) for r in o.interface.results]
+
+        begin = time.time()
+        code = subprocess.call([executable, "--output", "cli_check.txt", "cli_check.job"])
+        cli_time = time.time() - begin
+
+        times.append("{0:<20} python = {1:8.3f} s   multistrand-sim = {2:8.3f} s".format(name, python_time, cli_time))
+
+        self.assertEqual(code, 0)
+        self.assertEqual(len(python), num_simulations)
+        self.assertEqual(read_results(open("cli_check.txt"), first_step), python)
+
+    def test_first_step(self):
+        self.check(Literals.first_step, "first step")
+
+    def test_first_passage_time(self):
+        self.check(Literals.first_passage_time, "first passage time")
+
+    def test_unscaled(self):
+        """ results on stdout, and the warning for unset scalings on stderr """
+
+        # without #Intra and #Inter the scalings are reset with a warning, which must not
+        # end up in the results on stdout.
+        write_job(setup(Literals.first_passage_time, num_simulations), "cli_check.job")
+        job = [line for line in open("cli_check.job") if not line.startswith("#Intra") and not line.startswith("#Inter")]
+        with open("cli_check.job", "w") as f:
+            f.writelines(job)
+
+        code = subprocess.call([executable, "--output", "cli_check.txt", "cli_check.job"], stderr=open(os.devnull, "w"))
+        process = subprocess.Popen([executable, "cli_check.job"], stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+        output, errors = process.communicate()
+
+        self.assertEqual(code, 0)
+        self.assertEqual(process.returncode, 0)
+        self.assertEqual(read_results(output.decode().splitlines(True), False), read_results(open("cli_check.txt"), False))
+        self.assertIn("Warning", errors.decode())
+
+
+if __name__ == '__main__':
+
+    if len(sys.argv) > 1:
+        num_simulations = int(sys.argv[1])
+    if len(sys.argv) > 2:
+        executable = sys.argv[2]
+
+    program = unittest.main(argv=sys.argv[:1], verbosity=2, exit=False)
+
+    for line in times:
+        print(line)
+
+    sys.exit(not program.result.wasSuccessful())
@@ -0,0 +1,81 @@
+from multistrand.options import Literals
+from multistrand.system import SimSystem
+
+from parallel_check import setup
+
+import unittest
+import time
+import sys
+
+""" Checks that a run with Options.columnar_results set gives the same results as a
+    normal run, both through the result objects (built on request) and through the
+    arrays, and fails if they differ. Without numpy, the arrays are skipped. The
+    time taken to collect the results is printed after the tests.
+
+    usage: python columnar_check.py [trajectories, default 500]
+"""
+
+num_simulations = 500
+
+times = []  # printed after the tests
+
+
+def run(mode, num_simulations, columnar):
+
+    o = setup(mode, num_simulations)
+    o.columnar_results = columnar
+    s = SimSystem(o)
+
+    begin = time.time()
+    s.start()
+    elapsed = time.time() - begin
+
+    return o, elapsed
+
+
+def summary(results):
+
+    return [(r.seed, r.com_type, r.tag, r.time, getattr(r, "collision_rate", None), r.start_state) for r in results]
+
+
+class ColumnarTestCase(unittest.TestCase):
+
+    def check(self, mode, name):
+
+        normal, normal_time = run(mode, num_simulations, False)
+        columnar, columnar_time = run(mode, num_simulations, True)
+
+        times.append("{0:<20} normal = {1:8.3f} s   columnar = {2:8.3f} s".format(name, normal_time, columnar_time))
+
+        results = normal.interface.results
+
+        self.assertEqual(len(results), num_simulations)
+        self.assertEqual(summary(results), summary(columnar.interface.results), "the result objects differ")
+
+        try:
+            columns = columnar.interface.result_columns()
+        except ImportError:
+            self.skipTest("no numpy for the columns")
+
+        self.assertEqual(list(columns["seed"]), [r.seed for r in results], "the seed column differs")
+        self.assertEqual(list(columns["time"]), [r.time for r in results], "the time column differs")
+        self.assertEqual([columns["tags"][i] for i in columns["tag_id"]], [r.tag for r in results], "the tag column differs")
+
+    def test_first_step(self):
+        self.check(Literals.first_step, "first step")
+
+    def test_first_passage_time(self):
+        self.check(Literals.first_passage_time, "first passage time")
+
+
+if __name__ == '__main__':
+
+    if len(sys.argv) > 1:
+        num_simulations = int(sys.argv[1])
+
+    program = unittest.main(argv=sys.argv[:1], verbosity=2, exit=False)
+
+    for line in times:
+        print(line)
+
+    sys.exit(not program.result.wasSuccessful())
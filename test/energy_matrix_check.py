@@ -0,0 +1,179 @@
+from multistrand.objects import Complex, Strand
+from multistrand.options import Options, Literals
+from multistrand.system import energy, energy_matrix
+
+import unittest
+import random
+import time
+import sys
+
+""" Checks that multistrand.system.energy_matrix gives the energies of energy(), with
+    an energy model made at each temperature, for random one- and two-stranded
+    structures (hairpins, bulges, interior loops, multiloops and open loops), every
+    energy type, DNA and RNA and every dangles setting, and for a melting curve in
+    Kelvin and in Celsius; fails if not. The time taken by the two for the melting
+    curve is printed after the tests.
+
+    usage: python energy_matrix_check.py [structures, default 200] [temperatures, default 32]
+"""
+
+pairs = ["AT", "TA", "GC", "CG", "GT", "TG"]
+
+count = 200
+steps = 32
+
+times = []  # printed after the tests
+
+
+# a random nested structure of the given length, with its sequence.
+def random_structure(length):
+
+    structure = ["."] * length
+    sequence = [random.choice("ACGT") for i in range(length)]
+
+    def fill(begin, end):
+
+        i = begin
+
+        while i < end:
+
+            stem = random.randint(2, 6)
+
+            if end - i >= 2 * stem + 3 and random.random() < 0.3:
+
+                close = random.randint(i + 2 * stem + 3, end)
+
+                for k in range(stem):
+                    structure[i + k], structure[close - 1 - k] = "(", ")"
+                    sequence[i + k], sequence[close - 1 - k] = random.choice(pairs)
+
+                fill(i + stem, close - stem)
+                i = close
+
+            else:
+                i += 1
+
+    fill(0, length)
+
+    return "".join(sequence), "".join(structure)
+
+
+def random_complex(index, strands):
+
+    length = random.randint(20, 60)
+    sequence, structure = random_structure(length)
+
+    if strands == 1:
+        return Complex(strands=[Strand(name="s%d" % index, sequence=sequence)], structure=structure)
+
+    # a nick next to an unpaired base, inside a base pair so that the strands are connected.
+    while structure.count("(") == 0:
+        sequence, structure = random_structure(length)
+
+    depth = [structure[:k].count("(") - structure[:k].count(")") for k in range(length)]
+    cut = random.choice([k for k in range(1, length) if depth[k] > 0 and "." in structure[k - 1:k + 1]])
+
+    return Complex(strands=[Strand(name="s%d" % index, sequence=sequence[:cut]), Strand(name="t%d" % index, sequence=sequence[cut:])],
+                   structure=structure[:cut] + "+" + structure[cut:])
+
+
+def options(substrate, dangles, temperature=310.15):
+
+    o = Options(substrate_type=substrate, dangles=dangles)
+    o.temperature = temperature
+
+    return o
+
+
+# one energy() call per temperature, for the complexes of all the states; it gives
+# their energies last to first.
+def per_temperature(states, temperatures, substrate, dangles, energy_type):
+
+    rows = [[] for state in states]
+
+    for temperature in temperatures:
+
+        o = options(substrate, dangles, temperature)
+        values = reversed(energy([c for state in states for c in state], o, energy_type))
+
+        for row, state in zip(rows, states):
+            row.append(sum(next(values) for c in state))
+
+    return rows
+
+
+def close(matrix, rows):
+
+    return all(abs(x - y) <= 1e-6 * max(1.0, abs(y)) for a, b in zip(matrix, rows) for x, y in zip(a, b))
+
+
+class EnergyMatrixTestCase(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+
+        random.seed(7)
+
+        cls.states = [[random_complex(i, 1 + i % 2)] for i in range(count)]
+        cls.states += [[random_complex(count + i, 1), random_complex(2 * count + i, 2)] for i in range(count // 10)]
+
+        # 1 to 99 C, the temperatures that Options takes.
+        cls.temperatures = [274.15 + 98.0 * k / (steps - 1) for k in range(steps)]
+
+    def test_variants(self):
+        """ every substrate, dangles setting and energy type """
+
+        states = self.states
+        few = self.temperatures[::4] + [self.temperatures[-1]]
+
+        substrates = [("DNA", Literals.substrateDNA), ("RNA", Literals.substrateRNA)]
+        settings = [("none", Literals.dangles_none), ("some", Literals.dangles_some), ("all", Literals.dangles_all)]
+        differ = []
+
+        for sname, substrate in substrates:
+            for dname, dangles in settings:
+
+                o = options(substrate, dangles)
+
+                for energy_type in range(4):
+                    if not close(energy_matrix(states, few, o, energy_type), per_temperature(states, few, substrate, dangles, energy_type)):
+                        differ.append("{0} dangles {1} energy type {2}".format(sname, dname, energy_type))
+
+        self.assertEqual(differ, [], "energy_matrix differs from energy()")
+
+    def test_melting_curve(self):
+        """ DNA, dangles some, in Kelvin and in Celsius """
+
+        states, temperatures = self.states, self.temperatures
+        o = options(Literals.substrateDNA, Literals.dangles_some)
+
+        begin = time.time()
+        matrix = energy_matrix(states, temperatures, o, 3)
+        batched = time.time() - begin
+
+        begin = time.time()
+        rows = per_temperature(states, temperatures, Literals.substrateDNA, Literals.dangles_some, 3)
+        separate = time.time() - begin
+
+        times.append("{0} states x {1} temperatures: energy per temperature = {2:8.3f} s   energy_matrix = {3:8.3f} s".format(
+            len(states), steps, separate, batched))
+
+        celsius = energy_matrix(states, [t - 273.15 for t in temperatures], o, 3)
+
+        self.assertTrue(close(matrix, rows), "energy_matrix differs from energy()")
+        self.assertTrue(close(celsius, matrix), "the Celsius temperatures give other energies")
+
+
+if __name__ == '__main__':
+
+    if len(sys.argv) > 1:
+        count = int(sys.argv[1])
+    if len(sys.argv) > 2:
+        steps = int(sys.argv[2])
+
+    program = unittest.main(argv=sys.argv[:1], verbosity=2, exit=False)
+
+    for line in times:
+        print(line)
+
+    sys.exit(not program.result.wasSuccessful())
@@ -0,0 +1,180 @@
+from multistrand.objects import Complex, StopCondition
+from multistrand.options import Options, Literals
+from multistrand.system import SimSystem, energy
+
+from parallel_check import setup
+from energy_matrix_check import random_complex
+
+import unittest
+import random
+import time
+import sys
+
+""" Runs the three-way branch migration of parallel_check, and a hybridization of
+    its substrate and invader, for DNA and RNA, every dangles setting and every
+    rate method, and checks that every configuration completes its trajectories
+    and gives the same results with the energy model specialized for its dangles
+    setting and rate method as with the generic one (Options.specialized_model),
+    and that the two give the same energies for random one- and two-stranded
+    structures, of every energy type.
+    Given the output of an earlier build (saved with --save), also checks that
+    every configuration gives the same results as it did; fails if not. The time
+    taken, and how it changed since, are printed after the tests.
+
+    usage: python energy_variants_check.py [--save FILE | --compare FILE] [trajectories, default 200]
+"""
+
+substrates = [("DNA", Literals.substrateDNA), ("RNA", Literals.substrateRNA)]
+dangles = [("none", Literals.dangles_none), ("some", Literals.dangles_some), ("all", Literals.dangles_all)]
+methods = [("Metropolis", Literals.metropolis), ("Kawasaki", Literals.kawasaki), ("Arrhenius", Literals.arrhenius)]
+
+num_simulations = 200
+save = compare = None  # paths of the outcome to write, and of the earlier one
+
+
+# the substrate and invader of parallel_check, until their duplex is formed but for 4 base pairs.
+def hybridization(num_simulations):
+
+    o = setup(Literals.first_passage_time, 1)
+    substrate, invader = o.start_state[0].strand_list[0], o.start_state[1].strand_list[0]
+
+    duplex = Complex(strands=[substrate, invader], structure="(" * 26 + "+" + ")" * 26)
+
+    o = Options(simulation_mode=Literals.first_passage_time, num_simulations=num_simulations, temperature=25.0)
+    o.DNA23Metropolis()
+    o.simulation_time = 1e-4
+    o.start_state = [Complex(strands=[substrate], structure="." * 26), Complex(strands=[invader], structure="." * 26)]
+    o.stop_conditions = [StopCondition(Literals.success, [(duplex, Literals.loose_macrostate, 4)])]
+    o.initial_seed = 1777
+    o.verbosity = 0
+
+    return o
+
+
+def run(case, substrate, dangle, method, num_simulations, specialized=True):
+
+    if case == "hybridization":
+        o = hybridization(num_simulations)
+    else:
+        o = setup(Literals.first_passage_time, num_simulations)
+
+    o.substrate_type = substrate
+    o.dangles = dangle
+    o.specialized_model = specialized
+
+    if method == Literals.arrhenius:
+        o.DNA23Arrhenius()
+    else:
+        o.rate_method = method
+
+    begin = time.time()
+    SimSystem(o).start()
+    elapsed = time.time() - begin
+
+    return [(r.seed, r.tag, repr(r.time)) for r in o.interface.results], elapsed
+
+
+class EnergyVariantsTestCase(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+
+        cls.outcome = {}
+        cls.generic = {}
+
+        for case in ["branch migration", "hybridization"]:
+            for sname, substrate in substrates:
+                for dname, dangle in dangles:
+                    for mname, method in methods:
+                        cls.outcome[(case, sname, dname, mname)] = run(case, substrate, dangle, method, num_simulations)
+                        cls.generic[(case, sname, dname, mname)] = run(case, substrate, dangle, method, num_simulations, False)
+
+    def test_complete(self):
+
+        for key, (results, _) in self.outcome.items():
+            self.assertEqual(len(results), num_simulations, " ".join(key))
+
+    def test_same_as_generic(self):
+
+        differ = [" ".join(key) for key in sorted(self.outcome) if self.outcome[key][0] != self.generic[key][0]]
+
+        self.assertEqual(differ, [], "the specialized model differs from the generic one")
+
+    # the dangles setting changes the multiloop and open loop energies.
+    def test_energies_same_as_generic(self):
+
+        random.seed(11)
+
+        states = [random_complex(i, 1 + i % 2) for i in range(100)]
+        differ = []
+
+        for sname, substrate in substrates:
+            for dname, dangle in dangles:
+                for energy_type in range(4):
+
+                    values = []
+
+                    for specialized in [True, False]:
+                        o = Options(substrate_type=substrate, dangles=dangle)
+                        o.specialized_model = specialized
+                        values.append(energy(states, o, energy_type))
+
+                    if values[0] != values[1]:
+                        differ.append("{0} dangles {1} energy type {2}".format(sname, dname, energy_type))
+
+        self.assertEqual(differ, [], "the specialized model differs from the generic one")
+
+    def test_same_as_earlier(self):
+
+        if compare is None:
+            self.skipTest("no earlier output to compare with")
+
+        earlier = eval(open(compare).read())
+        differ = [" ".join(key) for key in sorted(self.outcome) if key in earlier and self.outcome[key][0] != earlier[key][0]]
+
+        self.assertEqual(differ, [], "other results than in " + compare)
+
+
+def print_times(outcome):
+
+    earlier = eval(open(compare).read()) if compare else None
+    total = [0.0, 0.0]
+
+    for key in sorted(outcome):
+
+        results, elapsed = outcome[key]
+        line = "{0:<17} {1} dangles {2:<5} {3:<11} {4:8.3f} s".format(key[0], key[1], key[2], key[3], elapsed)
+
+        if earlier is not None and key in earlier:
+            before = earlier[key][1]
+            total[0] += before
+            total[1] += elapsed
+            line += "   {0:+7.1f} %".format(100.0 * (elapsed / before - 1.0))
+
+        print(line)
+
+    if earlier is not None:
+        print("\ntotal {0:8.3f} s, was {1:8.3f} s: {2:+.1f} %".format(total[1], total[0], 100.0 * (total[1] / total[0] - 1.0)))
+
+
+if __name__ == '__main__':
+
+    args = sys.argv[1:]
+
+    if len(args) > 1 and args[0] in ["--save", "--compare"]:
+        save, compare = (args[1], None) if args[0] == "--save" else (None, args[1])
+        args = args[2:]
+    if len(args) > 0:
+        num_simulations = int(args[0])
+
+    program = unittest.main(argv=sys.argv[:1], verbosity=2, exit=False)
+
+    if hasattr(EnergyVariantsTestCase, "outcome"):
+
+        print_times(EnergyVariantsTestCase.outcome)
+
+        if save:
+            with open(save, "w") as f:
+                f.write(repr(EnergyVariantsTestCase.outcome))
+
+    sys.exit(not program.result.wasSuccessful())
@@ -0,0 +1,86 @@
+from multistrand.objects import Complex, Domain, Strand
+from multistrand.options import Options, Literals
+from multistrand.system import SimSystem
+
+import subprocess
+import json
+import sys
+import os
+
+""" Times the move generation of every loop type and the loop energy kernels with
+    the exp and log of the C library (#MathKernels=libm) and with the tabulated
+    kernels (tabulated), with multistrand-bench (make multistrand-bench), and prints
+    the median time of an operation for both. A branch migration run with
+    Literals.kernels_validate then reports how far the tables are from the C library,
+    for the Metropolis and Kawasaki rate methods.
+
+    usage: python kernel_benchmark.py [executable, default ../multistrand-bench] [repeats, default 7]
+"""
+
+FILTERS = ["moves/", "energy/"]  # the benchmarks of the kernels, see benchmarkmain.cc
+
+
+def bench(executable, kernels, repeats):
+
+    times = {}
+
+    for text in FILTERS:
+
+        output = subprocess.check_output([executable, "--kernels", kernels, "--filter", text, "--repeats", str(repeats)])
+
+        for b in json.loads(output.decode())["benchmarks"]:
+            times[b["name"]] = b["median_ns"]
+
+    return times
+
+
+def branch_migration():
+
+    toehold = Domain(name="toehold", sequence="GTGGGT")
+    bm = Domain(name="bm", sequence="ACCGCACGTCACTCACCTCG")
+
+    substrate = toehold + bm
+    incumbent = Strand(name="incumbent", domains=[bm.C])
+    incoming = substrate.C
+
+    return [Complex(strands=[substrate, incumbent, incoming],
+                    structure="((((((((((((((((((((((((((+))))))))))))))))))))+....................))))))")]
+
+
+def validate(rate_method):
+
+    o = Options(simulation_mode=Literals.first_passage_time, num_simulations=1, temperature=25.0)
+    o.DNA23Metropolis()
+    o.rate_method = rate_method
+    o.simulation_time = 5e-2
+    o.start_state = branch_migration()
+    o.initial_seed = 1777
+    o.math_kernels = Literals.kernels_validate
+
+    s = SimSystem(o)
+    s.start()
+
+    return s.kernelStats()
+
+
+if __name__ == '__main__':
+
+    executable = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "multistrand-bench")
+    repeats = 7
+
+    if len(sys.argv) > 1:
+        executable = sys.argv[1]
+    if len(sys.argv) > 2:
+        repeats = int(sys.argv[2])
+
+    libm = bench(executable, "libm", repeats)
+    tables = bench(executable, "tabulated", repeats)
+
+    for name in sorted(libm):
+        print("{0:<40} libm = {1:10.1f} ns   tables = {2:10.1f} ns   {3:+7.1f} %".format(name, libm[name], tables[name],
+                                                                                           100.0 * (tables[name] / libm[name] - 1.0)))
+
+    print("")
+
+    for rate_method, method in [(Literals.metropolis, "metropolis"), (Literals.kawasaki, "kawasaki")]:
+        print("branch migration {0:<11} validate {1}".format(method, validate(rate_method)))
@@ -0,0 +1,99 @@
+import subprocess
+import unittest
+import json
+import sys
+
+""" Runs multistrand-bench (make multistrand-bench) twice on the same seed and once
+    on another, and checks that every benchmark ran, and that the checksums depend
+    on the seed alone; fails if not. The median time of every benchmark is printed
+    after the tests. Given the JSON output of an earlier build, it also prints how
+    the median times changed since.
+
+    usage: python microbenchmark_check.py [executable, default ../multistrand-bench] [earlier results]
+"""
+
+names = ["energy/HairpinEnergy", "energy/InteriorEnergy", "energy/MultiloopEnergy", "energy/OpenloopEnergy",
+         "moves/StackLoop::generateMoves", "moves/HairpinLoop::generateMoves", "moves/BulgeLoop::generateMoves",
+         "moves/InteriorLoop::generateMoves", "moves/MultiLoop::generateMoves", "moves/OpenLoop::generateMoves",
+         "moves/Loop::performDeleteMove", "moves/StrandComplex::performComplexJoin", "steps/SComplexList::doBasicChoice",
+         "steps/SComplexList::doBasicChoice (hybridization)", "startup/NupackEnergyModel (parsed)", "startup/NupackEnergyModel (cached)",
+         "startup/NupackEnergyModel (mapped)"]
+
+executable = "../multistrand-bench"
+earlier = None  # the path of the earlier results
+
+
+def run(executable, seed, scale="0.1", repeats="3"):
+
+    output = subprocess.check_output([executable, "--seed", str(seed), "--scale", scale, "--repeats", repeats])
+    return json.loads(output)
+
+
+def byName(results):
+
+    return dict((b["name"], b) for b in results["benchmarks"])
+
+
+class MicrobenchmarkTestCase(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+
+        cls.first = byName(run(executable, 1))
+        cls.again = byName(run(executable, 1))
+        cls.other = byName(run(executable, 2))
+
+    def test_complete(self):
+        self.assertEqual(sorted(self.first.keys()), sorted(names))
+
+    def test_times_ordered(self):
+
+        for name, b in self.first.items():
+            self.assertTrue(0 < b["min_ns"] <= b["median_ns"] <= b["max_ns"], name)
+
+    def test_same_checksums_for_a_seed(self):
+
+        for name in self.first:
+            self.assertEqual(self.first[name]["checksum"], self.again[name]["checksum"], name)
+
+    def test_other_checksums_for_another_seed(self):
+
+        for name in self.first:
+            self.assertNotEqual(self.first[name]["checksum"], self.other[name]["checksum"], name)
+
+
+def print_times():
+
+    first = MicrobenchmarkTestCase.first
+
+    for name in names:
+        if name in first:
+            print("{0:<45} {1:12.1f} ns".format(name, first[name]["median_ns"]))
+
+    if earlier is not None:
+
+        before = byName(json.load(open(earlier)))
+        current = byName(run(executable, 1, "1", "7"))
+
+        print("\nchange of the median time since " + earlier)
+
+        for name in names:
+            if name in before and name in current:
+                ratio = current[name]["median_ns"] / before[name]["median_ns"]
+                same = "" if current[name]["checksum"] == before[name]["checksum"] else "   (other checksum)"
+                print("{0:<45} {1:+7.1f} %{2}".format(name, 100.0 * (ratio - 1.0), same))
+
+
+if __name__ == '__main__':
+
+    if len(sys.argv) > 1:
+        executable = sys.argv[1]
+    if len(sys.argv) > 2:
+        earlier = sys.argv[2]
+
+    program = unittest.main(argv=sys.argv[:1], verbosity=2, exit=False)
+
+    if hasattr(MicrobenchmarkTestCase, "first"):
+        print_times()
+
+    sys.exit(not program.result.wasSuccessful())
@@ -0,0 +1,103 @@
+from multistrand.objects import Complex, Domain, Strand, StopCondition
+from multistrand.options import Options, Literals
+from multistrand.system import SimSystem
+
+import unittest
+import time
+import sys
+
+""" Checks that SimSystem.startParallel gives the same results, in the same order,
+    as SimSystem.start, for the first step and first passage time modes, and fails
+    if they differ. The strand ids of the end states differ between runs, as each
+    run makes its own strands, so those are left out of the comparison. The time
+    taken by both is printed after the tests.
+
+    usage: python parallel_check.py [trajectories, default 200] [threads, default 0: one per core]
+"""
+
+num_simulations = 200
+threads = 0
+
+times = []  # printed after the tests
+
+
+def setup(mode, num_simulations):
+
+    toehold = Domain(name="toehold", sequence="GTGGGT")
+    bm = Domain(name="bm", sequence="ACCGCACGTCACTCACCTCG")
+
+    substrate = toehold + bm
+    incumbent = Strand(name="incumbent", domains=[bm.C])
+    incoming = substrate.C
+
+    start = Complex(strands=[substrate, incumbent], structure="......((((((((((((((((((((+))))))))))))))))))))")
+    invader = Complex(strands=[incoming], structure="." * 26)
+
+    released = Complex(strands=[incumbent], structure="." * 20)
+    failed = Complex(strands=[substrate, incumbent], structure="......((((((((((((((((((((+))))))))))))))))))))")
+
+    o = Options(simulation_mode=mode, num_simulations=num_simulations, temperature=25.0)
+    o.DNA23Metropolis()
+    o.simulation_time = 1e-2 if mode == Literals.first_step else 1e-4
+    o.start_state = [start, invader]
+    o.stop_conditions = [StopCondition(Literals.success, [(released, Literals.dissoc_macrostate, 0)]),
+                         StopCondition(Literals.failure, [(failed, Literals.dissoc_macrostate, 0)])]
+    o.initial_seed = 1777
+    o.verbosity = 0
+
+    return o
+
+
+def run(mode, num_simulations, threads=None):
+
+    o = setup(mode, num_simulations)
+    s = SimSystem(o)
+
+    begin = time.time()
+
+    if threads is None:
+        s.start()
+    else:
+        s.startParallel(threads)
+
+    elapsed = time.time() - begin
+
+    results = [(r.seed, r.tag, r.time, getattr(r, "collision_rate", None)) for r in o.interface.results]
+    end_states = [[line[:2] + line[3:] for line in state] for state in o.interface.end_states]
+
+    return results, end_states, elapsed
+
+
+class ParallelTestCase(unittest.TestCase):
+
+    def check(self, mode, name):
+
+        serial = run(mode, num_simulations)
+        parallel = run(mode, num_simulations, threads)
+
+        times.append("{0:<20} start = {1:8.3f} s   startParallel = {2:8.3f} s".format(name, serial[2], parallel[2]))
+
+        self.assertEqual(len(serial[0]), num_simulations)
+        self.assertEqual(serial[0], parallel[0], "the results differ")
+        self.assertEqual(serial[1], parallel[1], "the end states differ")
+
+    def test_first_step(self):
+        self.check(Literals.first_step, "first step")
+
+    def test_first_passage_time(self):
+        self.check(Literals.first_passage_time, "first passage time")
+
+
+if __name__ == '__main__':
+
+    if len(sys.argv) > 1:
+        num_simulations = int(sys.argv[1])
+    if len(sys.argv) > 2:
+        threads = int(sys.argv[2])
+
+    program = unittest.main(argv=sys.argv[:1], verbosity=2, exit=False)
+
+    for line in times:
+        print(line)
+
+    sys.exit(not program.result.wasSuccessful())
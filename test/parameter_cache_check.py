@@ -0,0 +1,146 @@
+from multistrand.options import Literals
+from multistrand.system import SimSystem
+
+from parallel_check import setup
+
+import subprocess
+import unittest
+import tempfile
+import shutil
+import time
+import sys
+import os
+
+""" Checks that the energy parameters cached in Options.parameter_cache give the
+    same results as the parameter files, in new processes that map the cache file
+    and when the file is damaged, and that multistrandRun.log is only written with
+    Options.log_constants; fails if not. Then prints the time taken to make a
+    SimSystem when the parameter files are read and when the cached parameters are
+    used.
+
+    usage: python parameter_cache_check.py [trajectories, default 100]
+"""
+
+num_simulations = 100
+
+
+def run(num_simulations, directory="", temperature=25.0, log=False):
+
+    o = setup(Literals.first_passage_time, num_simulations)
+    o.temperature = temperature
+    o.parameter_cache = directory
+    o.log_constants = log
+
+    SimSystem(o).start()
+
+    return [(r.seed, r.tag, r.time) for r in o.interface.results]
+
+
+# in a new process, in the given directory
+def child(num_simulations, directory, temperature=25.0, log=False, cwd=None):
+
+    here = os.path.dirname(os.path.abspath(__file__))
+    output = subprocess.check_output([sys.executable, os.path.join(here, "parameter_cache_check.py"), "--child", str(num_simulations), directory,
+                                      repr(temperature), str(log)], cwd=cwd, stderr=open(os.devnull, "w"))
+
+    return eval(output.strip().split("\n")[-1])
+
+
+def files(directory):
+
+    return sorted(f for f in os.listdir(directory) if f.endswith(".param"))
+
+
+def startup(count, directory=""):
+
+    o = setup(Literals.first_passage_time, 1)
+    o.parameter_cache = directory
+
+    begin = time.time()
+
+    for i in range(count):
+        SimSystem(o)
+
+    return (time.time() - begin) / count
+
+
+class ParameterCacheTestCase(unittest.TestCase):
+
+    def setUp(self):
+        self.directory = tempfile.mkdtemp()
+
+    def tearDown(self):
+        shutil.rmtree(self.directory)
+
+    def test_cache_file(self):
+        """ written, mapped, rebuilt when damaged, and extended for another temperature """
+
+        directory = self.directory
+        expected = run(num_simulations)
+
+        # the tables at 25 C, and before they are scaled.
+        self.assertEqual(child(num_simulations, directory), expected, "written")
+        self.assertEqual(len(files(directory)), 2)
+        self.assertEqual(child(num_simulations, directory), expected, "mapped")
+
+        for name in files(directory):
+            with open(os.path.join(directory, name), "r+b") as f:
+                f.seek(4096)
+                f.write(b"\xff" * 256)
+
+        self.assertEqual(child(num_simulations, directory), expected, "damaged")
+        self.assertEqual(child(num_simulations, directory), expected, "rebuilt")
+
+        self.assertEqual(child(num_simulations, directory, 37.0), run(num_simulations, temperature=37.0), "other temperature")
+        self.assertEqual(len(files(directory)), 3)
+
+    def test_log_constants(self):
+        """ multistrandRun.log only with log_constants """
+
+        directory = self.directory
+        log = os.path.join(directory, "multistrandRun.log")
+
+        child(1, directory, cwd=directory)
+        self.assertFalse(os.path.exists(log))
+
+        child(1, directory, log=True, cwd=directory)
+        self.assertTrue(os.path.exists(log))
+
+
+def print_times(first, later):
+
+    def process(directory):
+        begin = time.time()
+        child(1, directory)
+        return time.time() - begin
+
+    directory = tempfile.mkdtemp()
+
+    try:
+        parsed = min(process("") for i in range(5))
+        cached = min(process(directory) for i in range(5))
+    finally:
+        shutil.rmtree(directory)
+
+    print("SimSystem, parameter files read = {0:8.2f} ms   parameters of this process = {1:8.2f} ms".format(1000 * first, 1000 * later))
+    print("new process (fastest of 5), parameter files read = {0:8.3f} s   parameter cache file = {1:8.3f} s".format(parsed, cached))
+
+
+if __name__ == '__main__':
+
+    if len(sys.argv) > 1 and sys.argv[1] == "--child":
+        print(repr(run(int(sys.argv[2]), sys.argv[3], float(sys.argv[4]), sys.argv[5] == "True")))
+        sys.exit(0)
+
+    if len(sys.argv) > 1:
+        num_simulations = int(sys.argv[1])
+
+    # the first SimSystem of this process reads the parameter files.
+    first = startup(1)
+    later = startup(20)
+
+    program = unittest.main(argv=sys.argv[:1], verbosity=2, exit=False)
+
+    print_times(first, later)
+
+    sys.exit(not program.result.wasSuccessful())
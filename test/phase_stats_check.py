@@ -0,0 +1,128 @@
+from multistrand.options import Literals
+from multistrand.system import SimSystem
+
+from parallel_check import setup
+
+import unittest
+import json
+import time
+import sys
+
+""" Checks that a run with Options.phase_stats gives the same results as one without,
+    that the counts it returns add up, and that the trace of Options.phase_trace is
+    valid JSON with an event per trajectory, for SimSystem.start and startParallel;
+    fails if not. The time spent per phase, and the time taken with and without the
+    statistics, are printed after the tests.
+
+    usage: python phase_stats_check.py [trajectories, default 200] [threads, default 2]
+"""
+
+trace = "phase_stats_check.json"
+
+num_simulations = 200
+threads = 2
+
+
+def run(num_simulations, stats=False, threads=None):
+
+    o = setup(Literals.first_passage_time, num_simulations)
+    o.phase_stats = stats
+    if stats:
+        o.phase_trace = trace
+
+    s = SimSystem(o)
+
+    begin = time.time()
+
+    if threads is None:
+        s.start()
+    else:
+        s.startParallel(threads)
+
+    elapsed = time.time() - begin
+
+    results = [(r.seed, r.tag, r.time) for r in o.interface.results]
+    events = json.load(open(trace))["traceEvents"] if stats else None
+
+    return results, s.phaseStats(), elapsed, events
+
+
+class PhaseStatsTestCase(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+
+        cls.plain = run(num_simulations)
+        cls.counted = run(num_simulations, True)
+        cls.parallel = run(num_simulations, True, threads)
+
+    # the trajectories of the workers overlap, so their time adds up to more than the run.
+    # Every move generated is rated with at least one loop energy.
+    def checkCounts(self, stats, threads=1):
+
+        phases = stats["phases"]
+
+        self.assertEqual(stats["trajectories"], num_simulations)
+        self.assertGreater(stats["steps"], 0)
+        self.assertGreater(stats["moves_generated"], 0)
+        self.assertGreaterEqual(stats["energy_evaluations"], stats["moves_generated"])
+        self.assertLessEqual(phases["do_choice"]["calls"] + phases["join"]["calls"], stats["steps"])
+        self.assertGreater(phases["generate_moves"]["calls"], 0)
+        self.assertGreater(phases["trajectory"]["seconds"], 0)
+        self.assertLessEqual(phases["trajectory"]["seconds"], 1.01 * threads * stats["seconds"])
+
+    def checkTrace(self, events):
+
+        trajectories = [e for e in events if e["ph"] == "X" and e["name"] == "trajectory"]
+
+        self.assertEqual(len(trajectories), num_simulations)
+        self.assertTrue(all(e["dur"] >= 0 for e in events if e["ph"] == "X"))
+
+    def test_start(self):
+
+        results, stats, _, events = self.counted
+
+        self.assertEqual(results, self.plain[0])
+        self.checkCounts(stats)
+        self.checkTrace(events)
+
+    def test_off_without_phase_stats(self):
+        self.assertEqual(self.plain[1]["steps"], 0)
+
+    def test_start_parallel(self):
+
+        results, stats, _, events = self.parallel
+
+        self.assertEqual(results, self.plain[0])
+        self.checkCounts(stats, threads)
+        self.checkTrace(events)
+        self.assertEqual(stats["steps"], self.counted[1]["steps"])
+
+
+def print_times():
+
+    stats = PhaseStatsTestCase.counted[1]
+
+    print("{0} steps, {1} moves generated, {2} energy evaluations in {3:.3f} s".format(stats["steps"], stats["moves_generated"],
+                                                                                      stats["energy_evaluations"], stats["seconds"]))
+
+    for name, phase in sorted(stats["phases"].items(), key=lambda item: -item[1]["seconds"]):
+        print("{0:<20} {1:12d} calls {2:10.4f} s".format(name, phase["calls"], phase["seconds"]))
+
+    print("\nwithout phase_stats = {0:8.3f} s   with phase_stats and trace = {1:8.3f} s".format(PhaseStatsTestCase.plain[2],
+                                                                                               PhaseStatsTestCase.counted[2]))
+
+
+if __name__ == '__main__':
+
+    if len(sys.argv) > 1:
+        num_simulations = int(sys.argv[1])
+    if len(sys.argv) > 2:
+        threads = int(sys.argv[2])
+
+    program = unittest.main(argv=sys.argv[:1], verbosity=2, exit=False)
+
+    if hasattr(PhaseStatsTestCase, "counted"):
+        print_times()
+
+    sys.exit(not program.result.wasSuccessful())
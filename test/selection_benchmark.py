@@ -0,0 +1,91 @@
+from multistrand.objects import Complex, Domain, Strand
+from multistrand.options import Options, Literals
+from multistrand.system import SimSystem
+from multistrand.utils import generate_sequence
+
+import random
+import time
+import sys
+
+""" Compares the number of simulated steps per second for the two selection engines
+    (Literals.selection_linear and Literals.selection_sumtree) on a hairpin,
+    a three-way branch migration and a long single strand.
+
+    usage: python selection_benchmark.py [strand length, default 1000]
+"""
+
+OUTPUT_INTERVAL = 1000  # a state is recorded every 1000 steps
+
+
+def hairpin():
+
+    d = Domain(name="stem", sequence="GCGCAAAAAGCGCTTTTTCGATCG")
+    s = Strand(domains=[d])
+
+    return [Complex(strands=[s], structure="." * 24)], 0.5
+
+
+def branch_migration():
+
+    toehold = Domain(name="toehold", sequence="GTGGGT")
+    bm = Domain(name="bm", sequence="ACCGCACGTCACTCACCTCG")
+
+    substrate = toehold + bm
+    incumbent = Strand(name="incumbent", domains=[bm.C])
+    incoming = substrate.C
+
+    # incoming strand bound by the toehold, incumbent bound along the branch migration domain
+    start = Complex(strands=[substrate, incumbent, incoming],
+                    structure="((((((((((((((((((((((((((+))))))))))))))))))))+....................))))))")
+
+    return [start], 5e-2
+
+
+def long_strand(length):
+
+    random.seed(11)
+    s = Strand(name="long", sequence=generate_sequence(length))
+
+    return [Complex(strands=[s], structure="." * length)], 4e-4
+
+
+def steps_per_second(start_state, sim_time, engine):
+
+    o = Options(simulation_mode=Literals.trajectory, num_simulations=1, temperature=25.0)
+    o.DNA23Metropolis()
+    o.simulation_time = sim_time
+    o.output_interval = OUTPUT_INTERVAL
+    o.start_state = start_state
+    o.initial_seed = 1777
+    o.selection_engine = engine
+
+    begin = time.time()
+    s = SimSystem(o)
+    s.start()
+    elapsed = time.time() - begin
+
+    steps = len(o.full_trajectory) * OUTPUT_INTERVAL
+
+    return steps, elapsed
+
+
+def benchmark(name, setup):
+
+    start_state, sim_time = setup
+
+    for engine, desc in [(Literals.selection_linear, "linear"), (Literals.selection_sumtree, "sumtree")]:
+
+        steps, elapsed = steps_per_second(start_state, sim_time, engine)
+        print("{0:<20} {1:<8} steps = {2:<10} time = {3:8.3f} s   steps/sec = {4:12.0f}".format(name, desc, steps, elapsed, steps / elapsed))
+
+
+if __name__ == '__main__':
+
+    length = 1000
+
+    if len(sys.argv) > 1:
+        length = int(sys.argv[1])
+
+    benchmark("hairpin", hairpin())
+    benchmark("branch migration", branch_migration())
+    benchmark("single strand " + str(length), long_strand(length))
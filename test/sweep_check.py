@@ -0,0 +1,162 @@
+from multistrand.options import Literals
+from multistrand.system import SimSystem, run_sweep
+
+from parallel_check import setup
+
+import subprocess
+import unittest
+import json
+import time
+import sys
+import os
+
+""" Checks that multistrand.system.run_sweep gives every Options object of a sweep
+    over temperature, salt and rate scalings the results of SimSystem.startParallel,
+    also for a condition run on its own in a new process, where the parameter files
+    are read for it, that each condition counts its phases as its own options ask,
+    and that it rejects what it cannot run; fails if not. Then
+    prints the time taken by a sweep of 50 conditions and by SimSystem(o).startParallel
+    for each.
+
+    usage: python sweep_check.py [trajectories per condition, default 20] [threads, default 0: one per core]
+"""
+
+num_simulations = 20
+threads = 0
+
+
+def condition(index, num_simulations):
+
+    o = setup(Literals.first_passage_time, num_simulations)
+
+    o.temperature = 20.0 + (index % 5) * 5.0
+    o.sodium = [1.0, 0.5, 0.1][index % 3]
+    o.magnesium = [0.0, 0.0125][index % 2]
+    o.bimolecular_scaling *= [1.0, 2.0][(index // 2) % 2]
+    o.unimolecular_scaling *= [1.0, 0.5, 3.0][(index // 3) % 3]
+
+    return o
+
+
+def results(o):
+
+    return [(r.seed, r.tag, r.time) for r in o.interface.results]
+
+
+def separate(count, num_simulations, threads):
+
+    conditions = [condition(i, num_simulations) for i in range(count)]
+
+    begin = time.time()
+
+    for o in conditions:
+        SimSystem(o).startParallel(threads)
+
+    return [results(o) for o in conditions], time.time() - begin
+
+
+def sweep(count, num_simulations, threads):
+
+    conditions = [condition(i, num_simulations) for i in range(count)]
+
+    begin = time.time()
+    run_sweep(conditions, threads)
+
+    return [results(o) for o in conditions], time.time() - begin
+
+
+# condition index alone, in a new process
+def child(index, num_simulations):
+
+    here = os.path.dirname(os.path.abspath(__file__))
+    output = subprocess.check_output([sys.executable, os.path.join(here, "sweep_check.py"), "--child", str(index), str(num_simulations)],
+                                     stderr=open(os.devnull, "w"))
+
+    return eval(output.strip().split("\n")[-1])
+
+
+class SweepTestCase(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+
+        cls.expected = separate(12, num_simulations, threads)[0]
+        cls.swept = sweep(12, num_simulations, threads)[0]
+
+    def test_same_results(self):
+        self.assertEqual(self.swept, self.expected)
+
+    def test_in_a_new_process(self):
+
+        for i in [7, 11]:
+            self.assertEqual(child(i, num_simulations), self.expected[i], "condition {0}".format(i))
+
+    def test_conditions_differ(self):
+        self.assertEqual(len(set(repr(r) for r in self.expected)), len(self.expected))
+
+    # conditions 0 and 3 write a phase trace each, of their own trajectories only;
+    # condition 1 does not count its phases, condition 2 does without a trace.
+    def test_phase_stats_per_condition(self):
+
+        traces = {0: "sweep_check_0.json", 3: "sweep_check_3.json"}
+        counts = [num_simulations, num_simulations, num_simulations, 5]
+        conditions = [condition(i, counts[i]) for i in range(4)]
+
+        for i, path in traces.items():
+            conditions[i].phase_trace = path
+        conditions[2].phase_stats = True
+
+        try:
+            run_sweep(conditions, threads)
+
+            self.assertEqual([results(o) for o in conditions[:3]], self.expected[:3])
+
+            for i, path in traces.items():
+
+                events = json.load(open(path))["traceEvents"]
+                trajectories = [e for e in events if e["ph"] == "X" and e["name"] == "trajectory"]
+
+                self.assertEqual(len(trajectories), counts[i], "condition {0}".format(i))
+        finally:
+            for path in traces.values():
+                if os.path.exists(path):
+                    os.remove(path)
+
+    def test_not_options(self):
+        self.assertRaises(TypeError, run_sweep, [condition(0, 1), 3])
+
+    def test_not_parallel(self):
+
+        o = condition(0, 1)
+        o.output_interval = 1
+
+        self.assertRaises(ValueError, run_sweep, [condition(0, 1), o])
+
+
+def print_times():
+
+    def fastest(run):
+        return min(run(50, num_simulations, threads)[1] for i in range(3))
+
+    print("50 conditions x {0} trajectories: startParallel per condition = {1:8.3f} s   run_sweep = {2:8.3f} s".format(
+        num_simulations, fastest(separate), fastest(sweep)))
+
+
+if __name__ == '__main__':
+
+    if len(sys.argv) > 1 and sys.argv[1] == "--child":
+        o = condition(int(sys.argv[2]), int(sys.argv[3]))
+        SimSystem(o).startParallel()
+        print(repr(results(o)))
+        sys.exit(0)
+
+    if len(sys.argv) > 1:
+        num_simulations = int(sys.argv[1])
+    if len(sys.argv) > 2:
+        threads = int(sys.argv[2])
+
+    program = unittest.main(argv=sys.argv[:1], verbosity=2, exit=False)
+
+    print_times()
+
+    sys.exit(not program.result.wasSuccessful())
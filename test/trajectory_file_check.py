@@ -0,0 +1,182 @@
+from multistrand.objects import Complex, Domain, Strand
+from multistrand.options import Options, Literals
+from multistrand.system import SimSystem
+from multistrand.utils import readTrajectoryFile, trajectoryState
+
+import unittest
+import time
+import sys
+import os
+
+""" Checks that the states written with Options.trajectory_file set are the states
+    sent to Python otherwise, with every state a keyframe and delta-encoded between
+    keyframes (Options.trajectory_keyframes); that a path written again after a read
+    gives the new states; and that a strand index not in the strand table is
+    rejected. Fails if any of these does not hold. The time taken and the size of
+    the structure files are printed after the tests.
+
+    usage: python trajectory_file_check.py [simulation time, default 1e-3] [file, default trajectory.bin] [keyframe interval, default 100]
+"""
+
+simulation_time = 1e-3
+path = "trajectory.bin"
+keyframes = 100
+
+times = []  # printed after the tests
+
+
+def start_state():
+
+    toehold = Domain(name="toehold", sequence="GTGGGT")
+    bm = Domain(name="bm", sequence="ACCGCACGTCACTCACCTCG")
+
+    substrate = toehold + bm
+    incumbent = Strand(name="incumbent", domains=[bm.C])
+
+    start = Complex(strands=[substrate, incumbent], structure="......((((((((((((((((((((+))))))))))))))))))))")
+    invader = Complex(strands=[substrate.C], structure="." * 26)
+
+    return [start, invader]
+
+
+def setup(simulation_time, path, start, keyframes=0):
+
+    o = Options(simulation_mode=Literals.trajectory, num_simulations=3, temperature=25.0)
+    o.DNA23Metropolis()
+    o.simulation_time = simulation_time
+    o.start_state = start
+    o.output_interval = 1
+    o.initial_seed = 1777
+    o.verbosity = 0
+    o.trajectory_file = path
+    o.trajectory_keyframes = keyframes
+
+    return o
+
+
+def run(simulation_time, path, start, keyframes=0):
+
+    o = setup(simulation_time, path, start, keyframes)
+
+    begin = time.time()
+    SimSystem(o).start()
+
+    return o, time.time() - begin
+
+
+# the strand names and structure of each complex of state k, as sent to Python and as
+# read from the file.
+def expected_state(python, k):
+
+    # names are "unique id:name", and the unique ids differ between the runs.
+    return [([name.split(":")[1] for name in c[2].split(",")], c[4]) for c in python.full_trajectory[k]]
+
+
+def found_state(strands, path, k):
+
+    return [([strands[i][0] for i in indexes], structure) for indexes, structure in trajectoryState(path, k)]
+
+
+# reads state 5, then writes another run, of other strands, to the same path: state 6
+# must be the state of the new run.
+def rewritten(simulation_time, path, keyframes):
+
+    run(simulation_time, path, start_state(), keyframes)
+    trajectoryState(path, 5)
+
+    other = [start_state()[1]]
+    python, _ = run(simulation_time, "", other)
+    run(simulation_time, path, other, keyframes)
+
+    return expected_state(python, 6), found_state(readTrajectoryFile(path)[0], path, 6)
+
+
+# changes the first strand index of a record to one that is not in the strand table,
+# which is how a strand that is not in it is written (there are fewer than 9).
+def unknown_strand(path, index):
+
+    strands, records, structures = readTrajectoryFile(path)
+    offset = int(records[index]['offset'])
+    line = structures[offset:offset + int(records[index]['length'])].tostring()
+    del records, structures
+
+    first = 0 if line[0].isdigit() else 1 # a change starts with its type
+
+    with open(path + ".structures", "r+b") as f:
+        f.seek(offset + first)
+        f.write("9")
+
+
+class TrajectoryFileTestCase(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+
+        # the same strands for every run, so that the names agree.
+        cls.start = start_state()
+        cls.python, python_time = run(simulation_time, "", cls.start)
+
+        times.append("python            {0:8.3f} s".format(python_time))
+
+    def check(self, interval):
+
+        written, file_time = run(simulation_time, path, self.start, interval)
+        strands, records, structures = readTrajectoryFile(path)
+
+        times.append("keyframes = {0:<5} {1:8.3f} s   states = {2}   structures = {3} bytes".format(interval, file_time, len(records),
+                                                                                                   os.path.getsize(path + ".structures")))
+
+        python = self.python
+        self.assertEqual(len(records), len(python.full_trajectory))
+
+        for k in range(len(records)):
+
+            record = records[k]
+            state = python.full_trajectory[k]
+
+            self.assertEqual(expected_state(python, k), found_state(strands, path, k), "state {0}".format(k))
+            self.assertEqual(record['time'], python.full_trajectory_times[k], "the time of state {0}".format(k))
+            self.assertEqual(record['arr_type'], python.full_trajectory_arrType[k], "the arrType of state {0}".format(k))
+            self.assertAlmostEqual(record['energy'], sum(c[5] for c in state), 9, "the energy of state {0}".format(k))
+
+    def test_keyframes(self):
+        """ every state a keyframe """
+        self.check(0)
+
+    def test_deltas(self):
+        """ delta-encoded between keyframes """
+        self.check(keyframes)
+
+    def test_rewritten(self):
+        """ the path rewritten after a read gives the new states """
+
+        expected, found = rewritten(simulation_time, path, keyframes)
+        self.assertEqual(expected, found)
+
+    def test_unknown_strand(self):
+        """ a strand index not in the strand table is rejected """
+
+        # a keyframe, and a change to the state before
+        for index in [0, 1]:
+
+            run(simulation_time, path, self.start, keyframes)
+            unknown_strand(path, index)
+
+            self.assertRaises(ValueError, trajectoryState, path, index)
+
+
+if __name__ == '__main__':
+
+    if len(sys.argv) > 1:
+        simulation_time = float(sys.argv[1])
+    if len(sys.argv) > 2:
+        path = sys.argv[2]
+    if len(sys.argv) > 3:
+        keyframes = int(sys.argv[3])
+
+    program = unittest.main(argv=sys.argv[:1], verbosity=2, exit=False)
+
+    for line in times:
+        print(line)
+
+    sys.exit(not program.result.wasSuccessful())